@@ -0,0 +1,273 @@
+#include "id_token_verifier.h"
+
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/param_build.h>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "../protocol/json_reader.h"
+
+namespace auth {
+namespace {
+
+int64_t NowSeconds() {
+  return static_cast<int64_t>(std::time(nullptr));
+}
+
+int Base64UrlValue(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '-') return 62;
+  if (c == '_') return 63;
+  return -1;
+}
+
+// Unpadded base64url; trailing '=' is tolerated.
+bool Base64UrlDecode(std::string_view in, std::string& out) {
+  while (!in.empty() && in.back() == '=') in.remove_suffix(1);
+  if (in.size() % 4 == 1) return false;
+  out.clear();
+  out.reserve(in.size() * 3 / 4);
+  uint32_t acc = 0;
+  int bits = 0;
+  for (const char c : in) {
+    const int v = Base64UrlValue(c);
+    if (v < 0) return false;
+    acc = (acc << 6) | static_cast<uint32_t>(v);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back(static_cast<char>((acc >> bits) & 0xFF));
+    }
+  }
+  return true;
+}
+
+// Calls fn(object_span) for each top-level object in a raw JSON array span.
+template <typename Fn>
+void ForEachArrayObject(std::string_view array, Fn&& fn) {
+  int depth = 0;
+  bool in_string = false;
+  size_t start = 0;
+  for (size_t i = 0; i < array.size(); ++i) {
+    const char c = array[i];
+    if (in_string) {
+      if (c == '\\') {
+        ++i;
+      } else if (c == '"') {
+        in_string = false;
+      }
+      continue;
+    }
+    if (c == '"') {
+      in_string = true;
+    } else if (c == '{' || c == '[') {
+      if (depth++ == 1 && c == '{') start = i;
+    } else if (c == '}' || c == ']') {
+      if (--depth == 1 && c == '}') fn(array.substr(start, i - start + 1));
+    }
+  }
+}
+
+std::shared_ptr<EVP_PKEY> RsaPublicKey(const std::string& n, const std::string& e) {
+  BIGNUM* bn_n = BN_bin2bn(reinterpret_cast<const unsigned char*>(n.data()), static_cast<int>(n.size()), nullptr);
+  BIGNUM* bn_e = BN_bin2bn(reinterpret_cast<const unsigned char*>(e.data()), static_cast<int>(e.size()), nullptr);
+  OSSL_PARAM_BLD* bld = OSSL_PARAM_BLD_new();
+  OSSL_PARAM* params = nullptr;
+  EVP_PKEY_CTX* ctx = nullptr;
+  EVP_PKEY* pkey = nullptr;
+  if (bn_n && bn_e && bld && OSSL_PARAM_BLD_push_BN(bld, OSSL_PKEY_PARAM_RSA_N, bn_n) &&
+      OSSL_PARAM_BLD_push_BN(bld, OSSL_PKEY_PARAM_RSA_E, bn_e) && (params = OSSL_PARAM_BLD_to_param(bld)) &&
+      (ctx = EVP_PKEY_CTX_new_from_name(nullptr, "RSA", nullptr)) && EVP_PKEY_fromdata_init(ctx) == 1) {
+    if (EVP_PKEY_fromdata(ctx, &pkey, EVP_PKEY_PUBLIC_KEY, params) != 1) pkey = nullptr;
+  }
+  EVP_PKEY_CTX_free(ctx);
+  OSSL_PARAM_free(params);
+  OSSL_PARAM_BLD_free(bld);
+  BN_free(bn_e);
+  BN_free(bn_n);
+  if (!pkey) return nullptr;
+  return std::shared_ptr<EVP_PKEY>(pkey, EVP_PKEY_free);
+}
+
+bool VerifySha256(EVP_PKEY* key, std::string_view signing_input, const std::string& sig) {
+  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+  if (!ctx) return false;
+  const bool ok = EVP_DigestVerifyInit(ctx, nullptr, EVP_sha256(), nullptr, key) == 1 &&
+                  EVP_DigestVerify(ctx, reinterpret_cast<const unsigned char*>(sig.data()), sig.size(),
+                                   reinterpret_cast<const unsigned char*>(signing_input.data()),
+                                   signing_input.size()) == 1;
+  EVP_MD_CTX_free(ctx);
+  return ok;
+}
+
+}  // namespace
+
+std::optional<JwksDocument> FileJwksSource::Fetch() {
+  std::ifstream in(path_, std::ios::binary);
+  if (!in) return std::nullopt;
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  JwksDocument doc;
+  doc.body = ss.str();
+  return doc;
+}
+
+IdTokenVerifier::IdTokenVerifier(std::unique_ptr<JwksSource> source, Options options)
+    : source_(std::move(source)), options_(options), keys_(std::make_shared<const KeySet>()) {}
+
+IdTokenVerifier::~IdTokenVerifier() {
+  Stop();
+}
+
+void IdTokenVerifier::Start() {
+  if (refresher_.joinable()) return;
+  Refresh();
+  refresher_ = std::thread([this] { RefresherLoop(); });
+}
+
+void IdTokenVerifier::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mu_);
+    stopping_ = true;
+  }
+  wake_cv_.notify_all();
+  if (refresher_.joinable()) refresher_.join();
+}
+
+bool IdTokenVerifier::Refresh() {
+  std::lock_guard<std::mutex> refresh_lock(refresh_mu_);
+  const auto doc = source_->Fetch();
+  auto next = std::make_shared<KeySet>();
+  if (doc) {
+    const protocol::JsonFields fields(doc->body);
+    const auto* keys = fields.Find("keys");
+    if (keys && keys->type == protocol::JsonFields::Type::kArray) {
+      ForEachArrayObject(keys->value, [&](std::string_view obj) {
+        const protocol::JsonFields jwk(obj);
+        const auto kid = jwk.GetString("kid");
+        const auto n = jwk.GetStringView("n");
+        const auto e = jwk.GetStringView("e");
+        if (jwk.GetStringView("kty") != std::optional<std::string_view>("RSA") || !kid || !n || !e) return;
+        const auto alg = jwk.GetStringView("alg");
+        if (alg && *alg != "RS256") return;
+        std::string n_bytes;
+        std::string e_bytes;
+        if (!Base64UrlDecode(*n, n_bytes) || !Base64UrlDecode(*e, e_bytes)) return;
+        if (auto key = RsaPublicKey(n_bytes, e_bytes)) next->emplace(*kid, std::move(key));
+      });
+    }
+  }
+  if (next->empty()) {
+    ++refresh_failures_;
+    std::cerr << "[auth] jwks refresh failed source=" << source_->describe() << "\n";
+    return false;
+  }
+  int64_t interval = options_.refresh_seconds;
+  if (doc->max_age_seconds > 0) interval = std::min(interval, doc->max_age_seconds);
+  next_interval_seconds_.store(std::max(interval, options_.retry_seconds));
+  const size_t count = next->size();
+  {
+    std::lock_guard<std::mutex> lock(keys_mu_);
+    keys_ = std::move(next);
+  }
+  ++refreshes_;
+  last_refresh_unix_.store(NowSeconds());
+  std::cout << "[auth] jwks refreshed source=" << source_->describe() << " keys=" << count
+            << " next_in_s=" << next_interval_seconds_.load() << "\n";
+  return true;
+}
+
+void IdTokenVerifier::RefresherLoop() {
+  int64_t retry = options_.retry_seconds;
+  int64_t delay = next_interval_seconds_.load() > 0 ? next_interval_seconds_.load() : retry;
+  std::unique_lock<std::mutex> lock(wake_mu_);
+  while (!stopping_) {
+    wake_cv_.wait_for(lock, std::chrono::seconds(delay), [this] { return stopping_ || wake_requested_; });
+    if (stopping_) break;
+    const bool forced = wake_requested_;
+    wake_requested_ = false;
+    lock.unlock();
+    const bool ok = Refresh();
+    lock.lock();
+    if (forced) wake_allowed_after_unix_ = NowSeconds() + options_.retry_seconds;
+    if (ok) {
+      retry = options_.retry_seconds;
+      delay = next_interval_seconds_.load();
+    } else {
+      delay = retry;
+      retry = std::min(retry * 2, options_.refresh_seconds);
+    }
+  }
+}
+
+std::shared_ptr<const IdTokenVerifier::KeySet> IdTokenVerifier::keys() const {
+  std::lock_guard<std::mutex> lock(keys_mu_);
+  return keys_;
+}
+
+std::optional<std::string> IdTokenVerifier::Verify(std::string_view jwt) const {
+  const size_t dot1 = jwt.find('.');
+  const size_t dot2 = dot1 == std::string_view::npos ? dot1 : jwt.find('.', dot1 + 1);
+  if (dot2 == std::string_view::npos || jwt.find('.', dot2 + 1) != std::string_view::npos) {
+    ++rejected_;
+    return std::nullopt;
+  }
+  std::string header;
+  std::string sig;
+  if (!Base64UrlDecode(jwt.substr(0, dot1), header) || !Base64UrlDecode(jwt.substr(dot2 + 1), sig)) {
+    ++rejected_;
+    return std::nullopt;
+  }
+  const protocol::JsonFields head(header);
+  const auto kid = head.GetString("kid");
+  if (head.GetStringView("alg") != std::optional<std::string_view>("RS256") || !kid) {
+    ++rejected_;
+    return std::nullopt;
+  }
+  const auto snapshot = keys();
+  const auto it = snapshot->find(*kid);
+  if (it == snapshot->end()) {
+    // Likely a key rotation we have not picked up yet; nudge the refresher
+    // rather than fetching on the request path.
+    ++unknown_kid_;
+    ++rejected_;
+    {
+      std::lock_guard<std::mutex> lock(wake_mu_);
+      if (NowSeconds() >= wake_allowed_after_unix_) wake_requested_ = true;
+    }
+    wake_cv_.notify_one();
+    return std::nullopt;
+  }
+  std::string payload;
+  if (!VerifySha256(it->second.get(), jwt.substr(0, dot2), sig) ||
+      !Base64UrlDecode(jwt.substr(dot1 + 1, dot2 - dot1 - 1), payload)) {
+    ++rejected_;
+    return std::nullopt;
+  }
+  ++verified_;
+  return payload;
+}
+
+IdTokenVerifier::Stats IdTokenVerifier::stats() const {
+  Stats s;
+  s.keys = keys()->size();
+  s.refreshes = refreshes_.load();
+  s.refresh_failures = refresh_failures_.load();
+  s.last_refresh_unix = last_refresh_unix_.load();
+  s.verified = verified_.load();
+  s.rejected = rejected_.load();
+  s.unknown_kid = unknown_kid_.load();
+  return s;
+}
+
+}  // namespace auth
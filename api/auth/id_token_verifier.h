@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+typedef struct evp_pkey_st EVP_PKEY;
+
+namespace auth {
+
+struct JwksDocument {
+  std::string body;             // {"keys":[{"kty":"RSA","kid":..,"n":..,"e":..}, ...]}
+  int64_t max_age_seconds = 0;  // from Cache-Control; 0 if unknown
+};
+
+// Where signing keys come from. The server fetches Google's published JWKS
+// over HTTPS; local runs and tests can point at a file instead.
+class JwksSource {
+ public:
+  virtual ~JwksSource() = default;
+  virtual std::optional<JwksDocument> Fetch() = 0;
+  virtual std::string describe() const = 0;
+};
+
+class FileJwksSource final : public JwksSource {
+ public:
+  explicit FileJwksSource(std::string path) : path_(std::move(path)) {}
+  std::optional<JwksDocument> Fetch() override;
+  std::string describe() const override { return "file:" + path_; }
+
+ private:
+  const std::string path_;
+};
+
+// Verifies RS256 JWTs (Google ID tokens) locally against a cached key set.
+// Verification only reads an immutable snapshot of parsed public keys; a
+// background thread refreshes the snapshot before the source's max-age runs
+// out and retries with backoff on failure. Claim checks (iss/aud/exp) stay
+// with the caller.
+class IdTokenVerifier {
+ public:
+  struct Options {
+    int64_t refresh_seconds = 3600;  // upper bound between refreshes
+    int64_t retry_seconds = 15;      // first retry after a failed refresh; doubles
+  };
+
+  struct Stats {
+    size_t keys = 0;
+    uint64_t refreshes = 0;
+    uint64_t refresh_failures = 0;
+    int64_t last_refresh_unix = 0;
+    uint64_t verified = 0;
+    uint64_t rejected = 0;
+    uint64_t unknown_kid = 0;
+  };
+
+  IdTokenVerifier(std::unique_ptr<JwksSource> source, Options options);
+  ~IdTokenVerifier();
+  IdTokenVerifier(const IdTokenVerifier&) = delete;
+  IdTokenVerifier& operator=(const IdTokenVerifier&) = delete;
+
+  // Loads keys once synchronously, then starts the refresher.
+  void Start();
+  void Stop();
+  bool Refresh();
+
+  // Returns the decoded payload JSON if the signature is valid.
+  std::optional<std::string> Verify(std::string_view jwt) const;
+
+  Stats stats() const;
+  const JwksSource& source() const { return *source_; }
+
+ private:
+  using KeySet = std::unordered_map<std::string, std::shared_ptr<EVP_PKEY>>;
+
+  std::shared_ptr<const KeySet> keys() const;
+  void RefresherLoop();
+
+  const std::unique_ptr<JwksSource> source_;
+  const Options options_;
+
+  mutable std::mutex keys_mu_;
+  std::shared_ptr<const KeySet> keys_;
+
+  std::mutex refresh_mu_;
+  mutable std::mutex wake_mu_;
+  mutable std::condition_variable wake_cv_;
+  mutable bool wake_requested_ = false;
+  mutable int64_t wake_allowed_after_unix_ = 0;  // rate-limits unknown-kid refreshes
+  bool stopping_ = false;
+  std::thread refresher_;
+  std::atomic<int64_t> next_interval_seconds_{0};
+
+  std::atomic<uint64_t> refreshes_{0};
+  std::atomic<uint64_t> refresh_failures_{0};
+  std::atomic<int64_t> last_refresh_unix_{0};
+  mutable std::atomic<uint64_t> verified_{0};
+  mutable std::atomic<uint64_t> rejected_{0};
+  mutable std::atomic<uint64_t> unknown_kid_{0};
+};
+
+}  // namespace auth
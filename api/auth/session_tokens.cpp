@@ -0,0 +1,161 @@
+#include "session_tokens.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#include <charconv>
+#include <ctime>
+
+namespace auth {
+namespace {
+
+constexpr std::string_view kVersion = "v1";
+constexpr size_t kJtiBytes = 9;     // 12 base64url chars
+constexpr size_t kSigChars = 43;    // base64url(32 bytes), unpadded
+constexpr size_t kMaxRevoked = 100000;
+
+size_t Base64UrlEncode(const unsigned char* in, size_t n, char* out) {
+  static constexpr char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  size_t o = 0;
+  size_t i = 0;
+  for (; i + 2 < n; i += 3) {
+    const uint32_t v = (uint32_t{in[i]} << 16) | (uint32_t{in[i + 1]} << 8) | in[i + 2];
+    out[o++] = kAlphabet[(v >> 18) & 63];
+    out[o++] = kAlphabet[(v >> 12) & 63];
+    out[o++] = kAlphabet[(v >> 6) & 63];
+    out[o++] = kAlphabet[v & 63];
+  }
+  if (i < n) {
+    uint32_t v = uint32_t{in[i]} << 16;
+    if (i + 1 < n) v |= uint32_t{in[i + 1]} << 8;
+    out[o++] = kAlphabet[(v >> 18) & 63];
+    out[o++] = kAlphabet[(v >> 12) & 63];
+    if (i + 1 < n) out[o++] = kAlphabet[(v >> 6) & 63];
+  }
+  return o;
+}
+
+// Writes the kSigChars-long signature of `payload` into `out`.
+bool SignInto(const std::string& secret, std::string_view payload, char* out) {
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  unsigned int mac_len = 0;
+  if (!HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+            reinterpret_cast<const unsigned char*>(payload.data()), payload.size(), mac, &mac_len) ||
+      mac_len != 32) {
+    return false;
+  }
+  return Base64UrlEncode(mac, mac_len, out) == kSigChars;
+}
+
+int64_t NowSeconds() {
+  return static_cast<int64_t>(std::time(nullptr));
+}
+
+template <typename T>
+bool ParseNumber(std::string_view s, T& out) {
+  if (s.empty()) return false;
+  const auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+  return r.ec == std::errc() && r.ptr == s.data() + s.size();
+}
+
+}  // namespace
+
+SessionTokens::SessionTokens(std::string secret, int64_t ttl_seconds)
+    : secret_(std::move(secret)), ttl_seconds_(ttl_seconds), revoked_(std::make_shared<const RevokedSet>()) {}
+
+std::string SessionTokens::RandomSecret() {
+  unsigned char bytes[32];
+  if (RAND_bytes(bytes, sizeof(bytes)) != 1) return {};
+  static constexpr char kHex[] = "0123456789abcdef";
+  std::string out;
+  out.reserve(64);
+  for (unsigned char b : bytes) {
+    out.push_back(kHex[b >> 4]);
+    out.push_back(kHex[b & 15]);
+  }
+  return out;
+}
+
+std::string SessionTokens::Issue(int user_id) const {
+  unsigned char jti_bytes[kJtiBytes];
+  if (RAND_bytes(jti_bytes, sizeof(jti_bytes)) != 1) return {};
+  char jti[16];
+  const size_t jti_len = Base64UrlEncode(jti_bytes, sizeof(jti_bytes), jti);
+
+  std::string token;
+  token.reserve(96);
+  token.append(kVersion);
+  token.push_back('.');
+  token.append(std::to_string(user_id));
+  token.push_back('.');
+  token.append(std::to_string(NowSeconds() + ttl_seconds_));
+  token.push_back('.');
+  token.append(jti, jti_len);
+  char sig[kSigChars];
+  if (!SignInto(secret_, token, sig)) return {};
+  token.push_back('.');
+  token.append(sig, kSigChars);
+  return token;
+}
+
+std::optional<SessionTokens::Claims> SessionTokens::Parse(std::string_view token, int64_t now) const {
+  const size_t sig_dot = token.rfind('.');
+  if (sig_dot == std::string_view::npos || token.size() - sig_dot - 1 != kSigChars) return std::nullopt;
+  const std::string_view payload = token.substr(0, sig_dot);
+
+  std::string_view parts[4];
+  std::string_view rest = payload;
+  for (size_t i = 0; i < 4; ++i) {
+    const size_t dot = rest.find('.');
+    if ((dot == std::string_view::npos) != (i == 3)) return std::nullopt;
+    parts[i] = rest.substr(0, dot);
+    if (dot != std::string_view::npos) rest.remove_prefix(dot + 1);
+  }
+  if (parts[0] != kVersion || parts[3].empty()) return std::nullopt;
+
+  char expected[kSigChars];
+  if (!SignInto(secret_, payload, expected) || CRYPTO_memcmp(expected, token.data() + sig_dot + 1, kSigChars) != 0) {
+    return std::nullopt;
+  }
+  Claims c;
+  if (!ParseNumber(parts[1], c.user_id) || c.user_id <= 0) return std::nullopt;
+  if (!ParseNumber(parts[2], c.exp) || c.exp <= now) return std::nullopt;
+  c.jti = parts[3];
+  return c;
+}
+
+std::optional<int> SessionTokens::Verify(std::string_view token) const {
+  const auto claims = Parse(token, NowSeconds());
+  if (!claims) return std::nullopt;
+  if (revoked_count_.load(std::memory_order_acquire) > 0) {
+    const auto revoked = std::atomic_load_explicit(&revoked_, std::memory_order_acquire);
+    if (revoked->count(std::string(claims->jti)) > 0) return std::nullopt;
+  }
+  return claims->user_id;
+}
+
+bool SessionTokens::Revoke(std::string_view token) {
+  const int64_t now = NowSeconds();
+  const auto claims = Parse(token, now);
+  if (!claims) return false;
+  std::lock_guard<std::mutex> lock(revoke_mu_);
+  const auto current = std::atomic_load_explicit(&revoked_, std::memory_order_acquire);
+  auto next = std::make_shared<RevokedSet>();
+  next->reserve(current->size() + 1);
+  // Expired tokens fail verification on their own; drop them while copying.
+  for (const auto& kv : *current) {
+    if (kv.second > now) next->emplace(kv);
+  }
+  if (next->size() >= kMaxRevoked) return false;
+  next->emplace(std::string(claims->jti), claims->exp);
+  const size_t count = next->size();
+  // Publish the set before the count so a reader that sees count > 0 also sees the entry.
+  std::atomic_store_explicit(&revoked_, std::shared_ptr<const RevokedSet>(std::move(next)),
+                             std::memory_order_release);
+  revoked_count_.store(count, std::memory_order_release);
+  return true;
+}
+
+}  // namespace auth
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace auth {
+
+// Stateless bearer tokens: "v1.<user_id>.<exp>.<jti>.<sig>", where sig is the
+// base64url HMAC-SHA256 of everything before it. Any process holding the same
+// secret can verify a token without shared state, and tokens survive restarts.
+// Verify() takes no lock; the optional revocation list (jti -> exp, local to
+// this process) is an immutable snapshot that is only consulted when non-empty.
+class SessionTokens {
+ public:
+  SessionTokens(std::string secret, int64_t ttl_seconds);
+
+  std::string Issue(int user_id) const;
+  std::optional<int> Verify(std::string_view token) const;
+
+  // Rejects a valid token until it expires. Returns false for tokens that
+  // would not verify anyway.
+  bool Revoke(std::string_view token);
+  size_t revoked_count() const { return revoked_count_.load(std::memory_order_acquire); }
+
+  int64_t ttl_seconds() const { return ttl_seconds_; }
+
+  // 32 random bytes, hex-encoded; used when no secret is configured.
+  static std::string RandomSecret();
+
+ private:
+  struct Claims {
+    int user_id = 0;
+    int64_t exp = 0;
+    std::string_view jti;
+  };
+  using RevokedSet = std::unordered_map<std::string, int64_t>;
+
+  std::optional<Claims> Parse(std::string_view token, int64_t now) const;
+
+  const std::string secret_;
+  const int64_t ttl_seconds_;
+
+  std::mutex revoke_mu_;
+  std::shared_ptr<const RevokedSet> revoked_;  // std::atomic_load/atomic_store only
+  std::atomic<size_t> revoked_count_{0};
+};
+
+}  // namespace auth
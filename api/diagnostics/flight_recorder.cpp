@@ -0,0 +1,190 @@
+#include "flight_recorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace diagnostics {
+namespace {
+
+constexpr char kMagic[] = "SNKFLT01";
+constexpr size_t kMagicLen = 8;
+constexpr size_t kMaxQueued = 2;
+constexpr const char* kSuffix = ".bin";
+
+bool IsValidId(const std::string& id) {
+  if (id.empty() || id.size() > 96) return false;
+  return std::all_of(id.begin(), id.end(), [](char c) {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-';
+  });
+}
+
+uint32_t ReadU32(const char* p) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(p[0])) |
+         (static_cast<uint32_t>(static_cast<unsigned char>(p[1])) << 8) |
+         (static_cast<uint32_t>(static_cast<unsigned char>(p[2])) << 16) |
+         (static_cast<uint32_t>(static_cast<unsigned char>(p[3])) << 24);
+}
+
+}  // namespace
+
+FlightRecorder::FlightRecorder(Options options) : options_(std::move(options)) {
+  if (!enabled()) return;
+  std::error_code ec;
+  std::filesystem::create_directories(options_.dir, ec);
+  if (ec) std::cerr << "[flight] cannot create " << options_.dir << ": " << ec.message() << "\n";
+  LoadExisting();
+  writer_ = std::thread([this] { WriterLoop(); });
+}
+
+FlightRecorder::~FlightRecorder() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  if (writer_.joinable()) writer_.join();
+}
+
+std::string FlightRecorder::PathFor(const std::string& id) const {
+  return (std::filesystem::path(options_.dir) / (id + kSuffix)).string();
+}
+
+void FlightRecorder::LoadExisting() {
+  std::vector<Entry> found;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(options_.dir, ec), end; !ec && it != end; it.increment(ec)) {
+    const auto& path = it->path();
+    if (path.extension() != kSuffix) continue;
+    const std::string id = path.stem().string();
+    if (!IsValidId(id)) continue;
+    std::ifstream in(path, std::ios::binary);
+    char head[kMagicLen + 4];
+    if (!in.read(head, sizeof(head)) || std::string(head, kMagicLen) != std::string(kMagic, kMagicLen)) continue;
+    Entry e;
+    e.id = id;
+    e.summary_json.resize(ReadU32(head + kMagicLen));
+    if (!in.read(&e.summary_json[0], static_cast<std::streamsize>(e.summary_json.size()))) continue;
+    e.bytes = static_cast<size_t>(it->file_size(ec));
+    // ids are "slowtick-<created_ms>-<tick>"
+    if (std::sscanf(id.c_str(), "slowtick-%lld", reinterpret_cast<long long*>(&e.created_ms)) != 1) e.created_ms = 0;
+    found.push_back(std::move(e));
+  }
+  std::sort(found.begin(), found.end(), [](const Entry& a, const Entry& b) {
+    return a.created_ms != b.created_ms ? a.created_ms < b.created_ms : a.id < b.id;
+  });
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto& e : found) entries_.push_back(std::move(e));
+  while (entries_.size() > options_.max_captures) {
+    std::filesystem::remove(PathFor(entries_.front().id), ec);
+    entries_.pop_front();
+  }
+  stats_.stored = entries_.size();
+}
+
+bool FlightRecorder::TryBegin(int64_t now_ms) {
+  if (!enabled()) return false;
+  std::lock_guard<std::mutex> lock(mu_);
+  if ((last_capture_ms_ != 0 && now_ms - last_capture_ms_ < options_.min_interval_ms) || queue_.size() >= kMaxQueued) {
+    ++stats_.suppressed;
+    return false;
+  }
+  last_capture_ms_ = now_ms;
+  return true;
+}
+
+void FlightRecorder::Submit(std::string id, int64_t created_ms, std::string summary_json, std::string body) {
+  if (!enabled() || !IsValidId(id)) return;
+  Pending p;
+  p.entry.id = std::move(id);
+  p.entry.created_ms = created_ms;
+  p.entry.summary_json = std::move(summary_json);
+  p.entry.bytes = kMagicLen + 4 + p.entry.summary_json.size() + body.size();
+  p.body = std::move(body);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    queue_.push_back(std::move(p));
+  }
+  cv_.notify_one();
+}
+
+bool FlightRecorder::WriteFile(const Pending& p) {
+  const std::string path = PathFor(p.entry.id);
+  const std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    const uint32_t n = static_cast<uint32_t>(p.entry.summary_json.size());
+    const char len[4] = {static_cast<char>(n), static_cast<char>(n >> 8), static_cast<char>(n >> 16),
+                         static_cast<char>(n >> 24)};
+    out.write(kMagic, kMagicLen);
+    out.write(len, sizeof(len));
+    out.write(p.entry.summary_json.data(), static_cast<std::streamsize>(p.entry.summary_json.size()));
+    out.write(p.body.data(), static_cast<std::streamsize>(p.body.size()));
+    if (!out) return false;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  return !ec;
+}
+
+void FlightRecorder::WriterLoop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) break;
+    Pending p = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    const bool ok = WriteFile(p);
+    if (ok) {
+      std::cout << "[flight] captured " << p.entry.id << " bytes=" << p.entry.bytes << "\n";
+    } else {
+      std::cerr << "[flight] write failed for " << p.entry.id << " in " << options_.dir << "\n";
+    }
+    lock.lock();
+    if (!ok) {
+      ++stats_.write_failures;
+      continue;
+    }
+    ++stats_.captured;
+    p.body.clear();
+    entries_.push_back(std::move(p.entry));
+    while (entries_.size() > options_.max_captures) {
+      std::error_code ec;
+      std::filesystem::remove(PathFor(entries_.front().id), ec);
+      entries_.pop_front();
+    }
+    stats_.stored = entries_.size();
+  }
+}
+
+std::vector<FlightRecorder::Entry> FlightRecorder::List() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return std::vector<Entry>(entries_.rbegin(), entries_.rend());
+}
+
+std::optional<std::string> FlightRecorder::Read(const std::string& id) const {
+  if (!IsValidId(id)) return std::nullopt;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (std::none_of(entries_.begin(), entries_.end(), [&](const Entry& e) { return e.id == id; })) {
+      return std::nullopt;
+    }
+  }
+  std::ifstream in(PathFor(id), std::ios::binary);
+  if (!in) return std::nullopt;
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+FlightRecorder::Stats FlightRecorder::stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return stats_;
+}
+
+}  // namespace diagnostics
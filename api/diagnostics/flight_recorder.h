@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace diagnostics {
+
+// Bounded on-disk ring of slow-tick captures. The tick thread decides to
+// capture (TryBegin), builds the payload and hands it off (Submit); files are
+// written and the ring trimmed on a background thread so disk I/O never lands
+// on the tick that is already late.
+//
+// File layout: "SNKFLT01", u32 little-endian summary length, summary JSON,
+// then the opaque capture body (a world::World binary snapshot).
+class FlightRecorder {
+ public:
+  struct Options {
+    std::string dir;
+    size_t max_captures = 20;        // 0 disables the recorder
+    int64_t min_interval_ms = 5000;  // stalls tend to cluster; one capture per burst
+  };
+
+  struct Entry {
+    std::string id;
+    int64_t created_ms = 0;
+    size_t bytes = 0;
+    std::string summary_json;
+  };
+
+  struct Stats {
+    uint64_t captured = 0;
+    uint64_t suppressed = 0;
+    uint64_t write_failures = 0;
+    size_t stored = 0;
+  };
+
+  explicit FlightRecorder(Options options);
+  ~FlightRecorder();
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  bool enabled() const { return options_.max_captures > 0; }
+
+  // Claims the capture slot; false while rate-limited or disabled.
+  bool TryBegin(int64_t now_ms);
+  void Submit(std::string id, int64_t created_ms, std::string summary_json, std::string body);
+
+  std::vector<Entry> List() const;  // newest first
+  std::optional<std::string> Read(const std::string& id) const;
+  Stats stats() const;
+
+ private:
+  struct Pending {
+    Entry entry;
+    std::string body;
+  };
+
+  void LoadExisting();
+  void WriterLoop();
+  bool WriteFile(const Pending& p);
+  std::string PathFor(const std::string& id) const;
+
+  const Options options_;
+
+  mutable std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<Entry> entries_;  // oldest first
+  std::deque<Pending> queue_;
+  bool stopping_ = false;
+  int64_t last_capture_ms_ = 0;
+  Stats stats_;
+  std::thread writer_;
+};
+
+}  // namespace diagnostics
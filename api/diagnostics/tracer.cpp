@@ -0,0 +1,162 @@
+#include "tracer.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "../protocol/json_writer.h"
+
+namespace diagnostics {
+namespace {
+
+struct ThreadBinding {
+  const void* tracer = nullptr;
+  void* ring = nullptr;
+};
+thread_local ThreadBinding t_binding;
+
+struct CopiedSpan {
+  const char* category;
+  const char* name;
+  int64_t start_ns;
+  int64_t dur_ns;
+  uint32_t tid;
+};
+
+}  // namespace
+
+int64_t Tracer::NowNs() {
+  return ToNs(std::chrono::steady_clock::now());
+}
+
+int64_t Tracer::ToNs(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+Tracer::Ring& Tracer::LocalRing() {
+  if (t_binding.tracer == this) return *static_cast<Ring*>(t_binding.ring);
+  auto ring = std::make_unique<Ring>();
+  Ring* raw = ring.get();
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    raw->tid = static_cast<uint32_t>(rings_.size() + 1);
+    raw->thread_name = "thread-" + std::to_string(raw->tid);
+    rings_.push_back(std::move(ring));
+  }
+  t_binding = ThreadBinding{this, raw};
+  return *raw;
+}
+
+void Tracer::Record(const char* category, const char* name, int64_t start_ns, int64_t end_ns) {
+  if (!active()) return;
+  Ring& ring = LocalRing();
+  const uint64_t i = ring.head.load(std::memory_order_relaxed);
+  Slot& slot = ring.slots[i % kRingSize];
+  slot.category.store(category, std::memory_order_relaxed);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.start_ns.store(start_ns, std::memory_order_relaxed);
+  slot.dur_ns.store(std::max<int64_t>(0, end_ns - start_ns), std::memory_order_relaxed);
+  ring.head.store(i + 1, std::memory_order_release);
+}
+
+const char* Tracer::Intern(std::string_view s) {
+  std::lock_guard<std::mutex> lock(mu_);
+  return interned_.emplace(s).first->c_str();
+}
+
+void Tracer::SetThreadName(const std::string& name) {
+  Ring& ring = LocalRing();
+  std::lock_guard<std::mutex> lock(mu_);
+  ring.thread_name = name;
+}
+
+std::optional<Tracer::Capture> Tracer::Run(std::chrono::milliseconds duration) {
+  bool expected = false;
+  if (!capturing_.compare_exchange_strong(expected, true)) return std::nullopt;
+
+  // Rings are never freed, so the pointers stay valid after mu_ is released.
+  std::vector<std::pair<Ring*, uint64_t>> starts;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto& r : rings_) starts.emplace_back(r.get(), r->head.load(std::memory_order_acquire));
+  }
+  const int64_t t0 = NowNs();
+  active_.store(true, std::memory_order_relaxed);
+  std::this_thread::sleep_for(duration);
+  active_.store(false, std::memory_order_relaxed);
+
+  std::vector<std::pair<Ring*, std::string>> threads;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto& r : rings_) {
+      threads.emplace_back(r.get(), r->thread_name);
+      const bool known = std::any_of(starts.begin(), starts.end(), [&](const auto& s) { return s.first == r.get(); });
+      if (!known) starts.emplace_back(r.get(), 0);  // thread first traced during this capture
+    }
+  }
+
+  Capture out;
+  std::vector<CopiedSpan> spans;
+  for (const auto& [ring, start] : starts) {
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t from = std::max(start, head > kRingSize ? head - kRingSize : 0);
+    out.dropped += static_cast<size_t>(from - start);
+    const size_t first = spans.size();
+    for (uint64_t i = from; i < head; ++i) {
+      const Slot& slot = ring->slots[i % kRingSize];
+      spans.push_back(CopiedSpan{slot.category.load(std::memory_order_relaxed), slot.name.load(std::memory_order_relaxed),
+                                 slot.start_ns.load(std::memory_order_relaxed), slot.dur_ns.load(std::memory_order_relaxed),
+                                 ring->tid});
+    }
+    // A span finishing late may have lapped the ring while we copied it.
+    const uint64_t after = ring->head.load(std::memory_order_acquire);
+    if (after > kRingSize && after - kRingSize > from) {
+      const size_t stale = static_cast<size_t>(std::min(after - kRingSize, head) - from);
+      spans.erase(spans.begin() + static_cast<std::ptrdiff_t>(first),
+                  spans.begin() + static_cast<std::ptrdiff_t>(first + stale));
+      out.dropped += stale;
+    }
+  }
+  capturing_.store(false);
+
+  protocol::JsonWriter w(128 + spans.size() * 96);
+  w.BeginObject();
+  w.Key("traceEvents").BeginArray();
+  for (const auto& [ring, name] : threads) {
+    w.BeginObject();
+    w.Field("name", "thread_name");
+    w.Field("ph", "M");
+    w.Field("pid", 1);
+    w.Field("tid", ring->tid);
+    w.Key("args").BeginObject().Field("name", name).EndObject();
+    w.EndObject();
+  }
+  for (const auto& s : spans) {
+    if (!s.name) continue;
+    w.BeginObject();
+    w.Field("name", s.name);
+    w.Field("cat", s.category ? s.category : "");
+    w.Field("ph", "X");
+    w.Field("pid", 1);
+    w.Field("tid", s.tid);
+    w.Field("ts", static_cast<double>(s.start_ns - t0) / 1000.0);
+    w.Field("dur", static_cast<double>(s.dur_ns) / 1000.0);
+    w.EndObject();
+  }
+  w.EndArray();
+  w.Field("displayTimeUnit", "ns");
+  w.Key("otherData").BeginObject();
+  w.Field("duration_ms", static_cast<int64_t>(duration.count()));
+  w.Field("dropped", out.dropped);
+  w.EndObject();
+  w.EndObject();
+  out.events = spans.size();
+  out.json = w.Take();
+  return out;
+}
+
+Tracer& DefaultTracer() {
+  static Tracer* tracer = new Tracer();  // never destroyed; outlives worker threads
+  return *tracer;
+}
+
+}  // namespace diagnostics
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace diagnostics {
+
+// In-process span tracer exported as Chrome trace JSON (chrome://tracing,
+// Perfetto). Each thread appends finished spans to its own fixed-size ring with
+// a single release store, so recording never takes a lock; the capturing
+// thread copies the rings afterwards and discards slots overwritten while it
+// read. Nothing is recorded outside a capture, so an idle span is one relaxed
+// load.
+class Tracer {
+ public:
+  static constexpr size_t kRingSize = 16384;  // spans per thread per capture (~512 KB)
+
+  struct Capture {
+    std::string json;
+    size_t events = 0;
+    size_t dropped = 0;  // overwritten before they could be read
+  };
+
+  static int64_t NowNs();
+  static int64_t ToNs(std::chrono::steady_clock::time_point t);
+
+  bool active() const { return active_.load(std::memory_order_relaxed); }
+
+  // category and name must outlive the tracer: string literals or Intern().
+  void Record(const char* category, const char* name, int64_t start_ns, int64_t end_ns);
+  const char* Intern(std::string_view s);
+  // Labels the calling thread in exported traces.
+  void SetThreadName(const std::string& name);
+
+  // Records for `duration` on the calling thread's behalf (blocks), then
+  // returns the trace. nullopt if another capture is already running.
+  std::optional<Capture> Run(std::chrono::milliseconds duration);
+
+ private:
+  struct Slot {
+    std::atomic<const char*> category{nullptr};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> dur_ns{0};
+  };
+  struct Ring {
+    uint32_t tid = 0;
+    std::string thread_name;  // guarded by mu_
+    std::atomic<uint64_t> head{0};
+    std::unique_ptr<Slot[]> slots{new Slot[kRingSize]};
+  };
+
+  Ring& LocalRing();
+
+  std::atomic<bool> active_{false};
+  std::atomic<bool> capturing_{false};
+  std::mutex mu_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::unordered_set<std::string> interned_;
+};
+
+// Process-wide tracer used by the instrumentation below.
+Tracer& DefaultTracer();
+
+// Records [construction, End()/destruction) as a span when a capture is running.
+class TraceSpan {
+ public:
+  TraceSpan(const char* category, const char* name)
+      : category_(category), name_(name), start_ns_(DefaultTracer().active() ? Tracer::NowNs() : 0) {}
+  ~TraceSpan() { End(); }
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+  void End() {
+    if (start_ns_ == 0) return;
+    DefaultTracer().Record(category_, name_, start_ns_, Tracer::NowNs());
+    start_ns_ = 0;
+  }
+
+ private:
+  const char* category_;
+  const char* name_;
+  int64_t start_ns_;
+};
+
+}  // namespace diagnostics
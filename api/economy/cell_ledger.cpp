@@ -0,0 +1,427 @@
+#include "cell_ledger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+
+#include "../diagnostics/tracer.h"
+#include "../metrics/metrics.h"
+
+namespace economy {
+namespace {
+
+uint64_t RandomSalt() {
+  std::random_device rd;
+  return (static_cast<uint64_t>(rd()) << 32) ^ static_cast<uint64_t>(rd());
+}
+
+}  // namespace
+
+CellLedger::CellLedger(storage::IStorage& storage, Options options)
+    : storage_(storage), options_(std::move(options)), token_salt_(RandomSalt()) {}
+
+CellLedger::~CellLedger() { Stop(); }
+
+void CellLedger::Start(CommittedFn on_committed) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (running_ || stopping_) return;
+  }
+  LoadTreasury();
+  std::lock_guard<std::mutex> lock(mu_);
+  on_committed_ = std::move(on_committed);
+  running_ = true;
+  worker_ = std::thread([this] { Run(); });
+}
+
+void CellLedger::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  if (worker_.joinable()) worker_.join();
+  std::lock_guard<std::mutex> lock(mu_);
+  running_ = false;
+  settled_cv_.notify_all();
+}
+
+void CellLedger::RefreshTreasury() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    treasury_refresh_requested_ = true;
+  }
+  work_cv_.notify_one();
+}
+
+CellLedger::Result CellLedger::Apply(const Op& op, std::chrono::milliseconds wait) {
+  Result rejected;
+  if (op.amount <= 0 || op.user_id.empty()) {
+    rejected.error = op.user_id.empty() ? "user_not_found" : "invalid_amount";
+    std::lock_guard<std::mutex> lock(mu_);
+    ++stats_.rejected;
+    return rejected;
+  }
+  const std::string idem_key = op.op_id.empty() ? std::string() : op.user_id + '\x1f' + op.op_id;
+  const int64_t user_delta = op.kind == OpKind::kDebit ? -op.amount : op.amount;
+  const int64_t treasury_delta = op.kind == OpKind::kBorrow ? -op.amount : 0;
+
+  std::unique_lock<std::mutex> lock(mu_);
+  const auto reject = [&](const char* error) {
+    ++stats_.rejected;
+    rejected.error = error;
+    return rejected;
+  };
+  std::shared_ptr<Tracked> tracked;
+  bool replayed = false;
+  for (;;) {
+    if (!running_ || stopping_) return reject("ledger_stopped");
+    if (!idem_key.empty()) {
+      auto it = by_op_id_.find(idem_key);
+      if (it != by_op_id_.end()) {
+        if (it->second->kind != op.kind || it->second->amount != op.amount) return reject("op_id_reused");
+        tracked = it->second;
+        replayed = true;
+        ++stats_.replayed;
+        break;
+      }
+    }
+    auto acc = accounts_.find(op.user_id);
+    if (acc == accounts_.end()) {
+      // Read the row unlocked; a commit settling meanwhile may or may not be
+      // in what we read, so read again if one did.
+      const uint64_t epoch = commit_epoch_;
+      lock.unlock();
+      const auto user = storage_.GetUserById(op.user_id);
+      lock.lock();
+      if (!user.has_value()) return reject("user_not_found");
+      if (accounts_.count(op.user_id) == 0 && commit_epoch_ != epoch) continue;
+      acc = accounts_.emplace(op.user_id, Account{user->balance_mi, 0, 0, std::chrono::steady_clock::now(), false})
+                .first;
+      continue;  // re-check op_id and running state after relocking
+    }
+
+    Account& a = acc->second;
+    const int64_t balance = a.base + a.outstanding;
+    const int64_t treasury = treasury_base_ + treasury_outstanding_;
+    if (op.kind == OpKind::kDebit && balance < op.amount) return reject("insufficient_cells");
+    if (op.kind == OpKind::kBorrow && treasury < op.amount) return reject("insufficient_treasury");
+
+    a.outstanding += user_delta;
+    ++a.ops;
+    treasury_outstanding_ += treasury_delta;
+    tracked = std::make_shared<Tracked>();
+    tracked->kind = op.kind;
+    tracked->amount = op.amount;
+    tracked->result.ok = true;
+    tracked->result.balance_after = balance + user_delta;
+    tracked->result.treasury_after = treasury + treasury_delta;
+
+    Pending p;
+    p.entry.op_id = op.op_id;
+    p.entry.user_id = op.user_id;
+    p.entry.user_delta = user_delta;
+    p.entry.treasury_delta = treasury_delta;
+    if (op.kind == OpKind::kBorrow) {
+      p.entry.period_key = op.period_key;
+      p.entry.delta_m_buy = op.amount;
+    }
+    p.tracked = tracked;
+    reserved_.push_back(std::move(p));
+    ++stats_.applied;
+    if (!idem_key.empty()) {
+      by_op_id_[idem_key] = tracked;
+      op_id_order_.push_back(idem_key);
+      while (op_id_order_.size() > options_.idempotency_entries) {
+        by_op_id_.erase(op_id_order_.front());
+        op_id_order_.pop_front();
+      }
+    }
+    work_cv_.notify_one();
+    break;
+  }
+
+  if (wait.count() > 0) {
+    settled_cv_.wait_for(lock, wait, [&] { return tracked->state != State::kReserved || !running_; });
+  }
+  Result out = tracked->result;
+  out.durable = tracked->state == State::kCommitted;
+  out.replayed = replayed;
+  return out;
+}
+
+CellLedger::Stats CellLedger::stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  Stats out = stats_;
+  out.accounts = accounts_.size();
+  out.outstanding_ops = 0;
+  for (const auto& [user_id, a] : accounts_) out.outstanding_ops += a.ops;
+  out.treasury = treasury_base_ + treasury_outstanding_;
+  out.treasury_outstanding = treasury_outstanding_;
+  return out;
+}
+
+void CellLedger::OnUserBalanceSet(const std::string& user_id, int64_t) {
+  std::lock_guard<std::mutex> lock(mu_);
+  ResyncAccountLocked(user_id);
+}
+
+void CellLedger::OnUserBalanceDelta(const std::string& user_id, int64_t delta_mi) {
+  std::lock_guard<std::mutex> lock(mu_);
+  ++commit_epoch_;
+  auto it = accounts_.find(user_id);
+  if (it == accounts_.end()) return;
+  it->second.base += delta_mi;
+  ++stats_.external_writes;
+}
+
+void CellLedger::OnUserDeleted(const std::string& user_id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  ResyncAccountLocked(user_id);
+}
+
+void CellLedger::OnReset() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ++commit_epoch_;
+    for (auto it = accounts_.begin(); it != accounts_.end();) {
+      if (it->second.ops == 0) {
+        it = accounts_.erase(it);
+      } else {
+        it->second.stale = true;
+        ++it;
+      }
+    }
+    treasury_refresh_requested_ = true;
+  }
+  work_cv_.notify_one();
+}
+
+void CellLedger::ResyncAccountLocked(const std::string& user_id) {
+  // Also makes an Apply() reading this user's row right now read it again.
+  ++commit_epoch_;
+  auto it = accounts_.find(user_id);
+  if (it == accounts_.end()) return;
+  ++stats_.external_writes;
+  if (it->second.ops == 0) {
+    accounts_.erase(it);
+  } else {
+    it->second.stale = true;
+  }
+}
+
+void CellLedger::LoadTreasury() {
+  auto params = storage_.GetEconomyParamsActive();
+  if (!params.has_value()) params = storage_.GetEconomyParams();
+  std::lock_guard<std::mutex> lock(mu_);
+  if (params.has_value()) {
+    treasury_base_ = params->m_gov_reserve;
+    treasury_loaded_ = true;
+  }
+  treasury_refresh_requested_ = false;
+  treasury_loaded_at_ = std::chrono::steady_clock::now();
+}
+
+std::string CellLedger::NextToken() {
+  // Unique per process and group, within the 36 characters Dynamo allows.
+  char buf[40];
+  std::snprintf(buf, sizeof(buf), "cl%016llx%016llx", static_cast<unsigned long long>(token_salt_),
+                static_cast<unsigned long long>(++token_seq_));
+  return buf;
+}
+
+void CellLedger::FormGroups(std::vector<Pending>& batch) {
+  std::unordered_set<std::string> users;
+  std::unordered_set<std::string> periods;
+  bool treasury = false;
+  Group group;
+  const auto close_group = [&] {
+    if (group.ops.empty()) return;
+    group.token = NextToken();
+    groups_.push_back(std::move(group));
+    group = Group{};
+    users.clear();
+    periods.clear();
+    treasury = false;
+  };
+  for (auto& p : batch) {
+    const auto& e = p.entry;
+    const size_t new_keys = (users.count(e.user_id) ? 0 : 1) +
+                            (!e.period_key.empty() && !periods.count(e.period_key) ? 1 : 0) +
+                            (e.treasury_delta != 0 && !treasury ? 1 : 0);
+    if (group.ops.size() >= options_.max_ops_per_commit ||
+        users.size() + periods.size() + (treasury ? 1 : 0) + new_keys > storage::IStorage::kMaxCellLedgerKeys) {
+      close_group();
+    }
+    users.insert(e.user_id);
+    if (!e.period_key.empty()) periods.insert(e.period_key);
+    treasury = treasury || e.treasury_delta != 0;
+    group.ops.push_back(std::move(p));
+  }
+  close_group();
+  batch.clear();
+}
+
+std::vector<std::string> CellLedger::Settle(const std::vector<Pending>& ops, bool committed, const char* error) {
+  std::vector<std::string> touched;
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const auto& p : ops) {
+    const auto& e = p.entry;
+    auto acc = accounts_.find(e.user_id);
+    if (acc != accounts_.end()) {
+      Account& a = acc->second;
+      a.outstanding -= e.user_delta;
+      if (committed) {
+        a.base += e.user_delta;
+      } else {
+        a.stale = true;
+      }
+      if (a.ops > 0 && --a.ops == 0) a.idle_since = now;
+    }
+    treasury_outstanding_ -= e.treasury_delta;
+    if (committed) treasury_base_ += e.treasury_delta;
+    p.tracked->state = committed ? State::kCommitted : State::kFailed;
+    if (!committed) {
+      p.tracked->result.ok = false;
+      p.tracked->result.error = error;
+    }
+    touched.push_back(e.user_id);
+  }
+  if (committed) {
+    stats_.committed_ops += ops.size();
+  } else {
+    treasury_refresh_requested_ = true;
+    stats_.dropped_ops += ops.size();
+  }
+  ++commit_epoch_;
+  settled_cv_.notify_all();
+  std::sort(touched.begin(), touched.end());
+  touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+  return touched;
+}
+
+CellLedger::CommitOutcome CellLedger::CommitGroup(Group& group) {
+  static auto& commit_seconds = metrics::Default().GetHistogram(
+      "snake_cell_ledger_commit_seconds", "Cell ledger group commit duration.", {}, metrics::Histogram::kSeconds);
+  std::vector<storage::CellLedgerEntry> entries;
+  entries.reserve(group.ops.size());
+  for (const auto& p : group.ops) entries.push_back(p.entry);
+
+  std::string error;
+  bool ok = false;
+  const auto started = std::chrono::steady_clock::now();
+  {
+    metrics::ScopedTimer timer(commit_seconds);
+    diagnostics::TraceSpan span("economy", "cell_ledger_commit");
+    ok = storage_.CommitCellLedgerEntries(entries, group.token, &error);
+  }
+  const int64_t elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ++stats_.commits;
+    stats_.last_commit_ops = group.ops.size();
+    stats_.last_commit_ms = elapsed_ms;
+    if (!ok) ++stats_.commit_failures;
+  }
+
+  if (ok) {
+    const auto touched = Settle(group.ops, true);
+    if (on_committed_) on_committed_(touched);
+    return CommitOutcome::kSettled;
+  }
+  if (error == "condition_failed") {
+    if (group.ops.size() == 1) {
+      // Alone, the op's own condition failed: the user row is gone, or
+      // storage holds fewer cells than the ledger believed.
+      const auto& e = group.ops.front().entry;
+      const char* reason = e.treasury_delta < 0 ? "insufficient_treasury"
+                           : e.user_delta < 0   ? "insufficient_cells"
+                                                : "user_not_found";
+      std::cerr << "[cell_ledger] dropped op user_id=" << e.user_id << " user_delta=" << e.user_delta
+                << " treasury_delta=" << e.treasury_delta << " reason=" << reason << "\n";
+      (void)Settle(group.ops, false, reason);
+      return CommitOutcome::kSettled;
+    }
+    // Find the offending op(s) by committing the rest one by one.
+    for (auto it = group.ops.rbegin(); it != group.ops.rend(); ++it) {
+      Group single;
+      single.ops.push_back(std::move(*it));
+      single.token = NextToken();
+      groups_.push_front(std::move(single));
+    }
+    return CommitOutcome::kSettled;
+  }
+  ++group.attempts;
+  return CommitOutcome::kRetry;
+}
+
+void CellLedger::EvictIdleAccounts() {
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto it = accounts_.begin(); it != accounts_.end();) {
+    if (it->second.ops == 0 && (it->second.stale || now - it->second.idle_since >= options_.account_idle)) {
+      it = accounts_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void CellLedger::Run() {
+  constexpr int kMaxAttemptsOnStop = 5;
+  std::unique_lock<std::mutex> lock(mu_);
+  for (;;) {
+    work_cv_.wait_for(lock, options_.treasury_refresh,
+                      [&] { return stopping_ || !reserved_.empty() || treasury_refresh_requested_; });
+    // Group commit window: let requests arriving right behind this one join it.
+    if (!reserved_.empty() && !stopping_ && options_.commit_interval.count() > 0) {
+      work_cv_.wait_for(lock, options_.commit_interval,
+                        [&] { return stopping_ || reserved_.size() >= options_.max_ops_per_commit; });
+    }
+    std::vector<Pending> batch;
+    batch.swap(reserved_);
+    const bool stop = stopping_;
+    lock.unlock();
+
+    FormGroups(batch);
+    int retry_attempts = 0;
+    while (!groups_.empty()) {
+      Group group = std::move(groups_.front());
+      groups_.pop_front();
+      if (CommitGroup(group) == CommitOutcome::kRetry) {
+        retry_attempts = group.attempts;
+        groups_.push_front(std::move(group));
+        break;
+      }
+    }
+    if (groups_.empty()) {
+      // Nothing in flight, so storage holds exactly the ledger's committed ops.
+      bool refresh = false;
+      {
+        std::lock_guard<std::mutex> g(mu_);
+        refresh = treasury_refresh_requested_ || !treasury_loaded_ ||
+                  std::chrono::steady_clock::now() - treasury_loaded_at_ >= options_.treasury_refresh;
+      }
+      if (refresh) LoadTreasury();
+      EvictIdleAccounts();
+    }
+
+    lock.lock();
+    if (stop && reserved_.empty() && (groups_.empty() || retry_attempts >= kMaxAttemptsOnStop)) break;
+    if (retry_attempts > 0) {
+      const auto backoff = std::chrono::milliseconds(std::min(2000, 25 << std::min(retry_attempts, 6)));
+      work_cv_.wait_for(lock, backoff, [&] { return stopping_ && !stop; });
+    }
+  }
+  if (!groups_.empty()) {
+    size_t ops = 0;
+    for (const auto& g : groups_) ops += g.ops.size();
+    std::cerr << "[cell_ledger] stopping with " << ops << " uncommitted ops\n";
+  }
+}
+
+}  // namespace economy
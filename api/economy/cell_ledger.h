@@ -0,0 +1,204 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../storage/user_cache_storage.h"
+
+namespace economy {
+
+// Authoritative in-process view of user balances and the treasury for cell
+// purchases (borrow, attach, snake creation). Apply() validates and reserves
+// under one lock, with no storage round-trip once the user's row is cached.
+// A worker group-commits everything reserved since its last pass with
+// IStorage::CommitCellLedgerEntries. Balances are storage's value plus the
+// ops still outstanding. Balance writes that bypass the ledger (food credits
+// and death settlements from the persistence flush, signup grants, admin
+// edits) arrive as cache write notifications: deltas move a live account's
+// base, absolute writes drop the account once its ops settle. A user's entry
+// is also dropped `account_idle` after their last op settles, so later ops
+// reread the row and pick up out-of-process edits. The treasury base is reread between
+// commits, every `treasury_refresh` or sooner after RefreshTreasury().
+//
+// Idempotency: an op carrying a client op_id returns the first result for
+// that (user, op_id) again instead of moving cells twice. Each commit group
+// keeps one request token across resends, so a group whose outcome was lost
+// is not applied twice either.
+class CellLedger final : public storage::UserCacheStorage::WriteListener {
+ public:
+  enum class OpKind {
+    kBorrow,  // treasury -> user; counts toward the period's delta_m_buy
+    kDebit,   // user -> deployed capital (attach, snake creation)
+    kCredit,  // deployed capital -> user (refunds of failed debits)
+  };
+
+  struct Op {
+    OpKind kind = OpKind::kDebit;
+    std::string user_id;
+    int64_t amount = 0;
+    std::string op_id;       // optional client idempotency key
+    std::string period_key;  // kBorrow only
+  };
+
+  // Every field set, so call sites stay clear of partial brace-inits.
+  static Op MakeOp(OpKind kind, std::string user_id, int64_t amount, std::string op_id = {},
+                   std::string period_key = {}) {
+    Op op;
+    op.kind = kind;
+    op.user_id = std::move(user_id);
+    op.amount = amount;
+    op.op_id = std::move(op_id);
+    op.period_key = std::move(period_key);
+    return op;
+  }
+
+  struct Result {
+    bool ok = false;
+    // invalid_amount | user_not_found | insufficient_cells |
+    // insufficient_treasury | op_id_reused | ledger_stopped
+    std::string error;
+    int64_t balance_after = 0;
+    int64_t treasury_after = 0;
+    bool durable = false;   // committed before Apply returned
+    bool replayed = false;  // first result of an earlier op with this op_id
+  };
+
+  struct Options {
+    std::chrono::milliseconds commit_interval{10};
+    size_t max_ops_per_commit = 512;
+    size_t idempotency_entries = 100000;
+    std::chrono::milliseconds treasury_refresh{1000};
+    // Settled accounts are kept this long before storage is consulted again,
+    // which rides out eventually consistent reads of a just-committed row.
+    std::chrono::milliseconds account_idle{10000};
+  };
+
+  struct Stats {
+    uint64_t applied = 0;
+    uint64_t rejected = 0;
+    uint64_t replayed = 0;
+    uint64_t committed_ops = 0;
+    uint64_t commits = 0;
+    uint64_t commit_failures = 0;
+    uint64_t dropped_ops = 0;
+    uint64_t external_writes = 0;  // balance writes that bypassed the ledger, for live accounts
+    size_t outstanding_ops = 0;
+    size_t accounts = 0;
+    int64_t treasury = 0;
+    int64_t treasury_outstanding = 0;
+    size_t last_commit_ops = 0;
+    int64_t last_commit_ms = 0;
+  };
+
+  // Users whose balances a commit changed; runs on the worker, no lock held.
+  using CommittedFn = std::function<void(const std::vector<std::string>& user_ids)>;
+
+  CellLedger(storage::IStorage& storage, Options options);
+  ~CellLedger();
+  CellLedger(const CellLedger&) = delete;
+  CellLedger& operator=(const CellLedger&) = delete;
+
+  // Loads the treasury and starts the commit worker.
+  void Start(CommittedFn on_committed);
+  // Commits what is reserved, then joins.
+  void Stop();
+
+  // Reserves `op`, then waits up to `wait` for its group commit. A reserved op
+  // is kept (and retried) even if the wait runs out; only a commit rejected
+  // by storage (the user row is gone, or storage holds fewer cells than the
+  // ledger believed) turns it into an error.
+  Result Apply(const Op& op, std::chrono::milliseconds wait);
+  // Treasury changed outside the ledger (stabilization, admin).
+  void RefreshTreasury();
+
+  Stats stats() const;
+
+  // storage::UserCacheStorage::WriteListener; any thread.
+  void OnUserBalanceSet(const std::string& user_id, int64_t balance_mi) override;
+  void OnUserBalanceDelta(const std::string& user_id, int64_t delta_mi) override;
+  void OnUserDeleted(const std::string& user_id) override;
+  void OnCellLedgerDelta(const std::string&, int64_t) override {}  // Settle() already moved the base
+  void OnSnakePut(const storage::Snake&) override {}
+  void OnSnakeLength(const std::string&, int64_t) override {}
+  void OnSnakeDeleted(const std::string&) override {}
+  void OnReset() override;
+
+ private:
+  enum class State { kReserved, kCommitted, kFailed };
+  struct Tracked {
+    State state = State::kReserved;
+    Result result;
+    OpKind kind = OpKind::kDebit;
+    int64_t amount = 0;
+  };
+  struct Pending {
+    storage::CellLedgerEntry entry;
+    std::shared_ptr<Tracked> tracked;
+  };
+  struct Group {
+    std::vector<Pending> ops;
+    std::string token;
+    int attempts = 0;
+  };
+  struct Account {
+    int64_t base = 0;         // storage's balance, as of the last commit touching it
+    int64_t outstanding = 0;  // reserved, not yet committed
+    size_t ops = 0;
+    std::chrono::steady_clock::time_point idle_since{};
+    bool stale = false;  // written outside the ledger; reread once settled
+  };
+  enum class CommitOutcome { kSettled, kRetry };
+
+  void Run();
+  // Cuts `batch` into groups that fit one storage commit.
+  void FormGroups(std::vector<Pending>& batch);
+  CommitOutcome CommitGroup(Group& group);
+  // Moves the ops out of the outstanding totals; returns the users touched.
+  // Rejected ops fail with `error` and their accounts are reread.
+  std::vector<std::string> Settle(const std::vector<Pending>& ops, bool committed, const char* error = "");
+  void EvictIdleAccounts();
+  // An absolute write landed for `user_id`: forget the account, or mark it
+  // stale while ops are outstanding. Caller holds mu_.
+  void ResyncAccountLocked(const std::string& user_id);
+  void LoadTreasury();
+  std::string NextToken();
+
+  storage::IStorage& storage_;
+  const Options options_;
+  CommittedFn on_committed_;
+
+  mutable std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable settled_cv_;
+  std::unordered_map<std::string, Account> accounts_;
+  int64_t treasury_base_ = 0;
+  int64_t treasury_outstanding_ = 0;
+  bool treasury_loaded_ = false;
+  bool treasury_refresh_requested_ = false;
+  uint64_t commit_epoch_ = 0;  // bumped whenever a commit settles or a balance moves outside the ledger
+  std::vector<Pending> reserved_;
+  std::unordered_map<std::string, std::shared_ptr<Tracked>> by_op_id_;
+  std::deque<std::string> op_id_order_;
+  bool running_ = false;
+  bool stopping_ = false;
+  Stats stats_;
+
+  // Worker thread only.
+  std::deque<Group> groups_;
+  uint64_t token_seq_ = 0;
+  const uint64_t token_salt_;
+  std::chrono::steady_clock::time_point treasury_loaded_at_{};
+  std::thread worker_;
+};
+
+}  // namespace economy
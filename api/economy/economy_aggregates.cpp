@@ -0,0 +1,279 @@
+#include "economy_aggregates.h"
+
+#include <ctime>
+#include <iostream>
+#include <utility>
+
+namespace economy {
+namespace {
+
+// Scans are eventually consistent and take time; writes this recent are
+// trusted over what the scan returned.
+constexpr int64_t kRecentWriteMs = 5000;
+
+int64_t NowMs() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+EconomyAggregates::~EconomyAggregates() {
+  Stop();
+}
+
+EconomyAggregates::Totals EconomyAggregates::Read() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  Totals t;
+  t.sum_balance_mi = sum_balance_mi_;
+  t.total_capital = total_capital_;
+  t.users = live_users_;
+  t.snakes = live_snakes_;
+  return t;
+}
+
+int64_t EconomyAggregates::UserCapital(const std::string& user_id) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = user_capital_.find(user_id);
+  return it == user_capital_.end() ? 0 : it->second;
+}
+
+void EconomyAggregates::AddCapitalLocked(const std::string& user_id, int64_t delta) {
+  if (delta == 0) return;
+  total_capital_ += delta;
+  auto& c = user_capital_[user_id];
+  c += delta;
+  if (c == 0) user_capital_.erase(user_id);
+}
+
+void EconomyAggregates::SetUserLocked(const std::string& user_id, int64_t balance_mi, int64_t now_ms) {
+  auto [it, inserted] = users_.try_emplace(user_id);
+  UserEntry& e = it->second;
+  if (!inserted && !e.deleted) {
+    sum_balance_mi_ -= e.balance_mi;
+  } else {
+    ++live_users_;
+  }
+  e = UserEntry{balance_mi, now_ms, false, false};
+  sum_balance_mi_ += balance_mi;
+}
+
+void EconomyAggregates::SetSnakeLocked(const std::string& snake_id, SnakeEntry next) {
+  auto [it, inserted] = snakes_.try_emplace(snake_id);
+  SnakeEntry& e = it->second;
+  if (!inserted && !e.deleted) {
+    AddCapitalLocked(e.owner_user_id, -e.capital());
+    if (next.deleted) --live_snakes_;
+  } else if (!next.deleted) {
+    ++live_snakes_;
+  }
+  e = std::move(next);
+  AddCapitalLocked(e.owner_user_id, e.capital());
+}
+
+void EconomyAggregates::OnUserBalanceSet(const std::string& user_id, int64_t balance_mi) {
+  if (user_id.empty()) return;
+  std::lock_guard<std::mutex> lock(mu_);
+  SetUserLocked(user_id, balance_mi, NowMs());
+}
+
+void EconomyAggregates::OnUserBalanceDelta(const std::string& user_id, int64_t delta_mi) {
+  if (user_id.empty() || delta_mi == 0) return;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto [it, inserted] = users_.try_emplace(user_id);
+    UserEntry& e = it->second;
+    const bool known = !inserted && !e.deleted;
+    if (!known) {
+      // No base yet: count the delta now and have the row's base loaded.
+      e = UserEntry{0, 0, false, true};
+      ++live_users_;
+      ++stats_.unknown_user_deltas;
+      to_seed_.push_back(user_id);
+    }
+    e.balance_mi += delta_mi;
+    e.written_ms = NowMs();
+    sum_balance_mi_ += delta_mi;
+    if (known) return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wake_mu_);
+    seed_requested_ = true;
+  }
+  wake_cv_.notify_all();
+}
+
+void EconomyAggregates::SeedPending(storage::IStorage& storage) {
+  std::vector<std::string> ids;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ids.swap(to_seed_);
+  }
+  for (const auto& id : ids) {
+    // Read after the delta landed, so the row already includes it.
+    const auto row = storage.GetUserById(id);
+    if (!row.has_value()) continue;  // left pending; the next reconcile settles it
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = users_.find(id);
+    if (it == users_.end() || !it->second.pending) continue;  // set or deleted meanwhile
+    sum_balance_mi_ += row->balance_mi - it->second.balance_mi;
+    it->second = UserEntry{row->balance_mi, NowMs(), false, false};
+    ++stats_.users_seeded;
+  }
+}
+
+void EconomyAggregates::OnUserDeleted(const std::string& user_id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto [it, inserted] = users_.try_emplace(user_id);
+  if (!inserted && !it->second.deleted) {
+    sum_balance_mi_ -= it->second.balance_mi;
+    --live_users_;
+  }
+  it->second = UserEntry{0, NowMs(), true, false};
+}
+
+void EconomyAggregates::OnSnakePut(const storage::Snake& s) {
+  if (s.snake_id.empty()) return;
+  SnakeEntry next;
+  next.owner_user_id = s.owner_user_id;
+  next.length_k = s.length_k;
+  next.productive = s.alive && s.is_on_field;
+  next.written_ms = NowMs();
+  std::lock_guard<std::mutex> lock(mu_);
+  SetSnakeLocked(s.snake_id, std::move(next));
+}
+
+void EconomyAggregates::OnSnakeLength(const std::string& snake_id, int64_t length_k) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = snakes_.find(snake_id);
+  if (it == snakes_.end() || it->second.deleted) return;
+  SnakeEntry next = it->second;
+  next.length_k = length_k;
+  next.written_ms = NowMs();
+  SetSnakeLocked(snake_id, std::move(next));
+}
+
+void EconomyAggregates::OnSnakeDeleted(const std::string& snake_id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  SnakeEntry next;
+  auto it = snakes_.find(snake_id);
+  if (it != snakes_.end()) next.owner_user_id = it->second.owner_user_id;
+  next.deleted = true;
+  next.written_ms = NowMs();
+  SetSnakeLocked(snake_id, std::move(next));
+}
+
+void EconomyAggregates::OnReset() {
+  std::lock_guard<std::mutex> lock(mu_);
+  users_.clear();
+  snakes_.clear();
+  to_seed_.clear();
+  RebuildTotalsLocked();
+}
+
+void EconomyAggregates::RebuildTotalsLocked() {
+  sum_balance_mi_ = 0;
+  live_users_ = 0;
+  for (const auto& [id, e] : users_) {
+    if (e.deleted) continue;
+    sum_balance_mi_ += e.balance_mi;
+    ++live_users_;
+  }
+  user_capital_.clear();
+  total_capital_ = 0;
+  live_snakes_ = 0;
+  for (const auto& [id, e] : snakes_) {
+    if (e.deleted) continue;
+    ++live_snakes_;
+    AddCapitalLocked(e.owner_user_id, e.capital());
+  }
+}
+
+void EconomyAggregates::Reconcile(storage::IStorage& storage) {
+  const int64_t scan_start_ms = NowMs();
+  const auto users = storage.ListUsers();
+  const auto snakes = storage.ListSnakes();
+
+  std::unordered_map<std::string, UserEntry> next_users;
+  next_users.reserve(users.size());
+  for (const auto& u : users) next_users[u.user_id] = UserEntry{u.balance_mi, 0, false, false};
+  std::unordered_map<std::string, SnakeEntry> next_snakes;
+  next_snakes.reserve(snakes.size());
+  for (const auto& s : snakes) {
+    SnakeEntry e;
+    e.owner_user_id = s.owner_user_id;
+    e.length_k = s.length_k;
+    e.productive = s.alive && s.is_on_field;
+    next_snakes[s.snake_id] = std::move(e);
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  const int64_t trust_after_ms = scan_start_ms - kRecentWriteMs;
+  size_t kept = 0;
+  for (const auto& [id, e] : users_) {
+    if (e.written_ms < trust_after_ms) continue;
+    next_users[id] = e;
+    ++kept;
+  }
+  for (const auto& [id, e] : snakes_) {
+    if (e.written_ms < trust_after_ms) continue;
+    next_snakes[id] = e;
+    ++kept;
+  }
+  const int64_t balance_before = sum_balance_mi_;
+  const int64_t capital_before = total_capital_;
+  const bool first = stats_.reconciles == 0;
+  users_ = std::move(next_users);
+  snakes_ = std::move(next_snakes);
+  RebuildTotalsLocked();
+
+  ++stats_.reconciles;
+  stats_.last_unix = static_cast<int64_t>(std::time(nullptr));
+  stats_.last_duration_ms = NowMs() - scan_start_ms;
+  stats_.last_balance_drift = first ? 0 : sum_balance_mi_ - balance_before;
+  stats_.last_capital_drift = first ? 0 : total_capital_ - capital_before;
+  stats_.last_kept_recent = kept;
+  if (stats_.last_balance_drift != 0 || stats_.last_capital_drift != 0 || first) {
+    std::cout << "[economy] aggregates reconciled users=" << live_users_ << " snakes=" << live_snakes_
+              << " sum_balance_mi=" << sum_balance_mi_ << " total_capital=" << total_capital_
+              << " balance_drift=" << stats_.last_balance_drift << " capital_drift=" << stats_.last_capital_drift
+              << " kept_recent=" << kept << " scan_ms=" << stats_.last_duration_ms << "\n";
+  }
+}
+
+void EconomyAggregates::StartReconciler(storage::IStorage& storage, std::chrono::seconds interval) {
+  if (reconciler_.joinable()) return;
+  reconciler_ = std::thread([this, &storage, interval] {
+    std::unique_lock<std::mutex> lock(wake_mu_);
+    auto next_reconcile = std::chrono::steady_clock::now() + interval;
+    while (true) {
+      wake_cv_.wait_until(lock, next_reconcile, [this] { return stopping_ || seed_requested_; });
+      if (stopping_) break;
+      const bool seed = seed_requested_;
+      seed_requested_ = false;
+      lock.unlock();
+      if (seed) SeedPending(storage);
+      if (std::chrono::steady_clock::now() >= next_reconcile) {
+        Reconcile(storage);
+        next_reconcile = std::chrono::steady_clock::now() + interval;
+      }
+      lock.lock();
+    }
+  });
+}
+
+void EconomyAggregates::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mu_);
+    stopping_ = true;
+  }
+  wake_cv_.notify_all();
+  if (reconciler_.joinable()) reconciler_.join();
+}
+
+EconomyAggregates::ReconcileStats EconomyAggregates::reconcile_stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return stats_;
+}
+
+}  // namespace economy
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../storage/storage.h"
+#include "../storage/user_cache_storage.h"
+
+namespace economy {
+
+// Running totals behind economy reads: the users' summed balance_mi and the
+// deployed (alive, on-field) snake capital, in total and per owner. Kept up to
+// date from writes made through this process (balance intents, borrow, attach,
+// snake upserts/deletes) so a recompute is O(1) instead of two full scans, and
+// reconciled against scans in the background to absorb out-of-process edits.
+// A balance delta for a user not seen yet is counted right away on a pending
+// entry, which the reconciler thread then seeds from the user row.
+class EconomyAggregates final : public storage::UserCacheStorage::WriteListener {
+ public:
+  struct Totals {
+    int64_t sum_balance_mi = 0;
+    int64_t total_capital = 0;
+    size_t users = 0;
+    size_t snakes = 0;
+  };
+
+  struct ReconcileStats {
+    uint64_t reconciles = 0;
+    int64_t last_unix = 0;
+    int64_t last_duration_ms = 0;
+    // Scan minus running value at the last reconcile; non-zero means writes
+    // bypassed this process (or were lost) since the previous one.
+    int64_t last_balance_drift = 0;
+    int64_t last_capital_drift = 0;
+    size_t last_kept_recent = 0;  // keys written during the scan window, left as-is
+    uint64_t unknown_user_deltas = 0;  // deltas that opened a pending entry
+    uint64_t users_seeded = 0;
+  };
+
+  EconomyAggregates() = default;
+  ~EconomyAggregates();
+  EconomyAggregates(const EconomyAggregates&) = delete;
+  EconomyAggregates& operator=(const EconomyAggregates&) = delete;
+
+  Totals Read() const;
+  int64_t UserCapital(const std::string& user_id) const;
+
+  // Rebuilds from ListUsers/ListSnakes. Keys written shortly before or while
+  // the scan ran keep their running values: the scan may predate those writes.
+  void Reconcile(storage::IStorage& storage);
+  // Also seeds pending entries as soon as they appear.
+  void StartReconciler(storage::IStorage& storage, std::chrono::seconds interval);
+  void Stop();
+  ReconcileStats reconcile_stats() const;
+
+  void OnUserBalanceSet(const std::string& user_id, int64_t balance_mi) override;
+  void OnUserBalanceDelta(const std::string& user_id, int64_t delta_mi) override;
+  void OnUserDeleted(const std::string& user_id) override;
+  void OnSnakePut(const storage::Snake& s) override;
+  void OnSnakeLength(const std::string& snake_id, int64_t length_k) override;
+  void OnSnakeDeleted(const std::string& snake_id) override;
+  void OnReset() override;
+
+ private:
+  struct UserEntry {
+    int64_t balance_mi = 0;
+    int64_t written_ms = 0;  // 0: loaded by a scan
+    bool deleted = false;    // tombstone so a stale scan cannot resurrect it
+    bool pending = false;    // deltas only; the row's base is not loaded yet
+  };
+  struct SnakeEntry {
+    std::string owner_user_id;
+    int64_t length_k = 0;
+    bool productive = false;
+    int64_t written_ms = 0;
+    bool deleted = false;
+    int64_t capital() const { return productive && !deleted ? std::max<int64_t>(0, length_k) : 0; }
+  };
+
+  void SetUserLocked(const std::string& user_id, int64_t balance_mi, int64_t now_ms);
+  void SetSnakeLocked(const std::string& snake_id, SnakeEntry next);
+  void AddCapitalLocked(const std::string& user_id, int64_t delta);
+  void RebuildTotalsLocked();
+  void SeedPending(storage::IStorage& storage);
+
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, UserEntry> users_;
+  std::unordered_map<std::string, SnakeEntry> snakes_;
+  std::unordered_map<std::string, int64_t> user_capital_;
+  int64_t sum_balance_mi_ = 0;
+  int64_t total_capital_ = 0;
+  size_t live_users_ = 0;
+  size_t live_snakes_ = 0;
+  ReconcileStats stats_;
+  std::vector<std::string> to_seed_;
+
+  std::mutex wake_mu_;
+  std::condition_variable wake_cv_;
+  bool stopping_ = false;
+  bool seed_requested_ = false;
+  std::thread reconciler_;
+};
+
+}  // namespace economy
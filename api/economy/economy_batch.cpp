@@ -0,0 +1,121 @@
+#include "economy_batch.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace economy {
+
+UserIndex::UserIndex(const std::vector<storage::User>& users) {
+  ids_.reserve(users.size());
+  pos_.reserve(users.size());
+  for (const auto& u : users) {
+    if (pos_.emplace(u.user_id, static_cast<uint32_t>(ids_.size())).second) ids_.push_back(u.user_id);
+  }
+}
+
+size_t UserIndex::Find(const std::string& user_id) const {
+  auto it = pos_.find(user_id);
+  return it == pos_.end() ? npos : it->second;
+}
+
+void UserColumns::resize(size_t n) {
+  y.resize(n);
+  k.resize(n);
+  l.resize(n);
+  prev_y.resize(n);
+  prev_k.resize(n);
+  has_prev.resize(n);
+}
+
+void UserResultColumns::resize(size_t n) {
+  y.resize(n);
+  k.resize(n);
+  l.resize(n);
+  alpha.resize(n);
+  a.resize(n);
+  market_share.resize(n);
+  alpha_bootstrap.resize(n);
+}
+
+void ComputeUsersBatch(const UserColumns& in,
+                       int64_t global_y,
+                       double alpha_bootstrap_default,
+                       UserResultColumns& out,
+                       size_t begin,
+                       size_t end) {
+  const int64_t* __restrict in_y = in.y.data();
+  const int64_t* __restrict in_k = in.k.data();
+  const int64_t* __restrict in_l = in.l.data();
+  const int64_t* __restrict prev_y = in.prev_y.data();
+  const int64_t* __restrict prev_k = in.prev_k.data();
+  const uint8_t* __restrict has_prev = in.has_prev.data();
+  int64_t* __restrict y = out.y.data();
+  int64_t* __restrict k = out.k.data();
+  int64_t* __restrict l = out.l.data();
+  double* __restrict alpha = out.alpha.data();
+  double* __restrict a = out.a.data();
+  double* __restrict share = out.market_share.data();
+  uint8_t* __restrict bootstrap = out.alpha_bootstrap.data();
+
+  const double alpha0 = std::max(0.05, std::min(0.95, alpha_bootstrap_default));
+  const double gy = static_cast<double>(std::max<int64_t>(global_y, 1));
+
+  // Pass 1: clamps, market share and alpha; selects instead of branches.
+  for (size_t i = begin; i < end; ++i) {
+    const int64_t yi = std::max<int64_t>(0, in_y[i]);
+    const int64_t ki = std::max<int64_t>(0, in_k[i]);
+    y[i] = yi;
+    k[i] = ki;
+    l[i] = std::max<int64_t>(0, in_l[i]);
+    share[i] = static_cast<double>(yi) / gy;
+    const double d_y = static_cast<double>(yi - prev_y[i]);
+    const int64_t d_k = ki - prev_k[i];
+    const double mpk = d_k > 0 ? d_y / static_cast<double>(d_k > 0 ? d_k : 1) : 0.0;
+    double fitted = (mpk * static_cast<double>(ki)) / static_cast<double>(yi > 1 ? yi : 1);
+    fitted = fitted < 0.0 ? 0.0 : (fitted > 1.0 ? 1.0 : fitted);
+    alpha[i] = has_prev[i] ? fitted : alpha0;
+    bootstrap[i] = has_prev[i] ? 0 : 1;
+  }
+
+  // Pass 2: A = Y / (K^alpha * L^(1-alpha)), with K and L floored at 1.
+  for (size_t i = begin; i < end; ++i) {
+    const double log_k = std::log(static_cast<double>(k[i] > 1 ? k[i] : 1));
+    const double log_l = std::log(static_cast<double>(l[i] > 1 ? l[i] : 1));
+    const double denom = std::exp(alpha[i] * log_k + (1.0 - alpha[i]) * log_l);
+    a[i] = static_cast<double>(y[i]) / (denom > 1e-9 ? denom : 1e-9);
+  }
+}
+
+int64_t ProductiveCapitalByUser(const std::vector<storage::Snake>& snakes,
+                                const UserIndex& index,
+                                std::vector<int64_t>& per_user) {
+  per_user.assign(index.size(), 0);
+  int64_t total = 0;
+  for (const auto& s : snakes) {
+    if (!s.alive || !s.is_on_field) continue;
+    const int64_t k = std::max<int64_t>(0, s.length_k);
+    total += k;
+    const size_t i = index.Find(s.owner_user_id);
+    if (i != UserIndex::npos) per_user[i] += k;
+  }
+  return total;
+}
+
+std::optional<EconomyUserSnapshot> ClosedUserColumns::Find(const std::string& user_id) const {
+  const size_t i = index.Find(user_id);
+  if (i == UserIndex::npos || i >= values.size()) return std::nullopt;
+  EconomyUserSnapshot s;
+  s.period_id = period_id;
+  s.user_id = user_id;
+  s.y_u = values.y[i];
+  s.k_u = values.k[i];
+  s.l_u = values.l[i];
+  s.alpha_u = values.alpha[i];
+  s.a_u = values.a[i];
+  s.market_share = values.market_share[i];
+  s.alpha_bootstrap = values.alpha_bootstrap[i] != 0;
+  if (i < storage_balance.size()) s.storage_balance = storage_balance[i];
+  return s;
+}
+
+}  // namespace economy
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../storage/models.h"
+#include "economy_v1.h"
+
+namespace economy {
+
+// Dense 0..n-1 indices for user ids, in the order they were added. Columns
+// below are addressed by these indices instead of by string id.
+class UserIndex {
+ public:
+  UserIndex() = default;
+  explicit UserIndex(const std::vector<storage::User>& users);
+
+  size_t size() const { return ids_.size(); }
+  const std::string& id(size_t i) const { return ids_[i]; }
+  // npos when unknown.
+  size_t Find(const std::string& user_id) const;
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+ private:
+  std::vector<std::string> ids_;
+  std::unordered_map<std::string, uint32_t> pos_;
+};
+
+// Per-user period inputs, one element per dense index.
+struct UserColumns {
+  std::vector<int64_t> y;        // effective output (real output, else harvested food)
+  std::vector<int64_t> k;        // deployed capital
+  std::vector<int64_t> l;        // labor (movement ticks)
+  std::vector<int64_t> prev_y;   // last closing y_u; read only where has_prev
+  std::vector<int64_t> prev_k;   // last closing k_u
+  std::vector<uint8_t> has_prev;
+
+  void resize(size_t n);
+  size_t size() const { return y.size(); }
+};
+
+struct UserResultColumns {
+  std::vector<int64_t> y;
+  std::vector<int64_t> k;
+  std::vector<int64_t> l;
+  std::vector<double> alpha;
+  std::vector<double> a;
+  std::vector<double> market_share;
+  std::vector<uint8_t> alpha_bootstrap;
+
+  void resize(size_t n);
+  size_t size() const { return y.size(); }
+};
+
+// ComputeUser for rows [begin, end) in branch-free passes over the columns;
+// `out` must already be sized. Matches the scalar path to floating-point
+// rounding (A uses exp/log instead of pow).
+void ComputeUsersBatch(const UserColumns& in,
+                       int64_t global_y,
+                       double alpha_bootstrap_default,
+                       UserResultColumns& out,
+                       size_t begin,
+                       size_t end);
+
+// AggregateProductiveCapital by dense index: fills `per_user` (sized to the
+// index) and returns the total, which also counts owners missing from it.
+int64_t ProductiveCapitalByUser(const std::vector<storage::Snake>& snakes,
+                                const UserIndex& index,
+                                std::vector<int64_t>& per_user);
+
+// Closing per-user values of a finalized period.
+struct ClosedUserColumns {
+  std::string period_id;
+  UserIndex index;
+  UserResultColumns values;
+  std::vector<int64_t> storage_balance;
+
+  // The user's closing snapshot.
+  std::optional<EconomyUserSnapshot> Find(const std::string& user_id) const;
+};
+
+}  // namespace economy
@@ -0,0 +1,219 @@
+#include "economy_flush_pipeline.h"
+
+#include <algorithm>
+#include <ctime>
+#include <iostream>
+
+#include "../diagnostics/tracer.h"
+#include "../metrics/metrics.h"
+
+namespace economy {
+
+EconomyFlushPipeline::EconomyFlushPipeline(storage::IStorage& storage,
+                                           PeriodConfig period_cfg,
+                                           std::chrono::milliseconds interval)
+    : storage_(storage), period_cfg_(std::move(period_cfg)), interval_(interval) {}
+
+EconomyFlushPipeline::~EconomyFlushPipeline() {
+  Stop();
+  for (Node* n = head_.exchange(nullptr); n != nullptr;) {
+    Node* next = n->next;
+    delete n;
+    n = next;
+  }
+}
+
+void EconomyFlushPipeline::Start(FinalizeFn finalize, WrittenFn on_written) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (running_ || stopping_) return;
+  finalize_ = std::move(finalize);
+  on_written_ = std::move(on_written);
+  running_ = true;
+  worker_ = std::thread([this] { Run(); });
+}
+
+void EconomyFlushPipeline::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  wake_cv_.notify_all();
+  if (worker_.joinable()) worker_.join();
+}
+
+void EconomyFlushPipeline::Submit(Activity activity) {
+  queued_harvested_food_.fetch_add(activity.harvested_food, std::memory_order_relaxed);
+  queued_movement_ticks_.fetch_add(activity.movement_ticks, std::memory_order_relaxed);
+  submitted_.fetch_add(1, std::memory_order_relaxed);
+  Node* node = new Node{std::move(activity), head_.load(std::memory_order_relaxed)};
+  while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+}
+
+void EconomyFlushPipeline::RequestFinalize(std::string period_id) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    finalize_queue_.push_back(std::move(period_id));
+  }
+  wake_cv_.notify_one();
+}
+
+void EconomyFlushPipeline::FlushNow() {
+  std::unique_lock<std::mutex> lock(mu_);
+  if (!running_) return;
+  const uint64_t ticket = ++flush_requested_;
+  wake_cv_.notify_one();
+  done_cv_.wait(lock, [&] { return flush_done_ >= ticket || !running_; });
+}
+
+EconomyFlushPipeline::Stats EconomyFlushPipeline::stats() const {
+  Stats out;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    out = stats_;
+  }
+  out.submitted = submitted_.load(std::memory_order_relaxed);
+  out.pending_harvested_food += queued_harvested_food_.load(std::memory_order_relaxed);
+  out.pending_movement_ticks += queued_movement_ticks_.load(std::memory_order_relaxed);
+  return out;
+}
+
+void EconomyFlushPipeline::Drain() {
+  Node* n = head_.exchange(nullptr, std::memory_order_acquire);
+  // Stack order is newest first; sums do not care.
+  int64_t cached_unix = -1;
+  PeriodDeltas* cached = nullptr;
+  bool cached_late = false;
+  while (n != nullptr) {
+    const Activity& a = n->activity;
+    if (a.at_unix != cached_unix) {
+      cached_unix = a.at_unix;
+      std::string period_id = CurrentPeriodState(static_cast<std::time_t>(a.at_unix), period_cfg_).period_id;
+      cached_late = std::find(finalized_.begin(), finalized_.end(), period_id) != finalized_.end();
+      if (cached_late) period_id = CurrentPeriodState(std::time(nullptr), period_cfg_).period_id;
+      cached = &pending_[period_id];
+    }
+    if (cached_late) ++late_activity_moved_;
+    cached->harvested_food += a.harvested_food;
+    cached->movement_ticks += a.movement_ticks;
+    for (const auto& u : a.users) {
+      if (u.user_id <= 0 || (u.harvested_food == 0 && u.movement_ticks == 0)) continue;
+      auto& row = cached->users[u.user_id];
+      row.first += u.harvested_food;
+      row.second += u.movement_ticks;
+    }
+    queued_harvested_food_.fetch_sub(a.harvested_food, std::memory_order_relaxed);
+    queued_movement_ticks_.fetch_sub(a.movement_ticks, std::memory_order_relaxed);
+    Node* next = n->next;
+    delete n;
+    n = next;
+  }
+}
+
+bool EconomyFlushPipeline::WritePending(std::vector<int>& touched_users) {
+  static auto& flush_seconds = metrics::Default().GetHistogram(
+      "snake_economy_compute_seconds", "Economy recompute duration by operation.", {{"op", "flush_pending"}},
+      metrics::Histogram::kSeconds);
+  if (pending_.empty()) return false;
+  metrics::ScopedTimer timer(flush_seconds);
+  diagnostics::TraceSpan span("economy", "flush_pending");
+  const auto started = std::chrono::steady_clock::now();
+  uint64_t batches = 0;
+  uint64_t rows_written = 0;
+  uint64_t failures = 0;
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    PeriodDeltas& p = it->second;
+    std::vector<storage::EconomyPeriodUserDelta> rows;
+    rows.reserve(p.users.size());
+    for (const auto& [uid, hm] : p.users) {
+      if (hm.first == 0 && hm.second == 0) continue;
+      rows.push_back({std::to_string(uid), hm.first, hm.second});
+      touched_users.push_back(uid);
+    }
+    const size_t row_count = rows.size();
+    if (storage_.IncrementEconomyPeriodRawBatch(it->first, p.harvested_food, p.movement_ticks, rows)) {
+      ++batches;
+      rows_written += row_count;
+      it = pending_.erase(it);
+      continue;
+    }
+    // Keep exactly what did not land for the next pass.
+    ++failures;
+    rows_written += row_count - rows.size();
+    p.users.clear();
+    for (const auto& r : rows) p.users[std::stoi(r.user_id)] = {r.harvested_food, r.movement_ticks};
+    std::cerr << "[economy] delta flush failed period=" << it->first << " users_left=" << rows.size()
+              << "; retrying next pass\n";
+    ++it;
+  }
+  const int64_t elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+  std::lock_guard<std::mutex> lock(mu_);
+  stats_.batches_written += batches;
+  stats_.user_rows_written += rows_written;
+  stats_.write_failures += failures;
+  stats_.last_write_ms = elapsed_ms;
+  return batches > 0 || rows_written > 0;
+}
+
+void EconomyFlushPipeline::Run() {
+  diagnostics::DefaultTracer().SetThreadName("economy_flush");
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    wake_cv_.wait_for(lock, interval_, [this] {
+      return stopping_ || flush_requested_ != flush_done_ || !finalize_queue_.empty();
+    });
+    const bool stopping = stopping_;
+    const uint64_t ticket = flush_requested_;
+    std::deque<std::string> finalize;
+    finalize.swap(finalize_queue_);
+    lock.unlock();
+
+    Drain();
+    std::vector<int> touched_users;
+    const bool wrote = WritePending(touched_users);
+    // A period is finalized only once its deltas are stored; otherwise the
+    // closing snapshot would miss them. Stopping finalizes regardless.
+    for (auto& period_id : finalize) waiting_finalize_.push_back(std::move(period_id));
+    uint64_t finalized_now = 0;
+    for (auto it = waiting_finalize_.begin(); it != waiting_finalize_.end();) {
+      if (pending_.count(*it) != 0 && !stopping) {
+        ++it;
+        continue;
+      }
+      if (pending_.count(*it) != 0) {
+        std::cerr << "[economy] finalizing period=" << *it << " with unwritten deltas at shutdown\n";
+      }
+      if (finalize_) finalize_(*it);
+      finalized_.push_front(*it);
+      if (finalized_.size() > kFinalizedKept) finalized_.pop_back();
+      ++finalized_now;
+      it = waiting_finalize_.erase(it);
+    }
+    if (wrote && on_written_) on_written_(touched_users);
+
+    lock.lock();
+    stats_.periods_finalized += finalized_now;
+    stats_.finalizations_waiting = waiting_finalize_.size();
+    stats_.late_activity_moved = late_activity_moved_;
+    stats_.pending_harvested_food = 0;
+    stats_.pending_movement_ticks = 0;
+    stats_.pending_users = 0;
+    for (const auto& [period_id, p] : pending_) {
+      stats_.pending_harvested_food += p.harvested_food;
+      stats_.pending_movement_ticks += p.movement_ticks;
+      stats_.pending_users += p.users.size();
+    }
+    stats_.last_pass_at = std::chrono::steady_clock::now();
+    flush_done_ = ticket;
+    done_cv_.notify_all();
+    if (stopping && finalize_queue_.empty()) break;
+  }
+  if (!pending_.empty()) {
+    std::cerr << "[economy] stopping with " << pending_.size() << " period(s) of unwritten deltas\n";
+  }
+  running_ = false;
+  done_cv_.notify_all();
+}
+
+}  // namespace economy
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../storage/storage.h"
+#include "economy_v1.h"
+
+namespace economy {
+
+// Economy period counters (harvested food, movement ticks; per period and per
+// user) handed off by the tick loop and written by a dedicated worker.
+// Submit() is a lock-free push, so the tick thread never waits on storage.
+// Each pass the worker coalesces everything queued by period and user and
+// writes a period with one batched storage call; whatever fails stays
+// coalesced for the next pass. Period finalization runs on the same worker,
+// once every delta of that period queued before it was requested has been
+// written; a failed write keeps it waiting for a later pass. Activity for a
+// period that is already finalized (stamped just before rollover, submitted
+// after) is counted in the current period instead of reopening the closed one.
+class EconomyFlushPipeline {
+ public:
+  struct UserActivity {
+    int user_id = 0;
+    int64_t harvested_food = 0;
+    int64_t movement_ticks = 0;
+  };
+  struct Activity {
+    int64_t at_unix = 0;  // picks the period the counters belong to
+    int64_t harvested_food = 0;
+    int64_t movement_ticks = 0;
+    std::vector<UserActivity> users;  // the same user may appear more than once
+  };
+
+  struct Stats {
+    uint64_t submitted = 0;
+    uint64_t batches_written = 0;
+    uint64_t user_rows_written = 0;
+    uint64_t write_failures = 0;
+    uint64_t periods_finalized = 0;
+    uint64_t late_activity_moved = 0;  // submissions folded into the current period
+    size_t finalizations_waiting = 0;  // requested, held back by unwritten deltas
+    int64_t last_write_ms = 0;
+    // Not yet written: still queued, or coalesced and awaiting (re)try.
+    int64_t pending_harvested_food = 0;
+    int64_t pending_movement_ticks = 0;
+    size_t pending_users = 0;
+    std::chrono::steady_clock::time_point last_pass_at{};
+  };
+
+  using FinalizeFn = std::function<void(const std::string& period_id)>;
+  // Users whose period rows the pass attempted to write (landed or not).
+  using WrittenFn = std::function<void(const std::vector<int>& user_ids)>;
+
+  EconomyFlushPipeline(storage::IStorage& storage, PeriodConfig period_cfg, std::chrono::milliseconds interval);
+  ~EconomyFlushPipeline();
+  EconomyFlushPipeline(const EconomyFlushPipeline&) = delete;
+  EconomyFlushPipeline& operator=(const EconomyFlushPipeline&) = delete;
+
+  // Callbacks run on the worker without any pipeline lock held; on_written
+  // fires after a pass that stored something.
+  void Start(FinalizeFn finalize, WrittenFn on_written);
+  // Writes what is queued, runs pending finalizations, then joins.
+  void Stop();
+
+  // Any thread; never blocks.
+  void Submit(Activity activity);
+  // Asynchronous; the period is finalized after deltas queued so far are written.
+  void RequestFinalize(std::string period_id);
+  // Blocks until everything submitted before the call has been attempted. Must
+  // not be called from the callbacks or while holding a lock they take.
+  void FlushNow();
+
+  Stats stats() const;
+
+ private:
+  struct Node {
+    Activity activity;
+    Node* next = nullptr;
+  };
+  struct PeriodDeltas {
+    int64_t harvested_food = 0;
+    int64_t movement_ticks = 0;
+    std::unordered_map<int, std::pair<int64_t, int64_t>> users;
+  };
+
+  void Run();
+  void Drain();
+  bool WritePending(std::vector<int>& touched_users);
+
+  storage::IStorage& storage_;
+  const PeriodConfig period_cfg_;
+  const std::chrono::milliseconds interval_;
+  FinalizeFn finalize_;
+  WrittenFn on_written_;
+
+  // Intake: a Treiber stack the worker empties with one exchange.
+  std::atomic<Node*> head_{nullptr};
+  std::atomic<uint64_t> submitted_{0};
+  std::atomic<int64_t> queued_harvested_food_{0};
+  std::atomic<int64_t> queued_movement_ticks_{0};
+
+  // Worker thread only.
+  std::map<std::string, PeriodDeltas> pending_;
+  std::deque<std::string> waiting_finalize_;
+  std::deque<std::string> finalized_;  // most recent first, kFinalizedKept long
+  uint64_t late_activity_moved_ = 0;
+  static constexpr size_t kFinalizedKept = 8;
+
+  mutable std::mutex mu_;
+  std::condition_variable wake_cv_;
+  std::condition_variable done_cv_;
+  bool running_ = false;
+  bool stopping_ = false;
+  uint64_t flush_requested_ = 0;
+  uint64_t flush_done_ = 0;
+  std::deque<std::string> finalize_queue_;
+  Stats stats_;
+  std::thread worker_;
+};
+
+}  // namespace economy
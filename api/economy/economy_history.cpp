@@ -0,0 +1,460 @@
+#include "economy_history.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+namespace economy {
+namespace {
+
+constexpr char kMagic[8] = {'S', 'N', 'K', 'H', 'I', 'S', '0', '1'};
+constexpr const char* kSuffix = ".seg";
+constexpr uint32_t kGlobalCapacity = 4096;
+constexpr uint32_t kUserCapacity = 65536;
+constexpr int64_t kMicrosPerDay = 86400LL * 1000000LL;
+
+struct SegmentHeader {
+  char magic[8];
+  uint32_t series;
+  uint32_t columns;
+  uint32_t capacity;
+  uint32_t rows;
+  int64_t first_ts_us;
+  int64_t last_ts_us;
+  uint8_t reserved[24];
+};
+static_assert(sizeof(SegmentHeader) == 64, "segment header is 64 bytes");
+
+// Leading int64 columns (timestamp, and the user id for user segments).
+size_t KeyColumns(EconomyHistoryStore::Series series) {
+  return series == EconomyHistoryStore::Series::kUser ? 2 : 1;
+}
+
+const char* SeriesName(EconomyHistoryStore::Series series) {
+  return series == EconomyHistoryStore::Series::kUser ? "user" : "global";
+}
+
+// Sequence number from a "<series>-<ts>-<seq>.seg" file name; 0 if absent.
+uint64_t SegmentSeq(const std::string& path) {
+  const std::string stem = std::filesystem::path(path).stem().string();
+  const size_t dash = stem.rfind('-');
+  if (dash == std::string::npos) return 0;
+  return std::strtoull(stem.c_str() + dash + 1, nullptr, 10);
+}
+
+}  // namespace
+
+class EconomyHistoryStore::Segment {
+ public:
+  static std::shared_ptr<Segment> Create(const std::string& path, Series series, uint32_t capacity, int64_t ts_us) {
+    const uint32_t columns = static_cast<uint32_t>(KeyColumns(series) + ColumnNames(series).size());
+    const size_t bytes = sizeof(SegmentHeader) + static_cast<size_t>(columns) * capacity * 8;
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) return nullptr;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+      close(fd);
+      unlink(path.c_str());
+      return nullptr;
+    }
+    auto seg = Map(path, fd, bytes);
+    if (!seg) {
+      unlink(path.c_str());
+      return nullptr;
+    }
+    SegmentHeader* h = seg->header();
+    std::memcpy(h->magic, kMagic, sizeof(kMagic));
+    h->series = static_cast<uint32_t>(series);
+    h->columns = columns;
+    h->capacity = capacity;
+    h->rows = 0;
+    h->first_ts_us = ts_us;
+    h->last_ts_us = ts_us;
+    seg->Init();
+    return seg;
+  }
+
+  static std::shared_ptr<Segment> Open(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+      close(fd);
+      return nullptr;
+    }
+    auto seg = Map(path, fd, static_cast<size_t>(st.st_size));
+    if (!seg) return nullptr;
+    const SegmentHeader* h = seg->header();
+    const bool known_series = h->series == static_cast<uint32_t>(Series::kGlobal) ||
+                              h->series == static_cast<uint32_t>(Series::kUser);
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || !known_series) return nullptr;
+    const Series series = static_cast<Series>(h->series);
+    const size_t columns = KeyColumns(series) + ColumnNames(series).size();
+    const size_t expected = sizeof(SegmentHeader) + columns * static_cast<size_t>(h->capacity) * 8;
+    if (h->columns != columns || seg->bytes_ < expected || h->rows > h->capacity) return nullptr;
+    seg->Init();
+    seg->IndexUids();
+    return seg;
+  }
+
+  ~Segment() {
+    if (base_ != nullptr) munmap(base_, bytes_);
+    if (fd_ >= 0) close(fd_);
+  }
+
+  const std::string& path() const { return path_; }
+  Series series() const { return series_; }
+  uint32_t capacity() const { return capacity_; }
+  uint32_t rows() const { return rows_.load(std::memory_order_acquire); }
+  bool full() const { return rows() >= capacity_; }
+  int64_t first_ts_us() const { return header()->first_ts_us; }
+  int64_t last_ts_us() const { return last_ts_us_.load(std::memory_order_acquire); }
+
+  const int64_t* keys(size_t col) const { return reinterpret_cast<const int64_t*>(column(col)); }
+  const double* values(size_t v) const { return reinterpret_cast<const double*>(column(key_columns_ + v)); }
+
+  // Single writer; readers only look at rows below rows().
+  void Append(int64_t ts_us, int64_t user_id, const double* vals) {
+    const uint32_t i = rows_.load(std::memory_order_relaxed);
+    reinterpret_cast<int64_t*>(column(0))[i] = ts_us;
+    if (key_columns_ > 1) reinterpret_cast<int64_t*>(column(1))[i] = user_id;
+    for (size_t v = 0; v < value_columns_; ++v) reinterpret_cast<double*>(column(key_columns_ + v))[i] = vals[v];
+    SegmentHeader* h = header();
+    h->rows = i + 1;
+    h->last_ts_us = std::max(h->last_ts_us, ts_us);
+    last_ts_us_.store(h->last_ts_us, std::memory_order_release);
+    rows_.store(i + 1, std::memory_order_release);
+  }
+
+  void Sync() { msync(base_, bytes_, MS_ASYNC); }
+
+  // User segments: (uid, row) pairs sorted by uid, then row, over the first
+  // `rows` rows. Replaced whole, so readers never see a half-built index.
+  struct UidIndex {
+    std::vector<std::pair<int64_t, uint32_t>> entries;
+    uint32_t rows = 0;
+  };
+
+  std::shared_ptr<const UidIndex> uid_index() const { return std::atomic_load(&uid_index_); }
+
+  // Writer only: folds the rows appended since the last call into the index.
+  void IndexUids() {
+    if (key_columns_ < 2) return;
+    const auto cur = std::atomic_load(&uid_index_);
+    const uint32_t from = cur ? cur->rows : 0;
+    const uint32_t n = rows();
+    if (cur && from == n) return;
+    std::vector<std::pair<int64_t, uint32_t>> added;
+    added.reserve(n - from);
+    const int64_t* uid = keys(1);
+    for (uint32_t r = from; r < n; ++r) added.emplace_back(uid[r], r);
+    std::sort(added.begin(), added.end());
+    auto next = std::make_shared<UidIndex>();
+    next->rows = n;
+    if (cur) {
+      next->entries.reserve(cur->entries.size() + added.size());
+      std::merge(cur->entries.begin(), cur->entries.end(), added.begin(), added.end(),
+                 std::back_inserter(next->entries));
+    } else {
+      next->entries = std::move(added);
+    }
+    std::atomic_store(&uid_index_, std::shared_ptr<const UidIndex>(std::move(next)));
+  }
+
+ private:
+  Segment() = default;
+
+  static std::shared_ptr<Segment> Map(const std::string& path, int fd, size_t bytes) {
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      return nullptr;
+    }
+    std::shared_ptr<Segment> seg(new Segment());
+    seg->path_ = path;
+    seg->fd_ = fd;
+    seg->base_ = static_cast<char*>(p);
+    seg->bytes_ = bytes;
+    return seg;
+  }
+
+  void Init() {
+    const SegmentHeader* h = header();
+    series_ = static_cast<Series>(h->series);
+    capacity_ = h->capacity;
+    key_columns_ = KeyColumns(series_);
+    value_columns_ = h->columns - key_columns_;
+    rows_.store(h->rows, std::memory_order_release);
+    last_ts_us_.store(h->last_ts_us, std::memory_order_release);
+  }
+
+  SegmentHeader* header() { return reinterpret_cast<SegmentHeader*>(base_); }
+  const SegmentHeader* header() const { return reinterpret_cast<const SegmentHeader*>(base_); }
+  char* column(size_t c) const { return base_ + sizeof(SegmentHeader) + c * static_cast<size_t>(capacity_) * 8; }
+
+  std::string path_;
+  int fd_ = -1;
+  char* base_ = nullptr;
+  size_t bytes_ = 0;
+  Series series_ = Series::kGlobal;
+  uint32_t capacity_ = 0;
+  size_t key_columns_ = 1;
+  size_t value_columns_ = 0;
+  std::atomic<uint32_t> rows_{0};
+  std::atomic<int64_t> last_ts_us_{0};
+  std::shared_ptr<const UidIndex> uid_index_;
+};
+
+const std::vector<std::string>& EconomyHistoryStore::ColumnNames(Series series) {
+  static const std::vector<std::string> kGlobal = {"M", "P", "pi", "Y", "K", "L", "treasury"};
+  static const std::vector<std::string> kUser = {"Y_u", "K_u", "L_u", "alpha_u", "A_u", "market_share",
+                                                 "storage_balance"};
+  return series == Series::kUser ? kUser : kGlobal;
+}
+
+EconomyHistoryStore::EconomyHistoryStore(Options options) : options_(std::move(options)) {
+  if (!enabled()) return;
+  std::error_code ec;
+  std::filesystem::create_directories(options_.dir, ec);
+  if (ec) std::cerr << "[economy] cannot create history dir " << options_.dir << ": " << ec.message() << "\n";
+  LoadExisting();
+}
+
+EconomyHistoryStore::~EconomyHistoryStore() {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (Chain* c : {&global_, &users_}) {
+    if (!c->segments.empty()) c->segments.back()->Sync();
+  }
+}
+
+void EconomyHistoryStore::LoadExisting() {
+  std::vector<std::shared_ptr<Segment>> found;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(options_.dir, ec), end; !ec && it != end; it.increment(ec)) {
+    const auto& path = it->path();
+    if (path.extension() != kSuffix) continue;
+    auto seg = Segment::Open(path.string());
+    if (!seg) {
+      std::cerr << "[economy] skipping unreadable history segment " << path.string() << "\n";
+      continue;
+    }
+    found.push_back(std::move(seg));
+  }
+  std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+    if (a->first_ts_us() != b->first_ts_us()) return a->first_ts_us() < b->first_ts_us();
+    return SegmentSeq(a->path()) < SegmentSeq(b->path());
+  });
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto& seg : found) {
+    Chain& c = chain(seg->series());
+    c.next_seq = std::max(c.next_seq, SegmentSeq(seg->path()) + 1);
+    c.segments.push_back(std::move(seg));
+  }
+}
+
+EconomyHistoryStore::Segment* EconomyHistoryStore::WritableTail(Series series, int64_t ts_us) {
+  Chain& c = chain(series);
+  if (!c.segments.empty() && !c.segments.back()->full()) return c.segments.back().get();
+  const uint32_t capacity = series == Series::kUser ? kUserCapacity : kGlobalCapacity;
+  const std::string name =
+      std::string(SeriesName(series)) + "-" + std::to_string(ts_us) + "-" + std::to_string(c.next_seq++) + kSuffix;
+  auto seg = Segment::Create((std::filesystem::path(options_.dir) / name).string(), series, capacity, ts_us);
+  if (!seg) {
+    std::cerr << "[economy] cannot create history segment " << name << ": " << std::strerror(errno) << "\n";
+    return nullptr;
+  }
+  c.segments.push_back(std::move(seg));
+  return c.segments.back().get();
+}
+
+bool EconomyHistoryStore::CoveredLocked(Series series, int64_t ts_us) const {
+  const Chain& c = series == Series::kGlobal ? global_ : users_;
+  return !c.segments.empty() && c.segments.back()->rows() > 0 && c.segments.back()->last_ts_us() >= ts_us;
+}
+
+bool EconomyHistoryStore::AppendPeriod(int64_t ts_us, const EconomySnapshot& global) {
+  if (!enabled()) return false;
+  const double vals[] = {static_cast<double>(global.m), global.p,
+                         global.pi, static_cast<double>(global.y),
+                         static_cast<double>(global.k), static_cast<double>(global.l),
+                         static_cast<double>(global.treasury_balance)};
+  std::lock_guard<std::mutex> lock(mu_);
+  if (CoveredLocked(Series::kGlobal, ts_us)) {
+    stale_appends_skipped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  Segment* seg = WritableTail(Series::kGlobal, ts_us);
+  if (seg == nullptr) {
+    append_failures_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  seg->Append(ts_us, 0, vals);
+  seg->Sync();
+  return true;
+}
+
+bool EconomyHistoryStore::AppendUsers(int64_t ts_us, const ClosedUserColumns& users) {
+  if (!enabled()) return false;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (CoveredLocked(Series::kUser, ts_us)) {
+      stale_appends_skipped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  const UserResultColumns& v = users.values;
+  Segment* seg = nullptr;
+  for (size_t i = 0; i < users.index.size(); ++i) {
+    // Ids are decimal strings; anything else has no slot in the key column.
+    char* end = nullptr;
+    const std::string& id = users.index.id(i);
+    const long long uid = std::strtoll(id.c_str(), &end, 10);
+    if (id.empty() || *end != '\0') continue;
+    const double vals[] = {static_cast<double>(v.y[i]), static_cast<double>(v.k[i]),
+                           static_cast<double>(v.l[i]), v.alpha[i],
+                           v.a[i], v.market_share[i],
+                           static_cast<double>(i < users.storage_balance.size() ? users.storage_balance[i] : 0)};
+    if (seg == nullptr || seg->full()) {
+      if (seg != nullptr) {
+        seg->IndexUids();
+        seg->Sync();
+      }
+      std::lock_guard<std::mutex> lock(mu_);
+      seg = WritableTail(Series::kUser, ts_us);
+      if (seg == nullptr) {
+        append_failures_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    seg->Append(ts_us, uid, vals);
+  }
+  if (seg != nullptr) {
+    seg->IndexUids();
+    seg->Sync();
+  }
+  return true;
+}
+
+void EconomyHistoryStore::ApplyRetention(int64_t now_us) {
+  if (!enabled()) return;
+  const int64_t cutoff = now_us - static_cast<int64_t>(std::max(1, options_.retention_days)) * kMicrosPerDay;
+  std::vector<std::shared_ptr<Segment>> expired;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (Chain* c : {&global_, &users_}) {
+      auto& segs = c->segments;
+      auto keep = std::find_if(segs.begin(), segs.end(), [&](const auto& s) { return s->last_ts_us() >= cutoff; });
+      expired.insert(expired.end(), segs.begin(), keep);
+      segs.erase(segs.begin(), keep);
+    }
+  }
+  // Queries holding a segment keep its mapping alive past the unlink.
+  std::error_code ec;
+  for (const auto& seg : expired) std::filesystem::remove(seg->path(), ec);
+  segments_expired_.fetch_add(expired.size(), std::memory_order_relaxed);
+}
+
+std::vector<std::shared_ptr<EconomyHistoryStore::Segment>> EconomyHistoryStore::SnapshotChain(Series series) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return series == Series::kGlobal ? global_.segments : users_.segments;
+}
+
+EconomyHistoryStore::Result EconomyHistoryStore::Run(const Query& q) const {
+  Result out;
+  out.names = ColumnNames(q.series);
+  const size_t cols = out.names.size();
+  out.buckets.resize(cols);
+  // Timestamps are never negative; rejecting them keeps the span from overflowing.
+  if (!enabled() || q.step_us <= 0 || q.from_us < 0 || q.to_us <= q.from_us) return out;
+  const int64_t span = q.to_us - q.from_us;
+  const size_t nb = static_cast<size_t>(span / q.step_us + (span % q.step_us != 0 ? 1 : 0));
+  if (nb == 0 || nb > kMaxBuckets) return out;
+
+  struct Acc {
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0.0;
+    uint32_t n = 0;
+  };
+  std::vector<Acc> acc(cols * nb);
+  for (const auto& seg : SnapshotChain(q.series)) {
+    if (seg->last_ts_us() < q.from_us || seg->first_ts_us() >= q.to_us) continue;
+    const int64_t* ts = seg->keys(0);
+    auto add = [&](uint32_t r) {
+      ++out.rows_scanned;
+      if (ts[r] < q.from_us || ts[r] >= q.to_us) return;
+      const size_t b = static_cast<size_t>((ts[r] - q.from_us) / q.step_us);
+      for (size_t c = 0; c < cols; ++c) {
+        const double v = seg->values(c)[r];
+        Acc& a = acc[c * nb + b];
+        a.min = std::min(a.min, v);
+        a.max = std::max(a.max, v);
+        a.sum += v;
+        ++a.n;
+      }
+    };
+    if (q.series == Series::kGlobal) {
+      const uint32_t rows = seg->rows();
+      for (uint32_t r = 0; r < rows; ++r) add(r);
+      continue;
+    }
+    // The index is loaded before the row count so it never covers rows past it;
+    // rows appended after the last index update are checked one by one.
+    const auto index = seg->uid_index();
+    const uint32_t rows = seg->rows();
+    uint32_t indexed = 0;
+    if (index) {
+      indexed = index->rows;
+      const auto& e = index->entries;
+      for (auto it = std::lower_bound(e.begin(), e.end(), std::make_pair(q.user_id, uint32_t{0}));
+           it != e.end() && it->first == q.user_id; ++it) {
+        add(it->second);
+      }
+    }
+    const int64_t* uid = seg->keys(1);
+    for (uint32_t r = indexed; r < rows; ++r) {
+      if (uid[r] == q.user_id) add(r);
+    }
+  }
+  for (size_t c = 0; c < cols; ++c) {
+    for (size_t b = 0; b < nb; ++b) {
+      const Acc& a = acc[c * nb + b];
+      if (a.n == 0) continue;
+      out.buckets[c].push_back(Bucket{q.from_us + static_cast<int64_t>(b) * q.step_us, a.min, a.max,
+                                      a.sum / static_cast<double>(a.n), a.n});
+    }
+  }
+  return out;
+}
+
+EconomyHistoryStore::Stats EconomyHistoryStore::stats() const {
+  Stats out;
+  std::lock_guard<std::mutex> lock(mu_);
+  out.global_segments = global_.segments.size();
+  out.user_segments = users_.segments.size();
+  for (const auto& s : global_.segments) out.global_rows += s->rows();
+  for (const auto& s : users_.segments) out.user_rows += s->rows();
+  int64_t oldest = 0;
+  for (const Chain* c : {&global_, &users_}) {
+    if (c->segments.empty()) continue;
+    const int64_t first = c->segments.front()->first_ts_us();
+    oldest = oldest == 0 ? first : std::min(oldest, first);
+  }
+  out.oldest_us = oldest;
+  out.append_failures = append_failures_.load(std::memory_order_relaxed);
+  out.stale_appends_skipped = stale_appends_skipped_.load(std::memory_order_relaxed);
+  out.segments_expired = segments_expired_.load(std::memory_order_relaxed);
+  return out;
+}
+
+}  // namespace economy
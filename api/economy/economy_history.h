@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "economy_batch.h"
+#include "economy_v1.h"
+
+namespace economy {
+
+// Local history of finalized periods: the global snapshot and every user's
+// closing values, appended to columnar, memory-mapped segment files so charts
+// and analytics never read economy rows back from storage.
+//
+// Segment layout: a 64-byte header ("SNKHIS01", series, column count,
+// capacity, row count, first/last timestamp) followed by one array of
+// `capacity` 8-byte values per column. Column 0 is the timestamp in
+// microseconds (int64); user segments carry the numeric user id (int64) in
+// column 1; the remaining columns are doubles. Files are sized up front and
+// filled in place, and the row count is bumped only after the row's columns
+// are written. Segments whose newest row falls out of the retention window
+// are deleted. Each user segment keeps an in-memory uid -> rows index (rebuilt
+// on open, extended after each append) so per-user queries skip other users.
+class EconomyHistoryStore {
+ public:
+  enum class Series { kGlobal = 1, kUser = 2 };
+
+  struct Options {
+    std::string dir;  // empty disables the store
+    int retention_days = 90;
+  };
+
+  struct Query {
+    Series series = Series::kGlobal;
+    int64_t user_id = 0;  // kUser only
+    int64_t from_us = 0;
+    int64_t to_us = 0;  // exclusive
+    int64_t step_us = 0;
+  };
+
+  struct Bucket {
+    int64_t t_us = 0;  // bucket start
+    double min = 0.0;
+    double max = 0.0;
+    double avg = 0.0;
+    uint32_t n = 0;
+  };
+
+  struct Result {
+    std::vector<std::string> names;            // one per value column
+    std::vector<std::vector<Bucket>> buckets;  // [column][bucket], empty buckets omitted
+    uint64_t rows_scanned = 0;  // rows read, after the uid index narrows user segments
+  };
+
+  struct Stats {
+    size_t global_segments = 0;
+    size_t user_segments = 0;
+    uint64_t global_rows = 0;
+    uint64_t user_rows = 0;
+    uint64_t append_failures = 0;
+    uint64_t stale_appends_skipped = 0;  // rows not newer than the series tail
+    uint64_t segments_expired = 0;
+    int64_t oldest_us = 0;
+  };
+
+  static constexpr size_t kMaxBuckets = 2000;
+
+  explicit EconomyHistoryStore(Options options);
+  ~EconomyHistoryStore();
+  EconomyHistoryStore(const EconomyHistoryStore&) = delete;
+  EconomyHistoryStore& operator=(const EconomyHistoryStore&) = delete;
+
+  bool enabled() const { return !options_.dir.empty(); }
+
+  // One writer at a time (the period finalization job). Series stay time
+  // ordered: an append whose timestamp is not newer than the series' latest
+  // row (a recomputed or rewritten period) is skipped and returns false.
+  bool AppendPeriod(int64_t ts_us, const EconomySnapshot& global);
+  bool AppendUsers(int64_t ts_us, const ClosedUserColumns& users);
+  void ApplyRetention(int64_t now_us);
+
+  // Any thread. Downsamples each value column into `step_us` buckets over
+  // [from_us, to_us); the caller bounds the bucket count.
+  Result Run(const Query& q) const;
+  Stats stats() const;
+
+  static const std::vector<std::string>& ColumnNames(Series series);
+
+ private:
+  class Segment;
+  struct Chain {
+    std::vector<std::shared_ptr<Segment>> segments;  // oldest first; the last one takes appends
+    uint64_t next_seq = 0;
+  };
+
+  void LoadExisting();
+  Segment* WritableTail(Series series, int64_t ts_us);
+  bool CoveredLocked(Series series, int64_t ts_us) const;
+  Chain& chain(Series series) { return series == Series::kGlobal ? global_ : users_; }
+  std::vector<std::shared_ptr<Segment>> SnapshotChain(Series series) const;
+
+  const Options options_;
+  mutable std::mutex mu_;  // guards the chains' segment lists, not segment contents
+  Chain global_;
+  Chain users_;
+  std::atomic<uint64_t> append_failures_{0};
+  std::atomic<uint64_t> stale_appends_skipped_{0};
+  std::atomic<uint64_t> segments_expired_{0};
+};
+
+}  // namespace economy
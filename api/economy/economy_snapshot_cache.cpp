@@ -0,0 +1,71 @@
+#include "economy_snapshot_cache.h"
+
+#include <algorithm>
+
+namespace economy {
+
+UserEconomyLru::UserEconomyLru(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {
+  stats_.capacity = capacity_;
+}
+
+std::optional<UserEconomyLru::Inputs> UserEconomyLru::Get(const std::string& user_id, const std::string& period_id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = slots_.find(user_id);
+  if (it == slots_.end() || it->second.inputs.period_id != period_id) {
+    ++stats_.misses;
+    return std::nullopt;
+  }
+  ++stats_.hits;
+  order_.splice(order_.begin(), order_, it->second.pos);
+  return it->second.inputs;
+}
+
+void UserEconomyLru::Put(const std::string& user_id, Inputs inputs, uint64_t loaded_at_generation) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (loaded_at_generation != generation_) return;
+  auto it = slots_.find(user_id);
+  if (it != slots_.end()) {
+    it->second.inputs = std::move(inputs);
+    order_.splice(order_.begin(), order_, it->second.pos);
+    return;
+  }
+  order_.push_front(user_id);
+  slots_.emplace(user_id, Slot{std::move(inputs), order_.begin()});
+  while (slots_.size() > capacity_) {
+    slots_.erase(order_.back());
+    order_.pop_back();
+    ++stats_.evictions;
+  }
+}
+
+uint64_t UserEconomyLru::generation() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return generation_;
+}
+
+void UserEconomyLru::Invalidate(const std::string& user_id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  ++generation_;
+  auto it = slots_.find(user_id);
+  if (it == slots_.end()) return;
+  order_.erase(it->second.pos);
+  slots_.erase(it);
+  ++stats_.invalidations;
+}
+
+void UserEconomyLru::Clear() {
+  std::lock_guard<std::mutex> lock(mu_);
+  ++generation_;
+  stats_.invalidations += slots_.size();
+  slots_.clear();
+  order_.clear();
+}
+
+UserEconomyLru::Stats UserEconomyLru::stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  Stats out = stats_;
+  out.entries = slots_.size();
+  return out;
+}
+
+}  // namespace economy
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "../storage/storage.h"
+#include "economy_v1.h"
+
+namespace economy {
+
+// Collapses concurrent calls for the same key into one computation: the
+// first caller runs fn(), later callers wait for and share its result (or
+// its exception). Nothing is kept once the call completes.
+template <typename Key, typename Value>
+class SingleFlight {
+ public:
+  template <typename Fn>
+  Value Do(const Key& key, Fn&& fn) {
+    std::shared_ptr<std::promise<Value>> leader;
+    std::shared_future<Value> result;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      auto it = calls_.find(key);
+      if (it != calls_.end()) {
+        result = it->second;
+        shared_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        leader = std::make_shared<std::promise<Value>>();
+        result = leader->get_future().share();
+        calls_.emplace(key, result);
+      }
+    }
+    if (leader) {
+      try {
+        leader->set_value(fn());
+      } catch (...) {
+        leader->set_exception(std::current_exception());
+      }
+      std::lock_guard<std::mutex> lock(mu_);
+      calls_.erase(key);
+    }
+    return result.get();
+  }
+
+  // Calls that joined another caller's computation instead of running their own.
+  uint64_t shared() const { return shared_.load(std::memory_order_relaxed); }
+
+ private:
+  std::mutex mu_;
+  std::map<Key, std::shared_future<Value>> calls_;
+  std::atomic<uint64_t> shared_{0};
+};
+
+// Per-user inputs of the live economy view: the user's raw row for the
+// current period and their closing snapshot from the last finalized period.
+// Bounded LRU. Entries are dropped when the flush worker writes the user's row
+// and all at once when a period is finalized.
+class UserEconomyLru {
+ public:
+  struct Inputs {
+    std::string period_id;
+    storage::EconomyPeriodUser row;
+    std::optional<EconomyUserSnapshot> prev;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;
+    size_t entries = 0;
+    size_t capacity = 0;
+  };
+
+  explicit UserEconomyLru(size_t capacity);
+
+  // Misses when the cached entry belongs to another period.
+  std::optional<Inputs> Get(const std::string& user_id, const std::string& period_id);
+  // Read generation() before loading and pass it here: a load that raced an
+  // invalidation is not cached, since it may predate the write.
+  void Put(const std::string& user_id, Inputs inputs, uint64_t loaded_at_generation);
+  uint64_t generation() const;
+  void Invalidate(const std::string& user_id);
+  void Clear();
+  Stats stats() const;
+
+ private:
+  using Order = std::list<std::string>;  // front: most recently used
+  struct Slot {
+    Inputs inputs;
+    Order::iterator pos;
+  };
+
+  const size_t capacity_;
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, Slot> slots_;
+  Order order_;
+  uint64_t generation_ = 0;
+  Stats stats_;
+};
+
+}  // namespace economy
@@ -4,6 +4,7 @@
 #include <cmath>
 #include <ctime>
 #include <iomanip>
+#include <limits>
 #include <sstream>
 
 namespace economy {
@@ -133,6 +134,35 @@ PeriodState CurrentPeriodState(std::time_t now_utc, const PeriodConfig& cfg) {
   return out;
 }
 
+std::optional<int64_t> PeriodEndUnix(const std::string& period_id, const PeriodConfig& cfg) {
+  const bool midnight = cfg.align_mode == "midnight";
+  const size_t digits_from = midnight ? 0 : 1;
+  if (period_id.size() <= digits_from || period_id.size() > digits_from + 18) return std::nullopt;
+  if (!midnight && period_id[0] != 'p') return std::nullopt;
+  if (midnight && period_id.size() != 8) return std::nullopt;
+  int64_t n = 0;
+  for (size_t i = digits_from; i < period_id.size(); ++i) {
+    const char c = period_id[i];
+    if (c < '0' || c > '9') return std::nullopt;
+    n = n * 10 + (c - '0');
+  }
+
+  if (midnight) {
+    std::tm next_tm{};
+    next_tm.tm_year = static_cast<int>(n / 10000) - 1900;
+    next_tm.tm_mon = static_cast<int>(n / 100 % 100) - 1;
+    next_tm.tm_mday = static_cast<int>(n % 100) + 1;
+    next_tm.tm_isdst = -1;
+    const std::time_t next_time = std::mktime(&next_tm);
+    if (next_time == static_cast<std::time_t>(-1)) return std::nullopt;
+    return static_cast<int64_t>(next_time);
+  }
+
+  const int64_t period_seconds = std::max(60, cfg.period_seconds);
+  if (n >= std::numeric_limits<int64_t>::max() / period_seconds - 1) return std::nullopt;
+  return (n + 1) * period_seconds;
+}
+
 EconomyState ComputeEconomyV1(const EconomyInputs& in, const std::string& period_key) {
   EconomyState out;
   out.period_key = period_key;
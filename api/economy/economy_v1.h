@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <ctime>
+#include <optional>
 #include <string>
 
 #include "../storage/models.h"
@@ -70,6 +71,9 @@ EconomyUserSnapshot ComputeUser(const EconomyPeriodRaw& raw_user,
                                 const std::string& user_id);
 
 PeriodState CurrentPeriodState(std::time_t now_utc, const PeriodConfig& cfg);
+// Unix time at which `period_id` (as produced by CurrentPeriodState) closes;
+// nullopt when the id does not match the configured align mode.
+std::optional<int64_t> PeriodEndUnix(const std::string& period_id, const PeriodConfig& cfg);
 
 // Backward-compatible wrapper kept for existing call sites during migration.
 struct EconomyInputs {
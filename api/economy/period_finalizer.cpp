@@ -0,0 +1,166 @@
+#include "period_finalizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iterator>
+#include <thread>
+
+namespace economy {
+namespace {
+
+int64_t NowMs() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs fn(worker_index) on `n` threads (the caller's included) and joins.
+template <typename Fn>
+void RunOnThreads(size_t n, Fn&& fn) {
+  std::vector<std::thread> extra;
+  extra.reserve(n > 0 ? n - 1 : 0);
+  for (size_t i = 1; i < n; ++i) extra.emplace_back([&fn, i] { fn(i); });
+  fn(0);
+  for (auto& t : extra) t.join();
+}
+
+}  // namespace
+
+void FinalizeProgress::Begin(const std::string& period_id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  view_ = View{};
+  view_.period_id = period_id;
+  view_.phase = "capturing";
+  view_.started_unix = static_cast<int64_t>(std::time(nullptr));
+  started_ms_ = NowMs();
+  users_computed_.store(0, std::memory_order_relaxed);
+  rows_written_.store(0, std::memory_order_relaxed);
+  rows_failed_.store(0, std::memory_order_relaxed);
+}
+
+void FinalizeProgress::SetPhase(const char* phase, size_t users_total) {
+  std::lock_guard<std::mutex> lock(mu_);
+  view_.phase = phase;
+  if (users_total != 0) view_.users_total = users_total;
+}
+
+void FinalizeProgress::Finish(bool ok) {
+  std::lock_guard<std::mutex> lock(mu_);
+  view_.phase = ok ? "done" : "failed";
+  view_.finished_unix = static_cast<int64_t>(std::time(nullptr));
+  view_.duration_ms = NowMs() - started_ms_;
+}
+
+FinalizeProgress::View FinalizeProgress::Read() const {
+  View out;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    out = view_;
+    if (out.finished_unix == 0 && out.started_unix != 0) out.duration_ms = NowMs() - started_ms_;
+  }
+  out.users_computed = users_computed_.load(std::memory_order_relaxed);
+  out.rows_written = rows_written_.load(std::memory_order_relaxed);
+  out.rows_failed = rows_failed_.load(std::memory_order_relaxed);
+  return out;
+}
+
+PeriodUserFinalizer::PeriodUserFinalizer(storage::IStorage& storage, size_t threads)
+    : storage_(storage), threads_(std::max<size_t>(1, threads)) {}
+
+PeriodUserFinalizer::Result PeriodUserFinalizer::Run(Input in, FinalizeProgress& progress) {
+  const size_t n = in.index.size();
+  UserColumns cols;
+  cols.resize(n);
+  auto closed = std::make_shared<ClosedUserColumns>();
+  closed->period_id = in.period_id;
+  closed->values.resize(n);
+
+  progress.SetPhase("computing", n);
+  const size_t workers = std::min(threads_, std::max<size_t>(1, n / kComputeChunk));
+  RunOnThreads(workers, [&](size_t w) {
+    const size_t slice_end = n * (w + 1) / workers;
+    for (size_t begin = n * w / workers; begin < slice_end; begin += kComputeChunk) {
+      const size_t end = std::min(slice_end, begin + kComputeChunk);
+      for (size_t i = begin; i < end; ++i) {
+        const storage::EconomyPeriodUser& raw = in.raw_rows[i];
+        cols.y[i] = raw.user_real_output > 0 ? raw.user_real_output : raw.user_harvested_food;
+        cols.k[i] = in.user_capital[i];
+        cols.l[i] = raw.user_movement_ticks;
+        const size_t p = in.prev ? in.prev->index.Find(in.index.id(i)) : UserIndex::npos;
+        cols.has_prev[i] = p != UserIndex::npos;
+        cols.prev_y[i] = p != UserIndex::npos ? in.prev->values.y[p] : 0;
+        cols.prev_k[i] = p != UserIndex::npos ? in.prev->values.k[p] : 0;
+      }
+      ComputeUsersBatch(cols, in.global_y, in.alpha_bootstrap_default, closed->values, begin, end);
+      progress.AddComputed(end - begin);
+    }
+  });
+
+  // Each writer claims the next batch, so in-flight requests never exceed the
+  // writer count no matter how many rows there are. Rows are built per batch
+  // from the columns rather than held for every user at once.
+  progress.SetPhase("writing");
+  const UserResultColumns& v = closed->values;
+  const size_t batches = (n + kWriteBatch - 1) / kWriteBatch;
+  std::atomic<size_t> next_batch{0};
+  std::mutex leftover_mu;
+  std::vector<storage::EconomyPeriodUser> leftover;
+  RunOnThreads(std::min(threads_, std::max<size_t>(1, batches)), [&](size_t) {
+    std::vector<storage::EconomyPeriodUser> batch;
+    for (size_t b = next_batch.fetch_add(1); b < batches; b = next_batch.fetch_add(1)) {
+      const size_t begin = b * kWriteBatch;
+      const size_t end = std::min(n, begin + kWriteBatch);
+      batch.clear();
+      for (size_t i = begin; i < end; ++i) {
+        storage::EconomyPeriodUser row = std::move(in.raw_rows[i]);
+        row.period_key = in.period_id;
+        row.user_id = in.index.id(i);
+        row.user_output = v.y[i];
+        row.user_real_output = cols.y[i];
+        row.user_capital = v.k[i];
+        row.user_labor = v.l[i];
+        row.user_capital_share = v.alpha[i];
+        row.user_productivity = v.a[i];
+        row.user_market_share = v.market_share[i];
+        row.user_storage_balance = in.balance[i];
+        row.alpha_bootstrap = v.alpha_bootstrap[i] != 0;
+        row.computed_at = in.computed_at;
+        batch.push_back(std::move(row));
+      }
+      const size_t size = batch.size();
+      storage_.PutEconomyPeriodUsers(batch);
+      progress.AddWritten(size - batch.size());
+      if (!batch.empty()) {
+        std::lock_guard<std::mutex> lock(leftover_mu);
+        std::move(batch.begin(), batch.end(), std::back_inserter(leftover));
+      }
+    }
+  });
+
+  // Throttling and transient errors usually clear within a few seconds.
+  int64_t backoff_ms = kRetryBackoffMs;
+  for (int attempt = 0; attempt < kWriteRetries && !leftover.empty(); ++attempt, backoff_ms *= 2) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+    std::vector<storage::EconomyPeriodUser> still_failed;
+    std::vector<storage::EconomyPeriodUser> batch;
+    for (size_t begin = 0; begin < leftover.size(); begin += kWriteBatch) {
+      const size_t end = std::min(leftover.size(), begin + kWriteBatch);
+      batch.assign(std::make_move_iterator(leftover.begin() + begin), std::make_move_iterator(leftover.begin() + end));
+      const size_t size = batch.size();
+      storage_.PutEconomyPeriodUsers(batch);
+      progress.AddWritten(size - batch.size());
+      std::move(batch.begin(), batch.end(), std::back_inserter(still_failed));
+    }
+    leftover.swap(still_failed);
+  }
+  progress.AddFailed(leftover.size());
+
+  closed->index = std::move(in.index);
+  closed->storage_balance = std::move(in.balance);
+  Result out;
+  out.rows_failed = leftover.size();
+  out.closed = std::move(closed);
+  return out;
+}
+
+}  // namespace economy
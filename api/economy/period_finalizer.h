@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../storage/storage.h"
+#include "economy_batch.h"
+#include "economy_v1.h"
+
+namespace economy {
+
+// Progress of the running (or last) period finalization; any thread may read.
+class FinalizeProgress {
+ public:
+  struct View {
+    std::string period_id;
+    std::string phase = "idle";  // idle|capturing|computing|writing|done|failed
+    size_t users_total = 0;
+    size_t users_computed = 0;
+    size_t rows_written = 0;
+    size_t rows_failed = 0;
+    int64_t started_unix = 0;
+    int64_t finished_unix = 0;
+    int64_t duration_ms = 0;
+  };
+
+  void Begin(const std::string& period_id);
+  void SetPhase(const char* phase, size_t users_total = 0);
+  void AddComputed(size_t n) { users_computed_.fetch_add(n, std::memory_order_relaxed); }
+  void AddWritten(size_t n) { rows_written_.fetch_add(n, std::memory_order_relaxed); }
+  void AddFailed(size_t n) { rows_failed_.fetch_add(n, std::memory_order_relaxed); }
+  void Finish(bool ok);
+  View Read() const;
+
+ private:
+  mutable std::mutex mu_;
+  View view_;
+  int64_t started_ms_ = 0;
+  std::atomic<size_t> users_computed_{0};
+  std::atomic<size_t> rows_written_{0};
+  std::atomic<size_t> rows_failed_{0};
+};
+
+// Computes and stores the per-user rows of a closing period from inputs
+// captured up front, addressed by dense user index. ComputeUsersBatch runs
+// across `threads` workers over disjoint slices; rows go out through
+// IStorage::PutEconomyPeriodUsers with at most `threads` batches in flight.
+// Rows a batch could not store are retried with backoff before Run returns;
+// rows_failed counts only what still did not land.
+class PeriodUserFinalizer {
+ public:
+  struct Input {
+    std::string period_id;
+    int64_t computed_at = 0;
+    int64_t global_y = 0;
+    double alpha_bootstrap_default = 0.5;
+    UserIndex index;
+    // By index.
+    std::vector<int64_t> balance;
+    std::vector<int64_t> user_capital;
+    std::vector<storage::EconomyPeriodUser> raw_rows;  // empty user_id: no row yet
+    std::shared_ptr<const ClosedUserColumns> prev;      // may be null
+  };
+
+  struct Result {
+    std::shared_ptr<ClosedUserColumns> closed;
+    size_t rows_failed = 0;
+  };
+
+  static constexpr size_t kWriteBatch = 25;
+  static constexpr size_t kComputeChunk = 4096;  // gather + compute unit; also the progress step
+  static constexpr int kWriteRetries = 4;
+  static constexpr int64_t kRetryBackoffMs = 100;  // doubles per retry
+
+  PeriodUserFinalizer(storage::IStorage& storage, size_t threads);
+
+  Result Run(Input in, FinalizeProgress& progress);
+
+ private:
+  storage::IStorage& storage_;
+  size_t threads_;
+};
+
+}  // namespace economy
@@ -2,7 +2,6 @@
 
 #include <algorithm>
 #include <cmath>
-#include <unordered_set>
 #include <utility>
 
 namespace economy {
@@ -17,22 +16,6 @@ double safe_ratio(int64_t num, int64_t den) {
 
 StabilizationEngine::StabilizationEngine(StabilizationConfig cfg) : cfg_(std::move(cfg)) {}
 
-int64_t StabilizationEngine::ComputeOccupiedSnakeCells(const world::WorldSnapshot& world) {
-  std::unordered_set<uint64_t> occupied;
-  occupied.reserve(world.snakes.size() * 8);
-
-  for (const auto& s : world.snakes) {
-    if (!s.alive) continue;
-    for (const auto& seg : s.body) {
-      if (seg.x < 0 || seg.y < 0 || seg.x >= world.w || seg.y >= world.h) continue;
-      const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(seg.y)) << 32) |
-                           static_cast<uint32_t>(seg.x);
-      occupied.insert(key);
-    }
-  }
-  return static_cast<int64_t>(occupied.size());
-}
-
 StabilizationDerived StabilizationEngine::Derive(int64_t money_supply,
                                                  int64_t k_lend,
                                                  int64_t deployed_capital,
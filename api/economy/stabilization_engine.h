@@ -3,8 +3,6 @@
 #include <cstdint>
 #include <string>
 
-#include "../world/world.h"
-
 namespace economy {
 
 // Runtime-configured parameters for automatic stabilization.
@@ -60,8 +58,6 @@ class StabilizationEngine {
  public:
   explicit StabilizationEngine(StabilizationConfig cfg);
 
-  static int64_t ComputeOccupiedSnakeCells(const world::WorldSnapshot& world);
-
   StabilizationDerived Derive(int64_t money_supply,
                               int64_t k_lend,
                               int64_t deployed_capital,
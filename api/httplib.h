@@ -3428,6 +3428,9 @@ public:
              const std::string &reason = "");
   const Request &request() const;
   bool is_open() const;
+  // Local addition: the accepted socket, so the server can check send-buffer
+  // room and shut a slow peer down without searching for its descriptor.
+  socket_t socket() const { return strm_.socket(); }
 
 private:
   friend class httplib::Server;
@@ -0,0 +1,261 @@
+#include "leaderboard_service.h"
+
+#include <algorithm>
+#include <ctime>
+
+#include "../diagnostics/tracer.h"
+#include "../metrics/metrics.h"
+
+namespace leaderboard {
+
+const char* KindName(Kind kind) {
+  switch (kind) {
+    case Kind::kLength:
+      return "length";
+    case Kind::kCapital:
+      return "capital";
+    case Kind::kOutput:
+      return "output";
+  }
+  return "length";
+}
+
+std::optional<Kind> ParseKind(const std::string& name) {
+  if (name == "length") return Kind::kLength;
+  if (name == "capital") return Kind::kCapital;
+  if (name == "output" || name == "market_share") return Kind::kOutput;
+  return std::nullopt;
+}
+
+LeaderboardService::LeaderboardService(economy::PeriodConfig period_cfg, std::chrono::milliseconds apply_interval)
+    : period_cfg_(std::move(period_cfg)), apply_interval_(apply_interval) {}
+
+LeaderboardService::~LeaderboardService() {
+  Stop();
+  for (Node* n = head_.exchange(nullptr); n != nullptr;) {
+    Node* next = n->next;
+    delete n;
+    n = next;
+  }
+}
+
+void LeaderboardService::Seed(const std::vector<SnakeChange>& snakes,
+                              const std::string& period_id,
+                              const std::vector<std::pair<int, int64_t>>& output_by_user) {
+  {
+    std::unique_lock<std::shared_mutex> lock(mu_);
+    length_.Clear();
+    capital_.Clear();
+    snakes_.clear();
+    snakes_by_user_.clear();
+    for (const auto& s : snakes) SetSnakeLocked(s);
+    if (!period_id.empty()) {
+      output_.Clear();
+      output_period_id_ = period_id;
+      output_period_total_ = 0;
+      for (const auto& [user_id, output] : output_by_user) {
+        if (user_id <= 0 || output <= 0) continue;
+        output_.Add(user_id, output);
+        output_period_total_ += output;
+      }
+    }
+  }
+  version_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void LeaderboardService::Start() {
+  std::lock_guard<std::mutex> lock(run_mu_);
+  if (running_ || stopping_) return;
+  running_ = true;
+  worker_ = std::thread([this] { Run(); });
+}
+
+void LeaderboardService::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(run_mu_);
+    stopping_ = true;
+  }
+  wake_cv_.notify_all();
+  if (worker_.joinable()) worker_.join();
+}
+
+void LeaderboardService::Submit(Update update) {
+  if (update.snakes.empty() && update.removed_snakes.empty() && update.output_by_user.empty()) return;
+  submitted_.fetch_add(1, std::memory_order_relaxed);
+  Node* node = new Node{std::move(update), head_.load(std::memory_order_relaxed)};
+  while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+}
+
+void LeaderboardService::Run() {
+  std::unique_lock<std::mutex> lock(run_mu_);
+  while (!stopping_) {
+    wake_cv_.wait_for(lock, apply_interval_, [&] { return stopping_; });
+    lock.unlock();
+    if (ApplyPending()) version_.fetch_add(1, std::memory_order_acq_rel);
+    lock.lock();
+  }
+  lock.unlock();
+  if (ApplyPending()) version_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+bool LeaderboardService::ApplyPending() {
+  static auto& apply_seconds = metrics::Default().GetHistogram(
+      "snake_leaderboard_apply_seconds", "Time to apply one batch of tick deltas to the leaderboards.", {},
+      metrics::Histogram::kSeconds);
+  Node* n = head_.exchange(nullptr, std::memory_order_acquire);
+  if (n == nullptr) return false;
+  // Stack order is newest first; snake lengths are last-write-wins, so replay
+  // oldest first.
+  std::vector<Node*> batch;
+  for (; n != nullptr; n = n->next) batch.push_back(n);
+  std::reverse(batch.begin(), batch.end());
+
+  metrics::ScopedTimer timer(apply_seconds);
+  diagnostics::TraceSpan span("leaderboard", "apply");
+  const auto started = std::chrono::steady_clock::now();
+  bool changed = false;
+  std::unique_lock<std::shared_mutex> lock(mu_);
+  for (Node* node : batch) {
+    const Update& u = node->update;
+    for (int snake_id : u.removed_snakes) changed |= RemoveSnakeLocked(snake_id);
+    for (const auto& s : u.snakes) changed |= SetSnakeLocked(s);
+    if (!u.output_by_user.empty()) {
+      changed |= RollPeriodLocked(u.at_unix);
+      for (const auto& [user_id, output] : u.output_by_user) {
+        if (user_id <= 0 || output <= 0) continue;
+        output_.Add(user_id, output);
+        output_period_total_ += output;
+        changed = true;
+      }
+    }
+    delete node;
+  }
+  ++batches_applied_;
+  updates_applied_ += batch.size();
+  last_apply_us_ =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+  return changed;
+}
+
+bool LeaderboardService::SetSnakeLocked(const SnakeChange& c) {
+  if (c.snake_id <= 0) return false;
+  if (!c.alive || c.length <= 0) return RemoveSnakeLocked(c.snake_id);
+  auto it = snakes_.find(c.snake_id);
+  if (it == snakes_.end()) {
+    it = snakes_.emplace(c.snake_id, SnakeInfo{c.user_id, 0, c.name}).first;
+    snakes_by_user_[c.user_id].push_back(c.snake_id);
+  } else if (it->second.user_id != c.user_id) {
+    // Ownership does not change in the world today; handle it anyway.
+    RemoveSnakeLocked(c.snake_id);
+    return SetSnakeLocked(c);
+  }
+  SnakeInfo& info = it->second;
+  if (!c.name.empty()) info.name = c.name;
+  if (info.length == c.length) return false;
+  capital_.Add(c.user_id, c.length - info.length);
+  info.length = c.length;
+  length_.Set(c.snake_id, c.length);
+  return true;
+}
+
+bool LeaderboardService::RemoveSnakeLocked(int snake_id) {
+  auto it = snakes_.find(snake_id);
+  if (it == snakes_.end()) return false;
+  const SnakeInfo info = std::move(it->second);
+  snakes_.erase(it);
+  length_.Remove(snake_id);
+  capital_.Add(info.user_id, -info.length);
+  auto uit = snakes_by_user_.find(info.user_id);
+  if (uit != snakes_by_user_.end()) {
+    auto& ids = uit->second;
+    ids.erase(std::remove(ids.begin(), ids.end(), snake_id), ids.end());
+    if (ids.empty()) snakes_by_user_.erase(uit);
+  }
+  return true;
+}
+
+bool LeaderboardService::RollPeriodLocked(int64_t at_unix) {
+  const std::string period_id =
+      economy::CurrentPeriodState(static_cast<std::time_t>(at_unix), period_cfg_).period_id;
+  if (period_id == output_period_id_) return false;
+  output_.Clear();
+  output_period_id_ = period_id;
+  output_period_total_ = 0;
+  return true;
+}
+
+LeaderboardService::Page LeaderboardService::Top(Kind kind, size_t offset, size_t limit) const {
+  limit = std::min(limit, kMaxLimit);
+  Page page;
+  std::vector<RankTree::Entry> entries;
+  std::shared_lock<std::shared_mutex> lock(mu_);
+  page.version = version();
+  const Board& board = kind == Kind::kLength ? length_ : kind == Kind::kCapital ? capital_ : output_;
+  page.total = board.size();
+  if (kind == Kind::kOutput) {
+    page.period_id = output_period_id_;
+    page.score_total = output_period_total_;
+  }
+  board.Range(offset, limit, entries);
+  page.rows.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    Row row;
+    row.rank = offset + i + 1;
+    row.score = entries[i].score;
+    if (kind == Kind::kLength) {
+      row.snake_id = static_cast<int>(entries[i].id);
+      auto it = snakes_.find(row.snake_id);
+      if (it != snakes_.end()) {
+        row.user_id = it->second.user_id;
+        row.snake_name = it->second.name;
+      }
+    } else {
+      row.user_id = static_cast<int>(entries[i].id);
+    }
+    page.rows.push_back(std::move(row));
+  }
+  return page;
+}
+
+std::optional<LeaderboardService::Row> LeaderboardService::RankOf(Kind kind, int user_id) const {
+  std::shared_lock<std::shared_mutex> lock(mu_);
+  Row row;
+  row.user_id = user_id;
+  if (kind != Kind::kLength) {
+    const auto pos = (kind == Kind::kCapital ? capital_ : output_).Find(user_id);
+    if (!pos) return std::nullopt;
+    row.rank = pos->rank;
+    row.score = pos->score;
+    return row;
+  }
+  auto uit = snakes_by_user_.find(user_id);
+  if (uit == snakes_by_user_.end()) return std::nullopt;
+  for (int snake_id : uit->second) {
+    const auto pos = length_.Find(snake_id);
+    if (!pos || (row.rank != 0 && pos->rank >= row.rank)) continue;
+    row.rank = pos->rank;
+    row.score = pos->score;
+    row.snake_id = snake_id;
+  }
+  if (row.rank == 0) return std::nullopt;
+  auto sit = snakes_.find(row.snake_id);
+  if (sit != snakes_.end()) row.snake_name = sit->second.name;
+  return row;
+}
+
+LeaderboardService::Stats LeaderboardService::stats() const {
+  Stats out;
+  std::shared_lock<std::shared_mutex> lock(mu_);
+  out.submitted = submitted_.load(std::memory_order_relaxed);
+  out.batches_applied = batches_applied_;
+  out.updates_applied = updates_applied_;
+  out.version = version();
+  out.ranked_snakes = length_.size();
+  out.ranked_capital_users = capital_.size();
+  out.ranked_output_users = output_.size();
+  out.last_apply_us = last_apply_us_;
+  return out;
+}
+
+}  // namespace leaderboard
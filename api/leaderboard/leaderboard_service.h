@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../economy/economy_v1.h"
+#include "rank_tree.h"
+
+namespace leaderboard {
+
+enum class Kind { kLength = 0, kCapital = 1, kOutput = 2 };
+constexpr int kKindCount = 3;
+
+const char* KindName(Kind kind);
+std::optional<Kind> ParseKind(const std::string& name);
+
+// Live rankings kept in order-statistic trees:
+//   length  - alive snakes by body length (a user's rank is their best snake),
+//   capital - users by deployed capital (summed length of their alive snakes),
+//   output  - users by output in the current economy period; market share is
+//             the user's output over the period total.
+// The tick loop hands over the snakes and counters it already drained from the
+// world with Submit(), a lock-free push. A worker applies them in batches every
+// `apply_interval`, so World::Tick never touches the trees. Queries take a
+// shared lock and cost O(log n + limit).
+class LeaderboardService {
+ public:
+  struct SnakeChange {
+    int snake_id = 0;
+    int user_id = 0;
+    std::string name;
+    int64_t length = 0;
+    bool alive = true;
+  };
+  struct Update {
+    int64_t at_unix = 0;  // picks the period output counts toward
+    std::vector<SnakeChange> snakes;
+    std::vector<int> removed_snakes;
+    std::vector<std::pair<int, int64_t>> output_by_user;
+  };
+
+  struct Row {
+    size_t rank = 0;  // 1-based
+    int user_id = 0;
+    int snake_id = 0;  // length board only
+    std::string snake_name;
+    int64_t score = 0;
+  };
+  struct Page {
+    uint64_t version = 0;
+    size_t total = 0;
+    std::string period_id;  // output board only
+    int64_t score_total = 0;
+    std::vector<Row> rows;
+  };
+
+  struct Stats {
+    uint64_t submitted = 0;
+    uint64_t batches_applied = 0;
+    uint64_t updates_applied = 0;
+    uint64_t version = 0;
+    size_t ranked_snakes = 0;
+    size_t ranked_capital_users = 0;
+    size_t ranked_output_users = 0;
+    int64_t last_apply_us = 0;
+  };
+
+  static constexpr size_t kMaxLimit = 100;
+
+  LeaderboardService(economy::PeriodConfig period_cfg, std::chrono::milliseconds apply_interval);
+  ~LeaderboardService();
+  LeaderboardService(const LeaderboardService&) = delete;
+  LeaderboardService& operator=(const LeaderboardService&) = delete;
+
+  // Replaces the snake boards with `snakes`, and the output board with
+  // `output_by_user` when `period_id` is not empty. Call before Start() or
+  // after a world reload.
+  void Seed(const std::vector<SnakeChange>& snakes,
+            const std::string& period_id,
+            const std::vector<std::pair<int, int64_t>>& output_by_user);
+  void Start();
+  // Applies what is queued, then joins.
+  void Stop();
+
+  // Any thread; never blocks.
+  void Submit(Update update);
+
+  Page Top(Kind kind, size_t offset, size_t limit) const;
+  std::optional<Row> RankOf(Kind kind, int user_id) const;
+  // Bumped by every applied batch that changed a board.
+  uint64_t version() const { return version_.load(std::memory_order_acquire); }
+  Stats stats() const;
+
+ private:
+  struct Node {
+    Update update;
+    Node* next = nullptr;
+  };
+  struct SnakeInfo {
+    int user_id = 0;
+    int64_t length = 0;
+    std::string name;
+  };
+
+  void Run();
+  // Returns whether any board changed.
+  bool ApplyPending();
+  // Callers hold mu_ exclusively.
+  bool SetSnakeLocked(const SnakeChange& c);
+  bool RemoveSnakeLocked(int snake_id);
+  bool RollPeriodLocked(int64_t at_unix);
+
+  const economy::PeriodConfig period_cfg_;
+  const std::chrono::milliseconds apply_interval_;
+
+  std::atomic<Node*> head_{nullptr};
+  std::atomic<uint64_t> submitted_{0};
+  std::atomic<uint64_t> version_{0};
+
+  mutable std::shared_mutex mu_;  // guards the boards and the maps below
+  Board length_;
+  Board capital_;
+  Board output_;
+  std::unordered_map<int, SnakeInfo> snakes_;
+  std::unordered_map<int, std::vector<int>> snakes_by_user_;
+  std::string output_period_id_;
+  int64_t output_period_total_ = 0;
+  uint64_t batches_applied_ = 0;
+  uint64_t updates_applied_ = 0;
+  int64_t last_apply_us_ = 0;
+
+  std::mutex run_mu_;
+  std::condition_variable wake_cv_;
+  bool running_ = false;
+  bool stopping_ = false;
+  std::thread worker_;
+};
+
+}  // namespace leaderboard
@@ -0,0 +1,174 @@
+#include "rank_tree.h"
+
+namespace leaderboard {
+
+uint32_t RankTree::NextPriority() {
+  // xorshift32: treap priorities only need to be well spread, not secure.
+  rng_ ^= rng_ << 13;
+  rng_ ^= rng_ >> 17;
+  rng_ ^= rng_ << 5;
+  return rng_;
+}
+
+void RankTree::Pull(int32_t n) {
+  Node& node = nodes_[static_cast<size_t>(n)];
+  node.size = 1 + Size(node.left) + Size(node.right);
+}
+
+void RankTree::Split(int32_t t, int64_t score, int64_t id, int32_t& l, int32_t& r) {
+  if (t < 0) {
+    l = r = -1;
+    return;
+  }
+  Node& node = nodes_[static_cast<size_t>(t)];
+  if (Before(node.score, node.id, score, id)) {
+    Split(node.right, score, id, nodes_[static_cast<size_t>(t)].right, r);
+    l = t;
+  } else {
+    Split(node.left, score, id, l, nodes_[static_cast<size_t>(t)].left);
+    r = t;
+  }
+  Pull(t);
+}
+
+int32_t RankTree::Merge(int32_t a, int32_t b) {
+  if (a < 0) return b;
+  if (b < 0) return a;
+  if (nodes_[static_cast<size_t>(a)].prio > nodes_[static_cast<size_t>(b)].prio) {
+    const int32_t merged = Merge(nodes_[static_cast<size_t>(a)].right, b);
+    nodes_[static_cast<size_t>(a)].right = merged;
+    Pull(a);
+    return a;
+  }
+  const int32_t merged = Merge(a, nodes_[static_cast<size_t>(b)].left);
+  nodes_[static_cast<size_t>(b)].left = merged;
+  Pull(b);
+  return b;
+}
+
+void RankTree::Insert(int64_t score, int64_t id) {
+  int32_t n;
+  if (!free_.empty()) {
+    n = free_.back();
+    free_.pop_back();
+  } else {
+    n = static_cast<int32_t>(nodes_.size());
+    nodes_.emplace_back();
+  }
+  Node& node = nodes_[static_cast<size_t>(n)];
+  node = Node{};
+  node.score = score;
+  node.id = id;
+  node.prio = NextPriority();
+  int32_t l = -1;
+  int32_t r = -1;
+  Split(root_, score, id, l, r);
+  root_ = Merge(Merge(l, n), r);
+}
+
+int32_t RankTree::EraseFrom(int32_t t, int64_t score, int64_t id, bool& erased) {
+  if (t < 0) return t;
+  Node& node = nodes_[static_cast<size_t>(t)];
+  if (node.score == score && node.id == id) {
+    erased = true;
+    free_.push_back(t);
+    return Merge(node.left, node.right);
+  }
+  if (Before(score, id, node.score, node.id)) {
+    const int32_t child = EraseFrom(node.left, score, id, erased);
+    nodes_[static_cast<size_t>(t)].left = child;
+  } else {
+    const int32_t child = EraseFrom(node.right, score, id, erased);
+    nodes_[static_cast<size_t>(t)].right = child;
+  }
+  if (erased) Pull(t);
+  return t;
+}
+
+bool RankTree::Erase(int64_t score, int64_t id) {
+  bool erased = false;
+  root_ = EraseFrom(root_, score, id, erased);
+  return erased;
+}
+
+size_t RankTree::Rank(int64_t score, int64_t id) const {
+  size_t ahead = 0;
+  for (int32_t t = root_; t >= 0;) {
+    const Node& node = nodes_[static_cast<size_t>(t)];
+    if (Before(node.score, node.id, score, id)) {
+      ahead += Size(node.left) + 1;
+      t = node.right;
+    } else {
+      t = node.left;
+    }
+  }
+  return ahead;
+}
+
+void RankTree::Collect(int32_t t, size_t& skip, size_t limit, std::vector<Entry>& out) const {
+  if (t < 0 || out.size() >= limit) return;
+  const Node& node = nodes_[static_cast<size_t>(t)];
+  if (skip >= node.size) {
+    skip -= node.size;
+    return;
+  }
+  Collect(node.left, skip, limit, out);
+  if (out.size() >= limit) return;
+  if (skip > 0) {
+    --skip;
+  } else {
+    out.push_back(Entry{node.score, node.id});
+  }
+  Collect(node.right, skip, limit, out);
+}
+
+void RankTree::Range(size_t offset, size_t limit, std::vector<Entry>& out) const {
+  size_t skip = offset;
+  const size_t target = out.size() + limit;
+  Collect(root_, skip, target, out);
+}
+
+void RankTree::Clear() {
+  nodes_.clear();
+  free_.clear();
+  root_ = -1;
+}
+
+void Board::Set(int64_t id, int64_t score) {
+  auto it = scores_.find(id);
+  if (it != scores_.end()) {
+    if (it->second == score) return;
+    tree_.Erase(it->second, id);
+    if (score <= 0) {
+      scores_.erase(it);
+      return;
+    }
+    it->second = score;
+  } else {
+    if (score <= 0) return;
+    scores_.emplace(id, score);
+  }
+  tree_.Insert(score, id);
+}
+
+void Board::Add(int64_t id, int64_t delta) {
+  if (delta != 0) Set(id, Score(id) + delta);
+}
+
+int64_t Board::Score(int64_t id) const {
+  auto it = scores_.find(id);
+  return it == scores_.end() ? 0 : it->second;
+}
+
+std::optional<Board::Position> Board::Find(int64_t id) const {
+  auto it = scores_.find(id);
+  if (it == scores_.end()) return std::nullopt;
+  return Position{tree_.Rank(it->second, id) + 1, it->second};
+}
+
+void Board::Clear() {
+  tree_.Clear();
+  scores_.clear();
+}
+
+}  // namespace leaderboard
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace leaderboard {
+
+// Order-statistic treap over (score, id): highest score first, ties broken
+// by ascending id. Insert, Erase and Rank are O(log n) expected; Range costs
+// O(log n + limit). Nodes live in one vector with a free list, so steady
+// churn does not allocate.
+class RankTree {
+ public:
+  struct Entry {
+    int64_t score = 0;
+    int64_t id = 0;
+  };
+
+  void Insert(int64_t score, int64_t id);
+  bool Erase(int64_t score, int64_t id);
+  // Number of entries ranked ahead of (score, id), whether or not it is present.
+  size_t Rank(int64_t score, int64_t id) const;
+  // Entries at 0-based positions [offset, offset + limit), appended to `out`.
+  void Range(size_t offset, size_t limit, std::vector<Entry>& out) const;
+  size_t size() const { return Size(root_); }
+  void Clear();
+
+ private:
+  struct Node {
+    int64_t score = 0;
+    int64_t id = 0;
+    uint32_t prio = 0;
+    uint32_t size = 1;
+    int32_t left = -1;
+    int32_t right = -1;
+  };
+
+  static bool Before(int64_t s1, int64_t i1, int64_t s2, int64_t i2) { return s1 != s2 ? s1 > s2 : i1 < i2; }
+  uint32_t Size(int32_t n) const { return n < 0 ? 0 : nodes_[static_cast<size_t>(n)].size; }
+  void Pull(int32_t n);
+  // l: entries before (score, id); r: the rest.
+  void Split(int32_t t, int64_t score, int64_t id, int32_t& l, int32_t& r);
+  int32_t Merge(int32_t a, int32_t b);
+  int32_t EraseFrom(int32_t t, int64_t score, int64_t id, bool& erased);
+  void Collect(int32_t t, size_t& skip, size_t limit, std::vector<Entry>& out) const;
+  uint32_t NextPriority();
+
+  std::vector<Node> nodes_;
+  std::vector<int32_t> free_;
+  int32_t root_ = -1;
+  uint32_t rng_ = 0x9e3779b9u;
+};
+
+// A RankTree plus the current score per id, so callers can update by id.
+// Ids with a score of zero or less are not ranked.
+class Board {
+ public:
+  struct Position {
+    size_t rank = 0;  // 1-based
+    int64_t score = 0;
+  };
+
+  void Set(int64_t id, int64_t score);
+  void Add(int64_t id, int64_t delta);
+  void Remove(int64_t id) { Set(id, 0); }
+  std::optional<Position> Find(int64_t id) const;
+  int64_t Score(int64_t id) const;
+  void Range(size_t offset, size_t limit, std::vector<RankTree::Entry>& out) const { tree_.Range(offset, limit, out); }
+  size_t size() const { return scores_.size(); }
+  void Clear();
+
+ private:
+  RankTree tree_;
+  std::unordered_map<int64_t, int64_t> scores_;
+};
+
+}  // namespace leaderboard
@@ -0,0 +1,224 @@
+#include "metrics.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace metrics {
+namespace {
+
+std::atomic<size_t> g_next_shard{0};
+
+void AppendEscaped(std::string& out, const std::string& v) {
+  for (const char c : v) {
+    if (c == '\\' || c == '"') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (c == '\n') {
+      out.append("\\n");
+    } else {
+      out.push_back(c);
+    }
+  }
+}
+
+// {a="x",b="y"} with an optional trailing le label; empty when there are none.
+void AppendLabels(std::string& out, const Labels& labels, const char* le = nullptr) {
+  if (labels.empty() && !le) return;
+  out.push_back('{');
+  bool first = true;
+  for (const auto& [k, v] : labels) {
+    if (!first) out.push_back(',');
+    first = false;
+    out.append(k);
+    out.append("=\"");
+    AppendEscaped(out, v);
+    out.push_back('"');
+  }
+  if (le) {
+    if (!first) out.push_back(',');
+    out.append("le=\"");
+    out.append(le);
+    out.push_back('"');
+  }
+  out.push_back('}');
+}
+
+void AppendNumber(std::string& out, double v) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.9g", v);
+  out.append(buf);
+}
+
+void AppendNumber(std::string& out, uint64_t v) {
+  out.append(std::to_string(v));
+}
+
+}  // namespace
+
+size_t ThreadShard() {
+  thread_local const size_t shard = g_next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return shard;
+}
+
+uint64_t Counter::Value() const {
+  uint64_t total = 0;
+  for (const auto& c : cells_) total += c.v.load(std::memory_order_relaxed);
+  return total;
+}
+
+Histogram::Histogram(Scale scale)
+    : scale_(scale), bucket_count_(2 * scale.octaves + 2), shards_(new Shard[kShards]) {}
+
+int Histogram::BucketFor(double v) const {
+  if (!(v > scale_.min)) return 0;
+  int exp = 0;
+  const double m = std::frexp(v / scale_.min, &exp);  // v/min = m * 2^exp, m in [0.5, 1)
+  // Octave o covers (2^o, 2^(o+1)]; an exact power of two closes the octave below.
+  int octave = exp - 1;
+  double frac = m * 2.0;  // in [1, 2)
+  if (frac == 1.0) {
+    --octave;
+    frac = 2.0;
+  }
+  if (octave >= scale_.octaves) return bucket_count_ - 1;
+  return 1 + 2 * octave + (frac <= 1.5 ? 0 : 1);
+}
+
+void Histogram::Observe(double v) {
+  Shard& s = shards_[ThreadShard()];
+  s.buckets[static_cast<size_t>(BucketFor(v))].fetch_add(1, std::memory_order_relaxed);
+  double cur = s.sum.load(std::memory_order_relaxed);
+  while (!s.sum.compare_exchange_weak(cur, cur + v, std::memory_order_relaxed)) {
+  }
+}
+
+Histogram::Snapshot Histogram::Read() const {
+  Snapshot out;
+  out.upper_bounds.reserve(static_cast<size_t>(bucket_count_ - 1));
+  out.upper_bounds.push_back(scale_.min);
+  for (int o = 0; o < scale_.octaves; ++o) {
+    const double base = std::ldexp(scale_.min, o);
+    out.upper_bounds.push_back(base * 1.5);
+    out.upper_bounds.push_back(base * 2.0);
+  }
+  out.counts.assign(static_cast<size_t>(bucket_count_), 0);
+  for (size_t s = 0; s < kShards; ++s) {
+    for (int b = 0; b < bucket_count_; ++b) {
+      out.counts[static_cast<size_t>(b)] += shards_[s].buckets[static_cast<size_t>(b)].load(std::memory_order_relaxed);
+    }
+    out.sum += shards_[s].sum.load(std::memory_order_relaxed);
+  }
+  for (const uint64_t c : out.counts) out.count += c;
+  return out;
+}
+
+Registry::Series& Registry::GetSeries(const std::string& name, const std::string& help, Type type, const Labels& labels) {
+  auto& family = families_[name];
+  if (family.series.empty()) {
+    family.help = help;
+    family.type = type;
+  }
+  for (auto& s : family.series) {
+    if (s->labels == labels) return *s;
+  }
+  family.series.push_back(std::make_unique<Series>());
+  family.series.back()->labels = labels;
+  return *family.series.back();
+}
+
+Counter& Registry::GetCounter(const std::string& name, const std::string& help, const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto& s = GetSeries(name, help, Type::kCounter, labels);
+  if (!s.counter) s.counter = std::make_unique<Counter>();
+  return *s.counter;
+}
+
+Gauge& Registry::GetGauge(const std::string& name, const std::string& help, const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto& s = GetSeries(name, help, Type::kGauge, labels);
+  if (!s.gauge) s.gauge = std::make_unique<Gauge>();
+  return *s.gauge;
+}
+
+Histogram& Registry::GetHistogram(const std::string& name,
+                                  const std::string& help,
+                                  const Labels& labels,
+                                  Histogram::Scale scale) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto& s = GetSeries(name, help, Type::kHistogram, labels);
+  if (!s.histogram) s.histogram = std::make_unique<Histogram>(scale);
+  return *s.histogram;
+}
+
+void Registry::SetGaugeCallback(const std::string& name,
+                                const std::string& help,
+                                const Labels& labels,
+                                std::function<double()> fn) {
+  std::lock_guard<std::mutex> lock(mu_);
+  GetSeries(name, help, Type::kGauge, labels).callback = std::move(fn);
+}
+
+std::string Registry::RenderPrometheus() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::string out;
+  out.reserve(families_.size() * 512);
+  for (const auto& [name, family] : families_) {
+    out.append("# HELP ").append(name).push_back(' ');
+    out.append(family.help).push_back('\n');
+    out.append("# TYPE ").append(name).push_back(' ');
+    out.append(family.type == Type::kCounter ? "counter" : family.type == Type::kGauge ? "gauge" : "histogram");
+    out.push_back('\n');
+    for (const auto& s : family.series) {
+      if (s->histogram) {
+        const auto snap = s->histogram->Read();
+        uint64_t cumulative = 0;
+        char le[32];
+        for (size_t i = 0; i < snap.counts.size(); ++i) {
+          cumulative += snap.counts[i];
+          if (i < snap.upper_bounds.size()) {
+            std::snprintf(le, sizeof(le), "%.6g", snap.upper_bounds[i]);
+          } else {
+            std::snprintf(le, sizeof(le), "+Inf");
+          }
+          out.append(name).append("_bucket");
+          AppendLabels(out, s->labels, le);
+          out.push_back(' ');
+          AppendNumber(out, cumulative);
+          out.push_back('\n');
+        }
+        out.append(name).append("_sum");
+        AppendLabels(out, s->labels);
+        out.push_back(' ');
+        AppendNumber(out, snap.sum);
+        out.push_back('\n');
+        out.append(name).append("_count");
+        AppendLabels(out, s->labels);
+        out.push_back(' ');
+        AppendNumber(out, snap.count);
+        out.push_back('\n');
+        continue;
+      }
+      out.append(name);
+      AppendLabels(out, s->labels);
+      out.push_back(' ');
+      if (s->counter) {
+        AppendNumber(out, s->counter->Value());
+      } else if (s->callback) {
+        AppendNumber(out, s->callback());
+      } else if (s->gauge) {
+        AppendNumber(out, static_cast<double>(s->gauge->Value()));
+      } else {
+        out.push_back('0');
+      }
+      out.push_back('\n');
+    }
+  }
+  return out;
+}
+
+Registry& Default() {
+  static Registry* registry = new Registry();  // never destroyed; outlives worker threads
+  return *registry;
+}
+
+}  // namespace metrics
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace metrics {
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+// Writers update one of kShards cache-line-sized cells chosen per thread, so
+// hot-path updates are uncontended relaxed atomics; readers sum the shards.
+constexpr size_t kShards = 16;
+size_t ThreadShard();
+
+class Counter {
+ public:
+  void Inc(uint64_t n = 1) { cells_[ThreadShard()].v.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t Value() const;
+
+ private:
+  struct alignas(64) Cell {
+    std::atomic<uint64_t> v{0};
+  };
+  std::array<Cell, kShards> cells_{};
+};
+
+class Gauge {
+ public:
+  void Set(int64_t v) { v_.store(v, std::memory_order_relaxed); }
+  void Add(int64_t d) { v_.fetch_add(d, std::memory_order_relaxed); }
+  int64_t Value() const { return v_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> v_{0};
+};
+
+// Log-linear buckets: two per power of two starting at `min` (upper bounds
+// min, 1.5*min, 2*min, 3*min, 4*min, ...), plus +Inf. Worst-case relative
+// bucket width is 50%, which is plenty for latency/size distributions.
+class Histogram {
+ public:
+  struct Scale {
+    double min;
+    int octaves;
+  };
+  static constexpr Scale kSeconds{1e-6, 26};  // 1us .. ~67s
+  static constexpr Scale kBytes{64, 20};      // 64B .. 64MB
+  static constexpr int kMaxBuckets = 2 * 26 + 2;
+
+  struct Snapshot {
+    std::vector<double> upper_bounds;  // excludes +Inf
+    std::vector<uint64_t> counts;      // per bucket (not cumulative), last is +Inf
+    uint64_t count = 0;
+    double sum = 0;
+  };
+
+  explicit Histogram(Scale scale);
+
+  void Observe(double v);
+  Snapshot Read() const;
+
+ private:
+  int BucketFor(double v) const;
+
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, kMaxBuckets> buckets{};
+    std::atomic<double> sum{0};
+  };
+
+  const Scale scale_;
+  const int bucket_count_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+// Observes elapsed seconds into a histogram when it goes out of scope.
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Histogram& h) : h_(h), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    h_.Observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+  }
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  Histogram& h_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+// Named metric families rendered in the Prometheus text format. Get* returns a
+// reference that stays valid for the life of the registry; look it up once and
+// keep it (registration takes a lock, updates do not).
+class Registry {
+ public:
+  Counter& GetCounter(const std::string& name, const std::string& help, const Labels& labels = {});
+  Gauge& GetGauge(const std::string& name, const std::string& help, const Labels& labels = {});
+  Histogram& GetHistogram(const std::string& name,
+                          const std::string& help,
+                          const Labels& labels,
+                          Histogram::Scale scale);
+  // Gauge evaluated at scrape time; for values owned elsewhere (queue sizes,
+  // session counts). Re-registering the same series replaces the callback.
+  void SetGaugeCallback(const std::string& name,
+                        const std::string& help,
+                        const Labels& labels,
+                        std::function<double()> fn);
+
+  std::string RenderPrometheus() const;
+
+ private:
+  enum class Type { kCounter, kGauge, kHistogram };
+
+  struct Series {
+    Labels labels;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+    std::function<double()> callback;
+  };
+
+  struct Family {
+    std::string help;
+    Type type = Type::kCounter;
+    std::vector<std::unique_ptr<Series>> series;
+  };
+
+  Series& GetSeries(const std::string& name, const std::string& help, Type type, const Labels& labels);
+
+  mutable std::mutex mu_;
+  std::map<std::string, Family> families_;
+};
+
+// Process-wide registry used by instrumentation in storage/persistence layers.
+Registry& Default();
+
+}  // namespace metrics
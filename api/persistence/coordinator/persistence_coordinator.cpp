@@ -1,5 +1,7 @@
 #include "persistence_coordinator.h"
 
+#include "../../diagnostics/tracer.h"
+
 namespace persistence {
 
 PersistenceCoordinator::PersistenceCoordinator(CoordinatorConfig cfg,
@@ -22,6 +24,7 @@ PersistenceCoordinator::~PersistenceCoordinator() {
 }
 
 bool PersistenceCoordinator::Emit(const PersistenceIntent& intent) {
+  diagnostics::TraceSpan span("persistence", "Emit");
   runtime_store_.RecordIntent(intent);
 
   const auto policy = router_.Route(intent);
@@ -44,6 +47,7 @@ bool PersistenceCoordinator::Emit(const PersistenceIntent& intent) {
 }
 
 void PersistenceCoordinator::TickFlush() {
+  diagnostics::TraceSpan span("persistence", "TickFlush");
   (void)buffered_store_.FlushDue(permanent_store_, registry_,
                                  cfg_.flush_chunks_seconds,
                                  cfg_.flush_snapshots_seconds,
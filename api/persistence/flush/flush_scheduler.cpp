@@ -3,6 +3,8 @@
 #include <chrono>
 #include <utility>
 
+#include "../../diagnostics/tracer.h"
+
 namespace persistence {
 
 FlushScheduler::FlushScheduler(std::function<void()> tick_fn)
@@ -15,6 +17,7 @@ FlushScheduler::~FlushScheduler() {
 void FlushScheduler::Start() {
   if (running_.exchange(true)) return;
   worker_ = std::thread([this] {
+    diagnostics::DefaultTracer().SetThreadName("persistence_flush");
     while (running_.load()) {
       tick_fn_();
       std::this_thread::sleep_for(std::chrono::milliseconds(200));
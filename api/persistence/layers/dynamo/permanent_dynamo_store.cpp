@@ -45,13 +45,10 @@ bool PermanentDynamoStore::ApplyEconomyDeltas(
     int64_t movement_ticks_delta,
     const std::unordered_map<std::string, std::pair<int64_t, int64_t>>& user_deltas) {
   if (period_key.empty()) return true;
-  if (!storage_.IncrementEconomyPeriodRaw(period_key, harvested_food_delta, movement_ticks_delta)) return false;
-  for (const auto& kv : user_deltas) {
-    if (!storage_.IncrementEconomyPeriodUserRaw(period_key, kv.first, kv.second.first, kv.second.second)) {
-      return false;
-    }
-  }
-  return true;
+  std::vector<storage::EconomyPeriodUserDelta> rows;
+  rows.reserve(user_deltas.size());
+  for (const auto& kv : user_deltas) rows.push_back({kv.first, kv.second.first, kv.second.second});
+  return storage_.IncrementEconomyPeriodRawBatch(period_key, harvested_food_delta, movement_ticks_delta, rows);
 }
 
 }  // namespace persistence
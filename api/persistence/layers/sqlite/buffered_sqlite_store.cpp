@@ -8,6 +8,9 @@
 #include <utility>
 #include <vector>
 
+#include "../../../diagnostics/tracer.h"
+#include "../../../metrics/metrics.h"
+
 namespace persistence {
 namespace {
 
@@ -20,6 +23,71 @@ bool bind_text(sqlite3_stmt* stmt, int idx, const std::string& s) {
   return sqlite3_bind_text(stmt, idx, s.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK;
 }
 
+struct SqliteMetrics {
+  metrics::Histogram& insert_event;
+  metrics::Histogram& upsert_snapshot;
+  metrics::Histogram& upsert_chunk;
+  metrics::Histogram& upsert_period_delta;
+  metrics::Histogram& upsert_period_user_delta;
+  metrics::Histogram& delete_flushed;
+  metrics::Histogram& flush_world_chunks;
+  metrics::Histogram& flush_snake_snapshots;
+  metrics::Histogram& flush_period_deltas;
+  metrics::Histogram& flush_snake_events;
+  metrics::Gauge& rows_world_chunks;
+  metrics::Gauge& rows_snake_snapshots;
+  metrics::Gauge& rows_period_deltas;
+  metrics::Gauge& rows_snake_events;
+};
+
+SqliteMetrics& Metrics() {
+  static SqliteMetrics m = [] {
+    auto& r = metrics::Default();
+    const auto stmt = [&](const char* name) -> metrics::Histogram& {
+      return r.GetHistogram("snake_sqlite_statement_seconds", "SQLite statement step latency in the buffered store.",
+                            {{"statement", name}}, metrics::Histogram::kSeconds);
+    };
+    const auto flush = [&](const char* name) -> metrics::Histogram& {
+      return r.GetHistogram("snake_persistence_flush_seconds",
+                            "Time to drain one batch of buffered intents to the permanent store.",
+                            {{"intent", name}}, metrics::Histogram::kSeconds);
+    };
+    const auto rows = [&](const char* name) -> metrics::Gauge& {
+      return r.GetGauge("snake_persistence_buffered_rows", "Rows waiting in the SQLite buffer after the last flush.",
+                        {{"intent", name}});
+    };
+    return SqliteMetrics{stmt("insert_event"),
+                         stmt("upsert_snapshot"),
+                         stmt("upsert_chunk"),
+                         stmt("upsert_period_delta"),
+                         stmt("upsert_period_user_delta"),
+                         stmt("delete_flushed"),
+                         flush("world_chunks"),
+                         flush("snake_snapshots"),
+                         flush("period_deltas"),
+                         flush("snake_events"),
+                         rows("world_chunks"),
+                         rows("snake_snapshots"),
+                         rows("period_deltas"),
+                         rows("snake_events")};
+  }();
+  return m;
+}
+
+int StepTimed(sqlite3_stmt* stmt, metrics::Histogram& h) {
+  metrics::ScopedTimer timer(h);
+  return sqlite3_step(stmt);
+}
+
+int64_t CountRows(sqlite3* db, const char* table) {
+  const std::string sql = std::string("SELECT COUNT(*) FROM ") + table;
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) return 0;
+  const int64_t n = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+  sqlite3_finalize(stmt);
+  return n;
+}
+
 bool ColumnExists(sqlite3* db, const std::string& table, const std::string& column) {
   const std::string sql = "PRAGMA table_info(" + table + ")";
   sqlite3_stmt* stmt = nullptr;
@@ -179,7 +247,7 @@ bool BufferedSqliteStore::UpsertSnakeSnapshot(const storage::Snake& s, bool dele
   sqlite3_bind_int64(stmt, i++, s.updated_at);
   sqlite3_bind_int(stmt, i++, deleted ? 1 : 0);
   sqlite3_bind_int64(stmt, i++, now_ms());
-  const int rc = sqlite3_step(stmt);
+  const int rc = StepTimed(stmt, Metrics().upsert_snapshot);
   sqlite3_finalize(stmt);
   return rc == SQLITE_DONE;
 }
@@ -201,7 +269,7 @@ bool BufferedSqliteStore::UpsertWorldChunk(const storage::WorldChunk& c) {
   sqlite3_bind_int64(stmt, i++, c.version);
   sqlite3_bind_int64(stmt, i++, c.updated_at);
   sqlite3_bind_int64(stmt, i++, now_ms());
-  const int rc = sqlite3_step(stmt);
+  const int rc = StepTimed(stmt, Metrics().upsert_chunk);
   sqlite3_finalize(stmt);
   return rc == SQLITE_DONE;
 }
@@ -216,7 +284,7 @@ bool BufferedSqliteStore::UpsertPeriodDelta(const std::string& period_key, int64
   sqlite3_bind_int64(stmt, 2, h_delta);
   sqlite3_bind_int64(stmt, 3, m_delta);
   sqlite3_bind_int64(stmt, 4, now_ms());
-  const int rc = sqlite3_step(stmt);
+  const int rc = StepTimed(stmt, Metrics().upsert_period_delta);
   sqlite3_finalize(stmt);
   return rc == SQLITE_DONE;
 }
@@ -235,13 +303,16 @@ bool BufferedSqliteStore::UpsertPeriodUserDelta(const std::string& period_key,
   sqlite3_bind_int64(stmt, 3, h_delta);
   sqlite3_bind_int64(stmt, 4, m_delta);
   sqlite3_bind_int64(stmt, 5, now_ms());
-  const int rc = sqlite3_step(stmt);
+  const int rc = StepTimed(stmt, Metrics().upsert_period_user_delta);
   sqlite3_finalize(stmt);
   return rc == SQLITE_DONE;
 }
 
 bool BufferedSqliteStore::BufferIntent(const PersistenceIntent& intent) {
+  diagnostics::TraceSpan span("sqlite", "BufferIntent");
+  diagnostics::TraceSpan wait("sqlite", "BufferIntent.lock_wait");
   std::lock_guard<std::mutex> lock(mu_);
+  wait.End();
   if (!db_ && !OpenLocked()) return false;
 
   switch (intent.type) {
@@ -263,7 +334,7 @@ bool BufferedSqliteStore::BufferIntent(const PersistenceIntent& intent) {
       sqlite3_bind_int64(stmt, i++, intent.snake_event->world_version);
       sqlite3_bind_int64(stmt, i++, intent.snake_event->created_at);
       sqlite3_bind_int64(stmt, i++, now_ms());
-      const int rc = sqlite3_step(stmt);
+      const int rc = StepTimed(stmt, Metrics().insert_event);
       sqlite3_finalize(stmt);
       return rc == SQLITE_DONE;
     }
@@ -293,6 +364,7 @@ bool BufferedSqliteStore::FlushSnakeEvents(IPermanentStore& permanent, int flush
   const int64_t now = now_ms();
   if (now - last_events_flush_ms_ < flush_interval_seconds * 1000LL) return true;
   last_events_flush_ms_ = now;
+  metrics::ScopedTimer timer(Metrics().flush_snake_events);
 
   sqlite3_stmt* stmt = nullptr;
   const char* sql =
@@ -328,7 +400,7 @@ bool BufferedSqliteStore::FlushSnakeEvents(IPermanentStore& permanent, int flush
     sqlite3_stmt* del = nullptr;
     if (sqlite3_prepare_v2(db_, "DELETE FROM buffered_snake_events WHERE id=?", -1, &del, nullptr) != SQLITE_OK) return false;
     sqlite3_bind_int64(del, 1, id);
-    const int rc = sqlite3_step(del);
+    const int rc = StepTimed(del, Metrics().delete_flushed);
     sqlite3_finalize(del);
     if (rc != SQLITE_DONE) return false;
   }
@@ -339,6 +411,7 @@ bool BufferedSqliteStore::FlushSnakeSnapshots(IPermanentStore& permanent, int fl
   const int64_t now = now_ms();
   if (now - last_snapshots_flush_ms_ < flush_interval_seconds * 1000LL) return true;
   last_snapshots_flush_ms_ = now;
+  metrics::ScopedTimer timer(Metrics().flush_snake_snapshots);
 
   sqlite3_stmt* stmt = nullptr;
   const char* sql =
@@ -382,7 +455,7 @@ bool BufferedSqliteStore::FlushSnakeSnapshots(IPermanentStore& permanent, int fl
     sqlite3_stmt* del = nullptr;
     if (sqlite3_prepare_v2(db_, "DELETE FROM buffered_snake_snapshots WHERE snake_id=?", -1, &del, nullptr) != SQLITE_OK) return false;
     bind_text(del, 1, key);
-    const int rc = sqlite3_step(del);
+    const int rc = StepTimed(del, Metrics().delete_flushed);
     sqlite3_finalize(del);
     if (rc != SQLITE_DONE) return false;
   }
@@ -393,6 +466,7 @@ bool BufferedSqliteStore::FlushWorldChunks(IPermanentStore& permanent, int flush
   const int64_t now = now_ms();
   if (now - last_chunks_flush_ms_ < flush_interval_seconds * 1000LL) return true;
   last_chunks_flush_ms_ = now;
+  metrics::ScopedTimer timer(Metrics().flush_world_chunks);
 
   sqlite3_stmt* stmt = nullptr;
   const char* sql = "SELECT chunk_id,width,height,obstacles,food_state,version,updated_at FROM buffered_world_chunks LIMIT 200";
@@ -424,7 +498,7 @@ bool BufferedSqliteStore::FlushWorldChunks(IPermanentStore& permanent, int flush
     sqlite3_stmt* del = nullptr;
     if (sqlite3_prepare_v2(db_, "DELETE FROM buffered_world_chunks WHERE chunk_id=?", -1, &del, nullptr) != SQLITE_OK) return false;
     bind_text(del, 1, key);
-    const int rc = sqlite3_step(del);
+    const int rc = StepTimed(del, Metrics().delete_flushed);
     sqlite3_finalize(del);
     if (rc != SQLITE_DONE) return false;
   }
@@ -435,6 +509,7 @@ bool BufferedSqliteStore::FlushPeriodDeltas(IPermanentStore& permanent, int flus
   const int64_t now = now_ms();
   if (now - last_period_flush_ms_ < flush_interval_seconds * 1000LL) return true;
   last_period_flush_ms_ = now;
+  metrics::ScopedTimer timer(Metrics().flush_period_deltas);
 
   sqlite3_stmt* stmt = nullptr;
   const char* sql = "SELECT period_key,harvested_food_delta,movement_ticks_delta FROM buffered_period_deltas LIMIT 50";
@@ -471,14 +546,14 @@ bool BufferedSqliteStore::FlushPeriodDeltas(IPermanentStore& permanent, int flus
     sqlite3_stmt* del1 = nullptr;
     if (sqlite3_prepare_v2(db_, "DELETE FROM buffered_period_deltas WHERE period_key=?", -1, &del1, nullptr) != SQLITE_OK) return false;
     bind_text(del1, 1, period.period_key);
-    int rc = sqlite3_step(del1);
+    int rc = StepTimed(del1, Metrics().delete_flushed);
     sqlite3_finalize(del1);
     if (rc != SQLITE_DONE) return false;
 
     sqlite3_stmt* del2 = nullptr;
     if (sqlite3_prepare_v2(db_, "DELETE FROM buffered_period_user_deltas WHERE period_key=?", -1, &del2, nullptr) != SQLITE_OK) return false;
     bind_text(del2, 1, period.period_key);
-    rc = sqlite3_step(del2);
+    rc = StepTimed(del2, Metrics().delete_flushed);
     sqlite3_finalize(del2);
     if (rc != SQLITE_DONE) return false;
   }
@@ -490,7 +565,10 @@ bool BufferedSqliteStore::FlushDue(IPermanentStore& permanent,
                                    int flush_chunks_seconds,
                                    int flush_snapshots_seconds,
                                    int flush_period_deltas_seconds) {
+  diagnostics::TraceSpan span("sqlite", "FlushDue");
+  diagnostics::TraceSpan wait("sqlite", "FlushDue.lock_wait");
   std::lock_guard<std::mutex> lock(mu_);
+  wait.End();
   if (!db_ && !OpenLocked()) return false;
 
   if (!FlushWorldChunks(permanent, flush_chunks_seconds)) return false;
@@ -498,9 +576,21 @@ bool BufferedSqliteStore::FlushDue(IPermanentStore& permanent,
   if (!FlushPeriodDeltas(permanent, flush_period_deltas_seconds)) return false;
   // Keep snake events cheap by flushing less frequently via snapshot cadence default.
   if (!FlushSnakeEvents(permanent, std::max(15, flush_snapshots_seconds))) return false;
+  RefreshQueueDepthLocked();
   return true;
 }
 
+void BufferedSqliteStore::RefreshQueueDepthLocked() {
+  const int64_t now = now_ms();
+  if (now - last_depth_refresh_ms_ < 1000) return;
+  last_depth_refresh_ms_ = now;
+  auto& m = Metrics();
+  m.rows_world_chunks.Set(CountRows(db_, "buffered_world_chunks"));
+  m.rows_snake_snapshots.Set(CountRows(db_, "buffered_snake_snapshots"));
+  m.rows_period_deltas.Set(CountRows(db_, "buffered_period_deltas"));
+  m.rows_snake_events.Set(CountRows(db_, "buffered_snake_events"));
+}
+
 bool BufferedSqliteStore::Cleanup(int retention_hours, int max_mb) {
   std::lock_guard<std::mutex> lock(mu_);
   if (!db_ && !OpenLocked()) return false;
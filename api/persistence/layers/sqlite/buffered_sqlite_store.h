@@ -37,6 +37,8 @@ class BufferedSqliteStore final : public IBufferedStore {
   bool FlushSnakeSnapshots(IPermanentStore& permanent, int flush_interval_seconds);
   bool FlushWorldChunks(IPermanentStore& permanent, int flush_interval_seconds);
   bool FlushPeriodDeltas(IPermanentStore& permanent, int flush_interval_seconds);
+  // Publishes buffered row counts to metrics, at most once per second.
+  void RefreshQueueDepthLocked();
 
   std::string path_;
   sqlite3* db_ = nullptr;
@@ -46,6 +48,7 @@ class BufferedSqliteStore final : public IBufferedStore {
   int64_t last_snapshots_flush_ms_ = 0;
   int64_t last_chunks_flush_ms_ = 0;
   int64_t last_period_flush_ms_ = 0;
+  int64_t last_depth_refresh_ms_ = 0;
 };
 
 }  // namespace persistence
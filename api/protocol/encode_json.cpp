@@ -1,72 +1,64 @@
 #include "encode_json.h"
 
-#include <iomanip>
-#include <sstream>
+#include <charconv>
+#include <cstring>
+#include <string_view>
 
 namespace protocol {
 namespace {
 
-std::string json_escape(const std::string& in) {
-  std::ostringstream out;
-  for (unsigned char c : in) {
-    switch (c) {
-      case '\"': out << "\\\""; break;
-      case '\\': out << "\\\\"; break;
-      case '\b': out << "\\b"; break;
-      case '\f': out << "\\f"; break;
-      case '\n': out << "\\n"; break;
-      case '\r': out << "\\r"; break;
-      case '\t': out << "\\t"; break;
-      default:
-        if (c < 0x20) {
-          out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
-              << static_cast<int>(c) << std::dec;
-        } else {
-          out << static_cast<char>(c);
-        }
-    }
+// Points dominate snapshot size, so each one is formatted into a stack buffer
+// and appended in a single call.
+void append_vec2_array(JsonWriter& w, const std::vector<Vec2>& points) {
+  w.BeginArray();
+  char buf[48];
+  for (const auto& p : points) {
+    char* out = buf;
+    std::memcpy(out, "{\"x\":", 5);
+    out = std::to_chars(out + 5, out + 16, p.x).ptr;
+    std::memcpy(out, ",\"y\":", 5);
+    out = std::to_chars(out + 5, out + 16, p.y).ptr;
+    *out++ = '}';
+    w.Raw(std::string_view(buf, static_cast<size_t>(out - buf)));
   }
-  return out.str();
+  w.EndArray();
 }
 
-void append_vec2_array(std::ostringstream& out, const std::vector<Vec2>& points) {
-  out << "[";
-  for (size_t i = 0; i < points.size(); ++i) {
-    const auto& p = points[i];
-    out << "{\"x\":" << p.x << ",\"y\":" << p.y << "}";
-    if (i + 1 < points.size()) out << ",";
-  }
-  out << "]";
+size_t estimate_snapshot_bytes(const Snapshot& s) {
+  size_t cells = s.foods.size();
+  for (const auto& snake : s.snakes) cells += snake.body.size();
+  return 64 + cells * 20 + s.snakes.size() * 96;
 }
 
 }  // namespace
 
-std::string encode_snapshot_json(const Snapshot& s) {
-  std::ostringstream out;
-  out << "{";
-  out << "\"tick\":" << s.tick << ",";
-  out << "\"w\":" << s.w << ",";
-  out << "\"h\":" << s.h << ",";
-  out << "\"foods\":";
-  append_vec2_array(out, s.foods);
-  out << ",";
-  out << "\"snakes\":[";
-  for (size_t i = 0; i < s.snakes.size(); ++i) {
-    const auto& snake = s.snakes[i];
-    out << "{";
-    out << "\"id\":" << snake.id << ",";
-    out << "\"user_id\":" << snake.user_id << ",";
-    out << "\"color\":\"" << json_escape(snake.color) << "\",";
-    out << "\"dir\":" << snake.dir << ",";
-    out << "\"paused\":" << (snake.paused ? "true" : "false") << ",";
-    out << "\"body\":";
-    append_vec2_array(out, snake.body);
-    out << "}";
-    if (i + 1 < s.snakes.size()) out << ",";
+void encode_snapshot_json(JsonWriter& w, const Snapshot& s) {
+  w.BeginObject();
+  w.Field("tick", s.tick);
+  w.Field("w", s.w);
+  w.Field("h", s.h);
+  w.Key("foods");
+  append_vec2_array(w, s.foods);
+  w.Key("snakes").BeginArray();
+  for (const auto& snake : s.snakes) {
+    w.BeginObject();
+    w.Field("id", snake.id);
+    w.Field("user_id", snake.user_id);
+    w.Field("color", snake.color);
+    w.Field("dir", snake.dir);
+    w.Field("paused", snake.paused);
+    w.Key("body");
+    append_vec2_array(w, snake.body);
+    w.EndObject();
   }
-  out << "]";
-  out << "}";
-  return out.str();
+  w.EndArray();
+  w.EndObject();
+}
+
+std::string encode_snapshot_json(const Snapshot& s) {
+  JsonWriter w(estimate_snapshot_bytes(s));
+  encode_snapshot_json(w, s);
+  return w.Take();
 }
 
 }  // namespace protocol
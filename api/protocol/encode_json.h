@@ -2,6 +2,7 @@
 
 #include <string>
 
+#include "json_writer.h"
 #include "protocol.h"
 
 namespace protocol {
@@ -10,4 +11,7 @@ namespace protocol {
 // frontend parsing code.
 std::string encode_snapshot_json(const Snapshot& s);
 
+// Writes the same snapshot object as a value into an enclosing document.
+void encode_snapshot_json(JsonWriter& w, const Snapshot& s);
+
 }  // namespace protocol
@@ -0,0 +1,304 @@
+#include "json_reader.h"
+
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace protocol {
+namespace {
+
+class Scanner {
+ public:
+  explicit Scanner(std::string_view s) : p_(s.data()), end_(s.data() + s.size()) {}
+
+  void SkipWs() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_;
+  }
+  bool AtEnd() const { return p_ >= end_; }
+  char Peek() const { return p_ < end_ ? *p_ : '\0'; }
+  bool Consume(char c) {
+    if (p_ < end_ && *p_ == c) {
+      ++p_;
+      return true;
+    }
+    return false;
+  }
+
+  // At an opening quote; yields the contents without quotes.
+  bool String(std::string_view& out, bool& escaped) {
+    if (!Consume('"')) return false;
+    const char* start = p_;
+    escaped = false;
+    while (p_ < end_) {
+      const char c = *p_;
+      if (c == '"') {
+        out = std::string_view(start, static_cast<size_t>(p_ - start));
+        ++p_;
+        return true;
+      }
+      if (c == '\\') {
+        escaped = true;
+        if (++p_ >= end_) return false;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        return false;
+      }
+      ++p_;
+    }
+    return false;
+  }
+
+  bool Literal(std::string_view word) {
+    if (static_cast<size_t>(end_ - p_) < word.size() || std::string_view(p_, word.size()) != word) return false;
+    p_ += word.size();
+    return true;
+  }
+
+  bool Number(std::string_view& out) {
+    const char* start = p_;
+    while (p_ < end_) {
+      const char c = *p_;
+      if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+        ++p_;
+      } else {
+        break;
+      }
+    }
+    out = std::string_view(start, static_cast<size_t>(p_ - start));
+    return !out.empty();
+  }
+
+  // Skips a nested object/array, returning its raw text.
+  bool Nested(std::string_view& out) {
+    const char* start = p_;
+    int depth = 0;
+    while (p_ < end_) {
+      const char c = *p_;
+      if (c == '"') {
+        std::string_view ignored;
+        bool esc = false;
+        if (!String(ignored, esc)) return false;
+        continue;
+      }
+      if (c == '{' || c == '[') ++depth;
+      if (c == '}' || c == ']') {
+        if (--depth == 0) {
+          ++p_;
+          out = std::string_view(start, static_cast<size_t>(p_ - start));
+          return true;
+        }
+      }
+      ++p_;
+    }
+    return false;
+  }
+
+ private:
+  const char* p_;
+  const char* end_;
+};
+
+void AppendUtf8(std::string& out, uint32_t cp) {
+  if (cp < 0x80) {
+    out.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  }
+}
+
+bool ParseHex4(std::string_view s, size_t at, uint32_t& out) {
+  if (at + 4 > s.size()) return false;
+  uint32_t v = 0;
+  const auto r = std::from_chars(s.data() + at, s.data() + at + 4, v, 16);
+  if (r.ptr != s.data() + at + 4) return false;
+  out = v;
+  return true;
+}
+
+}  // namespace
+
+bool JsonFields::Parse(std::string_view json) {
+  count_ = 0;
+  ok_ = false;
+  Scanner sc(json);
+  sc.SkipWs();
+  if (!sc.Consume('{')) return false;
+  sc.SkipWs();
+  if (!sc.Consume('}')) {
+    for (;;) {
+      if (count_ == kMaxMembers) {
+        count_ = 0;
+        return false;
+      }
+      Member& m = members_[count_];
+      bool key_escaped = false;
+      sc.SkipWs();
+      if (!sc.String(m.key, key_escaped)) break;
+      sc.SkipWs();
+      if (!sc.Consume(':')) break;
+      sc.SkipWs();
+      m.escaped = false;
+      bool parsed = false;
+      switch (sc.Peek()) {
+        case '"':
+          m.type = Type::kString;
+          parsed = sc.String(m.value, m.escaped);
+          break;
+        case '{':
+        case '[':
+          m.type = sc.Peek() == '{' ? Type::kObject : Type::kArray;
+          parsed = sc.Nested(m.value);
+          break;
+        case 't':
+          m.type = Type::kBool;
+          m.value = "true";
+          parsed = sc.Literal("true");
+          break;
+        case 'f':
+          m.type = Type::kBool;
+          m.value = "false";
+          parsed = sc.Literal("false");
+          break;
+        case 'n':
+          m.type = Type::kNull;
+          m.value = "null";
+          parsed = sc.Literal("null");
+          break;
+        default:
+          m.type = Type::kNumber;
+          parsed = sc.Number(m.value);
+          break;
+      }
+      if (!parsed) break;
+      ++count_;
+      sc.SkipWs();
+      if (sc.Consume(',')) continue;
+      if (!sc.Consume('}')) break;
+      sc.SkipWs();
+      ok_ = sc.AtEnd();
+      if (!ok_) count_ = 0;
+      return ok_;
+    }
+    count_ = 0;
+    return false;
+  }
+  sc.SkipWs();
+  ok_ = sc.AtEnd();
+  return ok_;
+}
+
+const JsonFields::Member* JsonFields::Find(std::string_view key) const {
+  for (size_t i = 0; i < count_; ++i) {
+    if (members_[i].key == key) return &members_[i];
+  }
+  return nullptr;
+}
+
+std::optional<std::string_view> JsonFields::GetStringView(std::string_view key) const {
+  const Member* m = Find(key);
+  if (!m || m->type != Type::kString || m->escaped) return std::nullopt;
+  return m->value;
+}
+
+std::optional<std::string> JsonFields::GetString(std::string_view key) const {
+  const Member* m = Find(key);
+  if (!m || m->type != Type::kString) return std::nullopt;
+  return m->escaped ? JsonUnescape(m->value) : std::string(m->value);
+}
+
+std::optional<int64_t> JsonFields::GetInt64(std::string_view key) const {
+  const Member* m = Find(key);
+  if (!m || m->type != Type::kNumber) return std::nullopt;
+  const char* first = m->value.data();
+  const char* last = first + m->value.size();
+  int64_t v = 0;
+  const auto r = std::from_chars(first, last, v);
+  if (r.ec == std::errc() && r.ptr == last) return v;
+  const auto d = GetDouble(key);
+  if (!d || !std::isfinite(*d)) return std::nullopt;
+  const double t = std::trunc(*d);
+  if (t < static_cast<double>(std::numeric_limits<int64_t>::min()) ||
+      t >= static_cast<double>(std::numeric_limits<int64_t>::max())) {
+    return std::nullopt;
+  }
+  return static_cast<int64_t>(t);
+}
+
+std::optional<int> JsonFields::GetInt(std::string_view key) const {
+  const auto v = GetInt64(key);
+  if (!v || *v < std::numeric_limits<int>::min() || *v > std::numeric_limits<int>::max()) return std::nullopt;
+  return static_cast<int>(*v);
+}
+
+std::optional<double> JsonFields::GetDouble(std::string_view key) const {
+  const Member* m = Find(key);
+  if (!m || m->type != Type::kNumber) return std::nullopt;
+  const char* first = m->value.data();
+  const char* last = first + m->value.size();
+  if (first < last && *first == '+') ++first;  // from_chars rejects a leading '+'
+  double v = 0;
+  const auto r = std::from_chars(first, last, v);
+  if (r.ec != std::errc() || r.ptr != last) return std::nullopt;
+  return v;
+}
+
+std::optional<bool> JsonFields::GetBool(std::string_view key) const {
+  const Member* m = Find(key);
+  if (!m || m->type != Type::kBool) return std::nullopt;
+  return m->value == "true";
+}
+
+std::string JsonUnescape(std::string_view raw) {
+  std::string out;
+  out.reserve(raw.size());
+  for (size_t i = 0; i < raw.size(); ++i) {
+    const char c = raw[i];
+    if (c != '\\' || i + 1 >= raw.size()) {
+      out.push_back(c);
+      continue;
+    }
+    const char e = raw[++i];
+    switch (e) {
+      case 'b': out.push_back('\b'); break;
+      case 'f': out.push_back('\f'); break;
+      case 'n': out.push_back('\n'); break;
+      case 'r': out.push_back('\r'); break;
+      case 't': out.push_back('\t'); break;
+      case 'u': {
+        uint32_t cp = 0;
+        if (!ParseHex4(raw, i + 1, cp)) {
+          out.push_back('?');
+          break;
+        }
+        i += 4;
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+          uint32_t lo = 0;
+          if (i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u' && ParseHex4(raw, i + 3, lo) &&
+              lo >= 0xDC00 && lo <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            i += 6;
+          } else {
+            cp = 0xFFFD;
+          }
+        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+          cp = 0xFFFD;
+        }
+        AppendUtf8(out, cp);
+        break;
+      }
+      default: out.push_back(e); break;  // \" \\ \/
+    }
+  }
+  return out;
+}
+
+}  // namespace protocol
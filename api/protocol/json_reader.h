@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace protocol {
+
+// Single-pass view over the top-level members of one JSON object. Parse()
+// records each member as key/value spans into the input (nested objects and
+// arrays are kept as one raw span), so typed lookups are a short linear scan
+// over at most kMaxMembers entries with no allocation. The input must outlive
+// the JsonFields. Duplicate keys resolve to the first occurrence.
+class JsonFields {
+ public:
+  enum class Type : uint8_t { kString, kNumber, kBool, kNull, kObject, kArray };
+
+  struct Member {
+    std::string_view key;
+    std::string_view value;  // string contents without quotes; raw text otherwise
+    Type type = Type::kNull;
+    bool escaped = false;  // string value contains backslash escapes
+  };
+
+  static constexpr size_t kMaxMembers = 32;
+
+  JsonFields() = default;
+  explicit JsonFields(std::string_view json) { Parse(json); }
+
+  // Returns false (and holds no members) if `json` is not a single object or
+  // has more than kMaxMembers members.
+  bool Parse(std::string_view json);
+
+  bool ok() const { return ok_; }
+  size_t size() const { return count_; }
+  const Member* Find(std::string_view key) const;
+
+  // Raw string contents; nullopt for non-strings and strings with escapes
+  // (use GetString for those).
+  std::optional<std::string_view> GetStringView(std::string_view key) const;
+  // Unescaped string value. Allocates.
+  std::optional<std::string> GetString(std::string_view key) const;
+  // Numbers with a fraction or exponent are truncated; out-of-range is nullopt.
+  std::optional<int64_t> GetInt64(std::string_view key) const;
+  std::optional<int> GetInt(std::string_view key) const;
+  std::optional<double> GetDouble(std::string_view key) const;
+  std::optional<bool> GetBool(std::string_view key) const;
+
+ private:
+  std::array<Member, kMaxMembers> members_{};
+  size_t count_ = 0;
+  bool ok_ = false;
+};
+
+// Decodes JSON string escapes (\n, \", \uXXXX incl. surrogate pairs) in `raw`.
+std::string JsonUnescape(std::string_view raw);
+
+}  // namespace protocol
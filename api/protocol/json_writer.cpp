@@ -0,0 +1,222 @@
+#include "json_writer.h"
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace protocol {
+namespace {
+
+constexpr size_t kPoolMaxBuffers = 4;
+constexpr size_t kPoolMaxCapacity = 4u << 20;
+
+// 0 = copy as-is, 'u' = \u00XX, anything else = backslash + that char.
+constexpr std::array<char, 256> BuildEscapeTable() {
+  std::array<char, 256> t{};
+  for (int c = 0; c < 0x20; ++c) t[c] = 'u';
+  t['"'] = '"';
+  t['\\'] = '\\';
+  t['\b'] = 'b';
+  t['\f'] = 'f';
+  t['\n'] = 'n';
+  t['\r'] = 'r';
+  t['\t'] = 't';
+  return t;
+}
+
+constexpr std::array<char, 256> kEscape = BuildEscapeTable();
+
+std::vector<std::string>& BufferPool() {
+  static thread_local std::vector<std::string> pool;
+  return pool;
+}
+
+}  // namespace
+
+void AppendJsonEscaped(std::string& out, std::string_view s) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  const char* p = s.data();
+  const char* end = p + s.size();
+  const char* run = p;
+  while (p < end) {
+    const char e = kEscape[static_cast<unsigned char>(*p)];
+    if (e == 0) {
+      ++p;
+      continue;
+    }
+    out.append(run, static_cast<size_t>(p - run));
+    if (e == 'u') {
+      const unsigned char c = static_cast<unsigned char>(*p);
+      const char seq[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf]};
+      out.append(seq, sizeof(seq));
+    } else {
+      const char seq[2] = {'\\', e};
+      out.append(seq, sizeof(seq));
+    }
+    run = ++p;
+  }
+  out.append(run, static_cast<size_t>(end - run));
+}
+
+void AppendJsonNumber(std::string& out, double v) {
+  if (!std::isfinite(v)) {
+    out.push_back('0');
+    return;
+  }
+  // Fixed notation of DBL_MAX needs ~310 digits plus the fraction.
+  char buf[400];
+  const auto r = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, 6);
+  if (r.ec != std::errc()) {
+    out.push_back('0');
+    return;
+  }
+  const char* last = r.ptr;
+  while (last > buf && last[-1] == '0') --last;
+  if (last > buf && last[-1] == '.') ++last;  // keep one zero: "1.0"
+  out.append(buf, static_cast<size_t>(last - buf));
+}
+
+void AppendJsonInt(std::string& out, int64_t v) {
+  char buf[24];
+  const auto r = std::to_chars(buf, buf + sizeof(buf), v);
+  out.append(buf, static_cast<size_t>(r.ptr - buf));
+}
+
+void AppendJsonUint(std::string& out, uint64_t v) {
+  char buf[24];
+  const auto r = std::to_chars(buf, buf + sizeof(buf), v);
+  out.append(buf, static_cast<size_t>(r.ptr - buf));
+}
+
+std::string JsonEscape(std::string_view s) {
+  std::string out;
+  out.reserve(s.size() + 8);
+  AppendJsonEscaped(out, s);
+  return out;
+}
+
+std::string JsonNumber(double v) {
+  std::string out;
+  AppendJsonNumber(out, v);
+  return out;
+}
+
+JsonWriter::JsonWriter(size_t reserve_hint) {
+  auto& pool = BufferPool();
+  if (!pool.empty()) {
+    buf_ = std::move(pool.back());
+    pool.pop_back();
+    buf_.clear();
+  }
+  if (buf_.capacity() < reserve_hint) buf_.reserve(reserve_hint);
+}
+
+JsonWriter::~JsonWriter() {
+  if (buf_.capacity() == 0 || buf_.capacity() > kPoolMaxCapacity) return;
+  auto& pool = BufferPool();
+  if (pool.size() < kPoolMaxBuffers) pool.push_back(std::move(buf_));
+}
+
+std::string JsonWriter::Take() {
+  return std::move(buf_);
+}
+
+void JsonWriter::BeforeValue() {
+  if (after_key_) {
+    after_key_ = false;
+    return;
+  }
+  if (depth_ == 0) return;
+  const uint64_t bit = uint64_t{1} << ((depth_ - 1) & 63);
+  if (has_members_ & bit) buf_.push_back(',');
+  has_members_ |= bit;
+}
+
+JsonWriter& JsonWriter::BeginObject() {
+  BeforeValue();
+  buf_.push_back('{');
+  ++depth_;
+  has_members_ &= ~(uint64_t{1} << ((depth_ - 1) & 63));
+  return *this;
+}
+
+JsonWriter& JsonWriter::EndObject() {
+  buf_.push_back('}');
+  if (depth_ > 0) --depth_;
+  return *this;
+}
+
+JsonWriter& JsonWriter::BeginArray() {
+  BeforeValue();
+  buf_.push_back('[');
+  ++depth_;
+  has_members_ &= ~(uint64_t{1} << ((depth_ - 1) & 63));
+  return *this;
+}
+
+JsonWriter& JsonWriter::EndArray() {
+  buf_.push_back(']');
+  if (depth_ > 0) --depth_;
+  return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key) {
+  BeforeValue();
+  buf_.push_back('"');
+  AppendJsonEscaped(buf_, key);
+  buf_.append("\":", 2);
+  after_key_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::String(std::string_view v) {
+  BeforeValue();
+  buf_.push_back('"');
+  AppendJsonEscaped(buf_, v);
+  buf_.push_back('"');
+  return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool v) {
+  BeforeValue();
+  if (v) {
+    buf_.append("true", 4);
+  } else {
+    buf_.append("false", 5);
+  }
+  return *this;
+}
+
+JsonWriter& JsonWriter::Null() {
+  BeforeValue();
+  buf_.append("null", 4);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Int(int64_t v) {
+  BeforeValue();
+  AppendJsonInt(buf_, v);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Uint(uint64_t v) {
+  BeforeValue();
+  AppendJsonUint(buf_, v);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Number(double v) {
+  BeforeValue();
+  AppendJsonNumber(buf_, v);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Raw(std::string_view json) {
+  BeforeValue();
+  buf_.append(json.data(), json.size());
+  return *this;
+}
+
+}  // namespace protocol
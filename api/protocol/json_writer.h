@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace protocol {
+
+// Appends `s` to `out` with JSON string escaping (no surrounding quotes).
+void AppendJsonEscaped(std::string& out, std::string_view s);
+// Fixed 6-decimal formatting with trailing zeros trimmed ("1.0", "0.25").
+// Non-finite values are written as 0.
+void AppendJsonNumber(std::string& out, double v);
+void AppendJsonInt(std::string& out, int64_t v);
+void AppendJsonUint(std::string& out, uint64_t v);
+
+std::string JsonEscape(std::string_view s);
+std::string JsonNumber(double v);
+
+// Append-only JSON builder. Output goes into a buffer borrowed from a small
+// per-thread pool, so steady-state encodes reuse capacity instead of
+// reallocating; the buffer returns to the pool on destruction unless Take()
+// moved it out. Commas between members are inserted automatically.
+class JsonWriter {
+ public:
+  explicit JsonWriter(size_t reserve_hint = 512);
+  ~JsonWriter();
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  JsonWriter& BeginObject();
+  JsonWriter& EndObject();
+  JsonWriter& BeginArray();
+  JsonWriter& EndArray();
+  JsonWriter& Key(std::string_view key);
+
+  JsonWriter& String(std::string_view v);
+  JsonWriter& Bool(bool v);
+  JsonWriter& Null();
+  JsonWriter& Int(int64_t v);
+  JsonWriter& Uint(uint64_t v);
+  JsonWriter& Number(double v);
+  // Inserts an already-encoded JSON value verbatim.
+  JsonWriter& Raw(std::string_view json);
+
+  JsonWriter& Field(std::string_view key, std::string_view v) { return Key(key).String(v); }
+  JsonWriter& Field(std::string_view key, const std::string& v) { return Key(key).String(v); }
+  JsonWriter& Field(std::string_view key, const char* v) { return Key(key).String(v); }
+  JsonWriter& Field(std::string_view key, bool v) { return Key(key).Bool(v); }
+  JsonWriter& Field(std::string_view key, double v) { return Key(key).Number(v); }
+  template <typename T,
+            typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+  JsonWriter& Field(std::string_view key, T v) {
+    Key(key);
+    if constexpr (std::is_signed<T>::value) {
+      return Int(static_cast<int64_t>(v));
+    } else {
+      return Uint(static_cast<uint64_t>(v));
+    }
+  }
+  JsonWriter& RawField(std::string_view key, std::string_view json) { return Key(key).Raw(json); }
+
+  const std::string& str() const { return buf_; }
+  size_t size() const { return buf_.size(); }
+  std::string Take();
+
+ private:
+  void BeforeValue();
+
+  std::string buf_;
+  // One bit per nesting level: set once the container has a member.
+  uint64_t has_members_ = 0;
+  int depth_ = 0;
+  bool after_key_ = false;
+};
+
+}  // namespace protocol
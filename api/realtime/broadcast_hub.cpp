@@ -0,0 +1,108 @@
+#include "broadcast_hub.h"
+
+#include <algorithm>
+#include <string>
+
+#include "../diagnostics/tracer.h"
+
+namespace realtime {
+
+BroadcastHub::BroadcastHub(int writer_threads) {
+  const int n = std::max(1, writer_threads);
+  shards_.reserve(static_cast<size_t>(n));
+  for (int i = 0; i < n; ++i) shards_.push_back(std::make_unique<Shard>());
+}
+
+BroadcastHub::~BroadcastHub() {
+  Stop();
+}
+
+void BroadcastHub::Start(TickHandler handler) {
+  if (!writers_.empty()) return;
+  handler_ = std::move(handler);
+  {
+    std::lock_guard<std::mutex> lock(wake_mu_);
+    stopping_ = false;
+  }
+  writers_.reserve(shards_.size());
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    writers_.emplace_back([this, i] { WriterLoop(i); });
+  }
+}
+
+void BroadcastHub::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mu_);
+    stopping_ = true;
+  }
+  wake_cv_.notify_all();
+  for (auto& t : writers_) {
+    if (t.joinable()) t.join();
+  }
+  writers_.clear();
+}
+
+void BroadcastHub::Add(const std::shared_ptr<Subscriber>& sub) {
+  if (!sub) return;
+  sub->hub_id_ = next_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+  auto& shard = *shards_[sub->hub_id_ % shards_.size()];
+  std::lock_guard<std::mutex> lock(shard.mu);
+  shard.subs.push_back(sub);
+}
+
+void BroadcastHub::Remove(const std::shared_ptr<Subscriber>& sub) {
+  if (!sub) return;
+  sub->Close();
+  {
+    auto& shard = *shards_[sub->hub_id_ % shards_.size()];
+    std::lock_guard<std::mutex> lock(shard.mu);
+    shard.subs.erase(std::remove(shard.subs.begin(), shard.subs.end(), sub), shard.subs.end());
+  }
+  std::lock_guard<std::mutex> wait_idle(sub->busy_mu_);
+}
+
+void BroadcastHub::Publish() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mu_);
+    ++epoch_;
+  }
+  wake_cv_.notify_all();
+}
+
+size_t BroadcastHub::size() const {
+  size_t n = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mu);
+    n += shard->subs.size();
+  }
+  return n;
+}
+
+void BroadcastHub::WriterLoop(size_t shard_index) {
+  Shard& shard = *shards_[shard_index];
+  diagnostics::DefaultTracer().SetThreadName("ws_writer-" + std::to_string(shard_index));
+  std::vector<std::shared_ptr<Subscriber>> batch;
+  uint64_t seen_epoch = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(wake_mu_);
+      wake_cv_.wait(lock, [&] { return stopping_ || epoch_ != seen_epoch; });
+      if (stopping_) return;
+      seen_epoch = epoch_;
+    }
+    {
+      std::lock_guard<std::mutex> lock(shard.mu);
+      batch.assign(shard.subs.begin(), shard.subs.end());
+    }
+    diagnostics::TraceSpan pass("ws", "writer_pass");
+    for (const auto& sub : batch) {
+      std::lock_guard<std::mutex> busy(sub->busy_mu_);
+      if (!sub->alive()) continue;
+      diagnostics::TraceSpan span("ws", "session_update");
+      if (!handler_(*sub, seen_epoch)) sub->Close();
+    }
+    batch.clear();
+  }
+}
+
+}  // namespace realtime
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace realtime {
+
+// Hub-side handle for one realtime connection. Servers subclass it to carry
+// per-connection send state.
+class Subscriber {
+ public:
+  virtual ~Subscriber() = default;
+
+  uint64_t hub_id() const { return hub_id_; }
+  bool alive() const { return alive_.load(std::memory_order_acquire); }
+  void Close() { alive_.store(false, std::memory_order_release); }
+
+ private:
+  friend class BroadcastHub;
+  uint64_t hub_id_ = 0;
+  std::atomic<bool> alive_{true};
+  // Held by the writer while servicing this subscriber so Remove() can wait
+  // out an in-flight send before the connection is torn down.
+  std::mutex busy_mu_;
+};
+
+// Fixed pool of writer threads that fan out one broadcast tick to every
+// registered subscriber. Publish() is called once per broadcast tick by the
+// game loop; writers sleep on a condition variable in between, so idle
+// connections cost no wakeups. Subscribers are sharded by id across writers.
+class BroadcastHub {
+ public:
+  // Returns false to detach the subscriber (send failed, client gone).
+  using TickHandler = std::function<bool(Subscriber&, uint64_t epoch)>;
+
+  explicit BroadcastHub(int writer_threads);
+  ~BroadcastHub();
+  BroadcastHub(const BroadcastHub&) = delete;
+  BroadcastHub& operator=(const BroadcastHub&) = delete;
+
+  void Start(TickHandler handler);
+  void Stop();
+
+  void Add(const std::shared_ptr<Subscriber>& sub);
+  // Detaches the subscriber and blocks until no writer is using it.
+  void Remove(const std::shared_ptr<Subscriber>& sub);
+
+  // Wakes every writer once. Ticks published while writers are still busy
+  // coalesce into a single pass.
+  void Publish();
+
+  size_t size() const;
+  int writer_threads() const { return static_cast<int>(shards_.size()); }
+
+ private:
+  struct Shard {
+    mutable std::mutex mu;
+    std::vector<std::shared_ptr<Subscriber>> subs;
+  };
+
+  void WriterLoop(size_t shard_index);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::vector<std::thread> writers_;
+  TickHandler handler_;
+  std::atomic<uint64_t> next_id_{0};
+
+  std::mutex wake_mu_;
+  std::condition_variable wake_cv_;
+  uint64_t epoch_ = 0;
+  bool stopping_ = false;
+};
+
+}  // namespace realtime
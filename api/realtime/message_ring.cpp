@@ -0,0 +1,52 @@
+#include "message_ring.h"
+
+#include <algorithm>
+
+namespace realtime {
+namespace {
+
+size_t RoundUpPow2(size_t n) {
+  size_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+}  // namespace
+
+MessageRing::MessageRing(size_t capacity) : slots_(RoundUpPow2(std::max<size_t>(1, capacity))) {
+  mask_ = slots_.size() - 1;
+}
+
+uint64_t MessageRing::Publish(Frame frame) {
+  const uint64_t seq = head_.load(std::memory_order_relaxed) + 1;
+  Slot& slot = slots_[seq & mask_];
+  // Invalidate first so a reader still holding the old sequence rejects the
+  // slot instead of pairing it with the new frame.
+  slot.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::atomic_store_explicit(&slot.frame, std::move(frame), std::memory_order_release);
+  slot.seq.store(seq, std::memory_order_release);
+  head_.store(seq, std::memory_order_release);
+  return seq;
+}
+
+size_t MessageRing::ReadSince(uint64_t& cursor, std::vector<Frame>& out) const {
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  if (cursor >= head) return 0;
+  const uint64_t cap = slots_.size();
+  const uint64_t first = std::max(cursor + 1, head >= cap ? head - cap + 1 : uint64_t{1});
+  size_t appended = 0;
+  for (uint64_t seq = first; seq <= head; ++seq) {
+    const Slot& slot = slots_[seq & mask_];
+    if (slot.seq.load(std::memory_order_acquire) != seq) continue;
+    Frame frame = std::atomic_load_explicit(&slot.frame, std::memory_order_acquire);
+    // Overwritten by a lapping writer while we were reading it.
+    if (slot.seq.load(std::memory_order_acquire) != seq || !frame) continue;
+    out.push_back(std::move(frame));
+    ++appended;
+  }
+  cursor = head;
+  return appended;
+}
+
+}  // namespace realtime
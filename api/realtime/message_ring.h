@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace realtime {
+
+// Fixed-capacity ring of pre-encoded frames numbered by a monotonically
+// increasing sequence (first frame is 1). One writer at a time publishes;
+// any number of readers follow with their own cursor and never take a lock.
+// Readers that fall more than `capacity` frames behind skip the overwritten
+// ones.
+class MessageRing {
+ public:
+  using Frame = std::shared_ptr<const std::string>;
+
+  // Capacity is rounded up to a power of two.
+  explicit MessageRing(size_t capacity);
+
+  // Callers must serialize Publish(). Returns the sequence assigned to `frame`.
+  uint64_t Publish(Frame frame);
+
+  // Latest published sequence, 0 if nothing was published yet.
+  uint64_t head() const { return head_.load(std::memory_order_acquire); }
+  size_t capacity() const { return slots_.size(); }
+
+  // Appends frames newer than `cursor` to `out` and moves the cursor to the
+  // head. Returns the number of frames appended.
+  size_t ReadSince(uint64_t& cursor, std::vector<Frame>& out) const;
+
+ private:
+  struct Slot {
+    // Sequence held by the slot; 0 while the writer is replacing it.
+    std::atomic<uint64_t> seq{0};
+    Frame frame;  // accessed only through std::atomic_load/atomic_store
+  };
+
+  std::vector<Slot> slots_;
+  uint64_t mask_ = 0;
+  std::atomic<uint64_t> head_{0};
+};
+
+}  // namespace realtime
@@ -0,0 +1,311 @@
+#include "send_queue.h"
+
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#include <linux/sockios.h>
+#endif
+
+#include <algorithm>
+
+#include "../diagnostics/tracer.h"
+
+namespace realtime {
+namespace {
+
+struct ChannelStats {
+  std::atomic<int64_t> depth{0};
+  std::atomic<uint64_t> enqueued{0};
+  std::atomic<uint64_t> sent{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> send_failures{0};
+  std::atomic<uint64_t> deferred_sends{0};
+  std::atomic<uint64_t> slow_disconnects{0};
+  std::atomic<uint64_t> latency_us_total{0};
+  std::atomic<uint64_t> latency_us_max{0};
+};
+
+std::array<ChannelStats, kChannelCount> g_stats;
+
+ChannelStats& StatsFor(Channel ch) {
+  return g_stats[static_cast<size_t>(ch)];
+}
+
+void RecordSent(Channel ch, std::chrono::steady_clock::duration latency) {
+  auto& s = StatsFor(ch);
+  const auto us = static_cast<uint64_t>(
+      std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(latency).count()));
+  s.sent.fetch_add(1, std::memory_order_relaxed);
+  s.latency_us_total.fetch_add(us, std::memory_order_relaxed);
+  uint64_t prev = s.latency_us_max.load(std::memory_order_relaxed);
+  while (us > prev && !s.latency_us_max.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+const char* ChannelName(Channel ch) {
+  return ch == Channel::kPrivate ? "private" : "public";
+}
+
+ChannelStatsSnapshot ReadChannelStats(Channel ch) {
+  const auto& s = StatsFor(ch);
+  ChannelStatsSnapshot out;
+  out.depth = s.depth.load(std::memory_order_relaxed);
+  out.enqueued = s.enqueued.load(std::memory_order_relaxed);
+  out.sent = s.sent.load(std::memory_order_relaxed);
+  out.dropped = s.dropped.load(std::memory_order_relaxed);
+  out.send_failures = s.send_failures.load(std::memory_order_relaxed);
+  out.deferred_sends = s.deferred_sends.load(std::memory_order_relaxed);
+  out.slow_disconnects = s.slow_disconnects.load(std::memory_order_relaxed);
+  out.latency_us_total = s.latency_us_total.load(std::memory_order_relaxed);
+  out.latency_us_max = s.latency_us_max.load(std::memory_order_relaxed);
+  return out;
+}
+
+void RecordSlowDisconnect(Channel ch) {
+  StatsFor(ch).slow_disconnects.fetch_add(1, std::memory_order_relaxed);
+}
+
+SendQueue::SendQueue(SendPool& pool, Writer writer, SendQueueLimits limits, RoomCheck has_room)
+    : pool_(pool), writer_(std::move(writer)), limits_(limits), has_room_(std::move(has_room)) {}
+
+SendQueue::~SendQueue() {
+  std::lock_guard<std::mutex> lock(mu_);
+  DiscardLocked();
+}
+
+bool SendQueue::OverLimitLocked(Clock::time_point now) const {
+  if (events_.size() > limits_.max_pending_events) return true;
+  const auto max_lag = std::chrono::milliseconds(limits_.max_lag_ms);
+  if (!events_.empty() && now - events_.front().enqueued_at > max_lag) return true;
+  for (size_t i = 0; i < kSlotCount; ++i) {
+    if (slots_[i].has_value() && now - slot_pending_since_[i] > max_lag) return true;
+  }
+  return false;
+}
+
+bool SendQueue::PutLatest(Slot slot, Channel ch, std::string frame) {
+  return PutLatest(slot, ch, std::make_shared<const std::string>(std::move(frame)));
+}
+
+bool SendQueue::PutLatest(Slot slot, Channel ch, SharedFrame frame) {
+  if (closed()) return false;
+  const auto now = Clock::now();
+  const size_t i = static_cast<size_t>(slot);
+  std::lock_guard<std::mutex> lock(mu_);
+  if (OverLimitLocked(now)) return false;
+  auto& stats = StatsFor(ch);
+  stats.enqueued.fetch_add(1, std::memory_order_relaxed);
+  if (slots_[i].has_value()) {
+    auto& old_stats = StatsFor(slots_[i]->channel);
+    old_stats.dropped.fetch_add(1, std::memory_order_relaxed);
+    old_stats.depth.fetch_sub(1, std::memory_order_relaxed);
+  } else {
+    slot_pending_since_[i] = now;
+  }
+  stats.depth.fetch_add(1, std::memory_order_relaxed);
+  slots_[i] = Frame{std::move(frame), ch, now};
+  ScheduleLocked();
+  return true;
+}
+
+bool SendQueue::PushEvent(Channel ch, std::string frame) {
+  return PushEvent(ch, std::make_shared<const std::string>(std::move(frame)));
+}
+
+bool SendQueue::PushEvent(Channel ch, SharedFrame frame) {
+  if (closed()) return false;
+  const auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(mu_);
+  if (OverLimitLocked(now)) return false;
+  auto& stats = StatsFor(ch);
+  stats.enqueued.fetch_add(1, std::memory_order_relaxed);
+  stats.depth.fetch_add(1, std::memory_order_relaxed);
+  events_.push_back(Frame{std::move(frame), ch, now});
+  ScheduleLocked();
+  return true;
+}
+
+void SendQueue::Close() {
+  closed_.store(true, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    DiscardLocked();
+  }
+  std::lock_guard<std::mutex> wait_idle(write_mu_);
+}
+
+void SendQueue::ScheduleLocked() {
+  if (scheduled_) return;
+  scheduled_ = true;
+  pool_.Schedule(shared_from_this());
+}
+
+void SendQueue::DiscardLocked() {
+  for (auto& slot : slots_) {
+    if (!slot.has_value()) continue;
+    StatsFor(slot->channel).depth.fetch_sub(1, std::memory_order_relaxed);
+    slot.reset();
+  }
+  for (const auto& ev : events_) StatsFor(ev.channel).depth.fetch_sub(1, std::memory_order_relaxed);
+  events_.clear();
+}
+
+SendQueue::DrainResult SendQueue::Drain(size_t max_frames) {
+  std::lock_guard<std::mutex> writing(write_mu_);
+  for (size_t n = 0; n < max_frames; ++n) {
+    Frame frame;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (closed()) {
+        scheduled_ = false;
+        return DrainResult::kIdle;
+      }
+      // Events first: they are small and must not wait behind snapshots.
+      std::optional<Frame>* slot = nullptr;
+      const Frame* next = nullptr;
+      if (!events_.empty()) {
+        next = &events_.front();
+      } else {
+        auto it = std::find_if(slots_.begin(), slots_.end(), [](const auto& s) { return s.has_value(); });
+        if (it == slots_.end()) {
+          scheduled_ = false;
+          return DrainResult::kIdle;
+        }
+        slot = &*it;
+        next = &**it;
+      }
+      // Left queued (and still scheduled) so its lag keeps counting.
+      if (has_room_ && !has_room_(next->data->size())) {
+        StatsFor(next->channel).deferred_sends.fetch_add(1, std::memory_order_relaxed);
+        return DrainResult::kBlocked;
+      }
+      if (slot) {
+        frame = std::move(**slot);
+        slot->reset();
+      } else {
+        frame = std::move(events_.front());
+        events_.pop_front();
+      }
+    }
+    auto& stats = StatsFor(frame.channel);
+    stats.depth.fetch_sub(1, std::memory_order_relaxed);
+    diagnostics::TraceSpan span("ws_send", ChannelName(frame.channel));
+    if (!writer_(*frame.data)) {
+      stats.send_failures.fetch_add(1, std::memory_order_relaxed);
+      closed_.store(true, std::memory_order_release);
+      std::lock_guard<std::mutex> lock(mu_);
+      DiscardLocked();
+      scheduled_ = false;
+      return DrainResult::kIdle;
+    }
+    RecordSent(frame.channel, Clock::now() - frame.enqueued_at);
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  const bool more = !events_.empty() ||
+                    std::any_of(slots_.begin(), slots_.end(), [](const auto& s) { return s.has_value(); });
+  if (!more) scheduled_ = false;
+  return more ? DrainResult::kMore : DrainResult::kIdle;
+}
+
+SendPool::SendPool(int threads) {
+  const int n = std::max(1, threads);
+  threads_ = n;
+  workers_.reserve(static_cast<size_t>(n));
+  for (int i = 0; i < n; ++i) workers_.emplace_back([this] { WorkerLoop(); });
+}
+
+SendPool::~SendPool() {
+  Stop();
+}
+
+void SendPool::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  for (auto& t : workers_) {
+    if (t.joinable()) t.join();
+  }
+  workers_.clear();
+  std::lock_guard<std::mutex> lock(mu_);
+  ready_.clear();
+  blocked_.clear();
+}
+
+void SendPool::Schedule(std::shared_ptr<SendQueue> q) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (stopping_) return;
+    ready_.push_back(std::move(q));
+  }
+  cv_.notify_one();
+}
+
+void SendPool::WorkerLoop() {
+  diagnostics::DefaultTracer().SetThreadName("ws_send");
+  while (true) {
+    std::shared_ptr<SendQueue> q;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      while (true) {
+        if (stopping_) return;
+        const auto now = std::chrono::steady_clock::now();
+        if (!blocked_.empty() && blocked_.front().first <= now) {
+          q = std::move(blocked_.front().second);
+          blocked_.pop_front();
+          break;
+        }
+        if (!ready_.empty()) {
+          q = std::move(ready_.front());
+          ready_.pop_front();
+          break;
+        }
+        if (blocked_.empty()) {
+          cv_.wait(lock);
+        } else {
+          cv_.wait_until(lock, blocked_.front().first);
+        }
+      }
+    }
+    // Round-robin: a queue with a long backlog goes to the back after a burst;
+    // one whose socket is full waits out kBlockedRetry without a thread.
+    const auto result = q->Drain(kBurstFrames);
+    if (result == SendQueue::DrainResult::kIdle) continue;
+    std::lock_guard<std::mutex> lock(mu_);
+    if (stopping_) continue;
+    if (result == SendQueue::DrainResult::kBlocked) {
+      blocked_.emplace_back(std::chrono::steady_clock::now() + kBlockedRetry, std::move(q));
+    } else {
+      ready_.push_back(std::move(q));
+    }
+  }
+}
+
+bool SocketHasRoom(int fd, size_t bytes) {
+  pollfd p{};
+  p.fd = fd;
+  p.events = POLLOUT;
+  if (::poll(&p, 1, 0) < 0) return true;
+  if (p.revents & (POLLERR | POLLHUP | POLLNVAL)) return true;
+  if (!(p.revents & POLLOUT)) return false;
+#ifdef SIOCOUTQ
+  int queued = 0;
+  int sndbuf = 0;
+  socklen_t len = sizeof(sndbuf);
+  if (::ioctl(fd, SIOCOUTQ, &queued) == 0 &&
+      ::getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len) == 0) {
+    return queued <= 0 || static_cast<int64_t>(sndbuf) - queued >= static_cast<int64_t>(bytes);
+  }
+#endif
+  return true;
+}
+
+bool ShutdownSocket(int fd) {
+  return fd >= 0 && ::shutdown(fd, SHUT_RDWR) == 0;
+}
+
+}  // namespace realtime
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace realtime {
+
+enum class Channel : int { kPublic = 0, kPrivate = 1 };
+constexpr int kChannelCount = 2;
+const char* ChannelName(Channel ch);
+
+// Process-wide counters per channel, read by the admin status endpoint.
+struct ChannelStatsSnapshot {
+  int64_t depth = 0;
+  uint64_t enqueued = 0;
+  uint64_t sent = 0;
+  uint64_t dropped = 0;
+  uint64_t send_failures = 0;
+  uint64_t deferred_sends = 0;
+  uint64_t slow_disconnects = 0;
+  uint64_t latency_us_total = 0;
+  uint64_t latency_us_max = 0;
+};
+ChannelStatsSnapshot ReadChannelStats(Channel ch);
+void RecordSlowDisconnect(Channel ch);
+
+struct SendQueueLimits {
+  size_t max_pending_events = 256;
+  int max_lag_ms = 5000;
+};
+
+class SendPool;
+
+// Outbound frames for one connection. Periodic state lives in latest-wins
+// slots (a newer snapshot replaces the unsent one); events such as system
+// messages are FIFO and never dropped. Draining happens on a SendPool thread.
+// With a room check, a frame is only written once the socket can take it, so
+// a slow peer parks its own queue (which then ages past the lag limit)
+// instead of holding a pool thread inside a blocking write.
+class SendQueue : public std::enable_shared_from_this<SendQueue> {
+ public:
+  enum class Slot : int { kSnapshot = 0, kEconomy = 1, kUserState = 2, kLeaderboard = 3 };
+  using Writer = std::function<bool(const std::string&)>;
+  // True when a frame of `bytes` can be written without blocking.
+  using RoomCheck = std::function<bool(size_t bytes)>;
+  // Frames shared across connections (e.g. economy_world) are queued by
+  // reference instead of copied.
+  using SharedFrame = std::shared_ptr<const std::string>;
+
+  SendQueue(SendPool& pool, Writer writer, SendQueueLimits limits, RoomCheck has_room = {});
+  ~SendQueue();
+  SendQueue(const SendQueue&) = delete;
+  SendQueue& operator=(const SendQueue&) = delete;
+
+  // Both return false once the consumer is over its lag/backlog limit or the
+  // queue is closed; the caller should then disconnect the client.
+  bool PutLatest(Slot slot, Channel ch, SharedFrame frame);
+  bool PutLatest(Slot slot, Channel ch, std::string frame);
+  bool PushEvent(Channel ch, SharedFrame frame);
+  bool PushEvent(Channel ch, std::string frame);
+
+  // Drops pending frames and waits for an in-flight write to finish. No
+  // writes happen after this returns.
+  void Close();
+  bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+ private:
+  friend class SendPool;
+  using Clock = std::chrono::steady_clock;
+
+  struct Frame {
+    SharedFrame data;
+    Channel channel = Channel::kPublic;
+    Clock::time_point enqueued_at{};
+  };
+  static constexpr size_t kSlotCount = 4;
+  enum class DrainResult { kIdle, kMore, kBlocked };
+
+  bool OverLimitLocked(Clock::time_point now) const;
+  void ScheduleLocked();
+  // Writes up to max_frames. kMore: frames remain; kBlocked: the socket has
+  // no room for the next frame, retry later.
+  DrainResult Drain(size_t max_frames);
+  void DiscardLocked();
+
+  SendPool& pool_;
+  Writer writer_;
+  SendQueueLimits limits_;
+  RoomCheck has_room_;
+
+  mutable std::mutex mu_;
+  std::array<std::optional<Frame>, kSlotCount> slots_;
+  // Time the slot last became non-empty; kept across replacements so lag
+  // reflects how long the client has been behind, not the newest frame's age.
+  std::array<Clock::time_point, kSlotCount> slot_pending_since_{};
+  std::deque<Frame> events_;
+  bool scheduled_ = false;
+  std::atomic<bool> closed_{false};
+  std::mutex write_mu_;
+};
+
+// Fixed pool of threads that drain scheduled SendQueues.
+class SendPool {
+ public:
+  explicit SendPool(int threads);
+  ~SendPool();
+  SendPool(const SendPool&) = delete;
+  SendPool& operator=(const SendPool&) = delete;
+
+  void Stop();
+  int threads() const { return threads_; }
+
+ private:
+  friend class SendQueue;
+  static constexpr size_t kBurstFrames = 8;
+  static constexpr std::chrono::milliseconds kBlockedRetry{5};
+
+  void Schedule(std::shared_ptr<SendQueue> q);
+  void WorkerLoop();
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::shared_ptr<SendQueue>> ready_;
+  // Queues whose socket had no room, in retry order.
+  std::deque<std::pair<std::chrono::steady_clock::time_point, std::shared_ptr<SendQueue>>> blocked_;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+  int threads_ = 0;
+};
+
+// Room check for a connected socket: true once `fd` can take `bytes` more
+// without blocking, or has failed (so the write fails fast). A frame larger
+// than the send buffer waits until the buffer is empty.
+bool SocketHasRoom(int fd, size_t bytes);
+// Shuts down both directions so a reader blocked on `fd` returns. Used for
+// slow-consumer eviction; the caller must still own the connection.
+bool ShutdownSocket(int fd);
+
+}  // namespace realtime
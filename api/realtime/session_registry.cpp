@@ -0,0 +1,130 @@
+#include "session_registry.h"
+
+#include <thread>
+
+namespace realtime {
+namespace {
+
+// unordered_map node + bucket slot + shared_ptr control block, roughly.
+constexpr size_t kEntryOverheadBytes = 96;
+
+}  // namespace
+
+SessionState::Camera SessionState::camera() const {
+  for (;;) {
+    const uint32_t begin = camera_seq_.load(std::memory_order_acquire);
+    if (begin & 1u) {
+      std::this_thread::yield();
+      continue;
+    }
+    Camera c;
+    c.x = camera_x_.load(std::memory_order_relaxed);
+    c.y = camera_y_.load(std::memory_order_relaxed);
+    c.zoom = camera_zoom_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (camera_seq_.load(std::memory_order_relaxed) == begin) return c;
+  }
+}
+
+void SessionState::SetCamera(const Camera& c) {
+  // Odd sequence = write in progress; the CAS also serializes concurrent writers
+  // (a WS camera_set racing POST /game/camera for the same sid).
+  uint32_t seq = camera_seq_.load(std::memory_order_relaxed);
+  for (;;) {
+    if ((seq & 1u) == 0 &&
+        camera_seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+      break;
+    }
+    std::this_thread::yield();
+    seq = camera_seq_.load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  camera_x_.store(c.x, std::memory_order_relaxed);
+  camera_y_.store(c.y, std::memory_order_relaxed);
+  camera_zoom_.store(c.zoom, std::memory_order_relaxed);
+  camera_seq_.store(seq + 2, std::memory_order_release);
+}
+
+SessionPin::SessionPin(SessionPtr s) : session_(std::move(s)) {
+  if (session_) session_->pins_.fetch_add(1, std::memory_order_relaxed);
+}
+
+SessionPin::~SessionPin() {
+  if (session_) session_->pins_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+SessionRegistry::SessionRegistry(size_t shards) : shards_(shards == 0 ? 1 : shards) {}
+
+SessionRegistry::Shard& SessionRegistry::ShardFor(const std::string& sid) const {
+  return shards_[std::hash<std::string>{}(sid) % shards_.size()];
+}
+
+SessionPtr SessionRegistry::GetOrCreate(const std::string& sid, uint64_t now_ms, const Init& init) {
+  auto& shard = ShardFor(sid);
+  SessionPtr s;
+  {
+    std::lock_guard<std::mutex> lock(shard.mu);
+    auto it = shard.sessions.find(sid);
+    if (it != shard.sessions.end()) {
+      s = it->second;
+    } else {
+      s = std::make_shared<SessionState>(sid);
+      if (init) init(*s);
+      shard.sessions.emplace(sid, s);
+      created_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  s->updated_at_ms.store(now_ms, std::memory_order_relaxed);
+  return s;
+}
+
+SessionPtr SessionRegistry::Find(const std::string& sid) const {
+  auto& shard = ShardFor(sid);
+  std::lock_guard<std::mutex> lock(shard.mu);
+  auto it = shard.sessions.find(sid);
+  return it == shard.sessions.end() ? nullptr : it->second;
+}
+
+bool SessionRegistry::Erase(const std::string& sid) {
+  auto& shard = ShardFor(sid);
+  std::lock_guard<std::mutex> lock(shard.mu);
+  return shard.sessions.erase(sid) > 0;
+}
+
+size_t SessionRegistry::EvictIdle(uint64_t now_ms, uint64_t ttl_ms) {
+  size_t removed = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mu);
+    for (auto it = shard.sessions.begin(); it != shard.sessions.end();) {
+      const auto& s = *it->second;
+      const uint64_t last = s.updated_at_ms.load(std::memory_order_relaxed);
+      if (s.pins_.load(std::memory_order_relaxed) == 0 && now_ms > last && now_ms - last >= ttl_ms) {
+        it = shard.sessions.erase(it);
+        ++removed;
+      } else {
+        ++it;
+      }
+    }
+  }
+  evicted_.fetch_add(removed, std::memory_order_relaxed);
+  return removed;
+}
+
+SessionRegistry::Stats SessionRegistry::GetStats() const {
+  Stats st;
+  st.created = created_.load(std::memory_order_relaxed);
+  st.evicted = evicted_.load(std::memory_order_relaxed);
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mu);
+    st.sessions += shard.sessions.size();
+    st.approx_bytes += shard.sessions.bucket_count() * sizeof(void*);
+    for (const auto& kv : shard.sessions) {
+      if (kv.second->pins_.load(std::memory_order_relaxed) > 0) ++st.pinned;
+      st.approx_bytes += sizeof(SessionState) + kEntryOverheadBytes + kv.first.capacity() +
+                         kv.second->session_id().capacity();
+    }
+  }
+  return st;
+}
+
+}  // namespace realtime
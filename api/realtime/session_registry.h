@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace realtime {
+
+// Per-client view state shared by WS, SSE and the camera/view endpoints. Entries
+// are owned by SessionRegistry and handed out as stable shared_ptrs, so hot
+// paths read fields in place instead of copying the session under a lock.
+class SessionState {
+ public:
+  struct Camera {
+    int x = 0;
+    int y = 0;
+    double zoom = 1.0;
+  };
+
+  explicit SessionState(std::string session_id) : session_id_(std::move(session_id)) {}
+
+  const std::string& session_id() const { return session_id_; }
+
+  // Camera position and zoom are published together through a seqlock so a
+  // reader never sees x from one update and y from another.
+  Camera camera() const;
+  void SetCamera(const Camera& c);
+
+  std::optional<int> auth_user_id() const {
+    const int uid = auth_user_id_.load(std::memory_order_acquire);
+    return uid > 0 ? std::optional<int>(uid) : std::nullopt;
+  }
+  void set_auth_user_id(int uid) { auth_user_id_.store(uid, std::memory_order_release); }
+
+  std::optional<int> watched_snake_id() const {
+    const int id = watched_snake_id_.load(std::memory_order_relaxed);
+    return id > 0 ? std::optional<int>(id) : std::nullopt;
+  }
+  void set_watched_snake_id(std::optional<int> id) {
+    watched_snake_id_.store(id.value_or(0), std::memory_order_relaxed);
+  }
+
+  std::atomic<int> subscribed_chunks_count{1};
+  std::atomic<bool> is_watcher{true};
+  std::atomic<uint64_t> last_camera_update_ms{0};
+  // Last time any request touched the session; drives idle eviction.
+  std::atomic<uint64_t> updated_at_ms{0};
+
+ private:
+  friend class SessionRegistry;
+  friend class SessionPin;
+
+  const std::string session_id_;
+  std::atomic<int> auth_user_id_{0};  // 0: anonymous
+  std::atomic<int> watched_snake_id_{0};
+  mutable std::atomic<uint32_t> camera_seq_{0};
+  std::atomic<int> camera_x_{0};
+  std::atomic<int> camera_y_{0};
+  std::atomic<double> camera_zoom_{1.0};
+  // Live WS/SSE streams holding the session; pinned sessions never expire.
+  std::atomic<int> pins_{0};
+};
+
+using SessionPtr = std::shared_ptr<SessionState>;
+
+// Keeps a session from being evicted while a stream is attached to it.
+class SessionPin {
+ public:
+  explicit SessionPin(SessionPtr s);
+  ~SessionPin();
+  SessionPin(const SessionPin&) = delete;
+  SessionPin& operator=(const SessionPin&) = delete;
+
+ private:
+  SessionPtr session_;
+};
+
+// Session map split into independently locked shards keyed by session id.
+class SessionRegistry {
+ public:
+  using Init = std::function<void(SessionState&)>;
+
+  struct Stats {
+    size_t sessions = 0;
+    size_t pinned = 0;
+    size_t approx_bytes = 0;
+    uint64_t created = 0;
+    uint64_t evicted = 0;
+  };
+
+  explicit SessionRegistry(size_t shards = 16);
+
+  // Returns the session for `sid`, creating it (and running `init` once, before
+  // it becomes visible) if needed. Marks the session as used at `now_ms`.
+  SessionPtr GetOrCreate(const std::string& sid, uint64_t now_ms, const Init& init = nullptr);
+  SessionPtr Find(const std::string& sid) const;
+  bool Erase(const std::string& sid);
+
+  // Drops unpinned sessions untouched for ttl_ms. Returns how many were removed.
+  size_t EvictIdle(uint64_t now_ms, uint64_t ttl_ms);
+
+  Stats GetStats() const;
+
+ private:
+  struct Shard {
+    mutable std::mutex mu;
+    std::unordered_map<std::string, SessionPtr> sessions;
+  };
+
+  Shard& ShardFor(const std::string& sid) const;
+
+  mutable std::vector<Shard> shards_;
+  std::atomic<uint64_t> created_{0};
+  std::atomic<uint64_t> evicted_{0};
+};
+
+}  // namespace realtime
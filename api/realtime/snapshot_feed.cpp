@@ -0,0 +1,50 @@
+#include "snapshot_feed.h"
+
+namespace realtime {
+
+uint64_t SnapshotFeed::Publish() {
+  uint64_t seq = 0;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    seq = ++seq_;
+  }
+  cv_.notify_all();
+  return seq;
+}
+
+uint64_t SnapshotFeed::seq() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return seq_;
+}
+
+uint64_t SnapshotFeed::WaitForNext(uint64_t last_seq, Clock::time_point deadline) {
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait_until(lock, deadline, [&] { return stopped_ || seq_ != last_seq; });
+  return seq_;
+}
+
+SnapshotFeed::Frame SnapshotFeed::Current(const Encoder& encode, uint64_t* seq_out) {
+  const uint64_t current = seq();
+  std::lock_guard<std::mutex> lock(encode_mu_);
+  if (!cached_ || cached_seq_ < current) {
+    cached_ = std::make_shared<const std::string>(encode());
+    cached_seq_ = current;
+  }
+  if (seq_out) *seq_out = cached_seq_;
+  return cached_;
+}
+
+void SnapshotFeed::Shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopped_ = true;
+  }
+  cv_.notify_all();
+}
+
+bool SnapshotFeed::stopped() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return stopped_;
+}
+
+}  // namespace realtime
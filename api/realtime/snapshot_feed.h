@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace realtime {
+
+// Broadcast sequence shared by the game loop and SSE streams. Publish() bumps
+// the sequence and wakes every waiting stream; the frame for a sequence is
+// encoded once by whichever stream asks first and shared by reference.
+class SnapshotFeed {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Frame = std::shared_ptr<const std::string>;
+  using Encoder = std::function<std::string()>;
+
+  uint64_t Publish();
+  uint64_t seq() const;
+
+  // Blocks until the sequence moves past last_seq, the deadline passes or the
+  // feed shuts down. Returns the current sequence.
+  uint64_t WaitForNext(uint64_t last_seq, Clock::time_point deadline);
+
+  // Frame for the current sequence; `encode` runs at most once per sequence.
+  Frame Current(const Encoder& encode, uint64_t* seq_out = nullptr);
+
+  void Shutdown();
+  bool stopped() const;
+
+ private:
+  mutable std::mutex mu_;
+  std::condition_variable cv_;
+  uint64_t seq_ = 1;
+  bool stopped_ = false;
+
+  std::mutex encode_mu_;
+  uint64_t cached_seq_ = 0;
+  Frame cached_;
+};
+
+}  // namespace realtime
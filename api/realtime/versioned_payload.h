@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace realtime {
+
+// Latest encoded form of a broadcast message. The version only advances when
+// the change key differs from the previous one, so readers can skip resending
+// identical content.
+class VersionedPayload {
+ public:
+  using Frame = std::shared_ptr<const std::string>;
+
+  // Returns true if the content changed and the version advanced.
+  bool Update(std::string change_key, std::string payload) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (payload_ && change_key == change_key_) return false;
+    change_key_ = std::move(change_key);
+    payload_ = std::make_shared<const std::string>(std::move(payload));
+    ++version_;
+    return true;
+  }
+
+  // Returns the payload if it is newer than `seen_version` and advances it;
+  // nullptr otherwise.
+  Frame NewerThan(uint64_t& seen_version) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!payload_ || version_ == seen_version) return nullptr;
+    seen_version = version_;
+    return payload_;
+  }
+
+  uint64_t version() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return version_;
+  }
+
+ private:
+  mutable std::mutex mu_;
+  std::string change_key_;
+  Frame payload_;
+  uint64_t version_ = 0;
+};
+
+}  // namespace realtime
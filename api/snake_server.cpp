@@ -10,6 +10,7 @@
 #include <cstring>
 #include <ctime>
 #include <cmath>
+#include <condition_variable>
 #include <functional>
 #include <fstream>
 #include <iomanip>
@@ -37,10 +38,22 @@
 #include <aws/core/http/HttpTypes.h>
 #include <aws/core/utils/StringUtils.h>
 
+#include "auth/id_token_verifier.h"
+#include "auth/session_tokens.h"
+#include "diagnostics/flight_recorder.h"
+#include "diagnostics/tracer.h"
+#include "economy/cell_ledger.h"
+#include "economy/economy_aggregates.h"
+#include "economy/economy_flush_pipeline.h"
+#include "economy/economy_history.h"
+#include "economy/economy_snapshot_cache.h"
 #include "economy/economy_v1.h"
+#include "economy/period_finalizer.h"
 #include "economy/stabilization_engine.h"
 #include "economy_engine/compute.h"
 #include "httplib.h"
+#include "leaderboard/leaderboard_service.h"
+#include "metrics/metrics.h"
 #include "persistence/coordinator/persistence_coordinator.h"
 #include "persistence/layers/dynamo/permanent_dynamo_store.h"
 #include "persistence/layers/runtime/runtime_state_store.h"
@@ -48,7 +61,17 @@
 #include "persistence/profiles/persistence_profiles.h"
 #include "persistence/router/persistence_router.h"
 #include "protocol/encode_json.h"
+#include "protocol/json_reader.h"
+#include "protocol/json_writer.h"
+#include "realtime/broadcast_hub.h"
+#include "realtime/message_ring.h"
+#include "realtime/send_queue.h"
+#include "realtime/session_registry.h"
+#include "realtime/snapshot_feed.h"
+#include "realtime/versioned_payload.h"
 #include "storage/storage_factory.h"
+#include "storage/user_cache_storage.h"
+#include "web/static_asset_cache.h"
 #include "world/world.h"
 #include "../config/runtime_config.h"
 
@@ -59,9 +82,13 @@ static constexpr int DEFAULT_H = 20;
 static constexpr int DEFAULT_FOOD_COUNT = 1;
 
 static volatile sig_atomic_t g_reload_requested = 0;
+static volatile sig_atomic_t g_static_reload_requested = 0;
+// Start of the request the current HTTP worker is handling; 0 when not traced.
+static thread_local int64_t g_http_span_start_ns = 0;
 
 static void on_reload_signal(int) {
   g_reload_requested = 1;
+  g_static_reload_requested = 1;
 }
 
 static uint64_t now_ms() {
@@ -69,6 +96,11 @@ static uint64_t now_ms() {
   return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
 }
 
+static int64_t wall_ms() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
 static pair<int, int> dims_from_area(int64_t area, double aspect_ratio) {
   const int64_t safe_area = max<int64_t>(100, area);
   const double safe_aspect = (aspect_ratio > 0.1) ? aspect_ratio : 16.0 / 9.0;
@@ -99,50 +131,11 @@ struct EconomyActivityDelta {
 };
 
 static string json_escape(const string& s) {
-  ostringstream o;
-  for (char c : s) {
-    switch (c) {
-      case '"':
-        o << "\\\"";
-        break;
-      case '\\':
-        o << "\\\\";
-        break;
-      case '\b':
-        o << "\\b";
-        break;
-      case '\f':
-        o << "\\f";
-        break;
-      case '\n':
-        o << "\\n";
-        break;
-      case '\r':
-        o << "\\r";
-        break;
-      case '\t':
-        o << "\\t";
-        break;
-      default:
-        if (static_cast<unsigned char>(c) < 0x20) {
-          o << "\\u" << hex << setw(4) << setfill('0') << static_cast<int>(c);
-        } else {
-          o << c;
-        }
-    }
-  }
-  return o.str();
+  return protocol::JsonEscape(s);
 }
 
 static string json_number(double v) {
-  if (!std::isfinite(v)) return "0";
-  ostringstream out;
-  out << fixed << setprecision(6) << v;
-  string s = out.str();
-  while (!s.empty() && s.back() == '0') s.pop_back();
-  if (!s.empty() && s.back() == '.') s.push_back('0');
-  if (s.empty()) s = "0";
-  return s;
+  return protocol::JsonNumber(v);
 }
 
 static std::string stabilization_status_ui(const economy::StabilizationRuntimeState& st) {
@@ -166,39 +159,26 @@ static bool is_strict_semver(const std::string& v) {
   return std::regex_match(v, re);
 }
 
-class AuthState {
- public:
-  optional<int> token_to_user(const string& token) {
-    lock_guard<mutex> lock(mu_);
-    auto it = token_to_uid_.find(token);
-    if (it == token_to_uid_.end()) return nullopt;
-    return it->second;
-  }
-
-  string issue_token(int user_id) {
-    lock_guard<mutex> lock(mu_);
-    string token = rand_token();
-    token_to_uid_[token] = user_id;
-    return token;
-  }
-
- private:
-  mutex mu_;
-  unordered_map<string, int> token_to_uid_;
-};
-
-struct ClientSession {
-  string session_id;
-  int camera_x = DEFAULT_W / 2;
-  int camera_y = DEFAULT_H / 2;
-  double camera_zoom = 1.0;
-  int subscribed_chunks_count = 1;
-  optional<int> auth_user_id;
-  optional<int> watched_snake_id;
-  bool is_watcher = true;
-  uint64_t last_camera_update_ms = 0;
+// Per-WebSocket send state owned by the broadcast hub writers. Frames go
+// through `out`; only the send pool writes to the socket.
+struct WsConnection : realtime::Subscriber {
+  string sid;
+  realtime::SessionPtr session;
+  httplib::ws::WebSocket* ws = nullptr;
+  shared_ptr<realtime::SendQueue> out;
+  int socket_fd = -1;  // owned by httplib; valid until the handler returns
+  chrono::steady_clock::time_point next_world_send{};
+  uint64_t economy_world_version = 0;
+  chrono::steady_clock::time_point next_private_send{};
+  // user_state is pushed only when one of these moves.
+  int user_state_user_id = 0;
+  uint64_t user_state_version = 0;
+  uint64_t user_state_economy_version = 0;
+  // leaderboard_rank is pushed only when one of the user's ranks moves.
+  uint64_t leaderboard_version = 0;
+  chrono::steady_clock::time_point next_leaderboard_check{};
+  array<size_t, leaderboard::kKindCount> leaderboard_ranks{};
   uint64_t last_system_message_id = 0;
-  uint64_t updated_at_ms = 0;
 };
 
 struct PublicViewState {
@@ -210,42 +190,46 @@ struct PublicViewState {
   bool initialized = false;
 };
 
-struct SystemMessage {
-  uint64_t id = 0;
-  std::string level = "info";
-  std::string text;
-  int64_t created_at = 0;
-};
-
+// System notices for every WS client. Each message is encoded once at publish
+// time; sessions follow the ring with their own cursor, so an idle poll is a
+// single atomic load.
 class SystemMessageBus {
  public:
+  using Frame = realtime::MessageRing::Frame;
+
+  SystemMessageBus() : ring_(64) {}
+
+  // Called after every publish; the server points it at the broadcast hub.
+  void SetOnPublish(std::function<void()> fn) { on_publish_ = std::move(fn); }
+
   uint64_t Publish(const std::string& level, const std::string& text) {
-    std::lock_guard<std::mutex> lock(mu_);
-    SystemMessage msg;
-    msg.id = ++next_id_;
-    msg.level = level.empty() ? "info" : level;
-    msg.text = text;
-    msg.created_at = static_cast<int64_t>(time(nullptr));
-    messages_.push_back(std::move(msg));
-    if (messages_.size() > 64) {
-      messages_.erase(messages_.begin(), messages_.begin() + static_cast<long>(messages_.size() - 64));
-    }
-    return next_id_;
+    uint64_t id = 0;
+    {
+      // Publishers come from the game loop and admin handlers; the ring wants one writer.
+      std::lock_guard<std::mutex> lock(write_mu_);
+      id = ring_.head() + 1;
+      protocol::JsonWriter out;
+      out.BeginObject();
+      out.Field("type", "system_message");
+      out.Field("id", id);
+      out.Field("level", level.empty() ? "info" : level);
+      out.Field("message", text);
+      out.Field("created_at", static_cast<int64_t>(time(nullptr)));
+      out.EndObject();
+      ring_.Publish(std::make_shared<const std::string>(out.Take()));
+    }
+    if (on_publish_) on_publish_();
+    return id;
   }
 
-  std::vector<SystemMessage> GetSince(uint64_t last_seen_id) const {
-    std::lock_guard<std::mutex> lock(mu_);
-    std::vector<SystemMessage> out;
-    for (const auto& m : messages_) {
-      if (m.id > last_seen_id) out.push_back(m);
-    }
-    return out;
-  }
+  uint64_t head() const { return ring_.head(); }
+
+  size_t ReadSince(uint64_t& cursor, std::vector<Frame>& out) const { return ring_.ReadSince(cursor, out); }
 
  private:
-  mutable std::mutex mu_;
-  uint64_t next_id_ = 0;
-  std::vector<SystemMessage> messages_;
+  std::mutex write_mu_;
+  realtime::MessageRing ring_;
+  std::function<void()> on_publish_;
 };
 
 class GameService {
@@ -272,6 +256,19 @@ class GameService {
     world_.SetPlayableCellTarget(playable_cells_target);
   }
 
+  // Drained snake and output deltas are forwarded here; set before ticking.
+  void set_leaderboard(leaderboard::LeaderboardService* leaderboard) {
+    leaderboard_ = leaderboard;
+  }
+
+  vector<leaderboard::LeaderboardService::SnakeChange> leaderboard_snakes() {
+    vector<leaderboard::LeaderboardService::SnakeChange> out;
+    const auto snap = snapshot();
+    out.reserve(snap.snakes.size());
+    for (const auto& s : snap.snakes) out.push_back(leaderboard_change(world::World::ToStorageSnake(s)));
+    return out;
+  }
+
   void load_from_storage_or_seed_positions() {
     world_.LoadFromStorage(storage_.ListSnakes(), storage_.GetWorldChunk("main"));
   }
@@ -280,11 +277,24 @@ class GameService {
     world_.Tick();
   }
 
+  world::TickProfile last_tick_profile() const {
+    return world_.LastTickProfile();
+  }
+
+  string encode_binary_snapshot() const {
+    return world_.EncodeBinarySnapshot();
+  }
+
   world::WorldSnapshot snapshot() {
     ensure_loaded_from_storage_if_empty();
     return world_.Snapshot();
   }
 
+  // Published by the world as it changes; no copy, no lock.
+  world::SpatialMetrics spatial_metrics() const { return world_.Spatial(); }
+
+  vector<world::ChunkOccupancy> occupied_chunks() const { return world_.OccupiedChunks(); }
+
   world::WorldSnapshot snapshot_for_camera(int camera_x,
                                            int camera_y,
                                            bool aoi_enabled,
@@ -349,16 +359,15 @@ class GameService {
   // Expands playable space via the existing resize/mask pipeline at a safe call site.
   int64_t expand_playable_cells(int64_t cells_to_add, double aspect_ratio) {
     if (cells_to_add <= 0) return 0;
-    const auto before = world_.Snapshot();
-    const int64_t target_playable = std::max<int64_t>(0, before.playable_cells) + cells_to_add;
-    const int64_t current_area = static_cast<int64_t>(before.w) * static_cast<int64_t>(before.h);
+    const int64_t playable_before = world_.Spatial().playable_cells;
+    const int64_t target_playable = std::max<int64_t>(0, playable_before) + cells_to_add;
+    const int64_t current_area = static_cast<int64_t>(world_.Width()) * static_cast<int64_t>(world_.Height());
     if (target_playable > current_area) {
       const auto dims = dims_from_area(target_playable, aspect_ratio);
       world_.ResizeWorld(dims.first, dims.second);
     }
     world_.SetPlayableCellTarget(target_playable);
-    const auto after = world_.Snapshot();
-    return std::max<int64_t>(0, after.playable_cells - before.playable_cells);
+    return std::max<int64_t>(0, world_.Spatial().playable_cells - playable_before);
   }
 
   // Writes only event-driven deltas. No per-tick checkpoint persistence.
@@ -370,6 +379,7 @@ class GameService {
     out_activity.movement_ticks = delta.movement_ticks;
     out_activity.harvested_food_by_user = delta.harvested_food_by_user;
     out_activity.movement_ticks_by_user = delta.movement_ticks_by_user;
+    if (leaderboard_ != nullptr) submit_leaderboard_update(delta);
 
     std::unordered_map<std::string, std::string> owner_by_snake_id;
     owner_by_snake_id.reserve(delta.upsert_snakes.size());
@@ -462,6 +472,24 @@ class GameService {
 
 
  private:
+  // Seeding and tick updates both rank the persisted row, so a reseed never
+  // reorders the board.
+  static leaderboard::LeaderboardService::SnakeChange leaderboard_change(const storage::Snake& s) {
+    return {atoi(s.snake_id.c_str()), atoi(s.owner_user_id.c_str()), s.snake_name,
+            static_cast<int64_t>(s.length_k), s.alive && s.is_on_field};
+  }
+
+  void submit_leaderboard_update(const world::PersistenceDelta& delta) {
+    leaderboard::LeaderboardService::Update update;
+    update.at_unix = static_cast<int64_t>(std::time(nullptr));
+    update.snakes.reserve(delta.upsert_snakes.size());
+    for (const auto& s : delta.upsert_snakes) update.snakes.push_back(leaderboard_change(s));
+    update.removed_snakes.reserve(delta.delete_snake_ids.size());
+    for (const auto& sid : delta.delete_snake_ids) update.removed_snakes.push_back(atoi(sid.c_str()));
+    update.output_by_user.assign(delta.harvested_food_by_user.begin(), delta.harvested_food_by_user.end());
+    leaderboard_->Submit(std::move(update));
+  }
+
   void ensure_loaded_from_storage_if_empty() {
     const auto snap = world_.Snapshot();
     if (!snap.snakes.empty()) return;
@@ -477,6 +505,7 @@ class GameService {
 
   storage::IStorage& storage_;
   persistence::IPersistenceCoordinator& persistence_coordinator_;
+  leaderboard::LeaderboardService* leaderboard_ = nullptr;
   world::World world_;
   int aoi_pad_chunks_ = 0;
   chrono::steady_clock::time_point last_empty_reload_attempt_{};
@@ -487,11 +516,14 @@ class EconomyService {
   struct StabilizationActions {
     std::function<int64_t(int64_t)> expand_playable_cells;
     std::function<void(const std::string&, const std::string&, const std::string&)> emit_system_message;
-    std::function<world::WorldSnapshot()> current_world_snapshot;
+    std::function<world::SpatialMetrics()> current_spatial_metrics;
   };
 
-  explicit EconomyService(storage::IStorage& storage, const RuntimeConfig& runtime_cfg)
+  EconomyService(storage::IStorage& storage, const economy::EconomyAggregates& aggregates,
+                 economy::EconomyHistoryStore& history, const RuntimeConfig& runtime_cfg)
       : storage_(storage),
+        aggregates_(aggregates),
+        history_(history),
         period_cfg_{std::max(60, runtime_cfg.econ_period_seconds), runtime_cfg.econ_period_align},
         flush_interval_sec_(std::max(2, runtime_cfg.economy_flush_seconds)),
         stabilization_cfg_{runtime_cfg.auto_expansion_enabled,
@@ -512,7 +544,10 @@ class EconomyService {
           if (!env) return 2000;
           const int parsed = atoi(env);
           return max(500, min(10000, parsed));
-        }()) {
+        }()),
+        finalize_threads_(static_cast<size_t>(runtime_cfg.economy_finalize_threads)),
+        user_inputs_(static_cast<size_t>(runtime_cfg.economy_user_cache_entries)),
+        flush_pipeline_(storage, period_cfg_, std::chrono::seconds(flush_interval_sec_)) {
     if (!runtime_cfg.econ_period_tz.empty()) {
 #if !defined(_WIN32)
       setenv("TZ", runtime_cfg.econ_period_tz.c_str(), 1);
@@ -520,8 +555,13 @@ class EconomyService {
 #endif
     }
     next_fast_check_at_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(fast_check_interval_ms_);
+    flush_pipeline_.Start([this](const std::string& period_id) { FinalizeClosedPeriod(period_id); },
+                          [this](const std::vector<int>& user_ids) { OnDeltasWritten(user_ids); });
   }
 
+  // Writes queued deltas and joins the flush worker; call before storage goes away.
+  void Shutdown() { flush_pipeline_.Stop(); }
+
   struct Snapshot {
     storage::EconomyParams params;
     economy::EconomySnapshot global;
@@ -539,39 +579,35 @@ class EconomyService {
     stabilization_actions_ = std::move(actions);
   }
 
+  // Called from the tick loop: no lock, no storage. The flush worker
+  // coalesces and writes, then invalidates the cache.
   void OnActivity(const EconomyActivityDelta& d) {
     if (d.empty()) {
       return;
     }
-    lock_guard<mutex> lock(mu_);
-    EnsurePeriodLocked();
-    pending_harvested_food_ += d.harvested_food;
-    pending_real_output_ += d.harvested_food;
-    pending_movement_ticks_ += d.movement_ticks;
-    for (const auto& kv : d.harvested_food_by_user) {
-      if (kv.first <= 0 || kv.second == 0) continue;
-      pending_user_harvested_[kv.first] += kv.second;
-      pending_user_real_output_[kv.first] += kv.second;
-    }
-    for (const auto& kv : d.movement_ticks_by_user) {
-      if (kv.first <= 0 || kv.second == 0) continue;
-      pending_user_movement_[kv.first] += kv.second;
-    }
-    MaybeFlushPendingLocked(false);
-    cache_valid_ = false;
+    economy::EconomyFlushPipeline::Activity a;
+    a.at_unix = static_cast<int64_t>(time(nullptr));
+    a.harvested_food = d.harvested_food;
+    a.movement_ticks = d.movement_ticks;
+    a.users.reserve(d.harvested_food_by_user.size() + d.movement_ticks_by_user.size());
+    for (const auto& kv : d.harvested_food_by_user) a.users.push_back({kv.first, kv.second, 0});
+    for (const auto& kv : d.movement_ticks_by_user) a.users.push_back({kv.first, 0, kv.second});
+    flush_pipeline_.Submit(std::move(a));
   }
 
   void TickStabilization() {
     using clock = std::chrono::steady_clock;
     const auto now = clock::now();
-    lock_guard<mutex> lock(mu_);
+    // Runs on the tick thread: skip this check rather than wait behind a
+    // finalization or an admin recompute holding the lock.
+    unique_lock<mutex> lock(mu_, try_to_lock);
+    if (!lock.owns_lock()) return;
     EnsurePeriodLocked();
-    if (now < next_fast_check_at_) return;
-    MaybeFlushPendingLocked(false);
+    if (!finalizing_periods_.empty() || now < next_fast_check_at_) return;
     next_fast_check_at_ = now + std::chrono::milliseconds(fast_check_interval_ms_);
     if (!stabilization_cfg_.auto_expansion_enabled) return;
 
-    auto state = ComputeFresh(std::nullopt);
+    auto state = ComputeFresh(CaptureFreshInputsLocked());
     const auto decision = stabilization_engine_.EvaluateFastSpatialCheck(state.stabilization);
     if (!decision.triggered) return;
 
@@ -580,7 +616,7 @@ class EconomyService {
         const int64_t expanded_cells = stabilization_actions_.expand_playable_cells(decision.required_expansion_cells);
         if (expanded_cells > 0) {
           stabilization_engine_.OnSpatialExpansionApplied();
-          cache_valid_ = false;
+          ++cache_version_;
           if (stabilization_actions_.emit_system_message) {
             stabilization_actions_.emit_system_message(
                 "spatial_expansion",
@@ -613,41 +649,37 @@ class EconomyService {
     }
   }
 
+  // Per-user views are the shared global snapshot plus that user's cached
+  // inputs, so alternating global and per-user reads no longer evict each other.
   Snapshot GetState(std::optional<int> user_id = std::nullopt) {
-    using clock = chrono::steady_clock;
-    const auto now = clock::now();
+    const auto global = GlobalSnapshot();
+    if (!user_id.has_value()) return *global;
+    Snapshot out = *global;
+    out.user = ComputeUserView(*user_id, out);
+    return out;
+  }
 
+  Snapshot RecomputeAndPersist(const string& period_id,
+                               std::optional<int> user_id = std::nullopt,
+                               bool force_rewrite = false) {
+    flush_pipeline_.FlushNow();  // before mu_: the worker's finalize callback takes it
     {
       lock_guard<mutex> lock(mu_);
       EnsurePeriodLocked();
-      if (cache_valid_ && now < cache_expire_at_ && cache_user_id_ == user_id) return cache_;
-      MaybeFlushPendingLocked(false);
     }
-
-    Snapshot fresh = ComputeFresh(user_id);
+    // A rejected recompute keeps cached values intact.
+    (void)FinalizePeriod(period_id, force_rewrite);
+    FreshInputs inputs;
     {
       lock_guard<mutex> lock(mu_);
-      cache_ = fresh;
-      cache_user_id_ = user_id;
-      cache_valid_ = true;
-      cache_expire_at_ = now + chrono::milliseconds(cache_ttl_ms_);
-      return cache_;
+      inputs = CaptureFreshInputsLocked();
     }
+    Snapshot out = ComputeFresh(inputs);
+    if (user_id.has_value()) out.user = ComputeUserView(*user_id, out);
+    return out;
   }
 
-  Snapshot RecomputeAndPersist(const string& period_id,
-                               std::optional<int> user_id = std::nullopt,
-                               bool force_rewrite = false) {
-    lock_guard<mutex> lock(mu_);
-    EnsurePeriodLocked();
-    MaybeFlushPendingLocked(true);
-    if (!FinalizePeriodLocked(period_id, force_rewrite)) {
-      // Keep cached values intact if recompute is rejected.
-      return ComputeFresh(user_id);
-    }
-    cache_valid_ = false;
-    return ComputeFresh(user_id);
-  }
+  economy::FinalizeProgress::View GetFinalizeProgress() const { return finalize_progress_.Read(); }
 
   struct DebugState {
     std::string period_id;
@@ -658,6 +690,7 @@ class EconomyService {
     size_t pending_users = 0;
     int flush_interval_sec = 10;
     int64_t seconds_since_last_flush = 0;
+    economy::EconomyFlushPipeline::Stats flush;
   };
 
   DebugState GetDebugState() {
@@ -665,41 +698,97 @@ class EconomyService {
     EnsurePeriodLocked();
     using namespace std::chrono;
     const auto now = steady_clock::now();
+    const auto flush = flush_pipeline_.stats();
     DebugState out;
     out.period_id = current_period_id_;
     out.period_ends_in_seconds = current_period_ends_in_seconds_;
-    out.pending_harvested_food = pending_harvested_food_;
-    out.pending_real_output = pending_real_output_;
-    out.pending_movement_ticks = pending_movement_ticks_;
-    out.pending_users = pending_user_harvested_.size() + pending_user_real_output_.size() + pending_user_movement_.size();
+    out.pending_harvested_food = flush.pending_harvested_food;
+    out.pending_real_output = flush.pending_harvested_food;
+    out.pending_movement_ticks = flush.pending_movement_ticks;
+    out.pending_users = flush.pending_users;
     out.flush_interval_sec = flush_interval_sec_;
-    out.seconds_since_last_flush = static_cast<int64_t>(
-        duration_cast<seconds>(now - last_flush_at_).count());
+    out.seconds_since_last_flush = flush.last_pass_at == steady_clock::time_point{}
+                                       ? 0
+                                       : static_cast<int64_t>(duration_cast<seconds>(now - flush.last_pass_at).count());
+    out.flush = flush;
     return out;
   }
 
-  void InvalidateCache() {
+  // Balances of these users were committed by the cell ledger.
+  void OnBalancesCommitted(const std::vector<std::string>& user_ids) {
+    for (const auto& uid : user_ids) user_inputs_.Invalidate(uid);
+    lock_guard<mutex> lock(mu_);
+    ++cache_version_;
+  }
+
+  // Drops the shared snapshot only. For changes that move capital or the
+  // world (attach, create, delete): per-user inputs hold the period row and
+  // the closing snapshot, which those do not touch, and balances invalidate
+  // their user through OnBalancesCommitted.
+  void InvalidateGlobal() {
     lock_guard<mutex> lock(mu_);
-    cache_valid_ = false;
+    ++cache_version_;
+  }
+
+  // Drops the shared snapshot and every user's cached inputs.
+  void InvalidateCache() {
+    {
+      lock_guard<mutex> lock(mu_);
+      ++cache_version_;
+    }
+    user_inputs_.Clear();
+  }
+
+  struct CacheStats {
+    uint64_t version = 0;
+    uint64_t global_hits = 0;
+    uint64_t global_misses = 0;
+    uint64_t global_shared = 0;
+    uint64_t user_shared = 0;
+    economy::UserEconomyLru::Stats users;
+  };
+
+  CacheStats GetCacheStats() {
+    CacheStats out;
+    {
+      lock_guard<mutex> lock(mu_);
+      out.version = cache_version_;
+      out.global_hits = global_hits_;
+      out.global_misses = global_misses_;
+    }
+    out.global_shared = global_flight_.shared();
+    out.user_shared = user_flight_.shared();
+    out.users = user_inputs_.stats();
+    return out;
   }
 
  private:
   // Canonical derived economy/spatial view used by WS/HTTP/admin and stabilization logic.
   economy::StabilizationDerived BuildCanonicalSpatialDerived(const storage::EconomyParams& params,
                                                              int64_t money_supply,
-                                                             int64_t deployed_capital,
-                                                             const std::optional<world::WorldSnapshot>& world_snap) {
-    const int64_t occupied_cells = world_snap.has_value()
-                                       ? economy::StabilizationEngine::ComputeOccupiedSnakeCells(*world_snap)
-                                       : std::max<int64_t>(0, deployed_capital);
-    const int64_t field_size = world_snap.has_value()
-                                   ? std::max<int64_t>(0, world_snap->playable_cells)
-                                   : economy_world_area(params, economy::EconomySnapshot{});
-    const int64_t free_space_on_field = std::max<int64_t>(0, field_size - occupied_cells);
+                                                             int64_t deployed_capital) {
+    int64_t field_size = 0;
+    int64_t free_space_on_field = 0;
+    if (stabilization_actions_.current_spatial_metrics) {
+      const auto spatial = stabilization_actions_.current_spatial_metrics();
+      field_size = std::max<int64_t>(0, spatial.playable_cells);
+      free_space_on_field = std::max<int64_t>(0, spatial.free_playable_cells);
+    } else {
+      field_size = economy_world_area(params, economy::EconomySnapshot{});
+      free_space_on_field = std::max<int64_t>(0, field_size - deployed_capital);
+    }
     return stabilization_engine_.Derive(money_supply, params.k_land, deployed_capital, field_size, free_space_on_field);
   }
 
   void EnsurePeriodLocked() {
+    if (!finalize_retries_.empty()) {
+      const auto now = std::chrono::steady_clock::now();
+      for (auto& [period_id, retry] : finalize_retries_) {
+        if (retry.at > now) continue;
+        retry.at = std::chrono::steady_clock::time_point::max();  // until this attempt reports back
+        flush_pipeline_.RequestFinalize(period_id);
+      }
+    }
     const auto ps = economy::CurrentPeriodState(std::time(nullptr), period_cfg_);
     if (current_period_id_.empty()) {
       current_period_id_ = ps.period_id;
@@ -709,72 +798,150 @@ class EconomyService {
     current_period_ends_in_seconds_ = ps.ends_in_seconds;
     if (ps.period_id == current_period_id_) return;
 
-    MaybeFlushPendingLocked(true);
-    (void)FinalizePeriodLocked(current_period_id_, false);
+    // The closing period is finalized on the flush worker once its deltas are
+    // written; fast checks pause until every closed period is finalized so
+    // their failure counts stay intact.
+    flush_pipeline_.RequestFinalize(current_period_id_);
+    finalizing_periods_.insert(current_period_id_);
     current_period_id_ = ps.period_id;
-    pending_harvested_food_ = 0;
-    pending_real_output_ = 0;
-    pending_movement_ticks_ = 0;
-    pending_user_harvested_.clear();
-    pending_user_real_output_.clear();
-    pending_user_movement_.clear();
+  }
+
+  void FinalizeClosedPeriod(const std::string& period_id) {
+    const auto outcome = FinalizePeriod(period_id, false);
+    lock_guard<mutex> lock(mu_);
+    if (outcome == FinalizeOutcome::kIncomplete) {
+      // Still pending; EnsurePeriodLocked requests it again after a backoff.
+      auto& retry = finalize_retries_[period_id];
+      retry.delay = std::min(kFinalizeRetryMax, retry.delay.count() == 0 ? kFinalizeRetryMin : retry.delay * 2);
+      retry.at = std::chrono::steady_clock::now() + retry.delay;
+      return;
+    }
+    finalize_retries_.erase(period_id);
     stabilization_engine_.ResetForNewPeriod();
     next_fast_check_at_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(fast_check_interval_ms_);
+    finalizing_periods_.erase(period_id);
+    ++cache_version_;
+  }
+
+  // Flush worker: period totals moved, and so did these users' rows.
+  void OnDeltasWritten(const std::vector<int>& user_ids) {
+    for (int uid : user_ids) user_inputs_.Invalidate(std::to_string(uid));
+    lock_guard<mutex> lock(mu_);
+    ++cache_version_;
   }
 
-  void MaybeFlushPendingLocked(bool force) {
-    if (current_period_id_.empty()) return;
+  std::shared_ptr<const Snapshot> GlobalSnapshot() {
     const auto now = chrono::steady_clock::now();
-    if (!force && (now - last_flush_at_) < chrono::seconds(flush_interval_sec_)) {
-      return;
-    }
-    if (pending_harvested_food_ != 0 || pending_movement_ticks_ != 0) {
-      (void)storage_.IncrementEconomyPeriodRaw(current_period_id_, pending_harvested_food_, pending_movement_ticks_);
-      pending_harvested_food_ = 0;
-      pending_real_output_ = 0;
-      pending_movement_ticks_ = 0;
-    }
-    std::unordered_set<int> users;
-    for (const auto& kv : pending_user_harvested_) users.insert(kv.first);
-    for (const auto& kv : pending_user_real_output_) users.insert(kv.first);
-    for (const auto& kv : pending_user_movement_) users.insert(kv.first);
-    for (int uid : users) {
-      const int64_t h = pending_user_harvested_[uid];
-      (void)pending_user_real_output_[uid];
-      const int64_t m = pending_user_movement_[uid];
-      if (h == 0 && m == 0) continue;
-      (void)storage_.IncrementEconomyPeriodUserRaw(current_period_id_, std::to_string(uid), h, m);
-    }
-    pending_user_harvested_.clear();
-    pending_user_real_output_.clear();
-    pending_user_movement_.clear();
-    last_flush_at_ = now;
-  }
-
-  bool FinalizePeriodLocked(const std::string& period_id, bool force_rewrite) {
-    if (period_id.empty()) return false;
+    uint64_t version = 0;
+    FreshInputs inputs;
+    {
+      lock_guard<mutex> lock(mu_);
+      EnsurePeriodLocked();
+      version = cache_version_;
+      if (global_cache_ && global_cache_version_ == version && now < global_cache_expire_at_) {
+        ++global_hits_;
+        return global_cache_;
+      }
+      ++global_misses_;
+      inputs = CaptureFreshInputsLocked();
+    }
+    // Concurrent misses on one version share a single computation; a result
+    // overtaken by an invalidation is returned but not cached.
+    return global_flight_.Do(version, [this, version, &inputs] {
+      auto fresh = std::make_shared<const Snapshot>(ComputeFresh(inputs));
+      lock_guard<mutex> lock(mu_);
+      if (cache_version_ == version) {
+        global_cache_ = fresh;
+        global_cache_version_ = version;
+        global_cache_expire_at_ = chrono::steady_clock::now() + chrono::milliseconds(cache_ttl_ms_);
+      }
+      return fresh;
+    });
+  }
+
+  // The user's row of the current period and their last closing snapshot,
+  // from the LRU or, once per concurrent miss, from storage.
+  economy::UserEconomyLru::Inputs UserInputs(const std::string& uid, const std::string& period_id) {
+    if (auto hit = user_inputs_.Get(uid, period_id)) return std::move(*hit);
+    return user_flight_.Do(period_id + "/" + uid, [&] {
+      const uint64_t generation = user_inputs_.generation();
+      economy::UserEconomyLru::Inputs in;
+      in.period_id = period_id;
+      in.row = storage_.GetEconomyPeriodUser(period_id, uid).value_or(storage::EconomyPeriodUser{});
+      in.row.period_key = period_id;
+      in.row.user_id = uid;
+      const auto closed = std::atomic_load(&last_closed_);
+      if (closed && closed->users) in.prev = closed->users->Find(uid);
+      user_inputs_.Put(uid, in, generation);
+      return in;
+    });
+  }
+
+  std::optional<economy::EconomyUserSnapshot> ComputeUserView(int user_id, const Snapshot& global) {
+    const std::string uid = std::to_string(user_id);
+    auto user = storage_.GetUserById(uid);
+    if (!user.has_value()) return std::nullopt;
+    const auto in = UserInputs(uid, global.period_id);
+    economy::EconomyPeriodRaw uraw;
+    uraw.harvested_food = in.row.user_harvested_food;
+    uraw.real_output = in.row.user_real_output > 0 ? in.row.user_real_output : in.row.user_harvested_food;
+    uraw.movement_ticks = in.row.user_movement_ticks;
+    uraw.deployed_cells = aggregates_.UserCapital(uid);
+    uraw.alpha_bootstrap_default = global.params.alpha_bootstrap_default;
+    return economy_engine::ComputeUser(uraw, in.prev, user->balance_mi, global.global.y, global.period_id, uid);
+  }
+
+  enum class FinalizeOutcome { kFinalized, kSkipped, kIncomplete };
+
+  // Closes a period without holding mu_ across storage calls: inputs are
+  // captured up front, per-user rows are computed and written in parallel, the
+  // period row goes last as the commit marker, and the new closing snapshot is
+  // swapped in whole. If user rows still fail after the finalizer's retries the
+  // period stays unfinalized (kIncomplete) so a later run redoes it. One job at
+  // a time.
+  FinalizeOutcome FinalizePeriod(const std::string& period_id, bool force_rewrite) {
+    if (period_id.empty()) return FinalizeOutcome::kSkipped;
+    lock_guard<mutex> job_lock(finalize_job_mu_);
+    static auto& finalize_seconds = metrics::Default().GetHistogram(
+        "snake_economy_compute_seconds", "Economy recompute duration by operation.", {{"op", "finalize_period"}},
+        metrics::Histogram::kSeconds);
+    metrics::ScopedTimer timer(finalize_seconds);
+    diagnostics::TraceSpan span("economy", "finalize_period");
     auto period = storage_.GetEconomyPeriod(period_id).value_or(storage::EconomyPeriod{});
     period.period_key = period_id;
     if (period.is_finalized && !force_rewrite) {
-      return false;
+      return FinalizeOutcome::kSkipped;
     }
-    const auto params = storage_.GetEconomyParamsActive().value_or(storage::EconomyParams{});
-    const auto users = storage_.ListUsers();
-    const auto snakes = storage_.ListSnakes();
+    finalize_progress_.Begin(period_id);
 
+    // Capture. The flush worker has written this period's deltas before
+    // finalization is requested, so these reads see its complete inputs.
+    const auto params = storage_.GetEconomyParamsActive().value_or(storage::EconomyParams{});
+    economy::PeriodUserFinalizer::Input job;
     int64_t sum_mi = 0;
-    for (const auto& u : users) sum_mi += u.balance_mi;
-    const auto capital = economy_engine::AggregateProductiveCapital(snakes);
-    world::WorldSnapshot world_snap;
-    bool has_world_snapshot = false;
-    if (stabilization_actions_.current_world_snapshot) {
-      world_snap = stabilization_actions_.current_world_snapshot();
-      has_world_snapshot = true;
-    }
-    const auto derived_close_base = BuildCanonicalSpatialDerived(
-        params, sum_mi + params.m_gov_reserve, capital.total_capital, has_world_snapshot ? std::optional<world::WorldSnapshot>(world_snap) : std::nullopt);
-    const auto& derived_close = derived_close_base;
-    const auto close_decision = stabilization_engine_.EvaluatePeriodClose(period_id, derived_close, sum_mi + params.m_gov_reserve);
+    int64_t total_capital = 0;
+    {
+      const auto users = storage_.ListUsers();
+      job.index = economy::UserIndex(users);
+      job.balance.assign(job.index.size(), 0);
+      for (const auto& u : users) {
+        sum_mi += u.balance_mi;
+        job.balance[job.index.Find(u.user_id)] = u.balance_mi;
+      }
+      total_capital = economy::ProductiveCapitalByUser(storage_.ListSnakes(), job.index, job.user_capital);
+      job.raw_rows.resize(job.index.size());
+      for (auto& row : storage_.ListEconomyPeriodUsers(period_id)) {
+        const size_t i = job.index.Find(row.user_id);
+        if (i != economy::UserIndex::npos) job.raw_rows[i] = std::move(row);
+      }
+    }
+    const auto derived_close = BuildCanonicalSpatialDerived(params, sum_mi + params.m_gov_reserve, total_capital);
+    economy::PeriodCloseDecision close_decision;
+    {
+      lock_guard<mutex> lock(mu_);
+      close_decision = stabilization_engine_.EvaluatePeriodClose(period_id, derived_close, sum_mi + params.m_gov_reserve);
+    }
+    const auto prev_closed = std::atomic_load(&last_closed_);
     std::optional<storage::EconomyParams> stabilized_params;
     if (!close_decision.already_handled_for_period) {
       if (close_decision.should_expand_money && close_decision.actual_money_expansion > 0) {
@@ -819,10 +986,10 @@ class EconomyService {
     raw.harvested_food = period.harvested_food;
     raw.real_output = period.real_output > 0 ? period.real_output : period.harvested_food;
     raw.movement_ticks = period.movement_ticks;
-    raw.deployed_cells = capital.total_capital + active_params_after_stabilization.delta_k_obs;
+    raw.deployed_cells = total_capital + active_params_after_stabilization.delta_k_obs;
     raw.alpha_bootstrap_default = active_params_after_stabilization.alpha_bootstrap_default;
-    auto global =
-        economy_engine::ComputeGlobal(raw, last_closed_global_, sum_mi, active_params_after_stabilization.m_gov_reserve);
+    auto global = economy::ComputeGlobal(raw, prev_closed ? &prev_closed->global : nullptr, sum_mi,
+                                         active_params_after_stabilization.m_gov_reserve);
     global.period_id = period_id;
     global.snapshot_status = "cached";
 
@@ -861,63 +1028,79 @@ class EconomyService {
         last_warn_ts = now_ts;
       }
     }
+
+    job.period_id = period_id;
+    job.computed_at = period.computed_at;
+    job.global_y = global.y;
+    job.alpha_bootstrap_default = active_params_after_stabilization.alpha_bootstrap_default;
+    if (prev_closed) job.prev = prev_closed->users;
+    auto result = economy::PeriodUserFinalizer(storage_, finalize_threads_).Run(std::move(job), finalize_progress_);
+    if (result.rows_failed > 0) {
+      std::cerr << "[economy] period=" << period_id << " left unfinalized: " << result.rows_failed
+                << " user rows unwritten after retries\n";
+      finalize_progress_.Finish(false);
+      return FinalizeOutcome::kIncomplete;
+    }
     (void)storage_.PutEconomyPeriod(period);
 
-    auto user_raw_rows = storage_.ListEconomyPeriodUsers(period_id);
-    std::unordered_map<std::string, storage::EconomyPeriodUser> user_rows;
-    for (const auto& row : user_raw_rows) user_rows[row.user_id] = row;
-
-    for (const auto& u : users) {
-      auto row = user_rows.count(u.user_id) ? user_rows[u.user_id] : storage::EconomyPeriodUser{};
-      row.period_key = period_id;
-      row.user_id = u.user_id;
-      economy::EconomyPeriodRaw user_raw;
-      user_raw.harvested_food = row.user_harvested_food;
-      user_raw.real_output = row.user_real_output > 0 ? row.user_real_output : row.user_harvested_food;
-      user_raw.movement_ticks = row.user_movement_ticks;
-      if (const auto it_cap = capital.user_total_capital.find(u.user_id);
-          it_cap != capital.user_total_capital.end()) {
-        user_raw.deployed_cells = it_cap->second;
-      } else {
-        user_raw.deployed_cells = 0;
-      }
-      user_raw.alpha_bootstrap_default = active_params_after_stabilization.alpha_bootstrap_default;
-      std::optional<economy::EconomyUserSnapshot> prev_user;
-      auto it_prev = last_closed_users_.find(u.user_id);
-      if (it_prev != last_closed_users_.end()) prev_user = it_prev->second;
-      auto us = economy_engine::ComputeUser(user_raw, prev_user, u.balance_mi, global.y, period_id, u.user_id);
-      row.user_output = us.y_u;
-      row.user_real_output = user_raw.real_output;
-      row.user_capital = us.k_u;
-      row.user_labor = us.l_u;
-      row.user_capital_share = us.alpha_u;
-      row.user_productivity = us.a_u;
-      row.user_market_share = us.market_share;
-      row.user_storage_balance = us.storage_balance;
-      row.alpha_bootstrap = us.alpha_bootstrap;
-      row.computed_at = period.computed_at;
-      (void)storage_.PutEconomyPeriodUser(row);
-      last_closed_users_[u.user_id] = us;
-    }
-    last_closed_global_ = global;
-    return true;
+    auto closed = std::make_shared<ClosedPeriod>();
+    closed->global = global;
+    closed->users = std::move(result.closed);
+    // History rows carry the period's own close time, so a recompute of a
+    // past period maps to its original row and is skipped. A period that has
+    // not closed yet (an admin recompute) is recorded when it does.
+    const int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+    const auto ends_at = economy::PeriodEndUnix(period_id, period_cfg_);
+    if (!ends_at || *ends_at <= now_us / 1000000) {
+      const int64_t closed_at_us = ends_at ? *ends_at * 1000000 : now_us;
+      history_.AppendPeriod(closed_at_us, global);
+      if (closed->users) history_.AppendUsers(closed_at_us, *closed->users);
+    }
+    history_.ApplyRetention(now_us);
+    std::atomic_store(&last_closed_, std::shared_ptr<const ClosedPeriod>(std::move(closed)));
+    InvalidateCache();
+    finalize_progress_.Finish(true);
+    return FinalizeOutcome::kFinalized;
+  }
+
+  // Period and stabilization state that ComputeFresh reports. The tick thread
+  // writes it under mu_, so callers copy it under the lock and compute without.
+  struct FreshInputs {
+    std::string period_id;
+    int64_t period_ends_in_seconds = 0;
+    economy::StabilizationRuntimeState stabilization_runtime;
+    std::chrono::steady_clock::time_point next_fast_check_at{};
+  };
+
+  FreshInputs CaptureFreshInputsLocked() const {
+    FreshInputs in;
+    in.period_id = current_period_id_;
+    in.period_ends_in_seconds = current_period_ends_in_seconds_;
+    in.stabilization_runtime = stabilization_engine_.runtime_state();
+    in.next_fast_check_at = next_fast_check_at_;
+    return in;
   }
 
-  Snapshot ComputeFresh(std::optional<int> user_id) {
+  // The global view; per-user views are layered on by ComputeUserView.
+  Snapshot ComputeFresh(const FreshInputs& in) {
+    static auto& compute_seconds = metrics::Default().GetHistogram(
+        "snake_economy_compute_seconds", "Economy recompute duration by operation.", {{"op", "compute_fresh"}},
+        metrics::Histogram::kSeconds);
+    metrics::ScopedTimer timer(compute_seconds);
+    diagnostics::TraceSpan span("economy", "compute_fresh");
     Snapshot out;
     out.params = storage_.GetEconomyParamsActive().value_or(storage::EconomyParams{});
-    out.period_id = current_period_id_;
-    out.period_ends_in_seconds = current_period_ends_in_seconds_;
-    auto period = storage_.GetEconomyPeriod(current_period_id_).value_or(storage::EconomyPeriod{});
-    period.period_key = current_period_id_;
+    out.period_id = in.period_id;
+    out.period_ends_in_seconds = in.period_ends_in_seconds;
+    auto period = storage_.GetEconomyPeriod(in.period_id).value_or(storage::EconomyPeriod{});
+    period.period_key = in.period_id;
 
-    const auto users = storage_.ListUsers();
-    int64_t sum_mi = 0;
-    for (const auto& u : users) sum_mi += u.balance_mi;
-
-    const auto snakes = storage_.ListSnakes();
-    const auto capital = economy_engine::AggregateProductiveCapital(snakes);
-    out.k_snakes = capital.total_capital;
+    // Running totals; FinalizePeriod still scans for the closing snapshot.
+    const auto totals = aggregates_.Read();
+    const int64_t sum_mi = totals.sum_balance_mi;
+    out.k_snakes = totals.total_capital;
 
     economy::EconomyPeriodRaw raw;
     raw.harvested_food = period.harvested_food;
@@ -925,48 +1108,18 @@ class EconomyService {
     raw.movement_ticks = period.movement_ticks;
     raw.deployed_cells = out.k_snakes + out.params.delta_k_obs;
     raw.alpha_bootstrap_default = out.params.alpha_bootstrap_default;
-    out.global = economy_engine::ComputeGlobal(raw, last_closed_global_, sum_mi, out.params.m_gov_reserve);
-    out.global.period_id = current_period_id_;
-    out.global.period_ends_in_seconds = current_period_ends_in_seconds_;
+    const auto closed = std::atomic_load(&last_closed_);
+    out.global = economy::ComputeGlobal(raw, closed ? &closed->global : nullptr, sum_mi, out.params.m_gov_reserve);
+    out.global.period_id = in.period_id;
+    out.global.period_ends_in_seconds = in.period_ends_in_seconds;
     out.global.snapshot_status = period.is_finalized ? "cached" : "live_unfinalized";
 
-    if (user_id.has_value()) {
-      const std::string uid = std::to_string(*user_id);
-      auto user = storage_.GetUserById(uid);
-      if (user.has_value()) {
-        auto row = storage_.GetEconomyPeriodUser(current_period_id_, uid).value_or(storage::EconomyPeriodUser{});
-        row.period_key = current_period_id_;
-        row.user_id = uid;
-        economy::EconomyPeriodRaw uraw;
-        uraw.harvested_food = row.user_harvested_food;
-        uraw.real_output = row.user_real_output > 0 ? row.user_real_output : row.user_harvested_food;
-        uraw.movement_ticks = row.user_movement_ticks;
-        if (const auto it_cap = capital.user_total_capital.find(uid);
-            it_cap != capital.user_total_capital.end()) {
-          uraw.deployed_cells = it_cap->second;
-        } else {
-          uraw.deployed_cells = 0;
-        }
-        uraw.alpha_bootstrap_default = out.params.alpha_bootstrap_default;
-        std::optional<economy::EconomyUserSnapshot> prev_u;
-        auto it_prev = last_closed_users_.find(uid);
-        if (it_prev != last_closed_users_.end()) prev_u = it_prev->second;
-        out.user = economy_engine::ComputeUser(uraw, prev_u, user->balance_mi, out.global.y, current_period_id_, uid);
-      }
-    }
-    world::WorldSnapshot world_snap;
-    bool has_world_snapshot = false;
-    if (stabilization_actions_.current_world_snapshot) {
-      world_snap = stabilization_actions_.current_world_snapshot();
-      has_world_snapshot = true;
-    }
-    out.stabilization = BuildCanonicalSpatialDerived(
-        out.params, out.global.m, out.k_snakes, has_world_snapshot ? std::optional<world::WorldSnapshot>(world_snap) : std::nullopt);
-    out.stabilization_runtime = stabilization_engine_.runtime_state();
+    out.stabilization = BuildCanonicalSpatialDerived(out.params, out.global.m, out.k_snakes);
+    out.stabilization_runtime = in.stabilization_runtime;
     const auto now = std::chrono::steady_clock::now();
-    if (next_fast_check_at_ > now) {
+    if (in.next_fast_check_at > now) {
       out.next_fast_check_in_seconds = static_cast<int64_t>(
-          std::chrono::duration_cast<std::chrono::seconds>(next_fast_check_at_ - now).count());
+          std::chrono::duration_cast<std::chrono::seconds>(in.next_fast_check_at - now).count());
     } else {
       out.next_fast_check_in_seconds = 0;
     }
@@ -974,6 +1127,8 @@ class EconomyService {
   }
 
   storage::IStorage& storage_;
+  const economy::EconomyAggregates& aggregates_;
+  economy::EconomyHistoryStore& history_;
   economy::PeriodConfig period_cfg_;
   int flush_interval_sec_ = 10;
   economy::StabilizationConfig stabilization_cfg_{};
@@ -983,97 +1138,41 @@ class EconomyService {
   StabilizationActions stabilization_actions_{};
   int cache_ttl_ms_ = 2000;
   mutex mu_;
-  bool cache_valid_ = false;
-  chrono::steady_clock::time_point cache_expire_at_{};
-  std::optional<int> cache_user_id_{};
-  Snapshot cache_{};
+  // Bumped by every event that changes what the global snapshot shows; the
+  // TTL bounds staleness from sources without events (world occupancy).
+  uint64_t cache_version_ = 0;
+  std::shared_ptr<const Snapshot> global_cache_;
+  uint64_t global_cache_version_ = 0;
+  chrono::steady_clock::time_point global_cache_expire_at_{};
+  uint64_t global_hits_ = 0;
+  uint64_t global_misses_ = 0;
+  economy::SingleFlight<uint64_t, std::shared_ptr<const Snapshot>> global_flight_;
+  economy::SingleFlight<std::string, economy::UserEconomyLru::Inputs> user_flight_;
   std::string current_period_id_;
   int64_t current_period_ends_in_seconds_ = 0;
-  int64_t pending_harvested_food_ = 0;
-  int64_t pending_real_output_ = 0;
-  int64_t pending_movement_ticks_ = 0;
-  std::unordered_map<int, int64_t> pending_user_harvested_;
-  std::unordered_map<int, int64_t> pending_user_real_output_;
-  std::unordered_map<int, int64_t> pending_user_movement_;
-  chrono::steady_clock::time_point last_flush_at_{chrono::steady_clock::now()};
-  std::optional<economy::EconomySnapshot> last_closed_global_;
-  std::unordered_map<std::string, economy::EconomyUserSnapshot> last_closed_users_;
+  std::unordered_set<std::string> finalizing_periods_;  // requested, not finalized yet
+  struct FinalizeRetry {
+    std::chrono::steady_clock::time_point at{};
+    std::chrono::seconds delay{0};
+  };
+  static constexpr std::chrono::seconds kFinalizeRetryMin{5};
+  static constexpr std::chrono::seconds kFinalizeRetryMax{300};
+  std::map<std::string, FinalizeRetry> finalize_retries_;  // incomplete finalizations awaiting a rerun
+  // Closing snapshot of the last finalized period, replaced whole via
+  // std::atomic_store so readers never see a half-published period.
+  struct ClosedPeriod {
+    economy::EconomySnapshot global;
+    std::shared_ptr<const economy::ClosedUserColumns> users;
+  };
+  std::shared_ptr<const ClosedPeriod> last_closed_;
+  mutex finalize_job_mu_;
+  size_t finalize_threads_ = 4;
+  economy::FinalizeProgress finalize_progress_;
+  economy::UserEconomyLru user_inputs_;
+  // Last member: its worker calls back into the state above.
+  economy::EconomyFlushPipeline flush_pipeline_;
 };
 
-static optional<string> get_json_string_field(const string& body, const string& key) {
-  const string pat = "\"" + key + "\"";
-  size_t p = body.find(pat);
-  if (p == string::npos) return nullopt;
-  p = body.find(':', p);
-  if (p == string::npos) return nullopt;
-  ++p;
-  while (p < body.size() && isspace(static_cast<unsigned char>(body[p]))) ++p;
-  if (p >= body.size() || body[p] != '"') return nullopt;
-  ++p;
-  size_t e = body.find('"', p);
-  if (e == string::npos) return nullopt;
-  return body.substr(p, e - p);
-}
-
-static optional<int> get_json_int_field(const string& body, const string& key) {
-  const string pat = "\"" + key + "\"";
-  size_t p = body.find(pat);
-  if (p == string::npos) return nullopt;
-  p = body.find(':', p);
-  if (p == string::npos) return nullopt;
-  ++p;
-  while (p < body.size() && isspace(static_cast<unsigned char>(body[p]))) ++p;
-  size_t e = p;
-  while (e < body.size() && (isdigit(static_cast<unsigned char>(body[e])) || body[e] == '-')) ++e;
-  if (e == p) return nullopt;
-  return stoi(body.substr(p, e - p));
-}
-
-static optional<double> get_json_double_field(const string& body, const string& key) {
-  const string pat = "\"" + key + "\"";
-  size_t p = body.find(pat);
-  if (p == string::npos) return nullopt;
-  p = body.find(':', p);
-  if (p == string::npos) return nullopt;
-  ++p;
-  while (p < body.size() && isspace(static_cast<unsigned char>(body[p]))) ++p;
-  size_t e = p;
-  bool seen_digit = false;
-  if (e < body.size() && (body[e] == '-' || body[e] == '+')) ++e;
-  while (e < body.size()) {
-    const char c = body[e];
-    if (isdigit(static_cast<unsigned char>(c))) {
-      seen_digit = true;
-      ++e;
-      continue;
-    }
-    if (c == '.' || c == 'e' || c == 'E' || c == '-' || c == '+') {
-      ++e;
-      continue;
-    }
-    break;
-  }
-  if (!seen_digit || e == p) return nullopt;
-  try {
-    return stod(body.substr(p, e - p));
-  } catch (...) {
-    return nullopt;
-  }
-}
-
-static optional<bool> get_json_bool_field(const string& body, const string& key) {
-  const string pat = "\"" + key + "\"";
-  size_t p = body.find(pat);
-  if (p == string::npos) return nullopt;
-  p = body.find(':', p);
-  if (p == string::npos) return nullopt;
-  ++p;
-  while (p < body.size() && isspace(static_cast<unsigned char>(body[p]))) ++p;
-  if (body.compare(p, 4, "true") == 0) return true;
-  if (body.compare(p, 5, "false") == 0) return false;
-  return nullopt;
-}
-
 static string normalize_name(const string& in) {
   string out;
   out.reserve(in.size());
@@ -1102,13 +1201,14 @@ struct GoogleIdentity {
 
 static optional<GoogleIdentity> parse_google_identity_claims(const string& payload) {
   GoogleIdentity out;
-  out.subject = get_json_string_field(payload, "sub").value_or("");
-  out.email = get_json_string_field(payload, "email").value_or("");
-  out.issuer = get_json_string_field(payload, "iss").value_or("");
-  out.audience = get_json_string_field(payload, "aud").value_or("");
-  out.exp = static_cast<int64_t>(get_json_int_field(payload, "exp").value_or(0));
+  const protocol::JsonFields claims(payload);
+  out.subject = claims.GetString("sub").value_or("");
+  out.email = claims.GetString("email").value_or("");
+  out.issuer = claims.GetString("iss").value_or("");
+  out.audience = claims.GetString("aud").value_or("");
+  out.exp = claims.GetInt64("exp").value_or(0);
   if (out.exp <= 0) {
-    const auto exp_str = get_json_string_field(payload, "exp");
+    const auto exp_str = claims.GetString("exp");
     if (exp_str.has_value()) {
       try {
         out.exp = std::stoll(*exp_str);
@@ -1125,15 +1225,6 @@ static bool is_google_issuer_allowed(const string& iss) {
   return iss == "https://accounts.google.com" || iss == "accounts.google.com";
 }
 
-static bool read_file_bytes(const std::string& path, std::string& out) {
-  std::ifstream f(path, std::ios::binary);
-  if (!f.is_open()) return false;
-  std::ostringstream ss;
-  ss << f.rdbuf();
-  out = ss.str();
-  return true;
-}
-
 static bool is_safe_static_subpath(const std::string& rel) {
   if (rel.empty()) return false;
   if (rel.find("..") != std::string::npos) return false;
@@ -1141,42 +1232,49 @@ static bool is_safe_static_subpath(const std::string& rel) {
   return rel.find('\\') == std::string::npos;
 }
 
-static std::string content_type_for_path(const std::string& path) {
-  auto dot = path.find_last_of('.');
-  const std::string ext = (dot == std::string::npos) ? "" : path.substr(dot);
-  if (ext == ".html") return "text/html; charset=utf-8";
-  if (ext == ".css") return "text/css; charset=utf-8";
-  if (ext == ".js") return "application/javascript; charset=utf-8";
-  if (ext == ".json") return "application/json";
-  if (ext == ".png") return "image/png";
-  if (ext == ".jpg" || ext == ".jpeg") return "image/jpeg";
-  if (ext == ".svg") return "image/svg+xml";
-  if (ext == ".webp") return "image/webp";
-  if (ext == ".ico") return "image/x-icon";
-  return "application/octet-stream";
-}
+// Google's published signing keys, fetched over HTTPS by the key refresher
+// (never on the login path).
+class GoogleJwksHttpSource final : public auth::JwksSource {
+ public:
+  explicit GoogleJwksHttpSource(string url) : url_(std::move(url)) {}
+
+  optional<auth::JwksDocument> Fetch() override {
+    Aws::Client::ClientConfiguration client_cfg;
+    client_cfg.scheme = Aws::Http::Scheme::HTTPS;
+    client_cfg.connectTimeoutMs = 2500;
+    client_cfg.requestTimeoutMs = 4000;
+    auto request = Aws::Http::CreateHttpRequest(
+        Aws::Http::URI(url_.c_str()),
+        Aws::Http::HttpMethod::HTTP_GET,
+        Aws::Utils::Stream::DefaultResponseStreamFactoryMethod);
+    if (!request) return nullopt;
+    auto client = Aws::Http::CreateHttpClient(client_cfg);
+    if (!client) return nullopt;
+    auto response = client->MakeRequest(request);
+    if (!response || response->GetResponseCode() != Aws::Http::HttpResponseCode::OK) return nullopt;
+
+    auth::JwksDocument doc;
+    std::stringstream ss;
+    ss << response->GetResponseBody().rdbuf();
+    doc.body = ss.str();
+    if (response->HasHeader("cache-control")) {
+      const string cc = response->GetHeader("cache-control").c_str();
+      const auto pos = cc.find("max-age=");
+      if (pos != string::npos) doc.max_age_seconds = std::atoll(cc.c_str() + pos + 8);
+    }
+    return doc;
+  }
+
+  string describe() const override { return url_; }
+
+ private:
+  const string url_;
+};
 
-static optional<GoogleIdentity> verify_google_id_token_with_google(const string& id_token) {
-  Aws::Client::ClientConfiguration client_cfg;
-  client_cfg.scheme = Aws::Http::Scheme::HTTPS;
-  client_cfg.connectTimeoutMs = 2500;
-  client_cfg.requestTimeoutMs = 4000;
-  const Aws::String encoded = Aws::Utils::StringUtils::URLEncode(id_token.c_str());
-  Aws::Http::URI uri(Aws::String("https://oauth2.googleapis.com/tokeninfo?id_token=") + encoded);
-  auto request = Aws::Http::CreateHttpRequest(
-      uri,
-      Aws::Http::HttpMethod::HTTP_GET,
-      Aws::Utils::Stream::DefaultResponseStreamFactoryMethod);
-  if (!request) return nullopt;
-  auto client = Aws::Http::CreateHttpClient(client_cfg);
-  if (!client) return nullopt;
-  auto response = client->MakeRequest(request);
-  if (!response || response->GetResponseCode() != Aws::Http::HttpResponseCode::OK) return nullopt;
-
-  std::stringstream ss;
-  ss << response->GetResponseBody().rdbuf();
-  const string payload = ss.str();
-  return parse_google_identity_claims(payload);
+static optional<GoogleIdentity> verify_google_id_token(const auth::IdTokenVerifier& verifier, const string& id_token) {
+  const auto payload = verifier.Verify(id_token);
+  if (!payload.has_value()) return nullopt;
+  return parse_google_identity_claims(*payload);
 }
 
 static bool origin_allowed_for_ws(const string& origin) {
@@ -1225,13 +1323,13 @@ static string state_to_json(const world::WorldSnapshot& gs) {
   return protocol::encode_snapshot_json(to_protocol_snapshot(gs));
 }
 
-static optional<int> require_auth_user(AuthState& auth, const httplib::Request& req) {
+static optional<int> require_auth_user(const auth::SessionTokens& auth, const httplib::Request& req) {
   auto it = req.headers.find("Authorization");
   if (it == req.headers.end()) return nullopt;
   const string& v = it->second;
   const string prefix = "Bearer ";
   if (v.rfind(prefix, 0) != 0) return nullopt;
-  return auth.token_to_user(v.substr(prefix.size()));
+  return auth.Verify(std::string_view(v).substr(prefix.size()));
 }
 
 static bool require_admin_token(const httplib::Request& req, const std::string& admin_token) {
@@ -1296,6 +1394,18 @@ int main(int argc, char** argv) {
        << ", AUTH_AOI_RADIUS=" << runtime_cfg.auth_aoi_radius
        << ", AOI_PAD_CHUNKS=" << runtime_cfg.aoi_pad_chunks
        << ", CAMERA_MSG_MAX_HZ=" << runtime_cfg.camera_msg_max_hz
+       << ", WS_WRITER_THREADS=" << runtime_cfg.ws_writer_threads
+       << ", WS_SEND_THREADS=" << runtime_cfg.ws_send_threads
+       << ", WS_MAX_PENDING_EVENTS=" << runtime_cfg.ws_max_pending_events
+       << ", WS_SLOW_CONSUMER_MS=" << runtime_cfg.ws_slow_consumer_ms
+       << ", ECONOMY_BROADCAST_MS=" << runtime_cfg.economy_broadcast_ms
+       << ", USER_CACHE_TTL_MS=" << runtime_cfg.user_cache_ttl_ms
+       << ", USER_CACHE_MAX_ENTRIES=" << runtime_cfg.user_cache_max_entries
+       << ", SESSION_TTL_SECONDS=" << runtime_cfg.session_ttl_seconds
+       << ", SESSION_SHARDS=" << runtime_cfg.session_shards
+       << ", STATIC_MMAP_THRESHOLD_BYTES=" << runtime_cfg.static_mmap_threshold_bytes
+       << ", STATIC_CACHE_MAX_AGE_SECONDS=" << runtime_cfg.static_cache_max_age_seconds
+       << ", AUTH_TOKEN_TTL_SECONDS=" << runtime_cfg.auth_token_ttl_seconds
        << ", MAX_BORROW_PER_CALL=" << runtime_cfg.max_borrow_per_call
        << ", FOOD_REWARD_CELLS=" << runtime_cfg.food_reward_cells
        << ", RESIZE_THRESHOLD=" << runtime_cfg.resize_threshold
@@ -1318,12 +1428,42 @@ int main(int argc, char** argv) {
        << ", PERSISTENCE_PROFILE=" << runtime_cfg.persistence_profile
        << ", PERSISTENCE_SQLITE_PATH=" << runtime_cfg.persistence_sqlite_path
        << ", GOOGLE_AUTH_ENABLED=" << (runtime_cfg.google_auth_enabled ? "true" : "false")
+       << ", GOOGLE_JWKS=" << (runtime_cfg.google_jwks_file.empty() ? runtime_cfg.google_jwks_url : runtime_cfg.google_jwks_file)
+       << ", GOOGLE_JWKS_REFRESH_SECONDS=" << runtime_cfg.google_jwks_refresh_seconds
+       << ", FLIGHT_RECORDER_DIR=" << runtime_cfg.flight_recorder_dir
+       << ", FLIGHT_RECORDER_SLOW_TICK_MS=" << runtime_cfg.flight_recorder_slow_tick_ms
+       << ", FLIGHT_RECORDER_MAX_CAPTURES=" << runtime_cfg.flight_recorder_max_captures
+       << ", ECONOMY_RECONCILE_SECONDS=" << runtime_cfg.economy_reconcile_seconds
+       << ", ECONOMY_FINALIZE_THREADS=" << runtime_cfg.economy_finalize_threads
+       << ", ECONOMY_USER_CACHE_ENTRIES=" << runtime_cfg.economy_user_cache_entries
+       << ", ECONOMY_HISTORY_DIR=" << runtime_cfg.economy_history_dir
+       << ", LEADERBOARD_APPLY_MS=" << runtime_cfg.leaderboard_apply_ms
+       << ", CELL_LEDGER_COMMIT_MS=" << runtime_cfg.cell_ledger_commit_ms
+       << ", CELL_LEDGER_WAIT_MS=" << runtime_cfg.cell_ledger_wait_ms
        << ", STARTER_LIQUID_ASSETS=" << runtime_cfg.starter_liquid_assets
        << ", SEED_ENABLED=" << (runtime_cfg.seed_enabled ? "true" : "false")
        << ", SEED_CONFIG_PATH=" << runtime_cfg.seed_config_path
        << ", APP_ENV=" << runtime_cfg.app_env
        << "\n";
 
+  // Signed session tokens; AUTH_TOKEN_SECRET must be the same on every instance
+  // so tokens survive restarts and verify behind the load balancer. Only local
+  // and dev runs may fall back to a random per-process secret.
+  string auth_token_secret = []() {
+    const char* v = std::getenv("AUTH_TOKEN_SECRET");
+    return (v && *v) ? std::string(v) : std::string{};
+  }();
+  if (auth_token_secret.empty()) {
+    if (runtime_cfg.app_env != "local" && runtime_cfg.app_env != "dev") {
+      cerr << "AUTH_TOKEN_SECRET is required when APP_ENV=" << runtime_cfg.app_env << "\n";
+      Aws::ShutdownAPI(aws_options);
+      return 1;
+    }
+    auth_token_secret = auth::SessionTokens::RandomSecret();
+    cerr << "[auth] AUTH_TOKEN_SECRET not set; using a random per-process secret "
+         << "(tokens are lost on restart and rejected by other instances)\n";
+  }
+
   unique_ptr<storage::IStorage> storage;
   try {
     storage = storage::CreateStorageFromEnv();
@@ -1338,6 +1478,22 @@ int main(int argc, char** argv) {
     Aws::ShutdownAPI(aws_options);
     return 1;
   }
+  auto cached_storage = make_unique<storage::UserCacheStorage>(
+      std::move(storage), chrono::milliseconds(runtime_cfg.user_cache_ttl_ms),
+      static_cast<size_t>(runtime_cfg.user_cache_max_entries));
+  storage::UserCacheStorage* user_cache = cached_storage.get();
+  storage = std::move(cached_storage);
+  // Declared before the persistence stack so it outlives every writer that
+  // reports through the cache.
+  economy::EconomyAggregates economy_aggregates;
+  user_cache->AddWriteListener(&economy_aggregates);
+  // Same lifetime rule; the listener keeps live ledger balances in step with
+  // food credits and settlements the persistence flush writes directly.
+  economy::CellLedger::Options cell_ledger_options;
+  cell_ledger_options.commit_interval = chrono::milliseconds(runtime_cfg.cell_ledger_commit_ms);
+  economy::CellLedger cell_ledger(*storage, cell_ledger_options);
+  user_cache->AddWriteListener(&cell_ledger);
+  using Ledger = economy::CellLedger;
 
   // Ensure an active economy policy row exists for read/write paths and CLI tooling.
   if (!storage->GetEconomyParamsActive().has_value()) {
@@ -1377,13 +1533,33 @@ int main(int argc, char** argv) {
   game.set_duel_delay_ticks(runtime_cfg.tick_hz);
   game.set_aoi_pad_chunks(runtime_cfg.aoi_pad_chunks);
   game.configure_mask(runtime_cfg.world_mask_mode, runtime_cfg.world_mask_seed, runtime_cfg.world_mask_style);
-  EconomyService economy(*storage, runtime_cfg);
+  economy_aggregates.Reconcile(*storage);
+  economy::EconomyHistoryStore economy_history({runtime_cfg.economy_history_dir,
+                                               runtime_cfg.economy_period_history_days});
+  EconomyService economy(*storage, economy_aggregates, economy_history, runtime_cfg);
   SystemMessageBus system_message_bus;
   game.load_from_storage_or_seed_positions();
   {
     const auto eco = economy.GetState();
     game.set_playable_cell_target(economy_world_area(eco.params, eco.global));
   }
+  const economy::PeriodConfig economy_period_cfg{std::max(60, runtime_cfg.econ_period_seconds),
+                                                 runtime_cfg.econ_period_align};
+  leaderboard::LeaderboardService leaderboard(economy_period_cfg,
+                                              chrono::milliseconds(runtime_cfg.leaderboard_apply_ms));
+  {
+    const auto ps = economy::CurrentPeriodState(std::time(nullptr), economy_period_cfg);
+    vector<pair<int, int64_t>> output_by_user;
+    for (const auto& row : storage->ListEconomyPeriodUsers(ps.period_id)) {
+      const int64_t y = row.user_real_output > 0 ? row.user_real_output : row.user_harvested_food;
+      output_by_user.emplace_back(atoi(row.user_id.c_str()), y);
+    }
+    leaderboard.Seed(game.leaderboard_snakes(), ps.period_id, output_by_user);
+    game.set_leaderboard(&leaderboard);
+    leaderboard.Start();
+  }
+  cell_ledger.Start([&](const std::vector<std::string>& user_ids) { economy.OnBalancesCommitted(user_ids); });
+  const auto cell_ledger_wait = chrono::milliseconds(runtime_cfg.cell_ledger_wait_ms);
   game.flush_persistence_delta();
   persistence_coordinator.FlushNow();
 
@@ -1417,7 +1593,7 @@ int main(int argc, char** argv) {
     (void)dedupe_key;
     system_message_bus.Publish(level, text);
   };
-  stabilization_actions.current_world_snapshot = [&]() { return game.snapshot(); };
+  stabilization_actions.current_spatial_metrics = [&]() { return game.spatial_metrics(); };
   economy.SetStabilizationActions(std::move(stabilization_actions));
 
   if (mode == "reset") {
@@ -1438,12 +1614,11 @@ int main(int argc, char** argv) {
     Aws::ShutdownAPI(aws_options);
     return 1;
   }
+  economy_aggregates.StartReconciler(*storage, chrono::seconds(runtime_cfg.economy_reconcile_seconds));
 
   atomic<bool> running{true};
-  mutex snapshot_mu;
-  uint64_t snapshot_seq = 1;
-  mutex sessions_mu;
-  unordered_map<string, ClientSession> sessions;
+  realtime::SnapshotFeed snapshot_feed;
+  realtime::SessionRegistry sessions(static_cast<size_t>(runtime_cfg.session_shards));
   mutex public_view_mu;
   PublicViewState public_view;
   unordered_map<long long, int> public_activity_scores;
@@ -1472,6 +1647,17 @@ int main(int argc, char** argv) {
   signal(SIGUSR1, on_reload_signal);
   signal(SIGHUP, on_reload_signal);
 
+  realtime::SendPool ws_send_pool(runtime_cfg.ws_send_threads);
+  realtime::VersionedPayload economy_world_payload;
+  realtime::BroadcastHub ws_hub(runtime_cfg.ws_writer_threads);
+  // New system messages go out on the next writer pass instead of a 250 ms poll.
+  system_message_bus.SetOnPublish([&] { ws_hub.Publish(); });
+
+  diagnostics::FlightRecorder::Options flight_opts;
+  flight_opts.dir = runtime_cfg.flight_recorder_dir;
+  flight_opts.max_captures = static_cast<size_t>(runtime_cfg.flight_recorder_max_captures);
+  diagnostics::FlightRecorder flight_recorder(flight_opts);
+
   thread loop([&] {
     using clock = chrono::steady_clock;
     using ms = chrono::milliseconds;
@@ -1488,43 +1674,72 @@ int main(int argc, char** argv) {
     uint64_t broadcasts_since_log = 0;
     auto next_log_at = clock::now() + chrono::seconds(5);
     auto last_food_debug_log_at = clock::now() - chrono::seconds(10);
+    const uint64_t session_ttl_ms = static_cast<uint64_t>(runtime_cfg.session_ttl_seconds) * 1000;
+    auto next_session_sweep_at = clock::now() + chrono::seconds(10);
+
+    auto& tracer = diagnostics::DefaultTracer();
+    tracer.SetThreadName("tick");
+    auto& reg = metrics::Default();
+    const auto phase_histogram = [&](const char* phase) -> metrics::Histogram& {
+      return reg.GetHistogram("snake_tick_phase_seconds", "Game loop time per phase (per tick; stabilization per loop pass).",
+                              {{"phase", phase}}, metrics::Histogram::kSeconds);
+    };
+    auto& phase_world = phase_histogram("world");
+    auto& phase_persistence = phase_histogram("persistence_delta");
+    auto& phase_economy = phase_histogram("economy");
+    auto& phase_public_view = phase_histogram("public_view");
+    auto& phase_total = phase_histogram("total");
+    auto& phase_stabilization = phase_histogram("stabilization");
+    auto& ticks_total = reg.GetCounter("snake_ticks_total", "Game ticks executed.");
+    auto& catch_up_ticks_total =
+        reg.GetCounter("snake_tick_catch_up_total", "Extra ticks run back-to-back to catch up with the schedule.");
+    auto& lag_dropped_ticks_total =
+        reg.GetCounter("snake_tick_lag_dropped_total", "Ticks skipped when the loop fell more than 5 ticks behind.");
+    auto& broadcasts_total = reg.GetCounter("snake_broadcasts_total", "Broadcast passes published to WS/SSE.");
+    const auto seconds_between = [](clock::time_point a, clock::time_point b) {
+      return chrono::duration<double>(b - a).count();
+    };
+    array<metrics::Histogram*, world::TickProfile::kPhaseCount> world_phase_hists{};
+    for (int p = 0; p < world::TickProfile::kPhaseCount; ++p) {
+      world_phase_hists[static_cast<size_t>(p)] =
+          &reg.GetHistogram("snake_world_tick_phase_seconds", "World::Tick time per simulation phase.",
+                            {{"phase", world::TickProfile::PhaseName(p)}}, metrics::Histogram::kSeconds);
+    }
+    const double slow_tick_s = static_cast<double>(runtime_cfg.flight_recorder_slow_tick_ms) / 1000.0;
+    const auto ms_between = [&](clock::time_point a, clock::time_point b) { return seconds_between(a, b) * 1000.0; };
 
     while (running.load()) {
       if (g_reload_requested) {
         g_reload_requested = 0;
         game.load_from_storage_or_seed_positions();
-        {
-          lock_guard<mutex> lock(snapshot_mu);
-          ++snapshot_seq;
-        }
+        leaderboard.Seed(game.leaderboard_snakes(), "", {});
+        snapshot_feed.Publish();
       }
 
       auto now = clock::now();
 
       int catch_up_ticks = 0;
       while (now >= next_tick && catch_up_ticks < max_catch_up_ticks) {
+        const auto tick_start = clock::now();
         game.tick();
+        const auto world_done = clock::now();
         const auto activity = game.flush_persistence_delta_and_credit_food(runtime_cfg.food_reward_cells);
-        const bool has_food_activity = activity.harvested_food > 0;
-        EconomyService::Snapshot eco_before_food;
-        if (has_food_activity) {
-          eco_before_food = economy.GetState();
-        }
+        const auto persistence_done = clock::now();
         economy.OnActivity(activity);
-        if (has_food_activity && (clock::now() - last_food_debug_log_at) >= chrono::seconds(2)) {
-          const auto eco_after_food = economy.GetState();
+        if (activity.harvested_food > 0 && (clock::now() - last_food_debug_log_at) >= chrono::seconds(2)) {
+          // Deltas reach storage on the economy flush worker, so this shows the
+          // last flushed state (usually a cached snapshot).
+          const auto eco = economy.GetState();
           std::cerr << "[food] harvested=" << activity.harvested_food
                     << " users_with_harvest=" << activity.harvested_food_by_user.size()
-                    << " money_supply_before=" << eco_before_food.global.m
-                    << " money_supply_after=" << eco_after_food.global.m
-                    << " treasury_before=" << eco_before_food.global.treasury_balance
-                    << " treasury_after=" << eco_after_food.global.treasury_balance
-                    << " output_before=" << eco_before_food.global.y
-                    << " output_after=" << eco_after_food.global.y << "\n";
+                    << " money_supply=" << eco.global.m
+                    << " treasury=" << eco.global.treasury_balance
+                    << " output=" << eco.global.y << "\n";
           last_food_debug_log_at = clock::now();
         }
         ++ticks_since_log;
         ++catch_up_ticks;
+        const auto economy_done = clock::now();
         if (runtime_cfg.public_view_enabled) {
           const auto snap = game.snapshot();
           {
@@ -1563,27 +1778,111 @@ int main(int argc, char** argv) {
         }
         next_tick += tick_dt;
         now = clock::now();
+        phase_world.Observe(seconds_between(tick_start, world_done));
+        phase_persistence.Observe(seconds_between(world_done, persistence_done));
+        phase_economy.Observe(seconds_between(persistence_done, economy_done));
+        phase_public_view.Observe(seconds_between(economy_done, now));
+        const double tick_seconds = seconds_between(tick_start, now);
+        phase_total.Observe(tick_seconds);
+        ticks_total.Inc();
+        const auto profile = game.last_tick_profile();
+        for (int p = 0; p < world::TickProfile::kPhaseCount; ++p) {
+          world_phase_hists[static_cast<size_t>(p)]->Observe(static_cast<double>(profile.phase_ns[static_cast<size_t>(p)]) / 1e9);
+        }
+        if (tracer.active()) {
+          // Spans rebuilt from the timestamps above; world phases run back to back.
+          const int64_t tick_start_ns = diagnostics::Tracer::ToNs(tick_start);
+          tracer.Record("loop", "tick", tick_start_ns, diagnostics::Tracer::ToNs(now));
+          tracer.Record("loop", "world", tick_start_ns, diagnostics::Tracer::ToNs(world_done));
+          int64_t phase_start_ns = tick_start_ns;
+          for (int p = 0; p < world::TickProfile::kPhaseCount; ++p) {
+            const int64_t phase_end_ns = phase_start_ns + profile.phase_ns[static_cast<size_t>(p)];
+            tracer.Record("world", world::TickProfile::PhaseName(p), phase_start_ns, phase_end_ns);
+            phase_start_ns = phase_end_ns;
+          }
+          tracer.Record("loop", "persistence_delta", diagnostics::Tracer::ToNs(world_done),
+                        diagnostics::Tracer::ToNs(persistence_done));
+          tracer.Record("loop", "economy", diagnostics::Tracer::ToNs(persistence_done),
+                        diagnostics::Tracer::ToNs(economy_done));
+          tracer.Record("loop", "public_view", diagnostics::Tracer::ToNs(economy_done), diagnostics::Tracer::ToNs(now));
+        }
+        // Capture what the slow tick ran against: timings, counts and the
+        // post-tick world plus the input batch it consumed. Writing happens on
+        // the recorder thread.
+        const int64_t captured_at_ms = wall_ms();
+        if (tick_seconds >= slow_tick_s && flight_recorder.TryBegin(captured_at_ms)) {
+          string body = game.encode_binary_snapshot();
+          const string id = "slowtick-" + to_string(captured_at_ms) + "-" + to_string(profile.tick);
+          protocol::JsonWriter summary;
+          summary.BeginObject();
+          summary.Field("id", id);
+          summary.Field("tick", profile.tick);
+          summary.Field("created_ms", captured_at_ms);
+          summary.Field("threshold_ms", runtime_cfg.flight_recorder_slow_tick_ms);
+          summary.Field("total_ms", tick_seconds * 1000.0);
+          summary.Field("catch_up_index", catch_up_ticks - 1);
+          summary.Key("loop_phases_ms").BeginObject();
+          summary.Field("world", ms_between(tick_start, world_done));
+          summary.Field("persistence_delta", ms_between(world_done, persistence_done));
+          summary.Field("economy", ms_between(persistence_done, economy_done));
+          summary.Field("public_view", ms_between(economy_done, now));
+          summary.EndObject();
+          summary.Key("world_phases_ms").BeginObject();
+          for (int p = 0; p < world::TickProfile::kPhaseCount; ++p) {
+            summary.Field(world::TickProfile::PhaseName(p),
+                          static_cast<double>(profile.phase_ns[static_cast<size_t>(p)]) / 1e6);
+          }
+          summary.EndObject();
+          summary.Key("counts").BeginObject();
+          summary.Field("snakes", profile.snakes);
+          summary.Field("alive_snakes", profile.alive_snakes);
+          summary.Field("body_cells", profile.body_cells);
+          summary.Field("foods", profile.foods);
+          summary.Field("inputs", profile.inputs);
+          summary.Field("events", profile.events);
+          summary.EndObject();
+          summary.Field("snapshot_bytes", body.size());
+          summary.EndObject();
+          flight_recorder.Submit(id, captured_at_ms, summary.str(), std::move(body));
+        }
       }
+      if (catch_up_ticks > 1) catch_up_ticks_total.Inc(static_cast<uint64_t>(catch_up_ticks - 1));
 
       if ((now - next_tick) > max_lag) {
+        lag_dropped_ticks_total.Inc(static_cast<uint64_t>((now - next_tick) / tick_dt));
         next_tick = now + tick_dt;
       }
 
-      while (runtime_cfg.enable_broadcast && now >= next_broadcast) {
-        {
-          lock_guard<mutex> lock(snapshot_mu);
-          ++snapshot_seq;
-        }
+      bool broadcast_due = false;
+      while (now >= next_broadcast) {
+        broadcast_due = true;
         ++broadcasts_since_log;
+        broadcasts_total.Inc();
         next_broadcast += spectator_dt;
         now = clock::now();
       }
+      if (broadcast_due) {
+        diagnostics::TraceSpan span("loop", "publish");
+        if (runtime_cfg.enable_broadcast) snapshot_feed.Publish();
+        ws_hub.Publish();
+      }
 
       if ((now - next_broadcast) > (spectator_dt * 5)) {
         next_broadcast = now + spectator_dt;
       }
 
-      economy.TickStabilization();
+      {
+        metrics::ScopedTimer stabilization_timer(phase_stabilization);
+        diagnostics::TraceSpan span("loop", "stabilization");
+        economy.TickStabilization();
+      }
+
+      if (now >= next_session_sweep_at) {
+        // SSE/camera sessions have no close event; idle ones age out here.
+        const size_t evicted = sessions.EvictIdle(now_ms(), session_ttl_ms);
+        if (evicted > 0 && runtime_cfg.debug_tps) cout << "[sessions] evicted_idle=" << evicted << "\n";
+        next_session_sweep_at = now + chrono::seconds(10);
+      }
 
       if (runtime_cfg.debug_tps && now >= next_log_at) {
         cout << "[rate] ticks/5s=" << ticks_since_log << ", broadcasts/5s=" << broadcasts_since_log << "\n";
@@ -1592,15 +1891,83 @@ int main(int argc, char** argv) {
         next_log_at += chrono::seconds(5);
       }
 
-      auto next_deadline = runtime_cfg.enable_broadcast ? min(next_tick, next_broadcast) : next_tick;
+      auto next_deadline = min(next_tick, next_broadcast);
       auto max_sleep_until = clock::now() + ms(5);
       this_thread::sleep_until(min(next_deadline, max_sleep_until));
     }
   });
 
-  AuthState auth;
+  // Encodes economy_world once per ECONOMY_BROADCAST_MS for all WS sessions and
+  // bumps its version only when something other than the countdown changed.
+  mutex economy_broadcast_mu;
+  condition_variable economy_broadcast_cv;
+  thread economy_broadcaster([&] {
+    const auto interval = chrono::milliseconds(runtime_cfg.economy_broadcast_ms);
+    while (running.load()) {
+      const auto eco = economy.GetState();
+      const std::string stabilization_status = stabilization_status_ui(eco.stabilization_runtime);
+      protocol::JsonWriter out;
+      out.BeginObject();
+      out.Field("type", "economy_world");
+      out.Field("channel", "public");
+      out.Field("period_id", eco.period_id);
+      out.Field("Y", eco.global.y);
+      out.Field("extracted_output", eco.global.y);
+      out.Field("K", eco.global.k);
+      out.Field("L", eco.global.l);
+      out.Field("alpha", eco.global.alpha);
+      out.Field("A", eco.global.a);
+      out.Field("M", eco.global.m);
+      out.Field("P", eco.global.p);
+      out.Field("pi", eco.global.pi);
+      out.Field("price_index_valid", eco.global.price_index_valid);
+      out.Field("inflation_valid", eco.global.inflation_valid);
+      out.Field("treasury_balance", eco.global.treasury_balance);
+      out.Field("field_size", eco.stabilization.field_size);
+      out.Field("free_space_on_field", eco.stabilization.free_space_on_field);
+      out.Field("system_white_space_reserve", eco.stabilization.treasury_white_space);
+      out.Field("spatial_ratio_r", eco.stabilization.spatial_ratio_r);
+      out.Field("stabilization_status", stabilization_status);
+      out.Field("snapshot_status", eco.global.snapshot_status);
+      out.Field("A_world", economy_world_area(eco.params, eco.global));
+      string change_key = out.str();
+      out.Field("period_ends_in_seconds", eco.period_ends_in_seconds);
+      out.EndObject();
+      economy_world_payload.Update(std::move(change_key), out.Take());
+
+      unique_lock<mutex> lock(economy_broadcast_mu);
+      economy_broadcast_cv.wait_for(lock, interval, [&] { return !running.load(); });
+    }
+  });
+
+  auth::SessionTokens auth(std::move(auth_token_secret), runtime_cfg.auth_token_ttl_seconds);
+  // ID tokens are verified locally against cached Google signing keys.
+  std::unique_ptr<auth::IdTokenVerifier> google_verifier;
+  if (runtime_cfg.google_auth_enabled && !runtime_cfg.google_client_id.empty()) {
+    std::unique_ptr<auth::JwksSource> jwks_source;
+    if (!runtime_cfg.google_jwks_file.empty()) {
+      jwks_source = std::make_unique<auth::FileJwksSource>(runtime_cfg.google_jwks_file);
+    } else {
+      jwks_source = std::make_unique<GoogleJwksHttpSource>(runtime_cfg.google_jwks_url);
+    }
+    auth::IdTokenVerifier::Options verifier_opts;
+    verifier_opts.refresh_seconds = runtime_cfg.google_jwks_refresh_seconds;
+    google_verifier = std::make_unique<auth::IdTokenVerifier>(std::move(jwks_source), verifier_opts);
+    google_verifier->Start();
+  }
   httplib::Server srv;
-  auto compute_subscribed_chunks_count = [&](const ClientSession&) -> int {
+
+  // Local/dev fallback static serving so http://127.0.0.1:8080 works without a reverse proxy.
+  // In prod, Caddy/Nginx static serving still takes precedence. Files are loaded and
+  // precompressed once here and again on SIGHUP, never per request.
+  web::StaticAssetCache::Options static_options;
+  static_options.files = {{"/index.html", "index.html"}};
+  static_options.dirs = {{"/src/", "src"}, {"/assets/", "assets"}};
+  static_options.mmap_threshold_bytes = static_cast<size_t>(runtime_cfg.static_mmap_threshold_bytes);
+  static_options.cache_control = "public, max-age=" + std::to_string(runtime_cfg.static_cache_max_age_seconds);
+  web::StaticAssetCache static_assets(std::move(static_options));
+  static_assets.Reload();
+  auto compute_subscribed_chunks_count = [&]() -> int {
     if (!runtime_cfg.aoi_enabled) return -1;  // all-entities mode
     if (runtime_cfg.single_chunk_mode) return 1;
     const int span = (runtime_cfg.auth_aoi_radius + runtime_cfg.aoi_pad_chunks) * 2 + 1;
@@ -1608,22 +1975,14 @@ int main(int argc, char** argv) {
   };
 
   auto get_or_create_session = [&](const string& sid) {
-    lock_guard<mutex> lock(sessions_mu);
-    auto it = sessions.find(sid);
-    if (it == sessions.end()) {
-      ClientSession s;
-      s.session_id = sid;
-      s.camera_x = grid_w / 2;
-      s.camera_y = grid_h / 2;
-      s.camera_zoom = 1.0;
-      s.subscribed_chunks_count = compute_subscribed_chunks_count(s);
-      s.updated_at_ms = now_ms();
-      it = sessions.emplace(sid, s).first;
-    }
-    return it->second;
+    return sessions.GetOrCreate(sid, now_ms(), [&](realtime::SessionState& s) {
+      s.SetCamera({grid_w / 2, grid_h / 2, 1.0});
+      s.subscribed_chunks_count.store(compute_subscribed_chunks_count(), std::memory_order_relaxed);
+    });
   };
 
   srv.set_pre_routing_handler([&](const httplib::Request& req, httplib::Response& res) {
+    g_http_span_start_ns = diagnostics::DefaultTracer().active() ? diagnostics::Tracer::NowNs() : 0;
     const auto upgrade = req.get_header_value("Upgrade");
     const bool is_ws_upgrade = !upgrade.empty() &&
                                std::equal(upgrade.begin(), upgrade.end(), "websocket",
@@ -1638,343 +1997,393 @@ int main(int argc, char** argv) {
     }
     return httplib::Server::HandlerResponse::Unhandled;
   });
+  // Runs after the handler, before the response is written.
+  srv.set_post_routing_handler([&](const httplib::Request& req, httplib::Response&) {
+    if (g_http_span_start_ns == 0) return;
+    auto& tracer = diagnostics::DefaultTracer();
+    const string route = req.matched_route.empty() ? string("(unmatched)") : req.matched_route;
+    tracer.Record("http", tracer.Intern(req.method + " " + route), g_http_span_start_ns, diagnostics::Tracer::NowNs());
+    g_http_span_start_ns = 0;
+  });
 
-  srv.WebSocket("/ws", [&](const httplib::Request& req, httplib::ws::WebSocket& ws) {
-    (void)req;
-    const string sid = rand_token(16);
-    {
-      lock_guard<mutex> lock(sessions_mu);
-      ClientSession s;
-      s.session_id = sid;
-      s.camera_x = grid_w / 2;
-      s.camera_y = grid_h / 2;
-      s.camera_zoom = 1.0;
-      s.is_watcher = true;
-      s.subscribed_chunks_count = compute_subscribed_chunks_count(s);
-      s.updated_at_ms = now_ms();
-      sessions[sid] = s;
-    }
-
-    atomic<bool> alive{true};
-    thread reader([&] {
-      while (alive.load() && ws.is_open()) {
-        string msg;
-        auto rr = ws.read(msg);
-        if (rr != httplib::ws::Text) break;
-
-        auto type = get_json_string_field(msg, "type");
-        if (!type) continue;
-
-        if (*type == "auth") {
-          auto token = get_json_string_field(msg, "token");
-          if (!token || token->empty()) {
-            ws.send("{\"type\":\"auth_ack\",\"channel\":\"private\",\"ok\":false}");
-            continue;
-          }
-          auto uid = auth.token_to_user(*token);
-          if (!uid) {
-            ws.send("{\"type\":\"auth_ack\",\"channel\":\"private\",\"ok\":false}");
-            continue;
-          }
-          {
-            lock_guard<mutex> lock(sessions_mu);
-            auto it = sessions.find(sid);
-            if (it != sessions.end()) {
-              it->second.auth_user_id = *uid;
-              it->second.is_watcher = false;
-              it->second.updated_at_ms = now_ms();
-            }
-          }
-          ws.send("{\"type\":\"auth_ack\",\"channel\":\"private\",\"ok\":true}");
-          continue;
-        }
-
-        ClientSession session = get_or_create_session(sid);
-        if (!session.auth_user_id.has_value()) continue;
-
-        if (*type == "input") {
-          auto snake_id = get_json_int_field(msg, "snake_id");
-          auto dir = get_json_string_field(msg, "dir");
-          auto pause_toggle = get_json_bool_field(msg, "pause_toggle");
-          if (snake_id && dir) {
-            int d = 0;
-            if (*dir == "L") d = 1;
-            else if (*dir == "R") d = 2;
-            else if (*dir == "U") d = 3;
-            else if (*dir == "D") d = 4;
-            if (d >= 1 && d <= 4) {
-              game.set_snake_dir(*session.auth_user_id, *snake_id, static_cast<world::Dir>(d));
-            }
-          }
-          if (snake_id && pause_toggle && *pause_toggle) {
-            game.toggle_snake_pause(*session.auth_user_id, *snake_id);
-          }
-          continue;
-        }
+  const realtime::SendQueueLimits ws_send_limits{static_cast<size_t>(runtime_cfg.ws_max_pending_events),
+                                                 runtime_cfg.ws_slow_consumer_ms};
+  auto disconnect_slow_consumer = [&](WsConnection& c, realtime::Channel ch) {
+    if (c.out->closed()) return;  // send already failed; the reader sees the dead socket
+    realtime::RecordSlowDisconnect(ch);
+    c.out->Close();
+    const bool shut = realtime::ShutdownSocket(c.socket_fd);
+    cerr << "[ws] slow consumer disconnected sid=" << c.sid << " channel=" << realtime::ChannelName(ch)
+         << " socket_shutdown=" << (shut ? "true" : "false") << "\n";
+  };
 
-        if (*type == "camera_set") {
-          auto x = get_json_int_field(msg, "x");
-          auto y = get_json_int_field(msg, "y");
-          auto zoom = get_json_double_field(msg, "zoom");
-          if (!x || !y) continue;
-          const uint64_t now_millis = now_ms();
-          const uint64_t min_gap = static_cast<uint64_t>(
-              max(1, static_cast<int>(std::lround(1000.0 / static_cast<double>(runtime_cfg.camera_msg_max_hz)))));
-          if (session.last_camera_update_ms != 0 && now_millis - session.last_camera_update_ms < min_gap) continue;
-          session.camera_x = max(0, min(game.snapshot().w - 1, *x));
-          session.camera_y = max(0, min(game.snapshot().h - 1, *y));
-          if (zoom) session.camera_zoom = max(0.25, min(4.0, *zoom));
-          auto follow_id = get_json_int_field(msg, "follow_snake_id");
-          if (follow_id && *follow_id > 0) session.watched_snake_id = *follow_id;
-          session.subscribed_chunks_count = compute_subscribed_chunks_count(session);
-          session.last_camera_update_ms = now_millis;
-          session.updated_at_ms = now_millis;
-          lock_guard<mutex> lock(sessions_mu);
-          sessions[sid] = session;
+  std::array<metrics::Histogram*, realtime::kChannelCount> snapshot_encode_seconds{};
+  std::array<metrics::Histogram*, realtime::kChannelCount> snapshot_encode_bytes{};
+  for (const auto ch : {realtime::Channel::kPublic, realtime::Channel::kPrivate}) {
+    const metrics::Labels labels = {{"channel", realtime::ChannelName(ch)}};
+    snapshot_encode_seconds[static_cast<size_t>(ch)] = &metrics::Default().GetHistogram(
+        "snake_snapshot_encode_seconds", "World snapshot build+encode time per frame.", labels, metrics::Histogram::kSeconds);
+    snapshot_encode_bytes[static_cast<size_t>(ch)] = &metrics::Default().GetHistogram(
+        "snake_snapshot_encode_bytes", "Encoded world snapshot frame size.", labels, metrics::Histogram::kBytes);
+  }
+  auto& sse_encode_seconds = metrics::Default().GetHistogram(
+      "snake_snapshot_encode_seconds", "World snapshot build+encode time per frame.", {{"channel", "sse"}},
+      metrics::Histogram::kSeconds);
+  auto& sse_encode_bytes = metrics::Default().GetHistogram(
+      "snake_snapshot_encode_bytes", "Encoded world snapshot frame size.", {{"channel", "sse"}}, metrics::Histogram::kBytes);
+
+  ws_hub.Start([&](realtime::Subscriber& sub, uint64_t) {
+    auto& c = static_cast<WsConnection&>(sub);
+    if (!c.ws->is_open() || c.out->closed()) return false;
+    const realtime::SessionState& session = *c.session;
+    const auto auth_uid = session.auth_user_id();
+    const bool is_auth = auth_uid.has_value();
+    const auto session_channel = is_auth ? realtime::Channel::kPrivate : realtime::Channel::kPublic;
+    const int hz = is_auth ? runtime_cfg.auth_spectator_hz : runtime_cfg.public_spectator_hz;
+    const auto world_dt = chrono::milliseconds(max(1, static_cast<int>(std::lround(1000.0 / static_cast<double>(hz)))));
+
+    auto now = chrono::steady_clock::now();
+    if (now >= c.next_world_send) {
+      world::WorldSnapshot snap;
+      string channel = "public";
+      int cam_x = 0;
+      int cam_y = 0;
+      int aoi_radius = runtime_cfg.public_aoi_radius;
+      string mode = "PUBLIC";
+      const int padded_public_radius = aoi_radius + runtime_cfg.aoi_pad_chunks;
+      int aoi_chunks = runtime_cfg.single_chunk_mode ? 1 : (padded_public_radius * 2 + 1) * (padded_public_radius * 2 + 1);
+      int public_chunk_cx = 0;
+      int public_chunk_cy = 0;
+
+      const auto camera = session.camera();
+      if (is_auth) {
+        channel = "private";
+        mode = "AUTH";
+        cam_x = camera.x;
+        cam_y = camera.y;
+        aoi_radius = runtime_cfg.auth_aoi_radius;
+        aoi_chunks = compute_subscribed_chunks_count();
+      } else {
+        PublicViewState pv;
+        {
+          lock_guard<mutex> lock(public_view_mu);
+          pv = public_view;
         }
-
-        if (*type == "public_camera_init") {
-          // Spectator one-shot init: accepts only from unauthenticated sessions.
-          if (session.auth_user_id.has_value()) continue;
-          auto x = get_json_int_field(msg, "x");
-          auto y = get_json_int_field(msg, "y");
-          if (!x || !y) continue;
-          const auto snap = game.snapshot();
-          const int cx = max(0, min(snap.w - 1, *x));
-          const int cy = max(0, min(snap.h - 1, *y));
+        if (!pv.initialized) {
+          const auto world_snap = game.snapshot();
+          const int cx = std::max(0, world_snap.w / 2);
+          const int cy = std::max(0, world_snap.h / 2);
           const auto chunk = game.coord_to_chunk(cx, cy);
           {
             lock_guard<mutex> lock(public_view_mu);
-            if (!public_view.initialized) {
-              public_view.camera_x = cx;
-              public_view.camera_y = cy;
-              public_view.chunk_cx = chunk.cx;
-              public_view.chunk_cy = chunk.cy;
-              public_view.initialized = true;
-            }
+            public_view.camera_x = cx;
+            public_view.camera_y = cy;
+            public_view.chunk_cx = chunk.cx;
+            public_view.chunk_cy = chunk.cy;
+            public_view.initialized = true;
+            pv = public_view;
           }
-          continue;
         }
+        cam_x = pv.camera_x;
+        cam_y = pv.camera_y;
+        public_chunk_cx = pv.chunk_cx;
+        public_chunk_cy = pv.chunk_cy;
       }
-      alive.store(false);
-    });
 
-    auto next_world_send = chrono::steady_clock::now();
-    auto next_economy_send = chrono::steady_clock::now();
-    auto next_private_send = chrono::steady_clock::now();
-    auto next_system_send = chrono::steady_clock::now();
-    uint64_t last_system_message_id = 0;
-
-    while (alive.load() && ws.is_open()) {
-      ClientSession session = get_or_create_session(sid);
-      const bool is_auth = session.auth_user_id.has_value();
-      const int hz = is_auth ? runtime_cfg.auth_spectator_hz : runtime_cfg.public_spectator_hz;
-      const auto world_dt = chrono::milliseconds(max(1, static_cast<int>(std::lround(1000.0 / static_cast<double>(hz)))));
-
-      auto now = chrono::steady_clock::now();
-      if (now >= next_world_send) {
-        world::WorldSnapshot snap;
-        string channel = "public";
-        int cam_x = 0;
-        int cam_y = 0;
-        int aoi_radius = runtime_cfg.public_aoi_radius;
-        string mode = "PUBLIC";
-        const int padded_public_radius = aoi_radius + runtime_cfg.aoi_pad_chunks;
-        int aoi_chunks = runtime_cfg.single_chunk_mode ? 1 : (padded_public_radius * 2 + 1) * (padded_public_radius * 2 + 1);
-        int public_chunk_cx = 0;
-        int public_chunk_cy = 0;
-
-        if (is_auth) {
-          channel = "private";
-          mode = "AUTH";
-          cam_x = session.camera_x;
-          cam_y = session.camera_y;
-          aoi_radius = runtime_cfg.auth_aoi_radius;
-          aoi_chunks = compute_subscribed_chunks_count(session);
+      const auto encode_start = chrono::steady_clock::now();
+      snap = game.snapshot_for_camera(cam_x, cam_y, runtime_cfg.aoi_enabled, aoi_radius, runtime_cfg.debug_tps);
+      int aoi_min_x = 0;
+      int aoi_max_x = 0;
+      int aoi_min_y = 0;
+      int aoi_max_y = 0;
+      int cam_chunk_x = 0;
+      int cam_chunk_y = 0;
+      int effective_radius = std::max(0, aoi_radius + runtime_cfg.aoi_pad_chunks);
+      if (!runtime_cfg.single_chunk_mode) {
+        const int cs = std::max(1, runtime_cfg.chunk_size);
+        const int chunks_x = std::max(1, (snap.w + cs - 1) / cs);
+        const int chunks_y = std::max(1, (snap.h + cs - 1) / cs);
+        cam_chunk_x = std::max(0, std::min(chunks_x - 1, cam_x / cs));
+        cam_chunk_y = std::max(0, std::min(chunks_y - 1, cam_y / cs));
+        if (!runtime_cfg.aoi_enabled) {
+          aoi_min_x = 0;
+          aoi_max_x = chunks_x - 1;
+          aoi_min_y = 0;
+          aoi_max_y = chunks_y - 1;
         } else {
-          PublicViewState pv;
-          {
-            lock_guard<mutex> lock(public_view_mu);
-            pv = public_view;
-          }
-          if (!pv.initialized) {
-            const auto world_snap = game.snapshot();
-            const int cx = std::max(0, world_snap.w / 2);
-            const int cy = std::max(0, world_snap.h / 2);
-            const auto chunk = game.coord_to_chunk(cx, cy);
-            {
-              lock_guard<mutex> lock(public_view_mu);
-              public_view.camera_x = cx;
-              public_view.camera_y = cy;
-              public_view.chunk_cx = chunk.cx;
-              public_view.chunk_cy = chunk.cy;
-              public_view.initialized = true;
-              pv = public_view;
-            }
-          }
-          cam_x = pv.camera_x;
-          cam_y = pv.camera_y;
-          public_chunk_cx = pv.chunk_cx;
-          public_chunk_cy = pv.chunk_cy;
+          aoi_min_x = std::max(0, cam_chunk_x - effective_radius);
+          aoi_max_x = std::min(chunks_x - 1, cam_chunk_x + effective_radius);
+          aoi_min_y = std::max(0, cam_chunk_y - effective_radius);
+          aoi_max_y = std::min(chunks_y - 1, cam_chunk_y + effective_radius);
         }
+      }
+
+      protocol::JsonWriter out(4096);
+      out.BeginObject();
+      out.Field("type", "world_snapshot");
+      out.Field("channel", channel);
+      out.Field("mode", mode);
+      out.Key("camera").BeginObject();
+      out.Field("x", cam_x).Field("y", cam_y).Field("zoom", camera.zoom);
+      out.EndObject();
+      out.Key("aoi").BeginObject();
+      out.Field("min_chunk_x", aoi_min_x);
+      out.Field("max_chunk_x", aoi_max_x);
+      out.Field("min_chunk_y", aoi_min_y);
+      out.Field("max_chunk_y", aoi_max_y);
+      out.Field("camera_chunk_x", cam_chunk_x);
+      out.Field("camera_chunk_y", cam_chunk_y);
+      out.Field("radius", aoi_radius);
+      out.Field("effective_radius", effective_radius);
+      out.EndObject();
+      out.Field("aoi_chunks", aoi_chunks);
+      out.Key("public_camera_chunk").BeginObject();
+      out.Field("cx", public_chunk_cx).Field("cy", public_chunk_cy);
+      out.EndObject();
+      out.Field("chunk_size", runtime_cfg.chunk_size);
+      out.Key("mask").BeginObject();
+      out.Field("mode", snap.mask_mode);
+      out.Field("style", snap.mask_style);
+      out.Field("seed", snap.mask_seed);
+      out.Field("playable_cells", snap.playable_cells);
+      out.Field("unplayable_cells", snap.unplayable_cells);
+      out.EndObject();
+      out.Key("snapshot");
+      protocol::encode_snapshot_json(out, to_protocol_snapshot(snap));
+      out.EndObject();
+      string frame = out.Take();
+      snapshot_encode_seconds[static_cast<size_t>(session_channel)]->Observe(
+          chrono::duration<double>(chrono::steady_clock::now() - encode_start).count());
+      snapshot_encode_bytes[static_cast<size_t>(session_channel)]->Observe(static_cast<double>(frame.size()));
+      if (!c.out->PutLatest(realtime::SendQueue::Slot::kSnapshot, session_channel, std::move(frame))) {
+        disconnect_slow_consumer(c, session_channel);
+        return false;
+      }
+      // Writers wake on the broadcast grid with some jitter; a quarter-period of
+      // slack keeps the per-connection rate from aliasing down to every other tick.
+      c.next_world_send = now + world_dt - world_dt / 4;
+    }
+
+    if (const auto frame = economy_world_payload.NewerThan(c.economy_world_version)) {
+      if (!c.out->PutLatest(realtime::SendQueue::Slot::kEconomy, realtime::Channel::kPublic, frame)) {
+        disconnect_slow_consumer(c, realtime::Channel::kPublic);
+        return false;
+      }
+    }
 
-        snap = game.snapshot_for_camera(cam_x, cam_y, runtime_cfg.aoi_enabled, aoi_radius, runtime_cfg.debug_tps);
-        int aoi_min_x = 0;
-        int aoi_max_x = 0;
-        int aoi_min_y = 0;
-        int aoi_max_y = 0;
-        int cam_chunk_x = 0;
-        int cam_chunk_y = 0;
-        int effective_radius = std::max(0, aoi_radius + runtime_cfg.aoi_pad_chunks);
-        if (!runtime_cfg.single_chunk_mode) {
-          const int cs = std::max(1, runtime_cfg.chunk_size);
-          const int chunks_x = std::max(1, (snap.w + cs - 1) / cs);
-          const int chunks_y = std::max(1, (snap.h + cs - 1) / cs);
-          cam_chunk_x = std::max(0, std::min(chunks_x - 1, cam_x / cs));
-          cam_chunk_y = std::max(0, std::min(chunks_y - 1, cam_y / cs));
-          if (!runtime_cfg.aoi_enabled) {
-            aoi_min_x = 0;
-            aoi_max_x = chunks_x - 1;
-            aoi_min_y = 0;
-            aoi_max_y = chunks_y - 1;
-          } else {
-            aoi_min_x = std::max(0, cam_chunk_x - effective_radius);
-            aoi_max_x = std::min(chunks_x - 1, cam_chunk_x + effective_radius);
-            aoi_min_y = std::max(0, cam_chunk_y - effective_radius);
-            aoi_max_y = std::min(chunks_y - 1, cam_chunk_y + effective_radius);
+    const uint64_t user_version = is_auth ? user_cache->UserVersion(std::to_string(*auth_uid)) : 0;
+    const uint64_t economy_version = economy_world_payload.version();
+    const bool user_state_changed = is_auth && (c.user_state_user_id != *auth_uid ||
+                                                c.user_state_version != user_version ||
+                                                c.user_state_economy_version != economy_version);
+    if (user_state_changed && now >= c.next_private_send) {
+      const auto user = storage->GetUserById(std::to_string(*auth_uid));
+      const auto eco_user = economy.GetState(*auth_uid);
+      if (user.has_value()) {
+        const auto snakes = game.list_user_snakes(*auth_uid);
+        int64_t deployed = 0;
+        for (const auto& s : snakes) deployed += static_cast<int64_t>(s.body.size());
+        protocol::JsonWriter out;
+        out.BeginObject();
+        out.Field("type", "user_state");
+        out.Field("channel", "private");
+        out.Field("user_id", *auth_uid);
+        out.Field("balance_mi", user->balance_mi);
+        out.Field("liquid_assets", user->balance_mi);
+        out.Field("deployed_k", deployed);
+        out.Field("snake_count", snakes.size());
+        if (eco_user.user.has_value()) {
+          out.Key("economy_user").BeginObject();
+          out.Field("Y_u", eco_user.user->y_u);
+          out.Field("extracted_output_u", eco_user.user->y_u);
+          out.Field("K_u", eco_user.user->k_u);
+          out.Field("L_u", eco_user.user->l_u);
+          out.Field("alpha_u", eco_user.user->alpha_u);
+          out.Field("A_u", eco_user.user->a_u);
+          out.Field("market_share", eco_user.user->market_share);
+          out.Field("storage_balance", eco_user.user->storage_balance);
+          out.EndObject();
+        }
+        out.EndObject();
+        if (!c.out->PutLatest(realtime::SendQueue::Slot::kUserState, realtime::Channel::kPrivate, out.Take())) {
+          disconnect_slow_consumer(c, realtime::Channel::kPrivate);
+          return false;
+        }
+      }
+      c.user_state_user_id = *auth_uid;
+      c.user_state_version = user_version;
+      c.user_state_economy_version = economy_version;
+      c.next_private_send = now + chrono::seconds(1);
+    }
+
+    if (is_auth && now >= c.next_leaderboard_check && leaderboard.version() != c.leaderboard_version) {
+      c.leaderboard_version = leaderboard.version();
+      c.next_leaderboard_check = now + chrono::seconds(1);
+      array<optional<leaderboard::LeaderboardService::Row>, leaderboard::kKindCount> mine;
+      bool moved = false;
+      for (int k = 0; k < leaderboard::kKindCount; ++k) {
+        mine[static_cast<size_t>(k)] = leaderboard.RankOf(static_cast<leaderboard::Kind>(k), *auth_uid);
+        const size_t rank = mine[static_cast<size_t>(k)] ? mine[static_cast<size_t>(k)]->rank : 0;
+        moved |= rank != c.leaderboard_ranks[static_cast<size_t>(k)];
+        c.leaderboard_ranks[static_cast<size_t>(k)] = rank;
+      }
+      if (moved) {
+        protocol::JsonWriter out;
+        out.BeginObject();
+        out.Field("type", "leaderboard_rank");
+        out.Field("channel", "private");
+        out.Field("user_id", *auth_uid);
+        for (int k = 0; k < leaderboard::kKindCount; ++k) {
+          const auto& row = mine[static_cast<size_t>(k)];
+          out.Key(leaderboard::KindName(static_cast<leaderboard::Kind>(k)));
+          if (!row) {
+            out.Null();
+            continue;
           }
+          out.BeginObject();
+          out.Field("rank", row->rank);
+          out.Field("score", row->score);
+          out.EndObject();
         }
+        out.EndObject();
+        if (!c.out->PutLatest(realtime::SendQueue::Slot::kLeaderboard, realtime::Channel::kPrivate, out.Take())) {
+          disconnect_slow_consumer(c, realtime::Channel::kPrivate);
+          return false;
+        }
+      }
+    }
 
-        const string snap_json = state_to_json(snap);
-        ostringstream out;
-        out << "{"
-            << "\"type\":\"world_snapshot\","
-            << "\"channel\":\"" << channel << "\","
-            << "\"mode\":\"" << mode << "\","
-            << "\"camera\":{\"x\":" << cam_x << ",\"y\":" << cam_y << ",\"zoom\":" << json_number(session.camera_zoom) << "},"
-            << "\"aoi\":{"
-            << "\"min_chunk_x\":" << aoi_min_x << ","
-            << "\"max_chunk_x\":" << aoi_max_x << ","
-            << "\"min_chunk_y\":" << aoi_min_y << ","
-            << "\"max_chunk_y\":" << aoi_max_y << ","
-            << "\"camera_chunk_x\":" << cam_chunk_x << ","
-            << "\"camera_chunk_y\":" << cam_chunk_y << ","
-            << "\"radius\":" << aoi_radius << ","
-            << "\"effective_radius\":" << effective_radius
-            << "},"
-            << "\"aoi_chunks\":" << aoi_chunks << ","
-            << "\"public_camera_chunk\":{\"cx\":" << public_chunk_cx << ",\"cy\":" << public_chunk_cy << "},"
-            << "\"chunk_size\":" << runtime_cfg.chunk_size << ","
-            << "\"mask\":{"
-            << "\"mode\":\"" << json_escape(snap.mask_mode) << "\","
-            << "\"style\":\"" << json_escape(snap.mask_style) << "\","
-            << "\"seed\":" << snap.mask_seed << ","
-            << "\"playable_cells\":" << snap.playable_cells << ","
-            << "\"unplayable_cells\":" << snap.unplayable_cells
-            << "},"
-            << "\"snapshot\":" << snap_json
-            << "}";
-        if (!ws.send(out.str())) break;
-        next_world_send = now + world_dt;
+    if (system_message_bus.head() != c.last_system_message_id) {
+      vector<SystemMessageBus::Frame> messages;
+      system_message_bus.ReadSince(c.last_system_message_id, messages);
+      for (const auto& m : messages) {
+        if (!c.out->PushEvent(realtime::Channel::kPublic, m)) {
+          disconnect_slow_consumer(c, realtime::Channel::kPublic);
+          return false;
+        }
       }
+    }
+
+    return true;
+  });
 
-      if (now >= next_economy_send) {
-        const auto eco = economy.GetState();
-        const std::string stabilization_status = stabilization_status_ui(eco.stabilization_runtime);
-        ostringstream out;
-        out << "{"
-            << "\"type\":\"economy_world\","
-            << "\"channel\":\"public\","
-            << "\"period_id\":\"" << json_escape(eco.period_id) << "\","
-            << "\"Y\":" << eco.global.y << ","
-            << "\"extracted_output\":" << eco.global.y << ","
-            << "\"K\":" << eco.global.k << ","
-            << "\"L\":" << eco.global.l << ","
-            << "\"alpha\":" << json_number(eco.global.alpha) << ","
-            << "\"A\":" << json_number(eco.global.a) << ","
-            << "\"M\":" << eco.global.m << ","
-            << "\"P\":" << json_number(eco.global.p) << ","
-            << "\"pi\":" << json_number(eco.global.pi) << ","
-            << "\"price_index_valid\":" << (eco.global.price_index_valid ? "true" : "false") << ","
-            << "\"inflation_valid\":" << (eco.global.inflation_valid ? "true" : "false") << ","
-            << "\"treasury_balance\":" << eco.global.treasury_balance << ","
-            << "\"field_size\":" << eco.stabilization.field_size << ","
-            << "\"free_space_on_field\":" << eco.stabilization.free_space_on_field << ","
-            << "\"system_white_space_reserve\":" << eco.stabilization.treasury_white_space << ","
-            << "\"spatial_ratio_r\":" << json_number(eco.stabilization.spatial_ratio_r) << ","
-            << "\"stabilization_status\":\"" << json_escape(stabilization_status) << "\","
-            << "\"period_ends_in_seconds\":" << eco.period_ends_in_seconds << ","
-            << "\"snapshot_status\":\"" << json_escape(eco.global.snapshot_status) << "\","
-            << "\"A_world\":" << economy_world_area(eco.params, eco.global)
-            << "}";
-        if (!ws.send(out.str())) break;
-        next_economy_send = now + chrono::seconds(1);
+  srv.WebSocket("/ws", [&](const httplib::Request&, httplib::ws::WebSocket& ws) {
+    const string sid = rand_token(16);
+    const auto session = get_or_create_session(sid);
+    const realtime::SessionPin pin(session);
+
+    auto conn = make_shared<WsConnection>();
+    conn->sid = sid;
+    conn->session = session;
+    conn->ws = &ws;
+    conn->socket_fd = static_cast<int>(ws.socket());
+    const int fd = conn->socket_fd;
+    conn->out = make_shared<realtime::SendQueue>(
+        ws_send_pool, [&ws](const string& frame) { return ws.send(frame); }, ws_send_limits,
+        [fd](size_t bytes) { return realtime::SocketHasRoom(fd, bytes); });
+    ws_hub.Add(conn);
+
+    while (conn->alive() && ws.is_open()) {
+      string msg;
+      auto rr = ws.read(msg);
+      if (rr != httplib::ws::Text) break;
+
+      // Parsed once per frame; lookups below are views into `msg`.
+      const protocol::JsonFields fields(msg);
+      const auto type = fields.GetStringView("type");
+      if (!type) continue;
+
+      if (*type == "auth") {
+        auto token = fields.GetString("token");
+        if (!token || token->empty()) {
+          conn->out->PushEvent(realtime::Channel::kPrivate, "{\"type\":\"auth_ack\",\"channel\":\"private\",\"ok\":false}");
+          continue;
+        }
+        auto uid = auth.Verify(*token);
+        if (!uid) {
+          conn->out->PushEvent(realtime::Channel::kPrivate, "{\"type\":\"auth_ack\",\"channel\":\"private\",\"ok\":false}");
+          continue;
+        }
+        session->set_auth_user_id(*uid);
+        session->is_watcher.store(false, std::memory_order_relaxed);
+        session->updated_at_ms.store(now_ms(), std::memory_order_relaxed);
+        conn->out->PushEvent(realtime::Channel::kPrivate, "{\"type\":\"auth_ack\",\"channel\":\"private\",\"ok\":true}");
+        continue;
       }
 
-      if (is_auth && now >= next_private_send) {
-        const auto user = storage->GetUserById(std::to_string(*session.auth_user_id));
-        const auto eco_user = economy.GetState(*session.auth_user_id);
-        if (user.has_value()) {
-          const auto snakes = game.list_user_snakes(*session.auth_user_id);
-          int64_t deployed = 0;
-          for (const auto& s : snakes) deployed += static_cast<int64_t>(s.body.size());
-          ostringstream out;
-          out << "{"
-              << "\"type\":\"user_state\","
-              << "\"channel\":\"private\","
-              << "\"user_id\":" << *session.auth_user_id << ","
-              << "\"balance_mi\":" << user->balance_mi << ","
-              << "\"liquid_assets\":" << user->balance_mi << ","
-              << "\"deployed_k\":" << deployed << ","
-              << "\"snake_count\":" << snakes.size();
-          if (eco_user.user.has_value()) {
-            out << ",\"economy_user\":{"
-                << "\"Y_u\":" << eco_user.user->y_u << ","
-                << "\"extracted_output_u\":" << eco_user.user->y_u << ","
-                << "\"K_u\":" << eco_user.user->k_u << ","
-                << "\"L_u\":" << eco_user.user->l_u << ","
-                << "\"alpha_u\":" << json_number(eco_user.user->alpha_u) << ","
-                << "\"A_u\":" << json_number(eco_user.user->a_u) << ","
-                << "\"market_share\":" << json_number(eco_user.user->market_share) << ","
-                << "\"storage_balance\":" << eco_user.user->storage_balance
-                << "}";
+      const auto session_uid = session->auth_user_id();
+      if (!session_uid.has_value()) continue;
+
+      if (*type == "input") {
+        const auto snake_id = fields.GetInt("snake_id");
+        const auto dir = fields.GetStringView("dir");
+        const auto pause_toggle = fields.GetBool("pause_toggle");
+        if (snake_id && dir) {
+          int d = 0;
+          if (*dir == "L") d = 1;
+          else if (*dir == "R") d = 2;
+          else if (*dir == "U") d = 3;
+          else if (*dir == "D") d = 4;
+          if (d >= 1 && d <= 4) {
+            game.set_snake_dir(*session_uid, *snake_id, static_cast<world::Dir>(d));
           }
-          out
-              << "}";
-          if (!ws.send(out.str())) break;
         }
-        next_private_send = now + chrono::seconds(1);
+        if (snake_id && pause_toggle && *pause_toggle) {
+          game.toggle_snake_pause(*session_uid, *snake_id);
+        }
+        continue;
+      }
+
+      if (*type == "camera_set") {
+        auto x = fields.GetInt("x");
+        auto y = fields.GetInt("y");
+        auto zoom = fields.GetDouble("zoom");
+        if (!x || !y) continue;
+        const uint64_t now_millis = now_ms();
+        const uint64_t min_gap = static_cast<uint64_t>(
+            max(1, static_cast<int>(std::lround(1000.0 / static_cast<double>(runtime_cfg.camera_msg_max_hz)))));
+        const uint64_t last_update = session->last_camera_update_ms.load(std::memory_order_relaxed);
+        if (last_update != 0 && now_millis - last_update < min_gap) continue;
+        const auto snap = game.snapshot();
+        auto camera = session->camera();
+        camera.x = max(0, min(snap.w - 1, *x));
+        camera.y = max(0, min(snap.h - 1, *y));
+        if (zoom) camera.zoom = max(0.25, min(4.0, *zoom));
+        session->SetCamera(camera);
+        auto follow_id = fields.GetInt("follow_snake_id");
+        if (follow_id && *follow_id > 0) session->set_watched_snake_id(*follow_id);
+        session->subscribed_chunks_count.store(compute_subscribed_chunks_count(), std::memory_order_relaxed);
+        session->last_camera_update_ms.store(now_millis, std::memory_order_relaxed);
+        session->updated_at_ms.store(now_millis, std::memory_order_relaxed);
       }
 
-      if (now >= next_system_send) {
-        const auto messages = system_message_bus.GetSince(last_system_message_id);
-        for (const auto& m : messages) {
-          std::ostringstream out;
-          out << "{"
-              << "\"type\":\"system_message\","
-              << "\"id\":" << m.id << ","
-              << "\"level\":\"" << json_escape(m.level) << "\","
-              << "\"message\":\"" << json_escape(m.text) << "\","
-              << "\"created_at\":" << m.created_at
-              << "}";
-          if (!ws.send(out.str())) {
-            alive.store(false);
-            break;
+      if (*type == "public_camera_init") {
+        // Spectator one-shot init: accepts only from unauthenticated sessions.
+        if (session_uid.has_value()) continue;
+        auto x = fields.GetInt("x");
+        auto y = fields.GetInt("y");
+        if (!x || !y) continue;
+        const auto snap = game.snapshot();
+        const int cx = max(0, min(snap.w - 1, *x));
+        const int cy = max(0, min(snap.h - 1, *y));
+        const auto chunk = game.coord_to_chunk(cx, cy);
+        {
+          lock_guard<mutex> lock(public_view_mu);
+          if (!public_view.initialized) {
+            public_view.camera_x = cx;
+            public_view.camera_y = cy;
+            public_view.chunk_cx = chunk.cx;
+            public_view.chunk_cy = chunk.cy;
+            public_view.initialized = true;
           }
-          last_system_message_id = m.id;
         }
-        next_system_send = now + chrono::milliseconds(250);
+        continue;
       }
-
-      this_thread::sleep_for(chrono::milliseconds(10));
     }
 
-    alive.store(false);
-    if (reader.joinable()) reader.join();
-    {
-      lock_guard<mutex> lock(sessions_mu);
-      sessions.erase(sid);
-    }
+    ws_hub.Remove(conn);
+    conn->out->Close();
+    sessions.Erase(sid);
   });
 
   srv.Options(R"(.*)", [&](const httplib::Request&, httplib::Response& res) {
@@ -1989,20 +2398,20 @@ int main(int argc, char** argv) {
 
   srv.Get("/game/runtime", [&](const httplib::Request&, httplib::Response& res) {
     add_cors(res);
-    ostringstream o;
-    o << "{"
-      << "\"tick_hz\":" << runtime_cfg.tick_hz << ","
-      << "\"spectator_hz\":" << runtime_cfg.spectator_hz << ","
-      << "\"player_hz\":" << runtime_cfg.player_hz << ","
-      << "\"enable_broadcast\":" << (runtime_cfg.enable_broadcast ? "true" : "false") << ","
-      << "\"chunk_size\":" << runtime_cfg.chunk_size << ","
-      << "\"aoi_radius\":" << runtime_cfg.aoi_radius << ","
-      << "\"aoi_pad_chunks\":" << runtime_cfg.aoi_pad_chunks << ","
-      << "\"single_chunk_mode\":" << (runtime_cfg.single_chunk_mode ? "true" : "false") << ","
-      << "\"aoi_enabled\":" << (runtime_cfg.aoi_enabled ? "true" : "false") << ","
-      << "\"google_auth_enabled\":" << (runtime_cfg.google_auth_enabled ? "true" : "false") << ","
-      << "\"google_client_id\":\"" << json_escape(runtime_cfg.google_client_id) << "\""
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("tick_hz", runtime_cfg.tick_hz);
+    o.Field("spectator_hz", runtime_cfg.spectator_hz);
+    o.Field("player_hz", runtime_cfg.player_hz);
+    o.Field("enable_broadcast", runtime_cfg.enable_broadcast);
+    o.Field("chunk_size", runtime_cfg.chunk_size);
+    o.Field("aoi_radius", runtime_cfg.aoi_radius);
+    o.Field("aoi_pad_chunks", runtime_cfg.aoi_pad_chunks);
+    o.Field("single_chunk_mode", runtime_cfg.single_chunk_mode);
+    o.Field("aoi_enabled", runtime_cfg.aoi_enabled);
+    o.Field("google_auth_enabled", runtime_cfg.google_auth_enabled);
+    o.Field("google_client_id", runtime_cfg.google_client_id);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -2011,80 +2420,99 @@ int main(int argc, char** argv) {
     res.set_content("{\"ok\":true}", "application/json");
   });
 
-  // Local/dev fallback static serving so http://127.0.0.1:8080 works without a reverse proxy.
-  // In prod, Caddy/Nginx static serving still takes precedence.
-  srv.Get("/", [&](const httplib::Request&, httplib::Response& res) {
-    add_cors(res);
-    std::string body;
-    if (!read_file_bytes("index.html", body)) {
-      res.status = 404;
-      res.set_content("{\"error\":\"index_not_found\"}", "application/json");
+  // Values owned elsewhere are read at scrape time.
+  metrics::Default().SetGaugeCallback("snake_sessions", "Live realtime sessions (WS + SSE/camera).", {},
+                                      [&] { return static_cast<double>(sessions.GetStats().sessions); });
+  metrics::Default().SetGaugeCallback("snake_sessions_pinned", "Sessions held by an open connection.", {},
+                                      [&] { return static_cast<double>(sessions.GetStats().pinned); });
+  metrics::Default().SetGaugeCallback("snake_ws_connections", "Open WebSocket connections.", {},
+                                      [&] { return static_cast<double>(ws_hub.size()); });
+  metrics::Default().SetGaugeCallback("snake_static_assets", "Static assets held in memory.", {},
+                                      [&] { return static_cast<double>(static_assets.current()->assets.size()); });
+
+  srv.Get("/metrics", [&](const httplib::Request& req, httplib::Response& res) {
+    if (!require_admin_token(req, admin_token)) {
+      res.status = 401;
+      res.set_content("unauthorized\n", "text/plain");
       return;
     }
-    res.set_content(body, "text/html; charset=utf-8");
+    res.set_content(metrics::Default().RenderPrometheus(), "text/plain; version=0.0.4; charset=utf-8");
   });
 
-  srv.Get("/index.html", [&](const httplib::Request&, httplib::Response& res) {
+  auto serve_static = [&](const httplib::Request& req, httplib::Response& res, const string& url_path) -> bool {
+    if (g_static_reload_requested) {
+      // Rebuilt on a request worker, never on the tick thread.
+      g_static_reload_requested = 0;
+      static_assets.Reload();
+    }
+    const auto asset = static_assets.Find(url_path);
+    if (!asset) return false;
+    const auto enc = web::StaticAssetCache::Negotiate(*asset, req.get_header_value("Accept-Encoding"));
+    res.set_header("ETag", asset->etag(enc));
+    res.set_header("Cache-Control", asset->cache_control());
+    res.set_header("Vary", "Accept-Encoding");
+    if (req.has_header("If-None-Match") && asset->MatchesIfNoneMatch(req.get_header_value("If-None-Match"))) {
+      res.status = 304;
+      return true;
+    }
+    if (enc != web::StaticAsset::Encoding::kIdentity) {
+      res.set_header("Content-Encoding", web::StaticAssetCache::EncodingName(enc));
+    }
+    const auto body = asset->body(enc);
+    if (body.size == 0) {
+      res.set_content(string(), asset->content_type());
+      return true;
+    }
+    // Streams straight from the cached (or mmapped) bytes; `asset` keeps them alive.
+    res.set_content_provider(body.size, asset->content_type(),
+                             [asset, body](size_t offset, size_t length, httplib::DataSink& sink) {
+                               return sink.write(body.data + offset, length);
+                             });
+    return true;
+  };
+
+  srv.Get("/", [&](const httplib::Request& req, httplib::Response& res) {
     add_cors(res);
-    std::string body;
-    if (!read_file_bytes("index.html", body)) {
+    if (!serve_static(req, res, "/index.html")) {
       res.status = 404;
       res.set_content("{\"error\":\"index_not_found\"}", "application/json");
-      return;
     }
-    res.set_content(body, "text/html; charset=utf-8");
   });
 
-  srv.Get("/assets/world_evolution_log.json", [&](const httplib::Request&, httplib::Response& res) {
+  srv.Get("/index.html", [&](const httplib::Request& req, httplib::Response& res) {
     add_cors(res);
-    std::string body;
-    if (!read_file_bytes("assets/world_evolution_log.json", body)) {
+    if (!serve_static(req, res, "/index.html")) {
       res.status = 404;
-      res.set_content("{\"error\":\"world_evolution_log_not_found\"}", "application/json");
-      return;
-    }
-    if (body.empty()) {
-      res.status = 500;
-      res.set_content("{\"error\":\"world_evolution_log_empty\"}", "application/json");
-      return;
+      res.set_content("{\"error\":\"index_not_found\"}", "application/json");
     }
-    res.set_content(body, "application/json");
   });
 
-  srv.Get(R"(/src/(.+))", [&](const httplib::Request& req, httplib::Response& res) {
+  srv.Get("/assets/world_evolution_log.json", [&](const httplib::Request& req, httplib::Response& res) {
     add_cors(res);
-    const std::string rel = req.matches[1];
-    if (!is_safe_static_subpath(rel)) {
-      res.status = 400;
-      res.set_content("{\"error\":\"bad_path\"}", "application/json");
+    const auto asset = static_assets.Find("/assets/world_evolution_log.json");
+    if (asset && asset->size() == 0) {
+      res.status = 500;
+      res.set_content("{\"error\":\"world_evolution_log_empty\"}", "application/json");
       return;
     }
-    const std::string full = "src/" + rel;
-    std::string body;
-    if (!read_file_bytes(full, body)) {
+    if (!serve_static(req, res, "/assets/world_evolution_log.json")) {
       res.status = 404;
-      res.set_content("{\"error\":\"not_found\"}", "application/json");
-      return;
+      res.set_content("{\"error\":\"world_evolution_log_not_found\"}", "application/json");
     }
-    res.set_content(body, content_type_for_path(full).c_str());
   });
 
-  srv.Get(R"(/assets/(.+))", [&](const httplib::Request& req, httplib::Response& res) {
+  srv.Get(R"(/(src|assets)/(.+))", [&](const httplib::Request& req, httplib::Response& res) {
     add_cors(res);
-    const std::string rel = req.matches[1];
+    const std::string rel = req.matches[2];
     if (!is_safe_static_subpath(rel)) {
       res.status = 400;
       res.set_content("{\"error\":\"bad_path\"}", "application/json");
       return;
     }
-    const std::string full = "assets/" + rel;
-    std::string body;
-    if (!read_file_bytes(full, body)) {
+    if (!serve_static(req, res, "/" + std::string(req.matches[1]) + "/" + rel)) {
       res.status = 404;
       res.set_content("{\"error\":\"not_found\"}", "application/json");
-      return;
     }
-    res.set_content(body, content_type_for_path(full).c_str());
   });
 
   srv.Get("/economy/state", [&](const httplib::Request&, httplib::Response& res) {
@@ -2093,50 +2521,50 @@ int main(int argc, char** argv) {
     const auto period_row = storage->GetEconomyPeriod(s.period_id).value_or(storage::EconomyPeriod{});
     const int64_t a_world = economy_world_area(s.params, s.global);
     const int64_t m_white = std::max<int64_t>(0, a_world - s.global.k);
-    ostringstream o;
-    o << "{"
-      << "\"period_id\":\"" << json_escape(s.period_id) << "\","
-      << "\"period_key\":\"" << json_escape(s.period_id) << "\","
-      << "\"period_ends_in_seconds\":" << s.period_ends_in_seconds << ","
-      << "\"snapshot_status\":\"" << json_escape(s.global.snapshot_status) << "\","
-      << "\"is_finalized\":" << (period_row.is_finalized ? "true" : "false") << ","
-      << "\"finalized_at\":" << period_row.finalized_at << ","
-      << "\"Y\":" << s.global.y << ","
-      << "\"extracted_output\":" << s.global.y << ","
-      << "\"K\":" << s.global.k << ","
-      << "\"L\":" << s.global.l << ","
-      << "\"alpha\":" << json_number(s.global.alpha) << ","
-      << "\"A\":" << json_number(s.global.a) << ","
-      << "\"M\":" << s.global.m << ","
-      << "\"P\":" << json_number(s.global.p) << ","
-      << "\"pi\":" << json_number(s.global.pi) << ","
-      << "\"price_index_valid\":" << (s.global.price_index_valid ? "true" : "false") << ","
-      << "\"inflation_valid\":" << (s.global.inflation_valid ? "true" : "false") << ","
-      << "\"A_world\":" << a_world << ","
-      << "\"M_white\":" << m_white << ","
-      << "\"R\":" << json_number(s.stabilization.spatial_ratio_r) << ","
-      << "\"LCR\":" << json_number(s.stabilization.lcr) << ","
-      << "\"field_size\":" << s.stabilization.field_size << ","
-      << "\"free_space_on_field\":" << s.stabilization.free_space_on_field << ","
-      << "\"system_white_space_reserve\":" << s.stabilization.treasury_white_space << ","
-      << "\"stabilization_status\":\"" << json_escape(stabilization_status_ui(s.stabilization_runtime)) << "\","
-      << "\"treasury_white_space\":" << s.stabilization.treasury_white_space << ","
-      << "\"treasury_balance\":" << s.global.treasury_balance << ","
-      << "\"alpha_bootstrap\":" << (s.global.alpha_bootstrap ? "true" : "false") << ","
-      << "\"inputs\":{"
-      << "\"k_land\":" << s.params.k_land << ","
-      << "\"a_productivity\":" << json_number(s.params.a_productivity) << ","
-      << "\"v_velocity\":" << json_number(s.params.v_velocity) << ","
-      << "\"m_gov_reserve\":" << s.params.m_gov_reserve << ","
-      << "\"cap_delta_m\":" << s.params.cap_delta_m << ","
-      << "\"delta_m_issue\":" << s.params.delta_m_issue << ","
-      << "\"delta_k_obs\":" << s.params.delta_k_obs
-      << "},"
-      // Backward-compatible aliases for existing consumers.
-      << "\"legacy\":{"
-      << "\"k_snakes\":" << s.k_snakes
-      << "}"
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("period_id", s.period_id);
+    o.Field("period_key", s.period_id);
+    o.Field("period_ends_in_seconds", s.period_ends_in_seconds);
+    o.Field("snapshot_status", s.global.snapshot_status);
+    o.Field("is_finalized", period_row.is_finalized);
+    o.Field("finalized_at", period_row.finalized_at);
+    o.Field("Y", s.global.y);
+    o.Field("extracted_output", s.global.y);
+    o.Field("K", s.global.k);
+    o.Field("L", s.global.l);
+    o.Field("alpha", s.global.alpha);
+    o.Field("A", s.global.a);
+    o.Field("M", s.global.m);
+    o.Field("P", s.global.p);
+    o.Field("pi", s.global.pi);
+    o.Field("price_index_valid", s.global.price_index_valid);
+    o.Field("inflation_valid", s.global.inflation_valid);
+    o.Field("A_world", a_world);
+    o.Field("M_white", m_white);
+    o.Field("R", s.stabilization.spatial_ratio_r);
+    o.Field("LCR", s.stabilization.lcr);
+    o.Field("field_size", s.stabilization.field_size);
+    o.Field("free_space_on_field", s.stabilization.free_space_on_field);
+    o.Field("system_white_space_reserve", s.stabilization.treasury_white_space);
+    o.Field("stabilization_status", stabilization_status_ui(s.stabilization_runtime));
+    o.Field("treasury_white_space", s.stabilization.treasury_white_space);
+    o.Field("treasury_balance", s.global.treasury_balance);
+    o.Field("alpha_bootstrap", s.global.alpha_bootstrap);
+    o.Key("inputs").BeginObject();
+    o.Field("k_land", s.params.k_land);
+    o.Field("a_productivity", s.params.a_productivity);
+    o.Field("v_velocity", s.params.v_velocity);
+    o.Field("m_gov_reserve", s.params.m_gov_reserve);
+    o.Field("cap_delta_m", s.params.cap_delta_m);
+    o.Field("delta_m_issue", s.params.delta_m_issue);
+    o.Field("delta_k_obs", s.params.delta_k_obs);
+    o.EndObject();
+    // Backward-compatible aliases for existing consumers.
+    o.Key("legacy").BeginObject();
+    o.Field("k_snakes", s.k_snakes);
+    o.EndObject();
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -2154,19 +2582,168 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"economy_user_not_found\"}", "application/json");
       return;
     }
-    ostringstream o;
-    o << "{"
-      << "\"period_id\":\"" << json_escape(s.period_id) << "\","
-      << "\"Y_u\":" << s.user->y_u << ","
-      << "\"extracted_output_u\":" << s.user->y_u << ","
-      << "\"K_u\":" << s.user->k_u << ","
-      << "\"L_u\":" << s.user->l_u << ","
-      << "\"alpha_u\":" << json_number(s.user->alpha_u) << ","
-      << "\"A_u\":" << json_number(s.user->a_u) << ","
-      << "\"market_share\":" << json_number(s.user->market_share) << ","
-      << "\"storage_balance\":" << s.user->storage_balance << ","
-      << "\"alpha_bootstrap\":" << (s.user->alpha_bootstrap ? "true" : "false")
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("period_id", s.period_id);
+    o.Field("Y_u", s.user->y_u);
+    o.Field("extracted_output_u", s.user->y_u);
+    o.Field("K_u", s.user->k_u);
+    o.Field("L_u", s.user->l_u);
+    o.Field("alpha_u", s.user->alpha_u);
+    o.Field("A_u", s.user->a_u);
+    o.Field("market_share", s.user->market_share);
+    o.Field("storage_balance", s.user->storage_balance);
+    o.Field("alpha_bootstrap", s.user->alpha_bootstrap);
+    o.EndObject();
+    res.set_content(o.str(), "application/json");
+  });
+
+  // Served from the local history files only; never reads storage.
+  srv.Get("/economy/history", [&](const httplib::Request& req, httplib::Response& res) {
+    add_cors(res);
+    if (!economy_history.enabled()) {
+      res.status = 503;
+      res.set_content("{\"error\":\"history_disabled\"}", "application/json");
+      return;
+    }
+    economy::EconomyHistoryStore::Query q;
+    if (req.get_param_value("scope") == "user") {
+      auto uid = require_auth_user(auth, req);
+      if (!uid) {
+        res.status = 401;
+        res.set_content("{\"error\":\"unauthorized\"}", "application/json");
+        return;
+      }
+      q.series = economy::EconomyHistoryStore::Series::kUser;
+      q.user_id = *uid;
+    }
+    // Query values are untrusted: parse strictly and keep them in [0, kMaxUs]
+    // (a few centuries of microseconds) so the range math below cannot overflow.
+    constexpr int64_t kMaxUs = std::numeric_limits<int64_t>::max() / 4;
+    const auto param_i64 = [&](const char* name, int64_t fallback) -> std::optional<int64_t> {
+      if (!req.has_param(name)) return fallback;
+      const std::string v = req.get_param_value(name);
+      char* end = nullptr;
+      const long long parsed = std::strtoll(v.c_str(), &end, 10);
+      if (v.empty() || *end != '\0' || parsed < 0 || parsed > kMaxUs) return std::nullopt;
+      return static_cast<int64_t>(parsed);
+    };
+    const auto bad_request = [&](const char* error) {
+      res.status = 400;
+      res.set_content(std::string("{\"error\":\"") + error + "\"}", "application/json");
+    };
+    const int64_t now_us = chrono::duration_cast<chrono::microseconds>(
+                               chrono::system_clock::now().time_since_epoch())
+                               .count();
+    const auto to_us = param_i64("to_us", now_us);
+    const auto from_us =
+        to_us ? param_i64("from_us", std::max<int64_t>(0, *to_us - 86400LL * 1000000LL)) : std::nullopt;
+    if (!to_us || !from_us || *to_us <= *from_us) return bad_request("invalid_range");
+    q.to_us = *to_us;
+    q.from_us = *from_us;
+    const int64_t span = q.to_us - q.from_us;
+    const auto ceil_div = [](int64_t n, int64_t d) { return n / d + (n % d != 0 ? 1 : 0); };
+    const auto buckets = param_i64("buckets", 200);
+    if (!buckets) return bad_request("invalid_buckets");
+    const int64_t bucket_count =
+        std::clamp<int64_t>(*buckets, 1, static_cast<int64_t>(economy::EconomyHistoryStore::kMaxBuckets));
+    const auto step_us = param_i64("step_us", ceil_div(span, bucket_count));
+    if (!step_us || *step_us <= 0 ||
+        ceil_div(span, *step_us) > static_cast<int64_t>(economy::EconomyHistoryStore::kMaxBuckets)) {
+      return bad_request("too_many_buckets");
+    }
+    q.step_us = *step_us;
+    const auto result = economy_history.Run(q);
+    protocol::JsonWriter o(4096);
+    o.BeginObject();
+    o.Field("scope", q.series == economy::EconomyHistoryStore::Series::kUser ? "user" : "global");
+    o.Field("from_us", q.from_us);
+    o.Field("to_us", q.to_us);
+    o.Field("step_us", q.step_us);
+    o.Field("rows_scanned", result.rows_scanned);
+    o.Key("fields").BeginArray().String("t_us").String("min").String("max").String("avg").String("n").EndArray();
+    o.Key("series").BeginObject();
+    for (size_t c = 0; c < result.names.size(); ++c) {
+      o.Key(result.names[c]).BeginArray();
+      for (const auto& b : result.buckets[c]) {
+        o.BeginArray().Int(b.t_us).Number(b.min).Number(b.max).Number(b.avg).Uint(b.n).EndArray();
+      }
+      o.EndArray();
+    }
+    o.EndObject();
+    o.EndObject();
+    res.set_content(o.str(), "application/json");
+  });
+
+  srv.Get("/leaderboard", [&](const httplib::Request& req, httplib::Response& res) {
+    add_cors(res);
+    const string board_name = req.has_param("board") ? req.get_param_value("board") : "length";
+    const auto kind = leaderboard::ParseKind(board_name);
+    if (!kind) {
+      res.status = 400;
+      res.set_content("{\"error\":\"unknown_board\"}", "application/json");
+      return;
+    }
+    // Untrusted: digits only, at most kMaxParam; anything else is a 400.
+    constexpr long long kMaxParam = 1000000000LL;
+    const auto param_size = [&](const char* name, size_t fallback) -> std::optional<size_t> {
+      if (!req.has_param(name)) return fallback;
+      const std::string v = req.get_param_value(name);
+      char* end = nullptr;
+      const long long parsed = std::strtoll(v.c_str(), &end, 10);
+      if (v.empty() || *end != '\0' || parsed < 0 || parsed > kMaxParam) return std::nullopt;
+      return static_cast<size_t>(parsed);
+    };
+    const auto offset_param = param_size("offset", 0);
+    const auto limit_param = param_size("limit", 20);
+    if (!offset_param || !limit_param) {
+      res.status = 400;
+      res.set_content(std::string("{\"error\":\"") + (offset_param ? "invalid_limit" : "invalid_offset") + "\"}",
+                      "application/json");
+      return;
+    }
+    const size_t offset = *offset_param;
+    const size_t limit = std::clamp<size_t>(*limit_param, 1, leaderboard::LeaderboardService::kMaxLimit);
+    const auto page = leaderboard.Top(*kind, offset, limit);
+    const auto write_row = [&](protocol::JsonWriter& o, const leaderboard::LeaderboardService::Row& row) {
+      o.BeginObject();
+      o.Field("rank", row.rank);
+      o.Field("user_id", row.user_id);
+      if (*kind == leaderboard::Kind::kLength) {
+        o.Field("snake_id", row.snake_id);
+        o.Field("snake_name", row.snake_name);
+      }
+      o.Field("score", row.score);
+      if (*kind == leaderboard::Kind::kOutput) {
+        o.Field("market_share", page.score_total > 0 ? static_cast<double>(row.score) /
+                                                           static_cast<double>(page.score_total)
+                                                     : 0.0);
+      }
+      o.EndObject();
+    };
+    protocol::JsonWriter o(2048);
+    o.BeginObject();
+    o.Field("board", leaderboard::KindName(*kind));
+    o.Field("version", page.version);
+    o.Field("total", page.total);
+    if (*kind == leaderboard::Kind::kOutput) {
+      o.Field("period_id", page.period_id);
+      o.Field("output_total", page.score_total);
+    }
+    o.Field("offset", offset);
+    o.Key("rows").BeginArray();
+    for (const auto& row : page.rows) write_row(o, row);
+    o.EndArray();
+    // "me" only for a valid bearer token; the board itself is public.
+    if (const auto uid = require_auth_user(auth, req)) {
+      o.Key("me");
+      if (const auto mine = leaderboard.RankOf(*kind, *uid)) {
+        write_row(o, *mine);
+      } else {
+        o.Null();
+      }
+    }
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -2179,34 +2756,44 @@ int main(int argc, char** argv) {
     }
     const auto eco = economy.GetState();
     const auto dbg = economy.GetDebugState();
-    std::ostringstream o;
-    o << "{"
-      << "\"period_id\":\"" << json_escape(dbg.period_id) << "\","
-      << "\"period_ends_in_seconds\":" << dbg.period_ends_in_seconds << ","
-      << "\"pending\":{"
-      << "\"harvested_food\":" << dbg.pending_harvested_food << ","
-      << "\"real_output\":" << dbg.pending_real_output << ","
-      << "\"movement_ticks\":" << dbg.pending_movement_ticks << ","
-      << "\"users\":" << dbg.pending_users
-      << "},"
-      << "\"flush_interval_sec\":" << dbg.flush_interval_sec << ","
-      << "\"seconds_since_last_flush\":" << dbg.seconds_since_last_flush << ","
-      << "\"stabilization\":{"
-      << "\"field_size\":" << eco.stabilization.field_size << ","
-      << "\"free_space_on_field\":" << eco.stabilization.free_space_on_field << ","
-      << "\"spatial_ratio_r\":" << json_number(eco.stabilization.spatial_ratio_r) << ","
-      << "\"lcr\":" << json_number(eco.stabilization.lcr) << ","
-      << "\"treasury_white_space\":" << eco.stabilization.treasury_white_space << ","
-      << "\"failures_this_period\":" << eco.stabilization_runtime.spatial_expansion_failures_current_period << ","
-      << "\"mode\":\"" << json_escape(stabilization_status_ui(eco.stabilization_runtime)) << "\","
-      << "\"last_action_period_id\":\"" << json_escape(eco.stabilization_runtime.last_stabilization_action_period_id) << "\","
-      << "\"last_action_type\":\"" << json_escape(eco.stabilization_runtime.last_stabilization_action_type) << "\","
-      << "\"next_fast_check_in_seconds\":" << eco.next_fast_check_in_seconds
-      << "},"
-      << "\"price_index_valid\":" << (eco.global.price_index_valid ? "true" : "false") << ","
-      << "\"inflation_valid\":" << (eco.global.inflation_valid ? "true" : "false") << ","
-      << "\"snapshot_status\":\"" << json_escape(eco.global.snapshot_status) << "\""
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("period_id", dbg.period_id);
+    o.Field("period_ends_in_seconds", dbg.period_ends_in_seconds);
+    o.Key("pending").BeginObject();
+    o.Field("harvested_food", dbg.pending_harvested_food);
+    o.Field("real_output", dbg.pending_real_output);
+    o.Field("movement_ticks", dbg.pending_movement_ticks);
+    o.Field("users", dbg.pending_users);
+    o.EndObject();
+    o.Field("flush_interval_sec", dbg.flush_interval_sec);
+    o.Field("seconds_since_last_flush", dbg.seconds_since_last_flush);
+    o.Key("flush_pipeline").BeginObject();
+    o.Field("submitted", dbg.flush.submitted);
+    o.Field("batches_written", dbg.flush.batches_written);
+    o.Field("user_rows_written", dbg.flush.user_rows_written);
+    o.Field("write_failures", dbg.flush.write_failures);
+    o.Field("periods_finalized", dbg.flush.periods_finalized);
+    o.Field("finalizations_waiting", dbg.flush.finalizations_waiting);
+    o.Field("late_activity_moved", dbg.flush.late_activity_moved);
+    o.Field("last_write_ms", dbg.flush.last_write_ms);
+    o.EndObject();
+    o.Key("stabilization").BeginObject();
+    o.Field("field_size", eco.stabilization.field_size);
+    o.Field("free_space_on_field", eco.stabilization.free_space_on_field);
+    o.Field("spatial_ratio_r", eco.stabilization.spatial_ratio_r);
+    o.Field("lcr", eco.stabilization.lcr);
+    o.Field("treasury_white_space", eco.stabilization.treasury_white_space);
+    o.Field("failures_this_period", eco.stabilization_runtime.spatial_expansion_failures_current_period);
+    o.Field("mode", stabilization_status_ui(eco.stabilization_runtime));
+    o.Field("last_action_period_id", eco.stabilization_runtime.last_stabilization_action_period_id);
+    o.Field("last_action_type", eco.stabilization_runtime.last_stabilization_action_type);
+    o.Field("next_fast_check_in_seconds", eco.next_fast_check_in_seconds);
+    o.EndObject();
+    o.Field("price_index_valid", eco.global.price_index_valid);
+    o.Field("inflation_valid", eco.global.inflation_valid);
+    o.Field("snapshot_status", eco.global.snapshot_status);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -2221,43 +2808,274 @@ int main(int argc, char** argv) {
     const auto p = storage->GetEconomyPeriod(s.period_id).value_or(storage::EconomyPeriod{});
     const int64_t a_world = economy_world_area(s.params, s.global);
     const std::string stabilization_status = stabilization_status_ui(s.stabilization_runtime);
-    std::ostringstream o;
-    o << "{"
-      << "\"period_id\":\"" << json_escape(s.period_id) << "\","
-      << "\"is_finalized\":" << (p.is_finalized ? "true" : "false") << ","
-      << "\"finalized_at\":" << p.finalized_at << ","
-      << "\"snapshot_status\":\"" << json_escape(s.global.snapshot_status) << "\","
-      << "\"Y\":" << s.global.y << ","
-      << "\"K\":" << s.global.k << ","
-      << "\"L\":" << s.global.l << ","
-      << "\"alpha\":" << json_number(s.global.alpha) << ","
-      << "\"A\":" << json_number(s.global.a) << ","
-      << "\"M\":" << s.global.m << ","
-      << "\"P\":" << json_number(s.global.p) << ","
-      << "\"pi\":" << json_number(s.global.pi) << ","
-      << "\"price_index_valid\":" << (s.global.price_index_valid ? "true" : "false") << ","
-      << "\"inflation_valid\":" << (s.global.inflation_valid ? "true" : "false") << ","
-      << "\"A_world\":" << a_world << ","
-      << "\"M_white\":" << std::max<int64_t>(0, a_world - s.global.k) << ","
-      << "\"field_size\":" << s.stabilization.field_size << ","
-      << "\"free_space_on_field\":" << s.stabilization.free_space_on_field << ","
-      << "\"system_white_space_reserve\":" << s.stabilization.treasury_white_space << ","
-      << "\"spatial_ratio_r\":" << json_number(s.stabilization.spatial_ratio_r) << ","
-      << "\"lcr\":" << json_number(s.stabilization.lcr) << ","
-      << "\"treasury_white_space\":" << s.stabilization.treasury_white_space << ","
-      << "\"failures_this_period\":" << s.stabilization_runtime.spatial_expansion_failures_current_period << ","
-      << "\"stabilization_mode\":\"" << json_escape(stabilization_status) << "\","
-      << "\"stabilization_status\":\"" << json_escape(stabilization_status) << "\","
-      << "\"last_stabilization_action_period_id\":\""
-      << json_escape(s.stabilization_runtime.last_stabilization_action_period_id) << "\","
-      << "\"last_stabilization_action_type\":\""
-      << json_escape(s.stabilization_runtime.last_stabilization_action_type) << "\","
-      << "\"next_fast_check_in_seconds\":" << s.next_fast_check_in_seconds << ","
-      << "\"period_ends_in_seconds\":" << s.period_ends_in_seconds
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("period_id", s.period_id);
+    o.Field("is_finalized", p.is_finalized);
+    o.Field("finalized_at", p.finalized_at);
+    o.Field("snapshot_status", s.global.snapshot_status);
+    o.Field("Y", s.global.y);
+    o.Field("K", s.global.k);
+    o.Field("L", s.global.l);
+    o.Field("alpha", s.global.alpha);
+    o.Field("A", s.global.a);
+    o.Field("M", s.global.m);
+    o.Field("P", s.global.p);
+    o.Field("pi", s.global.pi);
+    o.Field("price_index_valid", s.global.price_index_valid);
+    o.Field("inflation_valid", s.global.inflation_valid);
+    o.Field("A_world", a_world);
+    o.Field("M_white", std::max<int64_t>(0, a_world - s.global.k));
+    o.Field("field_size", s.stabilization.field_size);
+    o.Field("free_space_on_field", s.stabilization.free_space_on_field);
+    o.Field("system_white_space_reserve", s.stabilization.treasury_white_space);
+    o.Field("spatial_ratio_r", s.stabilization.spatial_ratio_r);
+    o.Field("lcr", s.stabilization.lcr);
+    o.Field("treasury_white_space", s.stabilization.treasury_white_space);
+    o.Field("failures_this_period", s.stabilization_runtime.spatial_expansion_failures_current_period);
+    o.Field("stabilization_mode", stabilization_status);
+    o.Field("stabilization_status", stabilization_status);
+    o.Field("last_stabilization_action_period_id", s.stabilization_runtime.last_stabilization_action_period_id);
+    o.Field("last_stabilization_action_type", s.stabilization_runtime.last_stabilization_action_type);
+    o.Field("next_fast_check_in_seconds", s.next_fast_check_in_seconds);
+    o.Field("period_ends_in_seconds", s.period_ends_in_seconds);
+    const auto spatial = game.spatial_metrics();
+    const auto chunks = game.occupied_chunks();
+    int32_t busiest_chunk_cells = 0;
+    for (const auto& c : chunks) busiest_chunk_cells = std::max(busiest_chunk_cells, c.occupied_cells);
+    o.Key("spatial").BeginObject();
+    o.Field("tick", spatial.tick);
+    o.Field("occupied_cells", spatial.occupied_cells);
+    o.Field("playable_cells", spatial.playable_cells);
+    o.Field("free_playable_cells", spatial.free_playable_cells);
+    o.Field("occupied_chunks", chunks.size());
+    o.Field("busiest_chunk_cells", busiest_chunk_cells);
+    o.EndObject();
+    const auto totals = economy_aggregates.Read();
+    const auto reconcile = economy_aggregates.reconcile_stats();
+    o.Key("aggregates").BeginObject();
+    o.Field("sum_balance_mi", totals.sum_balance_mi);
+    o.Field("total_capital", totals.total_capital);
+    o.Field("users", totals.users);
+    o.Field("snakes", totals.snakes);
+    o.Field("reconciles", reconcile.reconciles);
+    o.Field("last_reconcile_unix", reconcile.last_unix);
+    o.Field("last_reconcile_ms", reconcile.last_duration_ms);
+    o.Field("last_balance_drift", reconcile.last_balance_drift);
+    o.Field("last_capital_drift", reconcile.last_capital_drift);
+    o.Field("last_kept_recent", reconcile.last_kept_recent);
+    o.Field("unknown_user_deltas", reconcile.unknown_user_deltas);
+    o.Field("users_seeded", reconcile.users_seeded);
+    o.EndObject();
+    const auto fin = economy.GetFinalizeProgress();
+    o.Key("finalization").BeginObject();
+    o.Field("period_id", fin.period_id);
+    o.Field("phase", fin.phase);
+    o.Field("users_total", fin.users_total);
+    o.Field("users_computed", fin.users_computed);
+    o.Field("rows_written", fin.rows_written);
+    o.Field("rows_failed", fin.rows_failed);
+    o.Field("started_at", fin.started_unix);
+    o.Field("finished_at", fin.finished_unix);
+    o.Field("duration_ms", fin.duration_ms);
+    o.EndObject();
+    const auto cache = economy.GetCacheStats();
+    o.Key("cache").BeginObject();
+    o.Field("version", cache.version);
+    o.Field("global_hits", cache.global_hits);
+    o.Field("global_misses", cache.global_misses);
+    o.Field("global_shared", cache.global_shared);
+    o.Field("user_hits", cache.users.hits);
+    o.Field("user_misses", cache.users.misses);
+    o.Field("user_shared", cache.user_shared);
+    o.Field("user_entries", cache.users.entries);
+    o.Field("user_capacity", cache.users.capacity);
+    o.Field("user_evictions", cache.users.evictions);
+    o.Field("user_invalidations", cache.users.invalidations);
+    o.EndObject();
+    const auto history = economy_history.stats();
+    o.Key("history").BeginObject();
+    o.Field("enabled", economy_history.enabled());
+    o.Field("global_segments", history.global_segments);
+    o.Field("user_segments", history.user_segments);
+    o.Field("global_rows", history.global_rows);
+    o.Field("user_rows", history.user_rows);
+    o.Field("append_failures", history.append_failures);
+    o.Field("stale_appends_skipped", history.stale_appends_skipped);
+    o.Field("segments_expired", history.segments_expired);
+    o.Field("oldest_us", history.oldest_us);
+    o.EndObject();
+    const auto boards = leaderboard.stats();
+    o.Key("leaderboard").BeginObject();
+    o.Field("version", boards.version);
+    o.Field("submitted", boards.submitted);
+    o.Field("batches_applied", boards.batches_applied);
+    o.Field("updates_applied", boards.updates_applied);
+    o.Field("ranked_snakes", boards.ranked_snakes);
+    o.Field("ranked_capital_users", boards.ranked_capital_users);
+    o.Field("ranked_output_users", boards.ranked_output_users);
+    o.Field("last_apply_us", boards.last_apply_us);
+    o.EndObject();
+    const auto ledger = cell_ledger.stats();
+    o.Key("cell_ledger").BeginObject();
+    o.Field("applied", ledger.applied);
+    o.Field("rejected", ledger.rejected);
+    o.Field("replayed", ledger.replayed);
+    o.Field("committed_ops", ledger.committed_ops);
+    o.Field("commits", ledger.commits);
+    o.Field("commit_failures", ledger.commit_failures);
+    o.Field("dropped_ops", ledger.dropped_ops);
+    o.Field("external_writes", ledger.external_writes);
+    o.Field("outstanding_ops", ledger.outstanding_ops);
+    o.Field("accounts", ledger.accounts);
+    o.Field("treasury", ledger.treasury);
+    o.Field("treasury_outstanding", ledger.treasury_outstanding);
+    o.Field("last_commit_ops", ledger.last_commit_ops);
+    o.Field("last_commit_ms", ledger.last_commit_ms);
+    o.EndObject();
+    o.EndObject();
+    res.set_content(o.str(), "application/json");
+  });
+
+  srv.Get("/admin/realtime/status", [&](const httplib::Request& req, httplib::Response& res) {
+    add_cors(res);
+    if (!require_admin_token(req, admin_token)) {
+      res.status = 401;
+      res.set_content("{\"error\":\"unauthorized_admin\"}", "application/json");
+      return;
+    }
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("ws_connections", ws_hub.size());
+    o.Field("ws_writer_threads", ws_hub.writer_threads());
+    o.Field("ws_send_threads", ws_send_pool.threads());
+    o.Field("ws_max_pending_events", runtime_cfg.ws_max_pending_events);
+    o.Field("ws_slow_consumer_ms", runtime_cfg.ws_slow_consumer_ms);
+    const auto cache_stats = user_cache->GetStats();
+    const auto session_stats = sessions.GetStats();
+    o.Key("sessions").BeginObject();
+    o.Field("count", session_stats.sessions);
+    o.Field("pinned", session_stats.pinned);
+    o.Field("approx_bytes", session_stats.approx_bytes);
+    o.Field("created", session_stats.created);
+    o.Field("evicted_idle", session_stats.evicted);
+    o.Field("ttl_seconds", runtime_cfg.session_ttl_seconds);
+    o.EndObject();
+    o.Key("auth_tokens").BeginObject();
+    o.Field("ttl_seconds", auth.ttl_seconds());
+    o.Field("revoked", auth.revoked_count());
+    o.EndObject();
+    if (google_verifier) {
+      const auto jwks = google_verifier->stats();
+      o.Key("google_keys").BeginObject();
+      o.Field("source", google_verifier->source().describe());
+      o.Field("keys", jwks.keys);
+      o.Field("refreshes", jwks.refreshes);
+      o.Field("refresh_failures", jwks.refresh_failures);
+      o.Field("last_refresh_unix", jwks.last_refresh_unix);
+      o.Field("verified", jwks.verified);
+      o.Field("rejected", jwks.rejected);
+      o.Field("unknown_kid", jwks.unknown_kid);
+      o.EndObject();
+    }
+    o.Key("user_cache").BeginObject();
+    o.Field("entries", cache_stats.entries);
+    o.Field("hits", cache_stats.hits);
+    o.Field("misses", cache_stats.misses);
+    o.Field("evictions", cache_stats.evictions);
+    o.Field("capacity", cache_stats.capacity);
+    o.EndObject();
+    o.Key("channels").BeginObject();
+    for (const auto ch : {realtime::Channel::kPublic, realtime::Channel::kPrivate}) {
+      const auto st = realtime::ReadChannelStats(ch);
+      o.Key(realtime::ChannelName(ch)).BeginObject();
+      o.Field("queue_depth", st.depth);
+      o.Field("enqueued", st.enqueued);
+      o.Field("sent", st.sent);
+      o.Field("dropped_superseded", st.dropped);
+      o.Field("send_failures", st.send_failures);
+      o.Field("deferred_sends", st.deferred_sends);
+      o.Field("slow_disconnects", st.slow_disconnects);
+      o.Field("send_latency_avg_ms",
+              st.sent > 0 ? static_cast<double>(st.latency_us_total) / static_cast<double>(st.sent) / 1000.0 : 0.0);
+      o.Field("send_latency_max_ms", static_cast<double>(st.latency_us_max) / 1000.0);
+      o.EndObject();
+    }
+    o.EndObject();
+    o.EndObject();
+    res.set_content(o.str(), "application/json");
+  });
+
+  srv.Get("/admin/flight/captures", [&](const httplib::Request& req, httplib::Response& res) {
+    add_cors(res);
+    if (!require_admin_token(req, admin_token)) {
+      res.status = 401;
+      res.set_content("{\"error\":\"unauthorized_admin\"}", "application/json");
+      return;
+    }
+    const auto st = flight_recorder.stats();
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("enabled", flight_recorder.enabled());
+    o.Field("slow_tick_ms", runtime_cfg.flight_recorder_slow_tick_ms);
+    o.Field("max_captures", runtime_cfg.flight_recorder_max_captures);
+    o.Field("captured", st.captured);
+    o.Field("suppressed", st.suppressed);
+    o.Field("write_failures", st.write_failures);
+    o.Key("captures").BeginArray();
+    for (const auto& e : flight_recorder.List()) {
+      o.BeginObject();
+      o.Field("id", e.id);
+      o.Field("created_ms", e.created_ms);
+      o.Field("bytes", e.bytes);
+      o.Field("download", "/admin/flight/captures/" + e.id);
+      o.RawField("summary", e.summary_json.empty() ? "null" : e.summary_json);
+      o.EndObject();
+    }
+    o.EndArray();
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
+  srv.Get(R"(/admin/flight/captures/([a-z0-9-]+))", [&](const httplib::Request& req, httplib::Response& res) {
+    add_cors(res);
+    if (!require_admin_token(req, admin_token)) {
+      res.status = 401;
+      res.set_content("{\"error\":\"unauthorized_admin\"}", "application/json");
+      return;
+    }
+    const string id = req.matches[1];
+    auto blob = flight_recorder.Read(id);
+    if (!blob) {
+      res.status = 404;
+      res.set_content("{\"error\":\"not_found\"}", "application/json");
+      return;
+    }
+    res.set_header("Content-Disposition", "attachment; filename=\"" + id + ".bin\"");
+    res.set_content(std::move(*blob), "application/octet-stream");
+  });
+
+  // Blocks this worker for the capture window; open the result in Perfetto or chrome://tracing.
+  srv.Get("/admin/trace", [&](const httplib::Request& req, httplib::Response& res) {
+    add_cors(res);
+    if (!require_admin_token(req, admin_token)) {
+      res.status = 401;
+      res.set_content("{\"error\":\"unauthorized_admin\"}", "application/json");
+      return;
+    }
+    const int seconds = req.has_param("seconds") ? std::clamp(atoi(req.get_param_value("seconds").c_str()), 1, 30) : 5;
+    auto capture = diagnostics::DefaultTracer().Run(chrono::seconds(seconds));
+    if (!capture) {
+      res.status = 409;
+      res.set_content("{\"error\":\"trace_in_progress\"}", "application/json");
+      return;
+    }
+    cout << "[trace] captured seconds=" << seconds << " events=" << capture->events << " dropped=" << capture->dropped
+         << "\n";
+    res.set_header("Content-Disposition", "attachment; filename=\"snake-trace.json\"");
+    res.set_content(std::move(capture->json), "application/json");
+  });
+
   srv.Post("/admin/economy/recompute", [&](const httplib::Request& req, httplib::Response& res) {
     add_cors(res);
     if (!require_admin_token(req, admin_token)) {
@@ -2265,8 +3083,9 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"unauthorized_admin\"}", "application/json");
       return;
     }
-    const bool force_rewrite = get_json_bool_field(req.body, "force_rewrite").value_or(false);
-    const std::string period_id = get_json_string_field(req.body, "period_id").value_or(economy.GetState().period_id);
+    const protocol::JsonFields body(req.body);
+    const bool force_rewrite = body.GetBool("force_rewrite").value_or(false);
+    const std::string period_id = body.GetString("period_id").value_or(economy.GetState().period_id);
     const auto existing = storage->GetEconomyPeriod(period_id).value_or(storage::EconomyPeriod{});
     if (existing.is_finalized && !force_rewrite) {
       res.status = 409;
@@ -2275,18 +3094,18 @@ int main(int argc, char** argv) {
     }
     const auto snap = economy.RecomputeAndPersist(period_id, std::nullopt, force_rewrite);
     maybe_resize_world_from_economy(snap);
-    std::ostringstream o;
-    o << "{"
-      << "\"ok\":true,"
-      << "\"period_id\":\"" << json_escape(period_id) << "\","
-      << "\"force_rewrite\":" << (force_rewrite ? "true" : "false") << ","
-      << "\"Y\":" << snap.global.y << ","
-      << "\"K\":" << snap.global.k << ","
-      << "\"L\":" << snap.global.l << ","
-      << "\"M\":" << snap.global.m << ","
-      << "\"P\":" << json_number(snap.global.p) << ","
-      << "\"pi\":" << json_number(snap.global.pi)
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("ok", true);
+    o.Field("period_id", period_id);
+    o.Field("force_rewrite", force_rewrite);
+    o.Field("Y", snap.global.y);
+    o.Field("K", snap.global.k);
+    o.Field("L", snap.global.l);
+    o.Field("M", snap.global.m);
+    o.Field("P", snap.global.p);
+    o.Field("pi", snap.global.pi);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -2297,8 +3116,9 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"unauthorized_admin\"}", "application/json");
       return;
     }
-    const auto param = get_json_string_field(req.body, "param");
-    const auto value_s = get_json_string_field(req.body, "value");
+    const protocol::JsonFields body(req.body);
+    const auto param = body.GetString("param");
+    const auto value_s = body.GetString("value");
     if (!param.has_value() || !value_s.has_value()) {
       res.status = 400;
       res.set_content("{\"error\":\"bad_payload\"}", "application/json");
@@ -2347,6 +3167,7 @@ int main(int argc, char** argv) {
       return;
     }
     economy.InvalidateCache();
+    cell_ledger.RefreshTreasury();
     auto snap = economy.GetState();
     maybe_resize_world_from_economy(snap);
     storage::SnakeEvent event;
@@ -2365,7 +3186,8 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"unauthorized_admin\"}", "application/json");
       return;
     }
-    auto amount = get_json_int_field(req.body, "amount");
+    const protocol::JsonFields body(req.body);
+    auto amount = body.GetInt("amount");
     if (!amount || *amount < 0) {
       res.status = 400;
       res.set_content("{\"error\":\"bad_amount\"}", "application/json");
@@ -2381,6 +3203,7 @@ int main(int argc, char** argv) {
       return;
     }
     economy.InvalidateCache();
+    cell_ledger.RefreshTreasury();
     storage::SnakeEvent event;
     event.snake_id = "system";
     event.event_id = std::to_string(static_cast<int64_t>(time(nullptr))) + "#admin_treasury_set";
@@ -2414,19 +3237,19 @@ int main(int argc, char** argv) {
     int64_t deployed = 0;
     for (const auto& s : snakes) deployed += static_cast<int64_t>(std::max(0, s.length_k));
 
-    ostringstream o;
-    o << "{"
-      << "\"user_id\":" << *uid << ","
-      << "\"auth_provider\":\"" << json_escape(user->auth_provider) << "\","
-      << "\"onboarding_completed\":" << (user->onboarding_completed ? "true" : "false") << ","
-      << "\"company_name\":\"" << json_escape(user->company_name) << "\","
-      << "\"starter_snake_id\":\"" << json_escape(user->starter_snake_id) << "\","
-      << "\"balance_mi\":" << user->balance_mi << ","
-      << "\"liquid_assets\":" << user->balance_mi << ","
-      << "\"deployed_k\":" << deployed << ","
-      << "\"snake_count\":" << snakes.size() << ","
-      << "\"last_seen_world_version\":\"" << json_escape(user->last_seen_world_version) << "\""
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("user_id", *uid);
+    o.Field("auth_provider", user->auth_provider);
+    o.Field("onboarding_completed", user->onboarding_completed);
+    o.Field("company_name", user->company_name);
+    o.Field("starter_snake_id", user->starter_snake_id);
+    o.Field("balance_mi", user->balance_mi);
+    o.Field("liquid_assets", user->balance_mi);
+    o.Field("deployed_k", deployed);
+    o.Field("snake_count", snakes.size());
+    o.Field("last_seen_world_version", user->last_seen_world_version);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -2438,7 +3261,8 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"unauthorized\"}", "application/json");
       return;
     }
-    auto version = get_json_string_field(req.body, "version");
+    const protocol::JsonFields body(req.body);
+    auto version = body.GetString("version");
     if (!version.has_value() || !is_strict_semver(*version)) {
       res.status = 400;
       res.set_content("{\"error\":\"bad_version\"}", "application/json");
@@ -2452,6 +3276,19 @@ int main(int argc, char** argv) {
     res.set_content("{\"ok\":true}", "application/json");
   });
 
+  // Client idempotency key for cell ledger ops: body "op_id" or the
+  // Idempotency-Key header. Empty when neither is sent.
+  const auto request_op_id = [](const httplib::Request& req, const protocol::JsonFields& body) -> string {
+    if (auto v = body.GetString("op_id")) return v->substr(0, 128);
+    return req.get_header_value("Idempotency-Key").substr(0, 128);
+  };
+  const auto cell_ledger_error_status = [](const string& error) {
+    if (error == "invalid_amount") return 400;
+    if (error == "user_not_found") return 404;
+    if (error == "ledger_stopped") return 503;
+    return 409;
+  };
+
   auto handle_borrow_cells = [&](const httplib::Request& req, httplib::Response& res) {
     add_cors(res);
     auto uid = require_auth_user(auth, req);
@@ -2469,8 +3306,9 @@ int main(int argc, char** argv) {
       return;
     }
 
-    auto amount = get_json_int_field(req.body, "amount");
-    if (!amount) amount = get_json_int_field(req.body, "cells");
+    const protocol::JsonFields body(req.body);
+    auto amount = body.GetInt("amount");
+    if (!amount) amount = body.GetInt("cells");
     if (!amount || *amount <= 0 || *amount > runtime_cfg.max_borrow_per_call) {
       std::cerr << "[economy_action] action=borrow"
                 << " user_id=" << *uid
@@ -2485,73 +3323,37 @@ int main(int argc, char** argv) {
       return;
     }
 
-    int64_t balance_after = 0;
     const string user_id = std::to_string(*uid);
-    const auto user_before = storage->GetUserById(user_id);
-    if (!user_before.has_value()) {
-      std::cerr << "[economy_action] action=borrow"
-                << " user_id=" << user_id
-                << " amount=" << *amount
-                << " profile=" << runtime_cfg.persistence_profile
-                << " intent_type=UserBalanceChanged+TreasuryBalanceChanged"
-                << " policy_result=validation_reject"
-                << " rejection_reason=unauthorized"
-                << " treasury_balance_before=-1\n";
-      res.status = 404;
-      res.set_content("{\"error\":\"user_not_found\"}", "application/json");
-      return;
-    }
-    const auto eco_before = economy.GetState();
-    const string period_key = eco_before.period_id;
-    if (eco_before.global.treasury_balance < *amount) {
+    // Borrowing moves cells from the treasury to the user, so M and the rest of
+    // the macro snapshot are unchanged; the cached snapshot serves both the
+    // log lines and the response.
+    const auto eco = economy.GetState();
+    const string period_key = economy::CurrentPeriodState(std::time(nullptr), economy_period_cfg).period_id;
+    const auto op = cell_ledger.Apply(
+        Ledger::MakeOp(Ledger::OpKind::kBorrow, user_id, *amount, request_op_id(req, body), period_key),
+        cell_ledger_wait);
+    if (!op.ok) {
       std::cerr << "[economy_action] action=borrow"
                 << " user_id=" << user_id
                 << " amount=" << *amount
                 << " profile=" << runtime_cfg.persistence_profile
                 << " intent_type=UserBalanceChanged+TreasuryBalanceChanged"
                 << " policy_result=validation_reject"
-                << " rejection_reason=insufficient_treasury"
-                << " treasury_balance_before=" << eco_before.global.treasury_balance << "\n";
-      res.status = 409;
-      res.set_content("{\"error\":\"insufficient_treasury\"}", "application/json");
+                << " rejection_reason=" << op.error
+                << " treasury_balance_before=" << cell_ledger.stats().treasury << "\n";
+      res.status = cell_ledger_error_status(op.error);
+      res.set_content("{\"error\":\"" + json_escape(op.error) + "\"}", "application/json");
       return;
     }
-    std::string borrow_error;
-    if (!storage->BorrowCellsAndTrackPeriod(user_id, *amount, period_key, balance_after, &borrow_error)) {
-      if (borrow_error.empty()) borrow_error = "internal_error";
-      const std::string rejection_reason = (borrow_error == "policy_rejected")
-                                               ? "persistence_write_failed"
-                                               : borrow_error;
-      std::cerr << "[borrow] reject user_id=" << user_id
-                << " amount=" << *amount
-                << " user_liquid_before=" << (user_before.has_value() ? user_before->balance_mi : -1)
-                << " treasury_before=" << eco_before.global.treasury_balance
-                << " money_supply_before=" << eco_before.global.m
-                << " reason=" << borrow_error << "\n";
-      std::cerr << "[economy_action] action=borrow"
-                << " user_id=" << user_id
-                << " amount=" << *amount
-                << " profile=" << runtime_cfg.persistence_profile
-                << " intent_type=UserBalanceChanged+TreasuryBalanceChanged"
-                << " policy_result=storage_reject"
-                << " rejection_reason=" << rejection_reason
-                << " treasury_balance_before=" << eco_before.global.treasury_balance << "\n";
-      res.status = (borrow_error == "internal_error") ? 500 : 409;
-      res.set_content("{\"error\":\"" + json_escape(borrow_error) + "\"}", "application/json");
-      return;
-    }
-
-    economy.InvalidateCache();
-    const auto eco = economy.GetState();
-    const auto user_after = storage->GetUserById(user_id);
+    const int64_t balance_after = op.balance_after;
     std::cerr << "[borrow] success user_id=" << user_id
               << " amount=" << *amount
-              << " user_liquid_before=" << (user_before.has_value() ? user_before->balance_mi : -1)
-              << " user_liquid_after=" << (user_after.has_value() ? user_after->balance_mi : balance_after)
-              << " treasury_before=" << eco_before.global.treasury_balance
-              << " treasury_after=" << eco.global.treasury_balance
-              << " money_supply_before=" << eco_before.global.m
-              << " money_supply_after=" << eco.global.m << "\n";
+              << " user_liquid_after=" << balance_after
+              << " treasury_before=" << (op.treasury_after + *amount)
+              << " treasury_after=" << op.treasury_after
+              << " money_supply=" << eco.global.m
+              << " durable=" << (op.durable ? "true" : "false")
+              << " replayed=" << (op.replayed ? "true" : "false") << "\n";
     std::cerr << "[economy_action] action=borrow"
               << " user_id=" << user_id
               << " amount=" << *amount
@@ -2559,28 +3361,30 @@ int main(int argc, char** argv) {
               << " intent_type=UserBalanceChanged+TreasuryBalanceChanged"
               << " policy_result=applied"
               << " rejection_reason=none"
-              << " treasury_balance_before=" << eco_before.global.treasury_balance << "\n";
+              << " treasury_balance_before=" << (op.treasury_after + *amount) << "\n";
     maybe_resize_world_from_economy(eco);
     const int64_t a_world = economy_world_area(eco.params, eco.global);
     const int64_t m_white = std::max<int64_t>(0, a_world - eco.global.k);
 
-    ostringstream o;
-    o << "{"
-      << "\"ok\":true,"
-      << "\"amount\":" << *amount << ","
-      << "\"balance_mi\":" << balance_after << ","
-      << "\"liquid_assets\":" << balance_after << ","
-      << "\"period_key\":\"" << json_escape(eco.period_id) << "\","
-      << "\"economy\":{"
-      << "\"M\":" << eco.global.m << ","
-      << "\"K\":" << eco.global.k << ","
-      << "\"A_world\":" << a_world << ","
-      << "\"M_white\":" << m_white << ","
-      << "\"extracted_output\":" << eco.global.y << ","
-      << "\"P\":" << json_number(eco.global.p) << ","
-      << "\"pi\":" << json_number(eco.global.pi)
-      << "}"
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("ok", true);
+    o.Field("amount", *amount);
+    o.Field("balance_mi", balance_after);
+    o.Field("liquid_assets", balance_after);
+    o.Field("treasury_balance", op.treasury_after);
+    o.Field("committed", op.durable);
+    o.Field("period_key", period_key);
+    o.Key("economy").BeginObject();
+    o.Field("M", eco.global.m);
+    o.Field("K", eco.global.k);
+    o.Field("A_world", a_world);
+    o.Field("M_white", m_white);
+    o.Field("extracted_output", eco.global.y);
+    o.Field("P", eco.global.p);
+    o.Field("pi", eco.global.pi);
+    o.EndObject();
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   };
 
@@ -2602,18 +3406,14 @@ int main(int argc, char** argv) {
     const std::string uid_str = std::to_string(uid);
     const std::string snake_id_str = std::to_string(snake_id);
 
-    auto append_id = [](std::ostringstream& oss, bool& first, const std::string& id) {
-      if (!first) oss << ",";
-      first = false;
-      oss << id;
+    auto append_id = [](std::string& ids, const std::string& id) {
+      if (!ids.empty()) ids.push_back(',');
+      ids += id;
     };
 
-    std::ostringstream panel_ids;
-    bool first_panel = true;
     for (const auto& s : game.list_user_snakes(uid)) {
-      append_id(panel_ids, first_panel, std::to_string(s.id));
+      append_id(out.panel_ids, std::to_string(s.id));
     }
-    out.panel_ids = panel_ids.str();
 
     auto snake = storage->GetSnakeById(snake_id_str);
     if (!snake.has_value()) {
@@ -2623,13 +3423,10 @@ int main(int argc, char** argv) {
       if (snake.has_value()) out.lookup_layer = "durable_storage_after_flush";
     }
 
-    std::ostringstream lookup_ids;
-    bool first_lookup = true;
     for (const auto& s : storage->ListSnakes()) {
       if (s.owner_user_id != uid_str) continue;
-      append_id(lookup_ids, first_lookup, s.snake_id);
+      append_id(out.lookup_ids, s.snake_id);
     }
-    out.lookup_ids = lookup_ids.str();
 
     if (!snake.has_value()) {
       out.reason = "snake_not_found";
@@ -2682,7 +3479,8 @@ int main(int argc, char** argv) {
     }
 
     int snake_id = stoi(req.matches[1]);
-    auto amount = get_json_int_field(req.body, "amount");
+    const protocol::JsonFields body(req.body);
+    auto amount = body.GetInt("amount");
     if (!amount || *amount <= 0) {
       res.status = 400;
       res.set_content("{\"error\":\"bad_amount\"}", "application/json");
@@ -2691,17 +3489,6 @@ int main(int argc, char** argv) {
 
     const std::string uid_str = std::to_string(*uid);
     const auto eco_before = economy.GetState();
-    const auto user = storage->GetUserById(uid_str);
-    if (!user.has_value()) {
-      res.status = 404;
-      res.set_content("{\"error\":\"user_not_found\"}", "application/json");
-      return;
-    }
-    if (user->balance_mi < *amount) {
-      res.status = 409;
-      res.set_content("{\"error\":\"insufficient_cells\"}", "application/json");
-      return;
-    }
     const auto resolved = resolve_owned_snake_or_error(*uid, snake_id, "attach");
     if (!resolved.ok) {
       res.status = resolved.forbidden ? 403 : 404;
@@ -2717,21 +3504,43 @@ int main(int argc, char** argv) {
     }
     const std::string resolved_snake_id_str = std::to_string(snake_id);
 
-    int64_t balance_after = 0;
-    int64_t snake_len_after = 0;
-    if (!storage->AttachCellsToSnake(uid_str, resolved_snake_id_str, *amount, balance_after, snake_len_after)) {
-      res.status = 409;
+    const string op_id = request_op_id(req, body);
+    const auto op =
+        cell_ledger.Apply(Ledger::MakeOp(Ledger::OpKind::kDebit, uid_str, *amount, op_id), cell_ledger_wait);
+    if (!op.ok) {
       std::cerr << "[attach_trace] action=attach route=/snake/{id}/attach"
                 << " user_id=" << uid_str
                 << " snake_id_requested=" << std::to_string(snake_id)
                 << " amount=" << *amount
                 << " profile=" << runtime_cfg.persistence_profile
-                << " lookup_source=durable_storage"
+                << " lookup_source=cell_ledger"
                 << " snake_lookup_succeeded=true"
                 << " create_snake_invoked=false"
-                << " response_code=409"
-                << " error=attach_conflict\n";
-      res.set_content("{\"error\":\"attach_conflict\"}", "application/json");
+                << " response_code=" << cell_ledger_error_status(op.error)
+                << " error=" << op.error << "\n";
+      res.status = cell_ledger_error_status(op.error);
+      res.set_content("{\"error\":\"" + json_escape(op.error) + "\"}", "application/json");
+      return;
+    }
+    const int64_t balance_after = op.balance_after;
+    if (op.replayed) {
+      // Same op_id as an attach that already went through: report, do not grow again.
+      int64_t length_now = snake.length_k;
+      for (const auto& ws : game.list_user_snakes(*uid)) {
+        if (ws.id == snake_id) {
+          length_now = static_cast<int64_t>(ws.body.size());
+          break;
+        }
+      }
+      protocol::JsonWriter o;
+      o.BeginObject();
+      o.Field("ok", true);
+      o.Field("replayed", true);
+      o.Field("balance_mi", balance_after);
+      o.Field("liquid_assets", balance_after);
+      o.Field("snake_length_k", length_now);
+      o.EndObject();
+      res.set_content(o.str(), "application/json");
       return;
     }
 
@@ -2741,6 +3550,9 @@ int main(int argc, char** argv) {
       game.load_from_storage_or_seed_positions();
       const auto refreshed = game.attach_cells_to_snake(*uid, snake_id, *amount);
       if (!refreshed.has_value()) {
+        (void)cell_ledger.Apply(Ledger::MakeOp(Ledger::OpKind::kCredit, uid_str, *amount,
+                                               op_id.empty() ? op_id : op_id + ":refund"),
+                                chrono::milliseconds(0));
         res.status = 500;
         res.set_content("{\"error\":\"attach_runtime_failed\"}", "application/json");
         return;
@@ -2748,21 +3560,18 @@ int main(int argc, char** argv) {
       world_len_after = refreshed;
     }
     game.flush_persistence_delta();
-    economy.InvalidateCache();
-    const auto eco_after = economy.GetState();
+    economy.InvalidateGlobal();
     std::cerr << "[attach] success user_id=" << uid_str
               << " snake_id=" << resolved_snake_id_str
               << " amount=" << *amount
-              << " user_liquid_before=" << user->balance_mi
+              << " user_liquid_before=" << (balance_after + *amount)
               << " user_liquid_after=" << balance_after
               << " snake_length_before=" << snake.length_k
               << " snake_length_after=" << *world_len_after
               << " total_capital_before=" << eco_before.global.k
-              << " total_capital_after=" << eco_after.global.k
               << " free_space_before=" << eco_before.stabilization.free_space_on_field
-              << " free_space_after=" << eco_after.stabilization.free_space_on_field
               << " money_supply_before=" << eco_before.global.m
-              << " money_supply_after=" << eco_after.global.m << "\n";
+              << " durable=" << (op.durable ? "true" : "false") << "\n";
     std::cerr << "[economy_action] action=attach"
               << " user_id=" << uid_str
               << " snake_id_requested=" << std::to_string(snake_id)
@@ -2782,13 +3591,13 @@ int main(int argc, char** argv) {
               << " response_code=200"
               << " error=none\n";
 
-    ostringstream o;
-    o << "{"
-      << "\"ok\":true,"
-      << "\"balance_mi\":" << balance_after << ","
-      << "\"liquid_assets\":" << balance_after << ","
-      << "\"snake_length_k\":" << *world_len_after
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("ok", true);
+    o.Field("balance_mi", balance_after);
+    o.Field("liquid_assets", balance_after);
+    o.Field("snake_length_k", *world_len_after);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -2821,15 +3630,8 @@ int main(int argc, char** argv) {
       }
     }
 
-    if (!storage->IncrementUserBalance(uid_str, refund_cells)) {
-      res.status = 500;
-      res.set_content("{\"error\":\"balance_update_failed\"}", "application/json");
-      return;
-    }
-
     bool deleted = storage->DeleteSnakeEventsBySnakeId(snake_id_str) && storage->DeleteSnake(snake_id_str);
     if (!deleted) {
-      (void)storage->IncrementUserBalance(uid_str, -refund_cells);
       std::cerr << "[snake_delete] user_id=" << uid_str
                 << " snake_id=" << snake_id
                 << " reason=snake_create_persist_failed"
@@ -2839,20 +3641,37 @@ int main(int argc, char** argv) {
       return;
     }
 
+    // Refund through the ledger so its cached balance for this user stays current.
+    int64_t balance_after = 0;
+    if (refund_cells > 0) {
+      const auto refund =
+          cell_ledger.Apply(Ledger::MakeOp(Ledger::OpKind::kCredit, uid_str, refund_cells), cell_ledger_wait);
+      if (!refund.ok) {
+        std::cerr << "[snake_delete] user_id=" << uid_str
+                  << " snake_id=" << snake_id
+                  << " reason=refund_failed"
+                  << " error=" << refund.error << "\n";
+        res.status = 500;
+        res.set_content("{\"error\":\"balance_update_failed\"}", "application/json");
+        return;
+      }
+      balance_after = refund.balance_after;
+    } else if (const auto user_after = storage->GetUserById(uid_str)) {
+      balance_after = user_after->balance_mi;
+    }
+
     (void)game.delete_snake_for_user(*uid, snake_id);
     game.flush_persistence_delta();
     game.load_from_storage_or_seed_positions();
-    economy.InvalidateCache();
-    const auto user_after = storage->GetUserById(uid_str);
-    const int64_t balance_after = user_after ? user_after->balance_mi : 0;
-
-    ostringstream o;
-    o << "{"
-      << "\"ok\":true,"
-      << "\"refunded_cells\":" << refund_cells << ","
-      << "\"balance_mi\":" << balance_after << ","
-      << "\"liquid_assets\":" << balance_after
-      << "}";
+    economy.InvalidateGlobal();
+
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("ok", true);
+    o.Field("refunded_cells", refund_cells);
+    o.Field("balance_mi", balance_after);
+    o.Field("liquid_assets", balance_after);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -2864,54 +3683,54 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"unauthorized_camera\"}", "application/json");
       return;
     }
-    auto sid = get_json_string_field(req.body, "sid");
-    auto x = get_json_int_field(req.body, "x");
-    auto y = get_json_int_field(req.body, "y");
+    const protocol::JsonFields body(req.body);
+    auto sid = body.GetString("sid");
+    auto x = body.GetInt("x");
+    auto y = body.GetInt("y");
     if (!sid || sid->empty() || !x || !y) {
       res.status = 400;
       res.set_content("{\"error\":\"bad_camera_payload\"}", "application/json");
       return;
     }
 
-    ClientSession session = get_or_create_session(*sid);
+    const auto session = get_or_create_session(*sid);
     const uint64_t now_millis = now_ms();
     const uint64_t min_gap = static_cast<uint64_t>(max(1, static_cast<int>(std::lround(1000.0 / static_cast<double>(runtime_cfg.camera_msg_max_hz)))));
-    if (session.last_camera_update_ms != 0 && now_millis - session.last_camera_update_ms < min_gap) {
+    const uint64_t last_update = session->last_camera_update_ms.load(std::memory_order_relaxed);
+    if (last_update != 0 && now_millis - last_update < min_gap) {
       res.set_content("{\"status\":\"THROTTLED\"}", "application/json");
       return;
     }
-    session.camera_x = max(0, min(grid_w - 1, *x));
-    session.camera_y = max(0, min(grid_h - 1, *y));
-    auto zoom = get_json_double_field(req.body, "zoom");
+    auto camera = session->camera();
+    camera.x = max(0, min(grid_w - 1, *x));
+    camera.y = max(0, min(grid_h - 1, *y));
+    auto zoom = body.GetDouble("zoom");
     if (zoom.has_value()) {
-      session.camera_zoom = max(0.25, min(4.0, *zoom));
+      camera.zoom = max(0.25, min(4.0, *zoom));
     }
-    session.auth_user_id = *uid;
-    session.subscribed_chunks_count = compute_subscribed_chunks_count(session);
-    session.last_camera_update_ms = now_millis;
-    session.updated_at_ms = now_ms();
+    session->SetCamera(camera);
+    session->set_auth_user_id(*uid);
+    const int aoi_chunks = compute_subscribed_chunks_count();
+    session->subscribed_chunks_count.store(aoi_chunks, std::memory_order_relaxed);
+    session->last_camera_update_ms.store(now_millis, std::memory_order_relaxed);
 
-    auto watch_snake = get_json_int_field(req.body, "watch_snake_id");
+    auto watch_snake = body.GetInt("watch_snake_id");
     if (watch_snake && *watch_snake > 0) {
-      session.watched_snake_id = *watch_snake;
+      session->set_watched_snake_id(*watch_snake);
     } else {
-      session.watched_snake_id.reset();
-    }
-
-    {
-      lock_guard<mutex> lock(sessions_mu);
-      sessions[*sid] = session;
-    }
-    ostringstream out;
-    out << "{"
-        << "\"status\":\"OK\","
-        << "\"camera_x\":" << session.camera_x << ","
-        << "\"camera_y\":" << session.camera_y << ","
-        << "\"camera_zoom\":" << json_number(session.camera_zoom) << ","
-        << "\"aoi_chunks\":" << session.subscribed_chunks_count << ","
-        << "\"mode\":\"AUTH\","
-        << "\"aoi_enabled\":" << (runtime_cfg.aoi_enabled ? "true" : "false")
-        << "}";
+      session->set_watched_snake_id(std::nullopt);
+    }
+
+    protocol::JsonWriter out;
+    out.BeginObject();
+    out.Field("status", "OK");
+    out.Field("camera_x", camera.x);
+    out.Field("camera_y", camera.y);
+    out.Field("camera_zoom", camera.zoom);
+    out.Field("aoi_chunks", aoi_chunks);
+    out.Field("mode", "AUTH");
+    out.Field("aoi_enabled", runtime_cfg.aoi_enabled);
+    out.EndObject();
     res.set_content(out.str(), "application/json");
   });
 
@@ -2920,31 +3739,28 @@ int main(int argc, char** argv) {
     const string sid = (req.has_param("sid") && !req.get_param_value("sid").empty())
                            ? req.get_param_value("sid")
                            : rand_token(16);
-    auto session = get_or_create_session(sid);
+    const auto session = get_or_create_session(sid);
 
     optional<int> uid;
     if (req.has_param("token")) {
       const auto token = req.get_param_value("token");
-      if (!token.empty()) uid = auth.token_to_user(token);
+      if (!token.empty()) uid = auth.Verify(token);
     }
     if (!uid) uid = require_auth_user(auth, req);
 
     if (uid) {
-      session.auth_user_id = *uid;
-      {
-        lock_guard<mutex> lock(sessions_mu);
-        sessions[sid] = session;
-      }
-      ostringstream o;
-      o << "{"
-        << "\"mode\":\"AUTH\","
-        << "\"camera_x\":" << session.camera_x << ","
-        << "\"camera_y\":" << session.camera_y << ","
-        << "\"zoom\":" << json_number(session.camera_zoom) << ","
-        << "\"aoi_radius\":" << runtime_cfg.auth_aoi_radius << ","
-        << "\"aoi_pad_chunks\":" << runtime_cfg.aoi_pad_chunks << ","
-        << "\"aoi_chunks\":" << session.subscribed_chunks_count
-        << "}";
+      session->set_auth_user_id(*uid);
+      const auto camera = session->camera();
+      protocol::JsonWriter o;
+      o.BeginObject();
+      o.Field("mode", "AUTH");
+      o.Field("camera_x", camera.x);
+      o.Field("camera_y", camera.y);
+      o.Field("zoom", camera.zoom);
+      o.Field("aoi_radius", runtime_cfg.auth_aoi_radius);
+      o.Field("aoi_pad_chunks", runtime_cfg.aoi_pad_chunks);
+      o.Field("aoi_chunks", session->subscribed_chunks_count.load(std::memory_order_relaxed));
+      o.EndObject();
       res.set_content(o.str(), "application/json");
       return;
     }
@@ -2954,17 +3770,20 @@ int main(int argc, char** argv) {
       lock_guard<mutex> lock(public_view_mu);
       pv = public_view;
     }
-    ostringstream o;
-    o << "{"
-      << "\"mode\":\"PUBLIC\","
-      << "\"camera_x\":" << pv.camera_x << ","
-      << "\"camera_y\":" << pv.camera_y << ","
-      << "\"zoom\":1.0,"
-      << "\"aoi_radius\":" << runtime_cfg.public_aoi_radius << ","
-      << "\"aoi_pad_chunks\":" << runtime_cfg.aoi_pad_chunks << ","
-      << "\"aoi_chunks\":" << (runtime_cfg.single_chunk_mode ? 1 : ((runtime_cfg.public_aoi_radius + runtime_cfg.aoi_pad_chunks) * 2 + 1) * ((runtime_cfg.public_aoi_radius + runtime_cfg.aoi_pad_chunks) * 2 + 1)) << ","
-      << "\"public_camera_chunk\":{\"cx\":" << pv.chunk_cx << ",\"cy\":" << pv.chunk_cy << "}"
-      << "}";
+    const int public_span = (runtime_cfg.public_aoi_radius + runtime_cfg.aoi_pad_chunks) * 2 + 1;
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("mode", "PUBLIC");
+    o.Field("camera_x", pv.camera_x);
+    o.Field("camera_y", pv.camera_y);
+    o.Field("zoom", 1.0);
+    o.Field("aoi_radius", runtime_cfg.public_aoi_radius);
+    o.Field("aoi_pad_chunks", runtime_cfg.aoi_pad_chunks);
+    o.Field("aoi_chunks", runtime_cfg.single_chunk_mode ? 1 : public_span * public_span);
+    o.Key("public_camera_chunk").BeginObject();
+    o.Field("cx", pv.chunk_cx).Field("cy", pv.chunk_cy);
+    o.EndObject();
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -2977,65 +3796,59 @@ int main(int argc, char** argv) {
     const string sid = (req.has_param("sid") && !req.get_param_value("sid").empty())
                            ? req.get_param_value("sid")
                            : rand_token(16);
-    ClientSession initial_session = get_or_create_session(sid);
+    const auto session = get_or_create_session(sid);
     optional<int> stream_uid;
     if (req.has_param("token")) {
       const auto token = req.get_param_value("token");
-      if (!token.empty()) stream_uid = auth.token_to_user(token);
+      if (!token.empty()) stream_uid = auth.Verify(token);
     }
     if (!stream_uid) stream_uid = require_auth_user(auth, req);
-    if (stream_uid) {
-      initial_session.auth_user_id = *stream_uid;
-      initial_session.updated_at_ms = now_ms();
-      lock_guard<mutex> lock(sessions_mu);
-      sessions[sid] = initial_session;
-    }
+    session->subscribed_chunks_count.store(-1, std::memory_order_relaxed);  // SSE frames carry the full world
+    if (stream_uid) session->set_auth_user_id(*stream_uid);
 
     res.set_chunked_content_provider(
         "text/event-stream",
-        [&](size_t, httplib::DataSink& sink) {
+        [&, session](size_t, httplib::DataSink& sink) {
+          const realtime::SessionPin pin(session);
           uint64_t last_seq = 0;
           auto last_heartbeat = chrono::steady_clock::now();
           const auto heartbeat_every = chrono::seconds(10);
+          const auto send_dt = chrono::milliseconds(
+              max(1, static_cast<int>(std::lround(1000.0 / static_cast<double>(runtime_cfg.spectator_hz)))));
           auto next_send_at = chrono::steady_clock::now();
-          while (true) {
-            string payload;
-            uint64_t current_seq = 0;
-            {
-              lock_guard<mutex> lock(snapshot_mu);
-              current_seq = snapshot_seq;
+          while (!snapshot_feed.stopped()) {
+            const uint64_t current_seq = snapshot_feed.WaitForNext(last_seq, last_heartbeat + heartbeat_every);
+            const auto now = chrono::steady_clock::now();
+            if (current_seq != last_seq && now >= next_send_at) {
+              // One encode per broadcast, shared by every stream.
+              const auto frame = snapshot_feed.Current(
+                  [&] {
+                    metrics::ScopedTimer encode_timer(sse_encode_seconds);
+                    string payload = "event: frame\ndata: ";
+                    payload += state_to_json(game.snapshot());
+                    payload += "\n\n";
+                    sse_encode_bytes.Observe(static_cast<double>(payload.size()));
+                    return payload;
+                  },
+                  &last_seq);
+              // Same quarter-period slack as the WS hub to avoid aliasing against the broadcast grid.
+              next_send_at = now + send_dt - send_dt / 4;
+              if (!sink.write(frame->data(), frame->size())) break;
+              continue;
             }
             if (current_seq != last_seq) {
-              ClientSession session = get_or_create_session(sid);
-              const int rate_hz = runtime_cfg.spectator_hz;
-              const auto send_dt = chrono::milliseconds(
-                  max(1, static_cast<int>(std::lround(1000.0 / static_cast<double>(rate_hz)))));
-              const auto now = chrono::steady_clock::now();
-              if (now >= next_send_at) {
-                last_seq = current_seq;
-                next_send_at = now + send_dt;
-                session.subscribed_chunks_count = -1;
-                {
-                  lock_guard<mutex> lock(sessions_mu);
-                  sessions[sid] = session;
-                }
-
-                const string encoded = state_to_json(game.snapshot());
-                payload = "event: frame\n";
-                payload += "data: " + encoded + "\n\n";
-              }
+              // Broadcast faster than SPECTATOR_HZ: skip this one.
+              last_seq = current_seq;
+              continue;
             }
-            if (payload.empty()) {
-              const auto now = chrono::steady_clock::now();
-              if (now - last_heartbeat >= heartbeat_every) {
-                payload = ": keepalive\n\n";
-                last_heartbeat = now;
-              }
+            if (now - last_heartbeat >= heartbeat_every) {
+              static const char kKeepalive[] = ": keepalive\n\n";
+              if (!sink.write(kKeepalive, sizeof(kKeepalive) - 1)) break;
+              last_heartbeat = now;
             }
-            if (!payload.empty() && !sink.write(payload.data(), payload.size())) break;
-            const int poll_ms = max(1, runtime_cfg.SpectatorIntervalMs() / 2);
-            this_thread::sleep_for(chrono::milliseconds(poll_ms));
           }
+          // Idle TTL starts when the stream goes away.
+          session->updated_at_ms.store(now_ms(), std::memory_order_relaxed);
           sink.done();
           return true;
         });
@@ -3064,13 +3877,19 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"google_client_id_missing\"}", "application/json");
       return;
     }
-    auto id_token = get_json_string_field(req.body, "id_token");
+    const protocol::JsonFields body(req.body);
+    auto id_token = body.GetString("id_token");
     if (!id_token || id_token->empty()) {
       res.status = 400;
       res.set_content("{\"error\":\"missing_id_token\"}", "application/json");
       return;
     }
-    const auto claims = verify_google_id_token_with_google(*id_token);
+    if (!google_verifier || google_verifier->stats().keys == 0) {
+      res.status = 503;
+      res.set_content("{\"error\":\"google_keys_unavailable\"}", "application/json");
+      return;
+    }
+    const auto claims = verify_google_id_token(*google_verifier, *id_token);
     if (!claims.has_value()) {
       res.status = 401;
       res.set_content("{\"error\":\"invalid_google_token\"}", "application/json");
@@ -3136,14 +3955,27 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"user_id_invalid\"}", "application/json");
       return;
     }
-    string token = auth.issue_token(uid);
-    ostringstream o;
-    o << "{"
-      << "\"token\":\"" << json_escape(token) << "\","
-      << "\"user_id\":" << uid << ","
-      << "\"first_login\":" << (first_login ? "true" : "false") << ","
-      << "\"onboarding_required\":" << (user->onboarding_completed ? "false" : "true")
-      << "}";
+    string token = auth.Issue(uid);
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("token", token);
+    o.Field("user_id", uid);
+    o.Field("first_login", first_login);
+    o.Field("onboarding_required", !user->onboarding_completed);
+    o.EndObject();
+    res.set_content(o.str(), "application/json");
+  });
+
+  srv.Post("/auth/logout", [&](const httplib::Request& req, httplib::Response& res) {
+    add_cors(res);
+    const string v = req.get_header_value("Authorization");
+    const string prefix = "Bearer ";
+    const bool revoked = v.rfind(prefix, 0) == 0 && auth.Revoke(std::string_view(v).substr(prefix.size()));
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("ok", true);
+    o.Field("revoked", revoked);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -3170,9 +4002,8 @@ int main(int argc, char** argv) {
     const bool valid = is_valid_game_name(name);
     const string norm = normalize_name(name);
     const bool taken = valid ? storage->CompanyNameExistsNormalized(norm) : false;
-    ostringstream o;
-    o << "{\"valid\":" << (valid ? "true" : "false")
-      << ",\"taken\":" << (taken ? "true" : "false") << "}";
+    protocol::JsonWriter o;
+    o.BeginObject().Field("valid", valid).Field("taken", taken).EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -3187,9 +4018,8 @@ int main(int argc, char** argv) {
     const bool valid = is_valid_game_name(name);
     const string norm = normalize_name(name);
     const bool taken = valid ? snake_name_exists_globally(norm) : false;
-    ostringstream o;
-    o << "{\"valid\":" << (valid ? "true" : "false")
-      << ",\"taken\":" << (taken ? "true" : "false") << "}";
+    protocol::JsonWriter o;
+    o.BeginObject().Field("valid", valid).Field("taken", taken).EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -3213,8 +4043,9 @@ int main(int argc, char** argv) {
       res.set_content("{\"ok\":true,\"already_completed\":true}", "application/json");
       return;
     }
-    auto company_name = get_json_string_field(req.body, "company_name");
-    auto snake_name = get_json_string_field(req.body, "snake_name");
+    const protocol::JsonFields body(req.body);
+    auto company_name = body.GetString("company_name");
+    auto snake_name = body.GetString("snake_name");
     if (!company_name || !snake_name || !is_valid_game_name(*company_name) || !is_valid_game_name(*snake_name)) {
       res.status = 400;
       res.set_content("{\"error\":\"invalid_name\"}", "application/json");
@@ -3346,9 +4177,12 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"user_update_failed\"}", "application/json");
       return;
     }
-    ostringstream o;
-    o << "{\"ok\":true,\"starter_snake_id\":" << starter_snake_id
-      << ",\"starter_liquid_assets\":" << runtime_cfg.starter_liquid_assets << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("ok", true);
+    o.Field("starter_snake_id", starter_snake_id);
+    o.Field("starter_liquid_assets", runtime_cfg.starter_liquid_assets);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -3368,7 +4202,8 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"user_not_found\"}", "application/json");
       return;
     }
-    auto confirm = get_json_string_field(req.body, "company_name_confirmation");
+    const protocol::JsonFields body(req.body);
+    auto confirm = body.GetString("company_name_confirmation");
     if (!confirm || *confirm != user->company_name) {
       res.status = 400;
       res.set_content("{\"error\":\"company_name_mismatch\"}", "application/json");
@@ -3484,9 +4319,9 @@ int main(int argc, char** argv) {
     }
 
     const auto snakes = build_owned_snake_view(*uid);
-    ostringstream o;
-    o << "{\"snakes\":[";
-    bool first_written = true;
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Key("snakes").BeginArray();
     for (size_t i = 0; i < snakes.size(); ++i) {
       int snake_id_num = 0;
       try {
@@ -3501,16 +4336,16 @@ int main(int argc, char** argv) {
                   << " snake_id=" << snakes[i].snake_id << "\n";
         continue;
       }
-      const std::string snake_name = snakes[i].snake_name;
-      if (!first_written) o << ",";
-      first_written = false;
-      o << "{" << "\"id\":" << snake_id_num << ","
-        << "\"name\":\"" << json_escape(snake_name) << "\","
-        << "\"color\":\"" << json_escape(snakes[i].color) << "\","
-        << "\"paused\":" << (snakes[i].paused ? "true" : "false") << ","
-        << "\"len\":" << snakes[i].length_k << "}";
-    }
-    o << "]}";
+      o.BeginObject();
+      o.Field("id", snake_id_num);
+      o.Field("name", snakes[i].snake_name);
+      o.Field("color", snakes[i].color);
+      o.Field("paused", snakes[i].paused);
+      o.Field("len", snakes[i].length_k);
+      o.EndObject();
+    }
+    o.EndArray();
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -3523,7 +4358,8 @@ int main(int argc, char** argv) {
       return;
     }
     int snake_id = stoi(req.matches[1]);
-    auto snake_name = get_json_string_field(req.body, "snake_name");
+    const protocol::JsonFields body(req.body);
+    auto snake_name = body.GetString("snake_name");
     if (!snake_name || !is_valid_game_name(*snake_name)) {
       res.status = 400;
       res.set_content("{\"error\":\"invalid_snake_name\"}", "application/json");
@@ -3556,12 +4392,12 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"rename_failed\"}", "application/json");
       return;
     }
-    std::ostringstream o;
-    o << "{"
-      << "\"ok\":true,"
-      << "\"id\":" << snake_id << ","
-      << "\"name\":\"" << json_escape(snake.snake_name) << "\""
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("ok", true);
+    o.Field("id", snake_id);
+    o.Field("name", snake.snake_name);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -3575,7 +4411,8 @@ int main(int argc, char** argv) {
     }
 
     int snake_id = stoi(req.matches[1]);
-    auto d = get_json_int_field(req.body, "dir");
+    const protocol::JsonFields body(req.body);
+    auto d = body.GetInt("dir");
     if (!d || *d < 1 || *d > 4) {
       res.status = 400;
       res.set_content("{\"error\":\"bad_dir\"}", "application/json");
@@ -3619,8 +4456,9 @@ int main(int argc, char** argv) {
       return;
     }
 
-    auto c = get_json_string_field(req.body, "color");
-    auto snake_name = get_json_string_field(req.body, "snake_name");
+    const protocol::JsonFields body(req.body);
+    auto c = body.GetString("color");
+    auto snake_name = body.GetString("snake_name");
     string color = c ? *c : "#ff00ff";
     const string uid_str = std::to_string(*uid);
     if (!snake_name || !is_valid_game_name(*snake_name)) {
@@ -3640,40 +4478,36 @@ int main(int argc, char** argv) {
       return;
     }
 
-    auto user = storage->GetUserById(uid_str);
-    if (!user.has_value()) {
-      res.status = 404;
-      res.set_content("{\"error\":\"user_not_found\"}", "application/json");
-      return;
-    }
-    if (user->balance_mi < 1) {
-      res.status = 409;
-      res.set_content("{\"error\":\"insufficient_cells\"}", "application/json");
-      return;
-    }
-    if (!storage->IncrementUserBalance(uid_str, -1)) {
-      std::cerr << "[me_snakes_create] user_id=" << uid_str
-                << " reason=snake_create_persist_failed"
-                << " step=debit_user_balance\n";
-      res.status = 500;
-      res.set_content("{\"error\":\"balance_update_failed\"}", "application/json");
+    const auto debit = cell_ledger.Apply(Ledger::MakeOp(Ledger::OpKind::kDebit, uid_str, 1), cell_ledger_wait);
+    if (!debit.ok) {
+      if (debit.error != "insufficient_cells" && debit.error != "user_not_found") {
+        std::cerr << "[me_snakes_create] user_id=" << uid_str
+                  << " reason=snake_create_persist_failed"
+                  << " step=debit_user_balance"
+                  << " error=" << debit.error << "\n";
+      }
+      res.status = cell_ledger_error_status(debit.error);
+      res.set_content("{\"error\":\"" + json_escape(debit.error) + "\"}", "application/json");
       return;
     }
+    auto refund_creation_cell = [&]() {
+      (void)cell_ledger.Apply(Ledger::MakeOp(Ledger::OpKind::kCredit, uid_str, 1), chrono::milliseconds(0));
+    };
 
     auto rollback_created_snake = [&](int created_id) {
       (void)game.delete_snake_for_user(*uid, created_id);
       game.flush_persistence_delta();
       (void)storage->DeleteSnakeEventsBySnakeId(std::to_string(created_id));
       (void)storage->DeleteSnake(std::to_string(created_id));
-      (void)storage->IncrementUserBalance(uid_str, 1);
+      refund_creation_cell();
       game.load_from_storage_or_seed_positions();
-      economy.InvalidateCache();
+      economy.InvalidateGlobal();
     };
 
     auto id = game.create_snake_for_user(*uid, color, *snake_name, snake_name_norm);
     if (!id) {
-      // Roll back storage debit when snake creation fails (limit/placement/etc).
-      storage->IncrementUserBalance(uid_str, 1);
+      // Roll back the debit when snake creation fails (limit/placement/etc).
+      refund_creation_cell();
       std::cerr << "[me_snakes_create] user_id=" << uid_str
                 << " reason=snake_create_persist_failed"
                 << " step=create_snake_runtime\n";
@@ -3724,18 +4558,16 @@ int main(int argc, char** argv) {
       res.set_content("{\"error\":\"snake_name_persist_failed\"}", "application/json");
       return;
     }
-    economy.InvalidateCache();
+    economy.InvalidateGlobal();
+    const int64_t balance_after = debit.balance_after;
 
-    const auto user_after = storage->GetUserById(uid_str);
-    const int64_t balance_after = user_after ? user_after->balance_mi : 0;
-
-    ostringstream o;
-    o << "{"
-      << "\"id\":" << *id << ","
-      << "\"name\":\"" << json_escape(created_snake_in_view->snake_name) << "\","
-      << "\"balance_mi\":" << balance_after << ","
-      << "\"liquid_assets\":" << balance_after
-      << "}";
+    protocol::JsonWriter o;
+    o.BeginObject();
+    o.Field("id", *id);
+    o.Field("name", created_snake_in_view->snake_name);
+    o.Field("balance_mi", balance_after);
+    o.Field("liquid_assets", balance_after);
+    o.EndObject();
     res.set_content(o.str(), "application/json");
   });
 
@@ -3743,13 +4575,27 @@ int main(int argc, char** argv) {
   cout << "WS:    GET /ws\n";
   cout << "State: GET /game/state\n";
   cout << "Login: POST /auth/google {id_token}\n";
+  cout << "Logout: POST /auth/logout (Bearer token)\n";
 
   srv.listen(bind_host, bind_port);
 
   running.store(false);
+  snapshot_feed.Shutdown();
+  {
+    lock_guard<mutex> lock(economy_broadcast_mu);
+  }
+  economy_broadcast_cv.notify_all();
+  economy_broadcaster.join();
   loop.join();
+  ws_hub.Stop();
+  ws_send_pool.Stop();
+  leaderboard.Stop();
+  cell_ledger.Stop();
   persistence_coordinator.Stop();
   game.flush_persistence_delta();
+  economy.Shutdown();
+  economy_aggregates.Stop();
+  if (google_verifier) google_verifier->Stop();
   Aws::ShutdownAPI(aws_options);
   return 0;
 }
@@ -1,24 +1,33 @@
 #include "dynamo_storage.h"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
 #include <chrono>
 #include <ctime>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <thread>
+#include <unordered_set>
 
 #include <aws/core/client/ClientConfiguration.h>
 #include <aws/dynamodb/model/AttributeValue.h>
+#include <aws/dynamodb/model/BatchWriteItemRequest.h>
 #include <aws/dynamodb/model/DeleteItemRequest.h>
 #include <aws/dynamodb/model/DescribeTableRequest.h>
 #include <aws/dynamodb/model/GetItemRequest.h>
 #include <aws/dynamodb/model/PutItemRequest.h>
+#include <aws/dynamodb/model/PutRequest.h>
 #include <aws/dynamodb/model/QueryRequest.h>
 #include <aws/dynamodb/model/ScanRequest.h>
 #include <aws/dynamodb/model/TransactWriteItem.h>
 #include <aws/dynamodb/model/TransactWriteItemsRequest.h>
 #include <aws/dynamodb/model/UpdateItemRequest.h>
+#include <aws/dynamodb/model/WriteRequest.h>
+
+#include "../diagnostics/tracer.h"
+#include "../metrics/metrics.h"
 
 namespace storage {
 namespace {
@@ -27,6 +36,55 @@ using Aws::DynamoDB::Model::AttributeValue;
 using Aws::Map;
 using Aws::String;
 
+enum class DynamoOp {
+  kGetItem,
+  kPutItem,
+  kUpdateItem,
+  kDeleteItem,
+  kQuery,
+  kScan,
+  kTransactWriteItems,
+  kBatchWriteItem,
+  kDescribeTable
+};
+constexpr const char* kDynamoOpNames[] = {"GetItem", "PutItem", "UpdateItem", "DeleteItem",
+                                          "Query", "Scan", "TransactWriteItems", "BatchWriteItem",
+                                          "DescribeTable"};
+constexpr size_t kDynamoOpCount = sizeof(kDynamoOpNames) / sizeof(kDynamoOpNames[0]);
+
+struct DynamoOpMetrics {
+  metrics::Histogram* latency = nullptr;
+  metrics::Counter* errors = nullptr;
+};
+
+const DynamoOpMetrics& MetricsFor(DynamoOp op) {
+  static const auto table = [] {
+    std::array<DynamoOpMetrics, kDynamoOpCount> t{};
+    auto& r = metrics::Default();
+    for (size_t i = 0; i < kDynamoOpCount; ++i) {
+      t[i].latency = &r.GetHistogram("snake_dynamo_request_seconds", "DynamoDB request latency by operation.",
+                                     {{"op", kDynamoOpNames[i]}}, metrics::Histogram::kSeconds);
+      t[i].errors = &r.GetCounter("snake_dynamo_errors_total", "DynamoDB requests that returned an error.",
+                                  {{"op", kDynamoOpNames[i]}});
+    }
+    return t;
+  }();
+  return table[static_cast<size_t>(op)];
+}
+
+// Runs one DynamoDB call, recording its latency and failure by operation
+// (and a trace span while a capture is running).
+template <typename Call>
+auto Timed(DynamoOp op, Call&& call) -> decltype(call()) {
+  const auto& m = MetricsFor(op);
+  diagnostics::TraceSpan span("dynamo", kDynamoOpNames[static_cast<size_t>(op)]);
+  const auto start = std::chrono::steady_clock::now();
+  auto outcome = call();
+  m.latency->Observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  if (!outcome.IsSuccess()) m.errors->Inc();
+  return outcome;
+}
+
 std::string GetString(const Map<String, AttributeValue>& item, const char* key, const std::string& def = "") {
   auto it = item.find(key);
   if (it == item.end()) return def;
@@ -106,6 +164,25 @@ EconomyParams LoadEconomyParamsFromItem(const Map<String, AttributeValue>& item)
   return p;
 }
 
+Map<String, AttributeValue> EconomyPeriodUserItem(const EconomyPeriodUser& p) {
+  Map<String, AttributeValue> item;
+  item["period_key"] = S(p.period_key);
+  item["user_id"] = S(p.user_id);
+  item["user_harvested_food"] = N(p.user_harvested_food);
+  item["user_real_output"] = N(p.user_real_output);
+  item["user_movement_ticks"] = N(p.user_movement_ticks);
+  item["user_output"] = N(p.user_output);
+  item["user_capital"] = N(p.user_capital);
+  item["user_labor"] = N(p.user_labor);
+  item["user_capital_share"] = D(p.user_capital_share);
+  item["user_productivity"] = D(p.user_productivity);
+  item["user_market_share"] = D(p.user_market_share);
+  item["user_storage_balance"] = N(p.user_storage_balance);
+  item["alpha_bootstrap"] = B(p.alpha_bootstrap);
+  item["computed_at"] = N(p.computed_at);
+  return item;
+}
+
 std::string EncodeBody(const std::vector<std::pair<int, int>>& body) {
   std::ostringstream out;
   out << "[";
@@ -184,7 +261,7 @@ std::vector<User> DynamoStorage::ListUsers() {
   req.SetTableName(cfg_.users_table.c_str());
 
   while (true) {
-    auto res = client_->Scan(req);
+    auto res = Timed(DynamoOp::kScan, [&] { return client_->Scan(req); });
     if (!res.IsSuccess()) break;
     for (const auto& item : res.GetResult().GetItems()) {
       User u;
@@ -220,7 +297,7 @@ std::optional<User> DynamoStorage::GetUserById(const std::string& user_id) {
   req.SetTableName(cfg_.users_table.c_str());
   req.AddKey("user_id", S(user_id));
 
-  auto out = client_->GetItem(req);
+  auto out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req); });
   if (!out.IsSuccess()) return std::nullopt;
   const auto& item = out.GetResult().GetItem();
   if (item.empty()) return std::nullopt;
@@ -252,7 +329,7 @@ std::optional<User> DynamoStorage::GetUserByGoogleSubject(const std::string& goo
   scan.SetFilterExpression("google_subject_id = :g");
   scan.AddExpressionAttributeValues(":g", S(google_subject_id));
   scan.SetLimit(1);
-  auto out = client_->Scan(scan);
+  auto out = Timed(DynamoOp::kScan, [&] { return client_->Scan(scan); });
   if (!out.IsSuccess()) return std::nullopt;
   const auto& items = out.GetResult().GetItems();
   if (items.empty()) return std::nullopt;
@@ -284,7 +361,7 @@ bool DynamoStorage::CompanyNameExistsNormalized(const std::string& company_name_
   scan.SetTableName(cfg_.users_table.c_str());
   scan.SetFilterExpression("company_name_normalized = :n");
   scan.AddExpressionAttributeValues(":n", S(company_name_normalized));
-  auto out = client_->Scan(scan);
+  auto out = Timed(DynamoOp::kScan, [&] { return client_->Scan(scan); });
   if (!out.IsSuccess()) return false;
   for (const auto& item : out.GetResult().GetItems()) {
     const auto uid = GetString(item, "user_id");
@@ -315,7 +392,7 @@ bool DynamoStorage::PutUser(const User& u) {
   req.AddItem("onboarding_completed", B(u.onboarding_completed));
   if (!u.starter_snake_id.empty()) req.AddItem("starter_snake_id", S(u.starter_snake_id));
   if (!u.account_status.empty()) req.AddItem("account_status", S(u.account_status));
-  return client_->PutItem(req).IsSuccess();
+  return Timed(DynamoOp::kPutItem, [&] { return client_->PutItem(req); }).IsSuccess();
 }
 
 bool DynamoStorage::UpdateUserLastSeenWorldVersion(const std::string& user_id, const std::string& version) {
@@ -325,14 +402,14 @@ bool DynamoStorage::UpdateUserLastSeenWorldVersion(const std::string& user_id, c
   req.SetUpdateExpression("SET last_seen_world_version = :v");
   req.SetConditionExpression("attribute_exists(user_id)");
   req.AddExpressionAttributeValues(":v", S(version));
-  return client_->UpdateItem(req).IsSuccess();
+  return Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(req); }).IsSuccess();
 }
 
 bool DynamoStorage::DeleteUserById(const std::string& user_id) {
   Aws::DynamoDB::Model::DeleteItemRequest req;
   req.SetTableName(cfg_.users_table.c_str());
   req.AddKey("user_id", S(user_id));
-  return client_->DeleteItem(req).IsSuccess();
+  return Timed(DynamoOp::kDeleteItem, [&] { return client_->DeleteItem(req); }).IsSuccess();
 }
 
 bool DynamoStorage::UpdateUserBalance(const std::string& user_id, int64_t new_balance) {
@@ -341,7 +418,7 @@ bool DynamoStorage::UpdateUserBalance(const std::string& user_id, int64_t new_ba
   req.AddKey("user_id", S(user_id));
   req.SetUpdateExpression("SET balance_mi = :b");
   req.AddExpressionAttributeValues(":b", N(new_balance));
-  return client_->UpdateItem(req).IsSuccess();
+  return Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(req); }).IsSuccess();
 }
 
 bool DynamoStorage::IncrementUserBalance(const std::string& user_id, int64_t delta_balance) {
@@ -351,7 +428,7 @@ bool DynamoStorage::IncrementUserBalance(const std::string& user_id, int64_t del
     req.AddKey("user_id", S(user_id));
     req.SetUpdateExpression("ADD balance_mi :delta");
     req.AddExpressionAttributeValues(":delta", N(delta_balance));
-    auto res = client_->UpdateItem(req);
+    auto res = Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(req); });
     if (res.IsSuccess()) return true;
     std::this_thread::sleep_for(std::chrono::milliseconds(50 * (attempt + 1)));
   }
@@ -373,7 +450,7 @@ bool DynamoStorage::BorrowCellsAndTrackPeriod(const std::string& user_id,
   Aws::DynamoDB::Model::GetItemRequest req_params;
   req_params.SetTableName(cfg_.economy_params_table.c_str());
   req_params.AddKey("params_id", S(treasury_params_id));
-  auto params_out = client_->GetItem(req_params);
+  auto params_out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req_params); });
   auto params_item = params_out.IsSuccess() ? params_out.GetResult().GetItem()
                                             : Aws::Map<Aws::String, Aws::DynamoDB::Model::AttributeValue>{};
   if (params_item.empty()) {
@@ -381,7 +458,7 @@ bool DynamoStorage::BorrowCellsAndTrackPeriod(const std::string& user_id,
     Aws::DynamoDB::Model::GetItemRequest req_legacy;
     req_legacy.SetTableName(cfg_.economy_params_table.c_str());
     req_legacy.AddKey("params_id", S(treasury_params_id));
-    params_out = client_->GetItem(req_legacy);
+    params_out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req_legacy); });
     params_item = params_out.IsSuccess() ? params_out.GetResult().GetItem()
                                          : Aws::Map<Aws::String, Aws::DynamoDB::Model::AttributeValue>{};
   }
@@ -407,7 +484,7 @@ bool DynamoStorage::BorrowCellsAndTrackPeriod(const std::string& user_id,
   treasury_debit.SetUpdateExpression("ADD m_gov_reserve :neg");
   treasury_debit.AddExpressionAttributeValues(":a", N(amount));
   treasury_debit.AddExpressionAttributeValues(":neg", N(-amount));
-  auto treasury_debit_res = client_->UpdateItem(treasury_debit);
+  auto treasury_debit_res = Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(treasury_debit); });
   if (!treasury_debit_res.IsSuccess()) {
     const auto exception_name = treasury_debit_res.GetError().GetExceptionName();
     if (out_error_code) {
@@ -425,7 +502,7 @@ bool DynamoStorage::BorrowCellsAndTrackPeriod(const std::string& user_id,
   user_credit.SetUpdateExpression("SET balance_mi = if_not_exists(balance_mi, :z) + :a");
   user_credit.AddExpressionAttributeValues(":z", N(0));
   user_credit.AddExpressionAttributeValues(":a", N(amount));
-  auto user_credit_res = client_->UpdateItem(user_credit);
+  auto user_credit_res = Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(user_credit); });
   if (!user_credit_res.IsSuccess()) {
     const auto exception_name = user_credit_res.GetError().GetExceptionName();
     Aws::DynamoDB::Model::UpdateItemRequest treasury_rollback;
@@ -434,7 +511,7 @@ bool DynamoStorage::BorrowCellsAndTrackPeriod(const std::string& user_id,
     treasury_rollback.SetUpdateExpression("ADD m_gov_reserve :a");
     treasury_rollback.AddExpressionAttributeValues(":zero", N(0));
     treasury_rollback.AddExpressionAttributeValues(":a", N(amount));
-    (void)client_->UpdateItem(treasury_rollback);
+    (void)Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(treasury_rollback); });
     if (out_error_code) {
       *out_error_code = (exception_name == "ConditionalCheckFailedException")
                             ? "unauthorized"
@@ -449,7 +526,7 @@ bool DynamoStorage::BorrowCellsAndTrackPeriod(const std::string& user_id,
     period_update_fallback.AddKey("period_key", S(period_key));
     period_update_fallback.SetUpdateExpression("ADD delta_m_buy :a");
     period_update_fallback.AddExpressionAttributeValues(":a", N(amount));
-    (void)client_->UpdateItem(period_update_fallback);
+    (void)Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(period_update_fallback); });
   }
 
   const auto user = GetUserById(user_id);
@@ -467,7 +544,7 @@ std::vector<Snake> DynamoStorage::ListSnakes() {
   req.SetTableName(cfg_.snakes_table.c_str());
 
   while (true) {
-    auto res = client_->Scan(req);
+    auto res = Timed(DynamoOp::kScan, [&] { return client_->Scan(req); });
     if (!res.IsSuccess()) break;
     for (const auto& item : res.GetResult().GetItems()) {
       Snake s;
@@ -503,7 +580,7 @@ std::optional<Snake> DynamoStorage::GetSnakeById(const std::string& snake_id) {
   req.SetTableName(cfg_.snakes_table.c_str());
   req.AddKey("snake_id", S(snake_id));
 
-  auto out = client_->GetItem(req);
+  auto out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req); });
   if (!out.IsSuccess()) return std::nullopt;
   const auto& item = out.GetResult().GetItem();
   if (item.empty()) return std::nullopt;
@@ -552,7 +629,7 @@ bool DynamoStorage::PutSnake(const Snake& s) {
   if (!s.last_event_id.empty()) req.AddItem("last_event_id", S(s.last_event_id));
   req.AddItem("created_at", N(s.created_at));
   req.AddItem("updated_at", N(s.updated_at));
-  return client_->PutItem(req).IsSuccess();
+  return Timed(DynamoOp::kPutItem, [&] { return client_->PutItem(req); }).IsSuccess();
 }
 
 bool DynamoStorage::SnakeNameExistsNormalized(const std::string& snake_name_normalized,
@@ -564,7 +641,7 @@ bool DynamoStorage::SnakeNameExistsNormalized(const std::string& snake_name_norm
   q.SetKeyConditionExpression("snake_name_normalized = :n");
   q.AddExpressionAttributeValues(":n", S(snake_name_normalized));
   q.SetLimit(10);
-  auto out_q = client_->Query(q);
+  auto out_q = Timed(DynamoOp::kQuery, [&] { return client_->Query(q); });
   if (out_q.IsSuccess()) {
     for (const auto& item : out_q.GetResult().GetItems()) {
       const auto sid = GetString(item, "snake_id");
@@ -579,7 +656,7 @@ bool DynamoStorage::SnakeNameExistsNormalized(const std::string& snake_name_norm
   scan.SetTableName(cfg_.snakes_table.c_str());
   scan.SetFilterExpression("snake_name_normalized = :n");
   scan.AddExpressionAttributeValues(":n", S(snake_name_normalized));
-  auto out_s = client_->Scan(scan);
+  auto out_s = Timed(DynamoOp::kScan, [&] { return client_->Scan(scan); });
   if (!out_s.IsSuccess()) return false;
   for (const auto& item : out_s.GetResult().GetItems()) {
     const auto sid = GetString(item, "snake_id");
@@ -593,7 +670,7 @@ bool DynamoStorage::DeleteSnake(const std::string& snake_id) {
   Aws::DynamoDB::Model::DeleteItemRequest req;
   req.SetTableName(cfg_.snakes_table.c_str());
   req.AddKey("snake_id", S(snake_id));
-  return client_->DeleteItem(req).IsSuccess();
+  return Timed(DynamoOp::kDeleteItem, [&] { return client_->DeleteItem(req); }).IsSuccess();
 }
 
 bool DynamoStorage::DeleteSnakeEventsBySnakeId(const std::string& snake_id) {
@@ -603,7 +680,7 @@ bool DynamoStorage::DeleteSnakeEventsBySnakeId(const std::string& snake_id) {
   q.SetKeyConditionExpression("snake_id = :s");
   q.AddExpressionAttributeValues(":s", S(snake_id));
   while (true) {
-    auto out = client_->Query(q);
+    auto out = Timed(DynamoOp::kQuery, [&] { return client_->Query(q); });
     if (!out.IsSuccess()) return false;
     for (const auto& item : out.GetResult().GetItems()) {
       const auto event_id = GetString(item, "event_id");
@@ -612,7 +689,7 @@ bool DynamoStorage::DeleteSnakeEventsBySnakeId(const std::string& snake_id) {
       del.SetTableName(cfg_.snake_events_table.c_str());
       del.AddKey("snake_id", S(snake_id));
       del.AddKey("event_id", S(event_id));
-      if (!client_->DeleteItem(del).IsSuccess()) return false;
+      if (!Timed(DynamoOp::kDeleteItem, [&] { return client_->DeleteItem(del); }).IsSuccess()) return false;
     }
     const auto& lek = out.GetResult().GetLastEvaluatedKey();
     if (lek.empty()) break;
@@ -658,7 +735,7 @@ bool DynamoStorage::AttachCellsToSnake(const std::string& user_id,
   snake_item.SetUpdate(snake_update);
   tx.AddTransactItems(snake_item);
 
-  auto tx_res = client_->TransactWriteItems(tx);
+  auto tx_res = Timed(DynamoOp::kTransactWriteItems, [&] { return client_->TransactWriteItems(tx); });
   if (tx_res.IsSuccess()) {
     const auto user = GetUserById(user_id);
     const auto snake = GetSnakeById(snake_id);
@@ -678,7 +755,7 @@ bool DynamoStorage::AttachCellsToSnake(const std::string& user_id,
   user_debit.SetConditionExpression("attribute_exists(user_id) AND attribute_exists(balance_mi) AND balance_mi >= :a");
   user_debit.SetUpdateExpression("SET balance_mi = balance_mi - :a");
   user_debit.AddExpressionAttributeValues(":a", N(amount));
-  auto debit_res = client_->UpdateItem(user_debit);
+  auto debit_res = Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(user_debit); });
   if (!debit_res.IsSuccess()) return false;
 
   const int64_t ts_fallback = static_cast<int64_t>(time(nullptr));
@@ -691,7 +768,7 @@ bool DynamoStorage::AttachCellsToSnake(const std::string& user_id,
   snake_grow.AddExpressionAttributeValues(":z", N(0));
   snake_grow.AddExpressionAttributeValues(":a", N(amount));
   snake_grow.AddExpressionAttributeValues(":ts", N(ts_fallback));
-  auto grow_res = client_->UpdateItem(snake_grow);
+  auto grow_res = Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(snake_grow); });
   if (!grow_res.IsSuccess()) {
     // Best-effort compensation to preserve user funds if snake update failed.
     Aws::DynamoDB::Model::UpdateItemRequest rollback_user;
@@ -700,7 +777,7 @@ bool DynamoStorage::AttachCellsToSnake(const std::string& user_id,
     rollback_user.SetUpdateExpression("SET balance_mi = if_not_exists(balance_mi, :zero) + :a");
     rollback_user.AddExpressionAttributeValues(":zero", N(0));
     rollback_user.AddExpressionAttributeValues(":a", N(amount));
-    (void)client_->UpdateItem(rollback_user);
+    (void)Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(rollback_user); });
     return false;
   }
 
@@ -717,7 +794,7 @@ std::optional<WorldChunk> DynamoStorage::GetWorldChunk(const std::string& chunk_
   req.SetTableName(cfg_.world_chunks_table.c_str());
   req.AddKey("chunk_id", S(chunk_id));
 
-  auto out = client_->GetItem(req);
+  auto out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req); });
   if (!out.IsSuccess()) return std::nullopt;
   const auto& item = out.GetResult().GetItem();
   if (item.empty()) return std::nullopt;
@@ -743,7 +820,7 @@ bool DynamoStorage::PutWorldChunk(const WorldChunk& chunk) {
   req.AddItem("food_state", S(chunk.food_state));
   req.AddItem("version", N(chunk.version));
   req.AddItem("updated_at", N(chunk.updated_at));
-  return client_->PutItem(req).IsSuccess();
+  return Timed(DynamoOp::kPutItem, [&] { return client_->PutItem(req); }).IsSuccess();
 }
 
 bool DynamoStorage::AppendSnakeEvent(const SnakeEvent& e) {
@@ -759,7 +836,7 @@ bool DynamoStorage::AppendSnakeEvent(const SnakeEvent& e) {
   req.AddItem("tick_number", N(static_cast<int64_t>(e.tick_number)));
   req.AddItem("world_version", N(e.world_version));
   req.AddItem("created_at", N(e.created_at));
-  return client_->PutItem(req).IsSuccess();
+  return Timed(DynamoOp::kPutItem, [&] { return client_->PutItem(req); }).IsSuccess();
 }
 
 std::optional<Settings> DynamoStorage::GetSettings(const std::string& settings_id) {
@@ -767,7 +844,7 @@ std::optional<Settings> DynamoStorage::GetSettings(const std::string& settings_i
   req.SetTableName(cfg_.settings_table.c_str());
   req.AddKey("settings_id", S(settings_id));
 
-  auto out = client_->GetItem(req);
+  auto out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req); });
   if (!out.IsSuccess()) return std::nullopt;
   const auto& item = out.GetResult().GetItem();
   if (item.empty()) return std::nullopt;
@@ -793,7 +870,7 @@ bool DynamoStorage::PutSettings(const Settings& settings) {
   req.AddItem("feature_flags", S(settings.feature_flags_json));
   req.AddItem("economy_refs", S(settings.economy_refs_json));
   req.AddItem("updated_at", N(settings.updated_at));
-  return client_->PutItem(req).IsSuccess();
+  return Timed(DynamoOp::kPutItem, [&] { return client_->PutItem(req); }).IsSuccess();
 }
 
 std::optional<EconomyParams> DynamoStorage::GetEconomyParams() {
@@ -805,7 +882,7 @@ std::optional<EconomyParams> DynamoStorage::GetEconomyParamsActive() {
   req_active.SetTableName(cfg_.economy_params_table.c_str());
   req_active.AddKey("params_id", S("active"));
 
-  auto out = client_->GetItem(req_active);
+  auto out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req_active); });
   if (!out.IsSuccess()) return std::nullopt;
   auto item = out.GetResult().GetItem();
   if (!item.empty()) return LoadEconomyParamsFromItem(item);
@@ -814,7 +891,7 @@ std::optional<EconomyParams> DynamoStorage::GetEconomyParamsActive() {
   Aws::DynamoDB::Model::GetItemRequest req_global;
   req_global.SetTableName(cfg_.economy_params_table.c_str());
   req_global.AddKey("params_id", S("global"));
-  out = client_->GetItem(req_global);
+  out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req_global); });
   if (!out.IsSuccess()) return std::nullopt;
   item = out.GetResult().GetItem();
   if (item.empty()) return std::nullopt;
@@ -849,7 +926,7 @@ bool DynamoStorage::PutEconomyParamsActiveAndVersioned(const EconomyParams& p, c
   req.AddItem("delta_k_obs", N(p.delta_k_obs));
   req.AddItem("updated_at", N(updated_at));
   req.AddItem("updated_by", S(updated_by));
-  if (!client_->PutItem(req).IsSuccess()) return false;
+  if (!Timed(DynamoOp::kPutItem, [&] { return client_->PutItem(req); }).IsSuccess()) return false;
 
   // Active row points to latest values.
   req = Aws::DynamoDB::Model::PutItemRequest();
@@ -867,7 +944,7 @@ bool DynamoStorage::PutEconomyParamsActiveAndVersioned(const EconomyParams& p, c
   req.AddItem("delta_k_obs", N(p.delta_k_obs));
   req.AddItem("updated_at", N(updated_at));
   req.AddItem("updated_by", S(updated_by));
-  return client_->PutItem(req).IsSuccess();
+  return Timed(DynamoOp::kPutItem, [&] { return client_->PutItem(req); }).IsSuccess();
 }
 
 std::optional<EconomyPeriod> DynamoStorage::GetEconomyPeriod(const std::string& period_key) {
@@ -875,7 +952,7 @@ std::optional<EconomyPeriod> DynamoStorage::GetEconomyPeriod(const std::string&
   req.SetTableName(cfg_.economy_period_table.c_str());
   req.AddKey("period_key", S(period_key));
 
-  auto out = client_->GetItem(req);
+  auto out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req); });
   if (!out.IsSuccess()) return std::nullopt;
   const auto& item = out.GetResult().GetItem();
   if (item.empty()) return std::nullopt;
@@ -945,7 +1022,7 @@ bool DynamoStorage::PutEconomyPeriod(const EconomyPeriod& p) {
   req.AddItem("computed_world_area", N(p.computed_world_area));
   req.AddItem("computed_white", N(p.computed_white));
   req.AddItem("computed_at", N(p.computed_at));
-  return client_->PutItem(req).IsSuccess();
+  return Timed(DynamoOp::kPutItem, [&] { return client_->PutItem(req); }).IsSuccess();
 }
 
 bool DynamoStorage::IncrementEconomyPeriodDeltaMBuy(const std::string& period_key, int64_t delta_m_buy) {
@@ -955,7 +1032,7 @@ bool DynamoStorage::IncrementEconomyPeriodDeltaMBuy(const std::string& period_ke
     req.AddKey("period_key", S(period_key));
     req.SetUpdateExpression("ADD delta_m_buy :delta");
     req.AddExpressionAttributeValues(":delta", N(delta_m_buy));
-    auto res = client_->UpdateItem(req);
+    auto res = Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(req); });
     if (res.IsSuccess()) return true;
     std::this_thread::sleep_for(std::chrono::milliseconds(50 * (attempt + 1)));
   }
@@ -977,7 +1054,7 @@ bool DynamoStorage::IncrementEconomyPeriodRaw(const std::string& period_key,
   req.AddExpressionAttributeValues(":status", S("live_unfinalized"));
   req.AddExpressionAttributeValues(":f", B(false));
   req.AddExpressionAttributeValues(":z", N(0));
-  return client_->UpdateItem(req).IsSuccess();
+  return Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(req); }).IsSuccess();
 }
 
 std::optional<EconomyPeriodUser> DynamoStorage::GetEconomyPeriodUser(const std::string& period_key,
@@ -986,7 +1063,7 @@ std::optional<EconomyPeriodUser> DynamoStorage::GetEconomyPeriodUser(const std::
   req.SetTableName(cfg_.economy_period_user_table.c_str());
   req.AddKey("period_key", S(period_key));
   req.AddKey("user_id", S(user_id));
-  auto out = client_->GetItem(req);
+  auto out = Timed(DynamoOp::kGetItem, [&] { return client_->GetItem(req); });
   if (!out.IsSuccess()) return std::nullopt;
   const auto& item = out.GetResult().GetItem();
   if (item.empty()) return std::nullopt;
@@ -1012,21 +1089,47 @@ std::optional<EconomyPeriodUser> DynamoStorage::GetEconomyPeriodUser(const std::
 bool DynamoStorage::PutEconomyPeriodUser(const EconomyPeriodUser& p) {
   Aws::DynamoDB::Model::PutItemRequest req;
   req.SetTableName(cfg_.economy_period_user_table.c_str());
-  req.AddItem("period_key", S(p.period_key));
-  req.AddItem("user_id", S(p.user_id));
-  req.AddItem("user_harvested_food", N(p.user_harvested_food));
-  req.AddItem("user_real_output", N(p.user_real_output));
-  req.AddItem("user_movement_ticks", N(p.user_movement_ticks));
-  req.AddItem("user_output", N(p.user_output));
-  req.AddItem("user_capital", N(p.user_capital));
-  req.AddItem("user_labor", N(p.user_labor));
-  req.AddItem("user_capital_share", D(p.user_capital_share));
-  req.AddItem("user_productivity", D(p.user_productivity));
-  req.AddItem("user_market_share", D(p.user_market_share));
-  req.AddItem("user_storage_balance", N(p.user_storage_balance));
-  req.AddItem("alpha_bootstrap", B(p.alpha_bootstrap));
-  req.AddItem("computed_at", N(p.computed_at));
-  return client_->PutItem(req).IsSuccess();
+  req.SetItem(EconomyPeriodUserItem(p));
+  return Timed(DynamoOp::kPutItem, [&] { return client_->PutItem(req); }).IsSuccess();
+}
+
+bool DynamoStorage::PutEconomyPeriodUsers(std::vector<EconomyPeriodUser>& rows) {
+  // BatchWriteItem takes 25 puts per call. Unprocessed items (throttling) are
+  // resent with backoff; rows still unwritten after that are left in `rows`.
+  constexpr size_t kMaxBatchItems = 25;
+  constexpr int kMaxAttempts = 5;
+  const String table = cfg_.economy_period_user_table.c_str();
+  std::vector<EconomyPeriodUser> left;
+  for (size_t begin = 0; begin < rows.size(); begin += kMaxBatchItems) {
+    const size_t end = std::min(rows.size(), begin + kMaxBatchItems);
+    Aws::Vector<Aws::DynamoDB::Model::WriteRequest> writes;
+    writes.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      Aws::DynamoDB::Model::PutRequest put;
+      put.SetItem(EconomyPeriodUserItem(rows[i]));
+      Aws::DynamoDB::Model::WriteRequest w;
+      w.SetPutRequest(put);
+      writes.push_back(std::move(w));
+    }
+    Map<String, Aws::Vector<Aws::DynamoDB::Model::WriteRequest>> pending;
+    pending[table] = std::move(writes);
+    for (int attempt = 0; attempt < kMaxAttempts && !pending.empty(); ++attempt) {
+      if (attempt > 0) std::this_thread::sleep_for(std::chrono::milliseconds(50 << attempt));
+      Aws::DynamoDB::Model::BatchWriteItemRequest req;
+      req.SetRequestItems(pending);
+      auto res = Timed(DynamoOp::kBatchWriteItem, [&] { return client_->BatchWriteItem(req); });
+      if (!res.IsSuccess()) continue;
+      pending = res.GetResult().GetUnprocessedItems();
+    }
+    if (pending.empty()) continue;
+    std::unordered_set<std::string> unwritten;
+    for (const auto& w : pending[table]) unwritten.insert(GetString(w.GetPutRequest().GetItem(), "user_id"));
+    for (size_t i = begin; i < end; ++i) {
+      if (unwritten.count(rows[i].user_id) != 0) left.push_back(std::move(rows[i]));
+    }
+  }
+  rows = std::move(left);
+  return rows.empty();
 }
 
 bool DynamoStorage::IncrementEconomyPeriodUserRaw(const std::string& period_key,
@@ -1041,7 +1144,80 @@ bool DynamoStorage::IncrementEconomyPeriodUserRaw(const std::string& period_key,
   req.SetUpdateExpression("ADD user_harvested_food :h, user_real_output :h, user_movement_ticks :m");
   req.AddExpressionAttributeValues(":h", N(harvested_food_delta));
   req.AddExpressionAttributeValues(":m", N(movement_ticks_delta));
-  return client_->UpdateItem(req).IsSuccess();
+  return Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(req); }).IsSuccess();
+}
+
+bool DynamoStorage::IncrementEconomyPeriodRawBatch(const std::string& period_key,
+                                                   int64_t& harvested_food_delta,
+                                                   int64_t& movement_ticks_delta,
+                                                   std::vector<EconomyPeriodUserDelta>& user_deltas) {
+  // BatchWriteItem cannot ADD, so increments go out as TransactWriteItems of
+  // up to 100 updates. Each chunk is all-or-nothing, and the SDK's generated
+  // client token keeps its own retries of a committed chunk from re-applying.
+  constexpr size_t kMaxTransactItems = 100;
+  user_deltas.erase(std::remove_if(user_deltas.begin(), user_deltas.end(),
+                                   [](const EconomyPeriodUserDelta& d) {
+                                     return d.user_id.empty() || (d.harvested_food == 0 && d.movement_ticks == 0);
+                                   }),
+                    user_deltas.end());
+  size_t done = 0;
+  while (harvested_food_delta != 0 || movement_ticks_delta != 0 || done < user_deltas.size()) {
+    const bool with_period = harvested_food_delta != 0 || movement_ticks_delta != 0;
+    const size_t end = std::min(user_deltas.size(), done + kMaxTransactItems - (with_period ? 1 : 0));
+    bool ok = false;
+    if ((with_period ? 1 : 0) + (end - done) == 1) {
+      // A one-item transaction costs twice the write capacity of a plain update.
+      ok = with_period ? IncrementEconomyPeriodRaw(period_key, harvested_food_delta, movement_ticks_delta)
+                       : IncrementEconomyPeriodUserRaw(period_key, user_deltas[done].user_id,
+                                                       user_deltas[done].harvested_food,
+                                                       user_deltas[done].movement_ticks);
+    } else {
+      Aws::DynamoDB::Model::TransactWriteItemsRequest tx;
+      if (with_period) {
+        Aws::DynamoDB::Model::Update u;
+        u.SetTableName(cfg_.economy_period_table.c_str());
+        u.AddKey("period_key", S(period_key));
+        u.SetUpdateExpression(
+            "ADD harvested_food :h, real_output :h, movement_ticks :m "
+            "SET snapshot_status = :status, is_finalized = :f, finalized_at = :z");
+        u.AddExpressionAttributeValues(":h", N(harvested_food_delta));
+        u.AddExpressionAttributeValues(":m", N(movement_ticks_delta));
+        u.AddExpressionAttributeValues(":status", S("live_unfinalized"));
+        u.AddExpressionAttributeValues(":f", B(false));
+        u.AddExpressionAttributeValues(":z", N(0));
+        Aws::DynamoDB::Model::TransactWriteItem item;
+        item.SetUpdate(u);
+        tx.AddTransactItems(item);
+      }
+      for (size_t i = done; i < end; ++i) {
+        Aws::DynamoDB::Model::Update u;
+        u.SetTableName(cfg_.economy_period_user_table.c_str());
+        u.AddKey("period_key", S(period_key));
+        u.AddKey("user_id", S(user_deltas[i].user_id));
+        u.SetUpdateExpression("ADD user_harvested_food :h, user_real_output :h, user_movement_ticks :m");
+        u.AddExpressionAttributeValues(":h", N(user_deltas[i].harvested_food));
+        u.AddExpressionAttributeValues(":m", N(user_deltas[i].movement_ticks));
+        Aws::DynamoDB::Model::TransactWriteItem item;
+        item.SetUpdate(u);
+        tx.AddTransactItems(item);
+      }
+      auto res = Timed(DynamoOp::kTransactWriteItems, [&] { return client_->TransactWriteItems(tx); });
+      ok = res.IsSuccess();
+      if (!ok) {
+        std::cerr << "[dynamo] economy delta batch failed period=" << period_key << ": "
+                  << res.GetError().GetMessage() << "\n";
+      }
+    }
+    if (!ok) {
+      user_deltas.erase(user_deltas.begin(), user_deltas.begin() + static_cast<std::ptrdiff_t>(done));
+      return false;
+    }
+    harvested_food_delta = 0;
+    movement_ticks_delta = 0;
+    done = end;
+  }
+  user_deltas.clear();
+  return true;
 }
 
 std::vector<EconomyPeriodUser> DynamoStorage::ListEconomyPeriodUsers(const std::string& period_key) {
@@ -1051,7 +1227,7 @@ std::vector<EconomyPeriodUser> DynamoStorage::ListEconomyPeriodUsers(const std::
   req.SetKeyConditionExpression("period_key = :pk");
   req.AddExpressionAttributeValues(":pk", S(period_key));
   while (true) {
-    auto out = client_->Query(req);
+    auto out = Timed(DynamoOp::kQuery, [&] { return client_->Query(req); });
     if (!out.IsSuccess()) break;
     for (const auto& item : out.GetResult().GetItems()) {
       EconomyPeriodUser p;
@@ -1093,7 +1269,7 @@ bool DynamoStorage::IncrementSystemReserve(int64_t delta_cells) {
     req.AddExpressionAttributeValues(":delta", N(delta_cells));
     req.AddExpressionAttributeValues(":ts", N(ts));
     req.AddExpressionAttributeValues(":by", S("runtime"));
-    return client_->UpdateItem(req);
+    return Timed(DynamoOp::kUpdateItem, [&] { return client_->UpdateItem(req); });
   };
 
   auto active_res = update_row("active");
@@ -1103,10 +1279,83 @@ bool DynamoStorage::IncrementSystemReserve(int64_t delta_cells) {
   return false;
 }
 
+bool DynamoStorage::CommitCellLedgerEntries(const std::vector<CellLedgerEntry>& entries,
+                                            const std::string& request_token,
+                                            std::string* out_error_code) {
+  if (out_error_code) *out_error_code = "";
+  std::map<std::string, int64_t> users;
+  std::map<std::string, int64_t> periods;
+  int64_t treasury_delta = 0;
+  for (const auto& e : entries) {
+    if (!e.user_id.empty() && e.user_delta != 0) users[e.user_id] += e.user_delta;
+    if (!e.period_key.empty() && e.delta_m_buy != 0) periods[e.period_key] += e.delta_m_buy;
+    treasury_delta += e.treasury_delta;
+  }
+  const int64_t ts = static_cast<int64_t>(time(nullptr));
+  Aws::DynamoDB::Model::TransactWriteItemsRequest tx;
+  // Dynamo remembers the token for ten minutes, so resending a group whose
+  // first attempt landed (e.g. the response timed out) is a no-op.
+  tx.SetClientRequestToken(request_token.c_str());
+  const auto add_update = [&](Aws::DynamoDB::Model::Update u) {
+    Aws::DynamoDB::Model::TransactWriteItem item;
+    item.SetUpdate(std::move(u));
+    tx.AddTransactItems(item);
+  };
+  for (const auto& [user_id, delta] : users) {
+    if (delta == 0) continue;
+    Aws::DynamoDB::Model::Update u;
+    u.SetTableName(cfg_.users_table.c_str());
+    u.AddKey("user_id", S(user_id));
+    u.SetUpdateExpression("SET balance_mi = if_not_exists(balance_mi, :z) + :d");
+    u.AddExpressionAttributeValues(":z", N(0));
+    u.AddExpressionAttributeValues(":d", N(delta));
+    if (delta < 0) {
+      u.SetConditionExpression("attribute_exists(user_id) AND balance_mi >= :need");
+      u.AddExpressionAttributeValues(":need", N(-delta));
+    } else {
+      u.SetConditionExpression("attribute_exists(user_id)");
+    }
+    add_update(std::move(u));
+  }
+  if (treasury_delta != 0) {
+    Aws::DynamoDB::Model::Update u;
+    u.SetTableName(cfg_.economy_params_table.c_str());
+    u.AddKey("params_id", S("active"));
+    u.SetUpdateExpression("SET m_gov_reserve = if_not_exists(m_gov_reserve, :z) + :d, updated_at = :ts, updated_by = :by");
+    u.AddExpressionAttributeValues(":z", N(0));
+    u.AddExpressionAttributeValues(":d", N(treasury_delta));
+    u.AddExpressionAttributeValues(":ts", N(ts));
+    u.AddExpressionAttributeValues(":by", S("cell_ledger"));
+    if (treasury_delta < 0) {
+      u.SetConditionExpression("m_gov_reserve >= :need");
+      u.AddExpressionAttributeValues(":need", N(-treasury_delta));
+    }
+    add_update(std::move(u));
+  }
+  for (const auto& [period_key, delta] : periods) {
+    if (delta == 0) continue;
+    Aws::DynamoDB::Model::Update u;
+    u.SetTableName(cfg_.economy_period_table.c_str());
+    u.AddKey("period_key", S(period_key));
+    u.SetUpdateExpression("ADD delta_m_buy :d");
+    u.AddExpressionAttributeValues(":d", N(delta));
+    add_update(std::move(u));
+  }
+  if (tx.GetTransactItems().empty()) return true;
+  auto res = Timed(DynamoOp::kTransactWriteItems, [&] { return client_->TransactWriteItems(tx); });
+  if (res.IsSuccess()) return true;
+  const bool condition_failed = res.GetError().GetExceptionName() == "TransactionCanceledException" &&
+                                res.GetError().GetMessage().find("ConditionalCheckFailed") != Aws::String::npos;
+  if (out_error_code) *out_error_code = condition_failed ? "condition_failed" : "persistence_write_failed";
+  std::cerr << "[dynamo] cell ledger commit failed entries=" << entries.size() << ": "
+            << res.GetError().GetMessage() << "\n";
+  return false;
+}
+
 bool DynamoStorage::HealthCheck() {
   Aws::DynamoDB::Model::DescribeTableRequest req;
   req.SetTableName(cfg_.users_table.c_str());
-  auto res = client_->DescribeTable(req);
+  auto res = Timed(DynamoOp::kDescribeTable, [&] { return client_->DescribeTable(req); });
   if (!res.IsSuccess()) {
     std::cerr << "Dynamo health check failed: " << res.GetError().GetMessage() << "\n";
     return false;
@@ -1119,7 +1368,7 @@ bool DynamoStorage::ResetForDev() {
     Aws::DynamoDB::Model::ScanRequest scan;
     scan.SetTableName(table.c_str());
     while (true) {
-      auto out = client_->Scan(scan);
+      auto out = Timed(DynamoOp::kScan, [&] { return client_->Scan(scan); });
       if (!out.IsSuccess()) return false;
       for (const auto& item : out.GetResult().GetItems()) {
         Aws::DynamoDB::Model::DeleteItemRequest del;
@@ -1132,7 +1381,7 @@ bool DynamoStorage::ResetForDev() {
           if (it_sk == item.end()) continue;
           del.AddKey(sk->c_str(), it_sk->second);
         }
-        if (!client_->DeleteItem(del).IsSuccess()) return false;
+        if (!Timed(DynamoOp::kDeleteItem, [&] { return client_->DeleteItem(del); }).IsSuccess()) return false;
       }
       const auto& lek = out.GetResult().GetLastEvaluatedKey();
       if (lek.empty()) break;
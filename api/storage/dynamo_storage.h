@@ -78,12 +78,20 @@ class DynamoStorage : public IStorage {
   std::optional<EconomyPeriodUser> GetEconomyPeriodUser(const std::string& period_key,
                                                         const std::string& user_id) override;
   bool PutEconomyPeriodUser(const EconomyPeriodUser& p) override;
+  bool PutEconomyPeriodUsers(std::vector<EconomyPeriodUser>& rows) override;
   bool IncrementEconomyPeriodUserRaw(const std::string& period_key,
                                      const std::string& user_id,
                                      int64_t harvested_food_delta,
                                      int64_t movement_ticks_delta) override;
+  bool IncrementEconomyPeriodRawBatch(const std::string& period_key,
+                                      int64_t& harvested_food_delta,
+                                      int64_t& movement_ticks_delta,
+                                      std::vector<EconomyPeriodUserDelta>& user_deltas) override;
   std::vector<EconomyPeriodUser> ListEconomyPeriodUsers(const std::string& period_key) override;
   bool IncrementSystemReserve(int64_t delta_cells) override;
+  bool CommitCellLedgerEntries(const std::vector<CellLedgerEntry>& entries,
+                               const std::string& request_token,
+                               std::string* out_error_code = nullptr) override;
 
   bool HealthCheck() override;
   bool ResetForDev() override;
@@ -148,4 +148,22 @@ struct EconomyPeriodUser {
   int64_t computed_at = 0;
 };
 
+// Raw counter increment for one user row of a period (real_output follows harvested_food).
+struct EconomyPeriodUserDelta {
+  std::string user_id;
+  int64_t harvested_food = 0;
+  int64_t movement_ticks = 0;
+};
+
+// One balance movement reserved by the in-memory cell ledger and committed in
+// a group with others.
+struct CellLedgerEntry {
+  std::string op_id;
+  std::string user_id;
+  int64_t user_delta = 0;      // balance_mi
+  int64_t treasury_delta = 0;  // m_gov_reserve
+  std::string period_key;      // receives delta_m_buy
+  int64_t delta_m_buy = 0;
+};
+
 }  // namespace storage
@@ -63,12 +63,32 @@ class IStorage {
   virtual std::optional<EconomyPeriodUser> GetEconomyPeriodUser(const std::string& period_key,
                                                                 const std::string& user_id) = 0;
   virtual bool PutEconomyPeriodUser(const EconomyPeriodUser& p) = 0;
+  // Writes many rows at once; rows that could not be written are left in `rows`.
+  virtual bool PutEconomyPeriodUsers(std::vector<EconomyPeriodUser>& rows) = 0;
   virtual bool IncrementEconomyPeriodUserRaw(const std::string& period_key,
                                              const std::string& user_id,
                                              int64_t harvested_food_delta,
                                              int64_t movement_ticks_delta) = 0;
+  // Applies the period's raw counters and many user rows at once. Whatever is
+  // left in the arguments on return was not applied (zeroed / erased on success),
+  // so a caller can retry exactly the remainder.
+  virtual bool IncrementEconomyPeriodRawBatch(const std::string& period_key,
+                                              int64_t& harvested_food_delta,
+                                              int64_t& movement_ticks_delta,
+                                              std::vector<EconomyPeriodUserDelta>& user_deltas) = 0;
   virtual std::vector<EconomyPeriodUser> ListEconomyPeriodUsers(const std::string& period_key) = 0;
   virtual bool IncrementSystemReserve(int64_t delta_cells) = 0;
+  // Applies the entries in one all-or-nothing write, coalesced by key: user
+  // balances, the treasury and period delta_m_buy. A resend with the same
+  // `request_token` is not applied twice. The caller keeps the distinct keys
+  // (users + periods + treasury) within kMaxCellLedgerKeys. Neither a user's
+  // net delta nor the treasury's may take it below zero. Error codes:
+  // "condition_failed" when a user row is gone or a balance would go negative
+  // (split the group and retry), otherwise "persistence_write_failed".
+  static constexpr size_t kMaxCellLedgerKeys = 100;
+  virtual bool CommitCellLedgerEntries(const std::vector<CellLedgerEntry>& entries,
+                                       const std::string& request_token,
+                                       std::string* out_error_code = nullptr) = 0;
 
   virtual bool HealthCheck() = 0;
   virtual bool ResetForDev() = 0;
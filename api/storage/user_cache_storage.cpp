@@ -0,0 +1,406 @@
+#include "user_cache_storage.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace storage {
+namespace {
+
+std::atomic<uint64_t> g_version_seq{0};
+
+uint64_t NextVersion() {
+  return g_version_seq.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+}  // namespace
+
+UserCacheStorage::UserCacheStorage(std::unique_ptr<IStorage> inner,
+                                   std::chrono::milliseconds ttl,
+                                   size_t max_entries)
+    : inner_(std::move(inner)), ttl_(ttl), max_entries_(std::max<size_t>(1, max_entries)) {}
+
+bool UserCacheStorage::AddWriteListener(WriteListener* listener) {
+  const size_t slot = listener_count_.load(std::memory_order_relaxed);
+  if (slot >= kMaxWriteListeners) return false;
+  listeners_[slot].store(listener, std::memory_order_release);
+  listener_count_.store(slot + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename Fn>
+void UserCacheStorage::NotifyListeners(Fn&& fn) {
+  const size_t n = listener_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < n; ++i) {
+    if (auto* l = listeners_[i].load(std::memory_order_acquire)) fn(*l);
+  }
+}
+
+uint64_t UserCacheStorage::UserVersion(const std::string& user_id) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = users_.find(user_id);
+  return it == users_.end() ? 0 : it->second.version;
+}
+
+UserCacheStorage::Stats UserCacheStorage::GetStats() const {
+  Stats s;
+  s.hits = hits_.load(std::memory_order_relaxed);
+  s.misses = misses_.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const auto& kv : users_) {
+    if (kv.second.user.has_value()) ++s.entries;
+  }
+  s.evictions = evictions_;
+  s.capacity = max_entries_;
+  return s;
+}
+
+UserCacheStorage::Entry& UserCacheStorage::SlotLocked(const std::string& user_id) {
+  auto it = users_.find(user_id);
+  if (it != users_.end()) {
+    order_.splice(order_.begin(), order_, it->second.pos);
+    return it->second;
+  }
+  order_.push_front(user_id);
+  Entry& e = users_[user_id];
+  e.pos = order_.begin();
+  while (users_.size() > max_entries_) {
+    users_.erase(order_.back());
+    order_.pop_back();
+    ++evictions_;
+  }
+  return e;
+}
+
+template <typename Fn>
+void UserCacheStorage::MutateLocked(const std::string& user_id, Fn&& fn) {
+  auto& e = SlotLocked(user_id);
+  if (e.user.has_value()) fn(*e.user);
+  e.version = NextVersion();
+}
+
+void UserCacheStorage::TouchLocked(const std::string& user_id) {
+  if (user_id.empty()) return;
+  SlotLocked(user_id).version = NextVersion();
+}
+
+void UserCacheStorage::RememberOwnerLocked(const Snake& s) {
+  if (!s.snake_id.empty() && !s.owner_user_id.empty()) snake_owner_[s.snake_id] = s.owner_user_id;
+}
+
+std::vector<User> UserCacheStorage::ListUsers() {
+  return inner_->ListUsers();
+}
+
+std::optional<User> UserCacheStorage::GetUserByGoogleSubject(const std::string& google_subject_id) {
+  return inner_->GetUserByGoogleSubject(google_subject_id);
+}
+
+bool UserCacheStorage::CompanyNameExistsNormalized(const std::string& company_name_normalized,
+                                                   const std::string& exclude_user_id) {
+  return inner_->CompanyNameExistsNormalized(company_name_normalized, exclude_user_id);
+}
+
+std::optional<User> UserCacheStorage::GetUserById(const std::string& user_id) {
+  uint64_t version_before = 0;
+  std::optional<User> stale;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = users_.find(user_id);
+    if (it != users_.end()) {
+      const auto& e = it->second;
+      order_.splice(order_.begin(), order_, e.pos);
+      if (e.user.has_value()) {
+        if (Clock::now() - e.loaded_at < ttl_) {
+          hits_.fetch_add(1, std::memory_order_relaxed);
+          return e.user;
+        }
+        stale = e.user;
+      }
+      version_before = e.version;
+    }
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  auto fresh = inner_->GetUserById(user_id);
+  if (!fresh.has_value()) return fresh;
+
+  std::lock_guard<std::mutex> lock(mu_);
+  auto& e = SlotLocked(user_id);
+  // A write that landed while we were reading wins; the next read reloads.
+  if (e.version != version_before) return fresh;
+  e.user = fresh;
+  e.loaded_at = Clock::now();
+  if (stale.has_value() && (stale->balance_mi != fresh->balance_mi || stale->account_status != fresh->account_status)) {
+    e.version = NextVersion();
+  }
+  return fresh;
+}
+
+bool UserCacheStorage::PutUser(const User& u) {
+  if (!inner_->PutUser(u)) return false;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto& e = SlotLocked(u.user_id);
+    e.user = u;
+    e.loaded_at = Clock::now();
+    e.version = NextVersion();
+  }
+  NotifyListeners([&](WriteListener& l) { l.OnUserBalanceSet(u.user_id, u.balance_mi); });
+  return true;
+}
+
+bool UserCacheStorage::UpdateUserLastSeenWorldVersion(const std::string& user_id, const std::string& version) {
+  if (!inner_->UpdateUserLastSeenWorldVersion(user_id, version)) return false;
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = users_.find(user_id);
+  if (it != users_.end() && it->second.user.has_value()) it->second.user->last_seen_world_version = version;
+  return true;
+}
+
+bool UserCacheStorage::DeleteUserById(const std::string& user_id) {
+  if (!inner_->DeleteUserById(user_id)) return false;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto& e = SlotLocked(user_id);
+    e.user.reset();
+    e.version = NextVersion();
+  }
+  NotifyListeners([&](WriteListener& l) { l.OnUserDeleted(user_id); });
+  return true;
+}
+
+bool UserCacheStorage::UpdateUserBalance(const std::string& user_id, int64_t new_balance) {
+  if (!inner_->UpdateUserBalance(user_id, new_balance)) return false;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    MutateLocked(user_id, [&](User& u) { u.balance_mi = new_balance; });
+  }
+  NotifyListeners([&](WriteListener& l) { l.OnUserBalanceSet(user_id, new_balance); });
+  return true;
+}
+
+bool UserCacheStorage::IncrementUserBalance(const std::string& user_id, int64_t delta_balance) {
+  if (!inner_->IncrementUserBalance(user_id, delta_balance)) return false;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    MutateLocked(user_id, [&](User& u) { u.balance_mi += delta_balance; });
+  }
+  NotifyListeners([&](WriteListener& l) { l.OnUserBalanceDelta(user_id, delta_balance); });
+  return true;
+}
+
+bool UserCacheStorage::BorrowCellsAndTrackPeriod(const std::string& user_id,
+                                                 int64_t amount,
+                                                 const std::string& period_key,
+                                                 int64_t& out_balance_mi,
+                                                 std::string* out_error_code) {
+  if (!inner_->BorrowCellsAndTrackPeriod(user_id, amount, period_key, out_balance_mi, out_error_code)) return false;
+  const int64_t balance = out_balance_mi;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    MutateLocked(user_id, [&](User& u) { u.balance_mi = balance; });
+  }
+  NotifyListeners([&](WriteListener& l) { l.OnUserBalanceSet(user_id, balance); });
+  return true;
+}
+
+std::vector<Snake> UserCacheStorage::ListSnakes() {
+  auto snakes = inner_->ListSnakes();
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const auto& s : snakes) RememberOwnerLocked(s);
+  return snakes;
+}
+
+std::optional<Snake> UserCacheStorage::GetSnakeById(const std::string& snake_id) {
+  auto s = inner_->GetSnakeById(snake_id);
+  if (s.has_value()) {
+    std::lock_guard<std::mutex> lock(mu_);
+    RememberOwnerLocked(*s);
+  }
+  return s;
+}
+
+bool UserCacheStorage::SnakeNameExistsNormalized(const std::string& snake_name_normalized,
+                                                 const std::string& exclude_snake_id) {
+  return inner_->SnakeNameExistsNormalized(snake_name_normalized, exclude_snake_id);
+}
+
+bool UserCacheStorage::PutSnake(const Snake& s) {
+  if (!inner_->PutSnake(s)) return false;
+  NotifyListeners([&](WriteListener& l) { l.OnSnakePut(s); });
+  std::lock_guard<std::mutex> lock(mu_);
+  RememberOwnerLocked(s);
+  TouchLocked(s.owner_user_id);
+  return true;
+}
+
+bool UserCacheStorage::DeleteSnake(const std::string& snake_id) {
+  if (!inner_->DeleteSnake(snake_id)) return false;
+  NotifyListeners([&](WriteListener& l) { l.OnSnakeDeleted(snake_id); });
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = snake_owner_.find(snake_id);
+  if (it != snake_owner_.end()) {
+    TouchLocked(it->second);
+    snake_owner_.erase(it);
+  }
+  return true;
+}
+
+bool UserCacheStorage::DeleteSnakeEventsBySnakeId(const std::string& snake_id) {
+  return inner_->DeleteSnakeEventsBySnakeId(snake_id);
+}
+
+bool UserCacheStorage::AttachCellsToSnake(const std::string& user_id,
+                                          const std::string& snake_id,
+                                          int64_t amount,
+                                          int64_t& out_balance_mi,
+                                          int64_t& out_length_k) {
+  if (!inner_->AttachCellsToSnake(user_id, snake_id, amount, out_balance_mi, out_length_k)) return false;
+  const int64_t balance = out_balance_mi;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    MutateLocked(user_id, [&](User& u) { u.balance_mi = balance; });
+  }
+  NotifyListeners([&](WriteListener& l) {
+    l.OnUserBalanceSet(user_id, balance);
+    l.OnSnakeLength(snake_id, out_length_k);
+  });
+  return true;
+}
+
+std::optional<WorldChunk> UserCacheStorage::GetWorldChunk(const std::string& chunk_id) {
+  return inner_->GetWorldChunk(chunk_id);
+}
+
+bool UserCacheStorage::PutWorldChunk(const WorldChunk& chunk) {
+  return inner_->PutWorldChunk(chunk);
+}
+
+bool UserCacheStorage::AppendSnakeEvent(const SnakeEvent& e) {
+  return inner_->AppendSnakeEvent(e);
+}
+
+std::optional<Settings> UserCacheStorage::GetSettings(const std::string& settings_id) {
+  return inner_->GetSettings(settings_id);
+}
+
+bool UserCacheStorage::PutSettings(const Settings& settings) {
+  return inner_->PutSettings(settings);
+}
+
+std::optional<EconomyParams> UserCacheStorage::GetEconomyParams() {
+  return inner_->GetEconomyParams();
+}
+
+std::optional<EconomyParams> UserCacheStorage::GetEconomyParamsActive() {
+  return inner_->GetEconomyParamsActive();
+}
+
+bool UserCacheStorage::PutEconomyParams(const EconomyParams& p) {
+  return inner_->PutEconomyParams(p);
+}
+
+bool UserCacheStorage::PutEconomyParamsActiveAndVersioned(const EconomyParams& p, const std::string& updated_by) {
+  return inner_->PutEconomyParamsActiveAndVersioned(p, updated_by);
+}
+
+std::optional<EconomyPeriod> UserCacheStorage::GetEconomyPeriod(const std::string& period_key) {
+  return inner_->GetEconomyPeriod(period_key);
+}
+
+bool UserCacheStorage::PutEconomyPeriod(const EconomyPeriod& p) {
+  return inner_->PutEconomyPeriod(p);
+}
+
+bool UserCacheStorage::IncrementEconomyPeriodDeltaMBuy(const std::string& period_key, int64_t delta_m_buy) {
+  return inner_->IncrementEconomyPeriodDeltaMBuy(period_key, delta_m_buy);
+}
+
+bool UserCacheStorage::IncrementEconomyPeriodRaw(const std::string& period_key,
+                                                 int64_t harvested_food_delta,
+                                                 int64_t movement_ticks_delta) {
+  return inner_->IncrementEconomyPeriodRaw(period_key, harvested_food_delta, movement_ticks_delta);
+}
+
+std::optional<EconomyPeriodUser> UserCacheStorage::GetEconomyPeriodUser(const std::string& period_key,
+                                                                        const std::string& user_id) {
+  return inner_->GetEconomyPeriodUser(period_key, user_id);
+}
+
+bool UserCacheStorage::PutEconomyPeriodUser(const EconomyPeriodUser& p) {
+  return inner_->PutEconomyPeriodUser(p);
+}
+
+bool UserCacheStorage::PutEconomyPeriodUsers(std::vector<EconomyPeriodUser>& rows) {
+  return inner_->PutEconomyPeriodUsers(rows);
+}
+
+bool UserCacheStorage::IncrementEconomyPeriodUserRaw(const std::string& period_key,
+                                                     const std::string& user_id,
+                                                     int64_t harvested_food_delta,
+                                                     int64_t movement_ticks_delta) {
+  return inner_->IncrementEconomyPeriodUserRaw(period_key, user_id, harvested_food_delta, movement_ticks_delta);
+}
+
+bool UserCacheStorage::IncrementEconomyPeriodRawBatch(const std::string& period_key,
+                                                      int64_t& harvested_food_delta,
+                                                      int64_t& movement_ticks_delta,
+                                                      std::vector<EconomyPeriodUserDelta>& user_deltas) {
+  return inner_->IncrementEconomyPeriodRawBatch(period_key, harvested_food_delta, movement_ticks_delta, user_deltas);
+}
+
+std::vector<EconomyPeriodUser> UserCacheStorage::ListEconomyPeriodUsers(const std::string& period_key) {
+  return inner_->ListEconomyPeriodUsers(period_key);
+}
+
+bool UserCacheStorage::IncrementSystemReserve(int64_t delta_cells) {
+  return inner_->IncrementSystemReserve(delta_cells);
+}
+
+bool UserCacheStorage::CommitCellLedgerEntries(const std::vector<CellLedgerEntry>& entries,
+                                               const std::string& request_token,
+                                               std::string* out_error_code) {
+  if (!inner_->CommitCellLedgerEntries(entries, request_token, out_error_code)) {
+    // A failed condition means storage disagrees with what we hold; let the
+    // ledger's reread go to storage.
+    if (out_error_code != nullptr && *out_error_code == "condition_failed") {
+      std::lock_guard<std::mutex> lock(mu_);
+      for (const auto& e : entries) {
+        auto it = users_.find(e.user_id);
+        if (it != users_.end()) it->second.user.reset();
+      }
+    }
+    return false;
+  }
+  std::unordered_map<std::string, int64_t> by_user;
+  for (const auto& e : entries) {
+    if (!e.user_id.empty() && e.user_delta != 0) by_user[e.user_id] += e.user_delta;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (const auto& [user_id, delta] : by_user) {
+      MutateLocked(user_id, [&](User& u) { u.balance_mi += delta; });
+    }
+  }
+  NotifyListeners([&](WriteListener& l) {
+    for (const auto& [user_id, delta] : by_user) l.OnCellLedgerDelta(user_id, delta);
+  });
+  return true;
+}
+
+bool UserCacheStorage::HealthCheck() {
+  return inner_->HealthCheck();
+}
+
+bool UserCacheStorage::ResetForDev() {
+  if (!inner_->ResetForDev()) return false;
+  NotifyListeners([](WriteListener& l) { l.OnReset(); });
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto& kv : users_) {
+    kv.second.user.reset();
+    kv.second.version = NextVersion();
+  }
+  snake_owner_.clear();
+  return true;
+}
+
+}  // namespace storage
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "storage.h"
+
+namespace storage {
+
+// Write-through IStorage decorator that keeps user rows in process. Every
+// user-affecting write made through this process (balance intents, borrow,
+// attach, snake upserts/deletes, profile updates) updates the cached row and
+// bumps a per-user version, so readers can tell whether anything visible to
+// the player changed without a storage round-trip. Entries also expire after
+// `ttl` to pick up out-of-process edits (seed tooling, console fixes), and the
+// least recently used ones are dropped beyond `max_entries`; a dropped user
+// reads as version 0 until their next write.
+//
+// Write listeners (economy aggregates, the cell ledger) hear about every
+// user-balance and snake write made through this decorator.
+class UserCacheStorage final : public IStorage {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t capacity = 0;
+  };
+
+  // Told about user/snake writes after the inner store accepted them, outside
+  // the cache lock; balance writes are reported after the cached row moved.
+  // Lets in-process aggregates follow writes without rescans.
+  class WriteListener {
+   public:
+    virtual ~WriteListener() = default;
+    virtual void OnUserBalanceSet(const std::string& user_id, int64_t balance_mi) = 0;
+    virtual void OnUserBalanceDelta(const std::string& user_id, int64_t delta_mi) = 0;
+    // A user's net change from one CommitCellLedgerEntries call.
+    virtual void OnCellLedgerDelta(const std::string& user_id, int64_t delta_mi) {
+      OnUserBalanceDelta(user_id, delta_mi);
+    }
+    virtual void OnUserDeleted(const std::string& user_id) = 0;
+    virtual void OnSnakePut(const Snake& s) = 0;
+    virtual void OnSnakeLength(const std::string& snake_id, int64_t length_k) = 0;
+    virtual void OnSnakeDeleted(const std::string& snake_id) = 0;
+    virtual void OnReset() = 0;
+  };
+
+  UserCacheStorage(std::unique_ptr<IStorage> inner, std::chrono::milliseconds ttl, size_t max_entries);
+
+  static constexpr size_t kMaxWriteListeners = 4;
+
+  // Not owned; must outlive this storage. Added before serving traffic; more
+  // than kMaxWriteListeners returns false.
+  bool AddWriteListener(WriteListener* listener);
+
+  // Advances whenever the user's row or one of their snakes changes.
+  uint64_t UserVersion(const std::string& user_id) const;
+  Stats GetStats() const;
+
+  std::vector<User> ListUsers() override;
+  std::optional<User> GetUserByGoogleSubject(const std::string& google_subject_id) override;
+  bool CompanyNameExistsNormalized(const std::string& company_name_normalized,
+                                   const std::string& exclude_user_id = "") override;
+  std::optional<User> GetUserById(const std::string& user_id) override;
+  bool PutUser(const User& u) override;
+  bool UpdateUserLastSeenWorldVersion(const std::string& user_id, const std::string& version) override;
+  bool DeleteUserById(const std::string& user_id) override;
+  bool UpdateUserBalance(const std::string& user_id, int64_t new_balance) override;
+  bool IncrementUserBalance(const std::string& user_id, int64_t delta_balance) override;
+  bool BorrowCellsAndTrackPeriod(const std::string& user_id,
+                                 int64_t amount,
+                                 const std::string& period_key,
+                                 int64_t& out_balance_mi,
+                                 std::string* out_error_code = nullptr) override;
+
+  std::vector<Snake> ListSnakes() override;
+  std::optional<Snake> GetSnakeById(const std::string& snake_id) override;
+  bool SnakeNameExistsNormalized(const std::string& snake_name_normalized,
+                                 const std::string& exclude_snake_id = "") override;
+  bool PutSnake(const Snake& s) override;
+  bool DeleteSnake(const std::string& snake_id) override;
+  bool DeleteSnakeEventsBySnakeId(const std::string& snake_id) override;
+  bool AttachCellsToSnake(const std::string& user_id,
+                          const std::string& snake_id,
+                          int64_t amount,
+                          int64_t& out_balance_mi,
+                          int64_t& out_length_k) override;
+
+  std::optional<WorldChunk> GetWorldChunk(const std::string& chunk_id) override;
+  bool PutWorldChunk(const WorldChunk& chunk) override;
+
+  bool AppendSnakeEvent(const SnakeEvent& e) override;
+
+  std::optional<Settings> GetSettings(const std::string& settings_id = "global") override;
+  bool PutSettings(const Settings& settings) override;
+
+  std::optional<EconomyParams> GetEconomyParams() override;
+  std::optional<EconomyParams> GetEconomyParamsActive() override;
+  bool PutEconomyParams(const EconomyParams& p) override;
+  bool PutEconomyParamsActiveAndVersioned(const EconomyParams& p, const std::string& updated_by) override;
+  std::optional<EconomyPeriod> GetEconomyPeriod(const std::string& period_key) override;
+  bool PutEconomyPeriod(const EconomyPeriod& p) override;
+  bool IncrementEconomyPeriodDeltaMBuy(const std::string& period_key, int64_t delta_m_buy) override;
+  bool IncrementEconomyPeriodRaw(const std::string& period_key,
+                                 int64_t harvested_food_delta,
+                                 int64_t movement_ticks_delta) override;
+  std::optional<EconomyPeriodUser> GetEconomyPeriodUser(const std::string& period_key,
+                                                        const std::string& user_id) override;
+  bool PutEconomyPeriodUser(const EconomyPeriodUser& p) override;
+  bool PutEconomyPeriodUsers(std::vector<EconomyPeriodUser>& rows) override;
+  bool IncrementEconomyPeriodUserRaw(const std::string& period_key,
+                                     const std::string& user_id,
+                                     int64_t harvested_food_delta,
+                                     int64_t movement_ticks_delta) override;
+  bool IncrementEconomyPeriodRawBatch(const std::string& period_key,
+                                      int64_t& harvested_food_delta,
+                                      int64_t& movement_ticks_delta,
+                                      std::vector<EconomyPeriodUserDelta>& user_deltas) override;
+  std::vector<EconomyPeriodUser> ListEconomyPeriodUsers(const std::string& period_key) override;
+  bool IncrementSystemReserve(int64_t delta_cells) override;
+  bool CommitCellLedgerEntries(const std::vector<CellLedgerEntry>& entries,
+                               const std::string& request_token,
+                               std::string* out_error_code = nullptr) override;
+
+  bool HealthCheck() override;
+  bool ResetForDev() override;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  using Order = std::list<std::string>;  // front: most recently used
+
+  struct Entry {
+    std::optional<User> user;  // empty: version tracked, row not cached
+    Clock::time_point loaded_at{};
+    uint64_t version = 0;
+    Order::iterator pos;
+  };
+
+  // Finds or creates the user's entry, marks it most recently used and trims
+  // the least recently used ones past capacity.
+  Entry& SlotLocked(const std::string& user_id);
+
+  // Applies `fn` to the cached row (if any) and bumps the user's version.
+  template <typename Fn>
+  void MutateLocked(const std::string& user_id, Fn&& fn);
+  void TouchLocked(const std::string& user_id);
+  void RememberOwnerLocked(const Snake& s);
+  template <typename Fn>
+  void NotifyListeners(Fn&& fn);
+
+  std::unique_ptr<IStorage> inner_;
+  const std::chrono::milliseconds ttl_;
+  const size_t max_entries_;
+
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, Entry> users_;
+  Order order_;
+  uint64_t evictions_ = 0;
+  std::unordered_map<std::string, std::string> snake_owner_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::array<std::atomic<WriteListener*>, kMaxWriteListeners> listeners_{};
+  std::atomic<size_t> listener_count_{0};
+};
+
+}  // namespace storage
@@ -0,0 +1,259 @@
+#include "static_asset_cache.h"
+
+#include <brotli/encode.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+namespace web {
+namespace {
+
+// A compressed variant is kept only if it saves at least this much.
+constexpr double kMinCompressionGain = 0.10;
+
+std::string ContentTypeForPath(const std::string& path) {
+  const auto dot = path.find_last_of('.');
+  const std::string ext = (dot == std::string::npos) ? "" : path.substr(dot);
+  if (ext == ".html") return "text/html; charset=utf-8";
+  if (ext == ".css") return "text/css; charset=utf-8";
+  if (ext == ".js") return "application/javascript; charset=utf-8";
+  if (ext == ".json") return "application/json";
+  if (ext == ".png") return "image/png";
+  if (ext == ".jpg" || ext == ".jpeg") return "image/jpeg";
+  if (ext == ".svg") return "image/svg+xml";
+  if (ext == ".webp") return "image/webp";
+  if (ext == ".ico") return "image/x-icon";
+  return "application/octet-stream";
+}
+
+bool IsCompressible(const std::string& content_type) {
+  return content_type.rfind("text/", 0) == 0 || content_type.rfind("application/javascript", 0) == 0 ||
+         content_type == "application/json" || content_type == "image/svg+xml";
+}
+
+std::string Gzip(const char* data, size_t size) {
+  z_stream zs{};
+  if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) return {};
+  std::string out(deflateBound(&zs, static_cast<uLong>(size)), '\0');
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  zs.avail_in = static_cast<uInt>(size);
+  zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  zs.avail_out = static_cast<uInt>(out.size());
+  const int rc = deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  return rc == Z_STREAM_END ? out : std::string();
+}
+
+std::string Brotli(const char* data, size_t size) {
+  size_t out_size = BrotliEncoderMaxCompressedSize(size);
+  if (out_size == 0) return {};
+  std::string out(out_size, '\0');
+  if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, size,
+                             reinterpret_cast<const uint8_t*>(data), &out_size,
+                             reinterpret_cast<uint8_t*>(&out[0]))) {
+    return {};
+  }
+  out.resize(out_size);
+  return out;
+}
+
+std::string EtagBase(const char* data, size_t size) {
+  uint64_t h = 1469598103934665603ull;  // FNV-1a
+  for (size_t i = 0; i < size; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 1099511628211ull;
+  }
+  char buf[48];
+  std::snprintf(buf, sizeof(buf), "%016llx-%zx", static_cast<unsigned long long>(h), size);
+  return buf;
+}
+
+std::string_view Trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+  return s;
+}
+
+// Calls fn(token) for each comma-separated, trimmed token.
+template <typename Fn>
+void ForEachToken(std::string_view header, Fn&& fn) {
+  while (!header.empty()) {
+    const size_t comma = header.find(',');
+    fn(Trim(header.substr(0, comma)));
+    if (comma == std::string_view::npos) break;
+    header.remove_prefix(comma + 1);
+  }
+}
+
+}  // namespace
+
+StaticAsset::~StaticAsset() {
+  if (map_) munmap(map_, size_);
+}
+
+StaticAsset::Body StaticAsset::body(Encoding enc) const {
+  switch (enc) {
+    case Encoding::kGzip: return {gzip_.data(), gzip_.size()};
+    case Encoding::kBrotli: return {brotli_.data(), brotli_.size()};
+    case Encoding::kIdentity: break;
+  }
+  return {map_ ? static_cast<const char*>(map_) : owned_.data(), size_};
+}
+
+bool StaticAsset::has(Encoding enc) const {
+  switch (enc) {
+    case Encoding::kGzip: return !gzip_.empty();
+    case Encoding::kBrotli: return !brotli_.empty();
+    case Encoding::kIdentity: break;
+  }
+  return true;
+}
+
+const std::string& StaticAsset::etag(Encoding enc) const {
+  switch (enc) {
+    case Encoding::kGzip: return etag_gzip_;
+    case Encoding::kBrotli: return etag_brotli_;
+    case Encoding::kIdentity: break;
+  }
+  return etag_identity_;
+}
+
+bool StaticAsset::MatchesIfNoneMatch(std::string_view header) const {
+  bool match = false;
+  ForEachToken(header, [&](std::string_view tag) {
+    if (tag == "*") match = true;
+    if (tag.rfind("W/", 0) == 0) tag.remove_prefix(2);
+    if (tag == etag_identity_ || (has(Encoding::kGzip) && tag == etag_gzip_) ||
+        (has(Encoding::kBrotli) && tag == etag_brotli_)) {
+      match = true;
+    }
+  });
+  return match;
+}
+
+StaticAssetCache::StaticAssetCache(Options options)
+    : options_(std::move(options)), snapshot_(std::make_shared<const Snapshot>()) {}
+
+std::shared_ptr<StaticAsset> StaticAssetCache::Load(const std::string& file) const {
+  const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullptr;
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return nullptr;
+  }
+  std::shared_ptr<StaticAsset> a(new StaticAsset());
+  a->size_ = static_cast<size_t>(st.st_size);
+  if (a->size_ >= options_.mmap_threshold_bytes && a->size_ > 0) {
+    void* p = mmap(nullptr, a->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) a->map_ = p;
+  }
+  if (!a->map_) {
+    a->owned_.resize(a->size_);
+    size_t got = 0;
+    while (got < a->size_) {
+      const ssize_t n = read(fd, &a->owned_[got], a->size_ - got);
+      if (n <= 0) break;
+      got += static_cast<size_t>(n);
+    }
+    a->owned_.resize(got);
+    a->size_ = got;
+  }
+  close(fd);
+
+  a->content_type_ = ContentTypeForPath(file);
+  a->cache_control_ =
+      a->content_type_.rfind("text/html", 0) == 0 ? options_.html_cache_control : options_.cache_control;
+  const auto id = a->body(StaticAsset::Encoding::kIdentity);
+  if (IsCompressible(a->content_type_) && id.size > 0) {
+    const size_t worth = static_cast<size_t>(static_cast<double>(id.size) * (1.0 - kMinCompressionGain));
+    a->gzip_ = Gzip(id.data, id.size);
+    if (a->gzip_.size() > worth) a->gzip_.clear();
+    a->brotli_ = Brotli(id.data, id.size);
+    if (a->brotli_.size() > worth) a->brotli_.clear();
+  }
+  const std::string base = EtagBase(id.data, id.size);
+  a->etag_identity_ = "\"" + base + "\"";
+  a->etag_gzip_ = "\"" + base + "-gz\"";
+  a->etag_brotli_ = "\"" + base + "-br\"";
+  return a;
+}
+
+size_t StaticAssetCache::Reload() {
+  std::lock_guard<std::mutex> reload_lock(reload_mu_);
+  auto next = std::make_shared<Snapshot>();
+  auto add = [&](const std::string& url, const std::string& file) {
+    auto a = Load(file);
+    if (!a) return;
+    next->identity_bytes += a->size();
+    next->gzip_bytes += a->gzip_.size();
+    next->brotli_bytes += a->brotli_.size();
+    if (a->mapped()) ++next->mapped_files;
+    next->assets[url] = std::move(a);
+  };
+  for (const auto& [url, file] : options_.files) add(url, file);
+  for (const auto& [prefix, dir] : options_.dirs) {
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+      if (!it->is_regular_file(ec)) continue;
+      const auto rel = std::filesystem::relative(it->path(), dir, ec).generic_string();
+      if (ec || rel.empty()) continue;
+      add(prefix + rel, it->path().string());
+    }
+  }
+  const size_t count = next->assets.size();
+  std::cout << "[static] loaded assets=" << count << " bytes=" << next->identity_bytes
+            << " gzip_bytes=" << next->gzip_bytes << " br_bytes=" << next->brotli_bytes
+            << " mmapped=" << next->mapped_files << "\n";
+  std::lock_guard<std::mutex> lock(mu_);
+  snapshot_ = std::move(next);
+  return count;
+}
+
+std::shared_ptr<const StaticAssetCache::Snapshot> StaticAssetCache::current() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return snapshot_;
+}
+
+std::shared_ptr<const StaticAsset> StaticAssetCache::Find(const std::string& url_path) const {
+  const auto snap = current();
+  const auto it = snap->assets.find(url_path);
+  return it == snap->assets.end() ? nullptr : it->second;
+}
+
+StaticAsset::Encoding StaticAssetCache::Negotiate(const StaticAsset& asset, std::string_view accept_encoding) {
+  bool br = false;
+  bool gzip = false;
+  ForEachToken(accept_encoding, [&](std::string_view token) {
+    const size_t semi = token.find(';');
+    const std::string_view name = Trim(token.substr(0, semi));
+    if (semi != std::string_view::npos) {
+      const std::string_view params = Trim(token.substr(semi + 1));
+      if (params.rfind("q=", 0) == 0 && std::atof(std::string(params.substr(2)).c_str()) <= 0.0) return;
+    }
+    if (name == "br") br = true;
+    if (name == "gzip" || name == "*") gzip = true;
+  });
+  if (br && asset.has(StaticAsset::Encoding::kBrotli)) return StaticAsset::Encoding::kBrotli;
+  if (gzip && asset.has(StaticAsset::Encoding::kGzip)) return StaticAsset::Encoding::kGzip;
+  return StaticAsset::Encoding::kIdentity;
+}
+
+const char* StaticAssetCache::EncodingName(StaticAsset::Encoding enc) {
+  switch (enc) {
+    case StaticAsset::Encoding::kGzip: return "gzip";
+    case StaticAsset::Encoding::kBrotli: return "br";
+    case StaticAsset::Encoding::kIdentity: break;
+  }
+  return "identity";
+}
+
+}  // namespace web
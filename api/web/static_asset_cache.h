@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace web {
+
+// One static file held in memory. Immutable once loaded; the identity body is
+// either owned bytes or a read-only mmap of the file.
+class StaticAsset {
+ public:
+  enum class Encoding { kIdentity, kGzip, kBrotli };
+
+  struct Body {
+    const char* data = nullptr;
+    size_t size = 0;
+  };
+
+  ~StaticAsset();
+  StaticAsset(const StaticAsset&) = delete;
+  StaticAsset& operator=(const StaticAsset&) = delete;
+
+  const std::string& content_type() const { return content_type_; }
+  const std::string& cache_control() const { return cache_control_; }
+  size_t size() const { return size_; }
+  bool mapped() const { return map_ != nullptr; }
+
+  Body body(Encoding enc) const;
+  bool has(Encoding enc) const;
+  // Strong ETag of one representation (quoted).
+  const std::string& etag(Encoding enc) const;
+  // True if an If-None-Match header names any representation of this asset.
+  bool MatchesIfNoneMatch(std::string_view header) const;
+
+ private:
+  friend class StaticAssetCache;
+  StaticAsset() = default;
+
+  std::string content_type_;
+  std::string cache_control_;
+  std::string owned_;
+  void* map_ = nullptr;
+  size_t size_ = 0;
+  std::string gzip_;
+  std::string brotli_;
+  std::string etag_identity_;
+  std::string etag_gzip_;
+  std::string etag_brotli_;
+};
+
+// Precompressed snapshot of the files served by the dev/fallback static routes.
+// Reload() builds a complete new snapshot off to the side and swaps it in, so
+// requests never touch the disk and in-flight responses keep the snapshot
+// (and its mmaps) they started with.
+class StaticAssetCache {
+ public:
+  struct Options {
+    // url path -> file, e.g. "/index.html" -> "index.html".
+    std::vector<std::pair<std::string, std::string>> files;
+    // url prefix -> directory, loaded recursively, e.g. "/src/" -> "src".
+    std::vector<std::pair<std::string, std::string>> dirs;
+    size_t mmap_threshold_bytes = 256 * 1024;
+    std::string html_cache_control = "no-cache";
+    std::string cache_control = "public, max-age=300";
+  };
+
+  struct Snapshot {
+    std::unordered_map<std::string, std::shared_ptr<const StaticAsset>> assets;
+    size_t identity_bytes = 0;
+    size_t gzip_bytes = 0;
+    size_t brotli_bytes = 0;
+    size_t mapped_files = 0;
+  };
+
+  explicit StaticAssetCache(Options options);
+
+  // Returns the number of assets loaded.
+  size_t Reload();
+  std::shared_ptr<const Snapshot> current() const;
+  std::shared_ptr<const StaticAsset> Find(const std::string& url_path) const;
+
+  // Best representation allowed by an Accept-Encoding header.
+  static StaticAsset::Encoding Negotiate(const StaticAsset& asset, std::string_view accept_encoding);
+  static const char* EncodingName(StaticAsset::Encoding enc);
+
+ private:
+  std::shared_ptr<StaticAsset> Load(const std::string& file) const;
+
+  const Options options_;
+  std::mutex reload_mu_;
+  mutable std::mutex mu_;
+  std::shared_ptr<const Snapshot> snapshot_;
+};
+
+}  // namespace web
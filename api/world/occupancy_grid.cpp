@@ -0,0 +1,76 @@
+#include "occupancy_grid.h"
+
+#include <algorithm>
+
+namespace world {
+
+void OccupancyGrid::Reset(int width, int height, int chunk_size, const std::vector<uint8_t>* playable) {
+  width_ = std::max(0, width);
+  height_ = std::max(0, height);
+  chunk_size_ = chunk_size > 0 ? std::max(8, chunk_size) : 0;
+  chunks_x_ = chunk_size_ > 0 ? std::max(1, (width_ + chunk_size_ - 1) / chunk_size_) : 1;
+  chunks_y_ = chunk_size_ > 0 ? std::max(1, (height_ + chunk_size_ - 1) / chunk_size_) : 1;
+  playable_ = playable;
+  counts_.assign(static_cast<size_t>(width_) * static_cast<size_t>(height_), 0);
+  chunk_cells_.assign(static_cast<size_t>(chunks_x_) * static_cast<size_t>(chunks_y_), 0);
+  occupied_ = 0;
+  occupied_playable_ = 0;
+}
+
+bool OccupancyGrid::Index(const Vec2& c, size_t& idx) const {
+  if (c.x < 0 || c.y < 0 || c.x >= width_ || c.y >= height_) return false;
+  idx = static_cast<size_t>(c.y) * static_cast<size_t>(width_) + static_cast<size_t>(c.x);
+  return true;
+}
+
+bool OccupancyGrid::PlayableAt(size_t idx) const {
+  if (!playable_ || playable_->empty()) return true;
+  return idx < playable_->size() && (*playable_)[idx] != 0;
+}
+
+size_t OccupancyGrid::ChunkOf(const Vec2& c) const {
+  if (chunk_size_ <= 0) return 0;
+  return static_cast<size_t>(c.y / chunk_size_) * static_cast<size_t>(chunks_x_) +
+         static_cast<size_t>(c.x / chunk_size_);
+}
+
+ChunkId OccupancyGrid::ChunkAt(size_t index) const {
+  return {static_cast<int>(index % static_cast<size_t>(chunks_x_)),
+          static_cast<int>(index / static_cast<size_t>(chunks_x_))};
+}
+
+void OccupancyGrid::Add(const Vec2& c) {
+  size_t idx = 0;
+  if (!Index(c, idx)) return;
+  if (counts_[idx]++ != 0) return;
+  ++occupied_;
+  if (PlayableAt(idx)) ++occupied_playable_;
+  ++chunk_cells_[ChunkOf(c)];
+}
+
+void OccupancyGrid::Remove(const Vec2& c) {
+  size_t idx = 0;
+  if (!Index(c, idx)) return;
+  uint32_t& n = counts_[idx];
+  if (n == 0 || --n != 0) return;
+  --occupied_;
+  if (PlayableAt(idx)) --occupied_playable_;
+  --chunk_cells_[ChunkOf(c)];
+}
+
+void OccupancyGrid::AddBody(const std::vector<Vec2>& body) {
+  for (const auto& c : body) Add(c);
+}
+
+void OccupancyGrid::RemoveBody(const std::vector<Vec2>& body) {
+  for (const auto& c : body) Remove(c);
+}
+
+void OccupancyGrid::RecountPlayable() {
+  occupied_playable_ = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] != 0 && PlayableAt(i)) ++occupied_playable_;
+  }
+}
+
+}  // namespace world
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "chunk_manager.h"
+#include "entities/snake.h"
+
+namespace world {
+
+// Per-cell count of snake body segments, updated on every body change so the
+// occupied / free-playable totals (world-wide and per chunk) are read in O(1)
+// instead of hashing every body cell. Counts rather than flags because a
+// cell can hold several segments (attach stacks new cells on the tail).
+// Cells outside the grid are not counted.
+class OccupancyGrid {
+ public:
+  // Clears all counts. `chunk_size` <= 0 keeps a single chunk. `playable`
+  // is the world's mask (empty: every cell playable); it is read when a
+  // cell turns occupied or free, so it must outlive the grid.
+  void Reset(int width, int height, int chunk_size, const std::vector<uint8_t>* playable);
+  void Add(const Vec2& c);
+  void Remove(const Vec2& c);
+  void AddBody(const std::vector<Vec2>& body);
+  void RemoveBody(const std::vector<Vec2>& body);
+  // The mask changed under unchanged bodies: O(width * height).
+  void RecountPlayable();
+
+  int64_t occupied_cells() const { return occupied_; }
+  int64_t occupied_playable_cells() const { return occupied_playable_; }
+  // Distinct occupied cells per chunk, row-major over chunks_x() x chunks_y().
+  const std::vector<int32_t>& chunk_cells() const { return chunk_cells_; }
+  int chunks_x() const { return chunks_x_; }
+  int chunks_y() const { return chunks_y_; }
+  ChunkId ChunkAt(size_t index) const;
+
+ private:
+  bool Index(const Vec2& c, size_t& idx) const;
+  bool PlayableAt(size_t idx) const;
+  size_t ChunkOf(const Vec2& c) const;
+
+  int width_ = 0;
+  int height_ = 0;
+  int chunk_size_ = 0;
+  int chunks_x_ = 1;
+  int chunks_y_ = 1;
+  const std::vector<uint8_t>* playable_ = nullptr;
+  std::vector<uint32_t> counts_;
+  std::vector<int32_t> chunk_cells_;
+  int64_t occupied_ = 0;
+  int64_t occupied_playable_ = 0;
+};
+
+}  // namespace world
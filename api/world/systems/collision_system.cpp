@@ -40,6 +40,7 @@ void ApplyForcedReverseTurn(Snake& s) {
 }
 
 void ApplySingleCellLoss(Snake& s,
+                         OccupancyGrid* occupancy,
                          uint64_t tick_id,
                          const std::string& event_type,
                          int other_snake_id,
@@ -48,7 +49,10 @@ void ApplySingleCellLoss(Snake& s,
                          int delta_system_cells = 0) {
   if (!s.alive) return;
   if (s.last_loss_tick == tick_id) return;
-  if (!s.body.empty()) s.body.pop_back();
+  if (!s.body.empty()) {
+    if (occupancy) occupancy->Remove(s.body.back());
+    s.body.pop_back();
+  }
   s.last_loss_tick = tick_id;
   CollisionEvent ev;
   ev.event_type = event_type;
@@ -82,7 +86,8 @@ void CollisionSystem::Run(std::vector<Snake>& snakes,
                           std::mt19937& rng,
                           std::vector<CollisionEvent>& events,
                           bool& food_changed,
-                          const std::function<bool(const Vec2&)>& is_playable) {
+                          const std::function<bool(const Vec2&)>& is_playable,
+                          OccupancyGrid* occupancy) {
   food_changed = false;
   // 1) Resolve pending side-head duels (once).
   std::unordered_set<int> resolved_duels;
@@ -113,7 +118,7 @@ void CollisionSystem::Run(std::vector<Snake>& snakes,
     win.delta_user_cells = 1;
     events.push_back(std::move(win));
 
-    ApplySingleCellLoss(*loser, tick_id, "HEAD_DUEL_LOSS", winner->id, impact, events, 0);
+    ApplySingleCellLoss(*loser, occupancy, tick_id, "HEAD_DUEL_LOSS", winner->id, impact, events, 0);
     s.duel_pending = false;
     s.duel_with_id = 0;
     s.duel_resolve_tick = 0;
@@ -170,8 +175,8 @@ void CollisionSystem::Run(std::vector<Snake>& snakes,
     Snake* b = FindSnakeById(snakes, pair.second);
     if (!a || !b || !a->alive || !b->alive) continue;
     const Vec2 impact = proposed.count(a->id) ? proposed[a->id].next_head : (a->body.empty() ? Vec2{} : a->body.front());
-    ApplySingleCellLoss(*a, tick_id, "HEAD_ONCOMING", b->id, impact, events, 1);
-    ApplySingleCellLoss(*b, tick_id, "HEAD_ONCOMING", a->id, impact, events, 1);
+    ApplySingleCellLoss(*a, occupancy, tick_id, "HEAD_ONCOMING", b->id, impact, events, 1);
+    ApplySingleCellLoss(*b, occupancy, tick_id, "HEAD_ONCOMING", a->id, impact, events, 1);
     ApplyForcedReverseTurn(*a);
     ApplyForcedReverseTurn(*b);
     blocked_move.insert(a->id);
@@ -206,8 +211,8 @@ void CollisionSystem::Run(std::vector<Snake>& snakes,
         Snake* def = FindSnakeById(snakes, defender.id);
         if (atk && def && atk->alive && def->alive) {
           const Vec2 impact = ita->second.next_head;
-          ApplySingleCellLoss(*atk, tick_id, "HEAD_ONCOMING", def->id, impact, events, 1);
-          ApplySingleCellLoss(*def, tick_id, "HEAD_ONCOMING", atk->id, impact, events, 1);
+          ApplySingleCellLoss(*atk, occupancy, tick_id, "HEAD_ONCOMING", def->id, impact, events, 1);
+          ApplySingleCellLoss(*def, occupancy, tick_id, "HEAD_ONCOMING", atk->id, impact, events, 1);
           ApplyForcedReverseTurn(*atk);
           blocked_move.insert(atk->id);
           blocked_move.insert(def->id);
@@ -279,7 +284,7 @@ void CollisionSystem::Run(std::vector<Snake>& snakes,
     bite.delta_user_cells = 1;
     events.push_back(std::move(bite));
 
-    ApplySingleCellLoss(*defender, tick_id, "TAIL_BITTEN", attacker->id, impact, events, 0);
+    ApplySingleCellLoss(*defender, occupancy, tick_id, "TAIL_BITTEN", attacker->id, impact, events, 0);
     blocked_move.insert(attacker->id);
   }
 
@@ -303,7 +308,7 @@ void CollisionSystem::Run(std::vector<Snake>& snakes,
       }
     }
     if (self_hit) {
-      ApplySingleCellLoss(s, tick_id, "SELF_COLLISION", 0, itp->second.next_head, events, 0);
+      ApplySingleCellLoss(s, occupancy, tick_id, "SELF_COLLISION", 0, itp->second.next_head, events, 0);
       s.paused = true;
       blocked_move.insert(s.id);
     }
@@ -315,9 +320,11 @@ void CollisionSystem::Run(std::vector<Snake>& snakes,
     auto itp = proposed.find(s.id);
     if (itp == proposed.end()) continue;
     s.body.insert(s.body.begin(), itp->second.next_head);
+    if (occupancy) occupancy->Add(itp->second.next_head);
     if (s.grow > 0) {
       --s.grow;
     } else if (!s.body.empty()) {
+      if (occupancy) occupancy->Remove(s.body.back());
       s.body.pop_back();
     }
   }
@@ -343,7 +350,13 @@ void CollisionSystem::Run(std::vector<Snake>& snakes,
     }
   }
 
-  snakes.erase(std::remove_if(snakes.begin(), snakes.end(), [](const Snake& s) { return !s.alive || s.body.empty(); }), snakes.end());
+  snakes.erase(std::remove_if(snakes.begin(), snakes.end(),
+                              [&](const Snake& s) {
+                                const bool gone = !s.alive || s.body.empty();
+                                if (gone && occupancy) occupancy->RemoveBody(s.body);
+                                return gone;
+                              }),
+               snakes.end());
 }
 
 }  // namespace world
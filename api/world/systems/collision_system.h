@@ -7,6 +7,7 @@
 
 #include "../entities/food.h"
 #include "../entities/snake.h"
+#include "../occupancy_grid.h"
 
 namespace world {
 
@@ -25,6 +26,7 @@ struct CollisionEvent {
 class CollisionSystem {
  public:
   // Resolves collisions using the current gameplay rules and emits meaningful gameplay events.
+  // Every body cell added or removed is mirrored into `occupancy` when given.
   static void Run(std::vector<Snake>& snakes,
                   std::vector<Food>& foods,
                   int width,
@@ -34,7 +36,8 @@ class CollisionSystem {
                   std::mt19937& rng,
                   std::vector<CollisionEvent>& events,
                   bool& food_changed,
-                  const std::function<bool(const Vec2&)>& is_playable = nullptr);
+                  const std::function<bool(const Vec2&)>& is_playable = nullptr,
+                  OccupancyGrid* occupancy = nullptr);
 };
 
 }  // namespace world
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstdint>
 #include <sstream>
 #include <unordered_set>
@@ -10,6 +11,56 @@
 #include "systems/spawn_system.h"
 
 namespace world {
+namespace {
+
+int64_t SteadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Little-endian writer for EncodeBinarySnapshot.
+class BinaryWriter {
+ public:
+  explicit BinaryWriter(std::string& out) : out_(out) {}
+  void U8(uint8_t v) { out_.push_back(static_cast<char>(v)); }
+  void U32(uint32_t v) {
+    for (int i = 0; i < 4; ++i) U8(static_cast<uint8_t>(v >> (8 * i)));
+  }
+  void U64(uint64_t v) {
+    for (int i = 0; i < 8; ++i) U8(static_cast<uint8_t>(v >> (8 * i)));
+  }
+  void I32(int32_t v) { U32(static_cast<uint32_t>(v)); }
+  void I64(int64_t v) { U64(static_cast<uint64_t>(v)); }
+  void Varint(uint64_t v) {
+    while (v >= 0x80) {
+      U8(static_cast<uint8_t>(v | 0x80));
+      v >>= 7;
+    }
+    U8(static_cast<uint8_t>(v));
+  }
+  void ZigZag(int64_t v) { Varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63)); }
+  void Str(const std::string& v) {
+    Varint(v.size());
+    out_.append(v);
+  }
+
+ private:
+  std::string& out_;
+};
+
+}  // namespace
+
+const char* TickProfile::PhaseName(int phase) {
+  switch (phase) {
+    case kPrepare: return "prepare";
+    case kMovement: return "movement";
+    case kCollision: return "collision";
+    case kSpawn: return "spawn";
+    case kEvents: return "events";
+    case kChunks: return "chunks";
+    default: return "unknown";
+  }
+}
 
 World::World(int width, int height, int food_count, int max_snakes_per_user)
     : width_(width),
@@ -20,6 +71,40 @@ World::World(int width, int height, int food_count, int max_snakes_per_user)
       chunk_manager_(64, true) {
   playable_cells_target_ = static_cast<int64_t>(std::max(1, width_)) * static_cast<int64_t>(std::max(1, height_));
   RebuildPlayableMaskLocked();
+  RebuildOccupancyLocked();
+  PublishSpatialLocked();
+}
+
+void World::RebuildOccupancyLocked() {
+  occupancy_.Reset(width_, height_, occupancy_chunk_size_, &playable_mask_);
+  for (const auto& s : snakes_) occupancy_.AddBody(s.body);
+}
+
+void World::PublishSpatialLocked() {
+  spatial_occupied_.store(occupancy_.occupied_cells(), std::memory_order_relaxed);
+  spatial_playable_.store(playable_cells_count_, std::memory_order_relaxed);
+  spatial_free_playable_.store(std::max<int64_t>(0, playable_cells_count_ - occupancy_.occupied_playable_cells()),
+                               std::memory_order_relaxed);
+  spatial_tick_.store(tick_, std::memory_order_release);
+}
+
+SpatialMetrics World::Spatial() const {
+  SpatialMetrics out;
+  out.tick = spatial_tick_.load(std::memory_order_acquire);
+  out.occupied_cells = spatial_occupied_.load(std::memory_order_relaxed);
+  out.playable_cells = spatial_playable_.load(std::memory_order_relaxed);
+  out.free_playable_cells = spatial_free_playable_.load(std::memory_order_relaxed);
+  return out;
+}
+
+std::vector<ChunkOccupancy> World::OccupiedChunks() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::vector<ChunkOccupancy> out;
+  const auto& cells = occupancy_.chunk_cells();
+  for (size_t i = 0; i < cells.size(); ++i) {
+    if (cells[i] > 0) out.push_back({occupancy_.ChunkAt(i), cells[i]});
+  }
+  return out;
 }
 
 bool World::HashJitterLess(int x, int y, uint32_t threshold) const {
@@ -161,6 +246,8 @@ void World::LoadFromStorage(const std::vector<storage::Snake>& stored_snakes,
   ResolveOverlapsOnStartLocked();
   chunk_manager_.SetWorldBounds(width_, height_);
   chunk_manager_.Rebuild(snakes_, foods_, obstacles_, tick_);
+  RebuildOccupancyLocked();
+  PublishSpatialLocked();
 
   if (!world_chunk.has_value()) {
     // First boot with empty DB needs an initial world row.
@@ -171,6 +258,17 @@ void World::LoadFromStorage(const std::vector<storage::Snake>& stored_snakes,
 
 void World::Tick() {
   std::lock_guard<std::mutex> lock(mu_);
+  TickProfile& prof = last_tick_profile_;
+  const int64_t t_start = SteadyNowNs();
+  int64_t t_mark = t_start;
+  const auto end_phase = [&](TickProfile::Phase phase) {
+    const int64_t t = SteadyNowNs();
+    prof.phase_ns[phase] = t - t_mark;
+    t_mark = t;
+  };
+
+  last_tick_inputs_.clear();
+  for (const auto& kv : input_buffer_) last_tick_inputs_.emplace_back(kv.first, kv.second);
 
   std::unordered_map<int, std::pair<Dir, bool>> before_dir_pause;
   before_dir_pause.reserve(snakes_.size());
@@ -180,20 +278,25 @@ void World::Tick() {
     before_dir_pause[s.id] = {s.dir, s.paused};
     if (s.alive && !s.body.empty()) before_heads[s.id] = s.body.front();
   }
+  end_phase(TickProfile::kPrepare);
 
   MovementSystem::Run(snakes_, input_buffer_, width_, height_);
+  end_phase(TickProfile::kMovement);
 
   std::vector<CollisionEvent> events;
   events.reserve(8);
   bool food_changed = false;
   auto is_playable = [&](const Vec2& p) { return IsPlayableLocked(p); };
-  CollisionSystem::Run(snakes_, foods_, width_, height_, tick_, duel_delay_ticks_, rng_, events, food_changed, is_playable);
+  CollisionSystem::Run(snakes_, foods_, width_, height_, tick_, duel_delay_ticks_, rng_, events, food_changed, is_playable,
+                       &occupancy_);
+  end_phase(TickProfile::kCollision);
 
   foods_.erase(std::remove_if(foods_.begin(), foods_.end(), [&](const Food& f) {
                 return !is_playable(Vec2{f.x, f.y});
               }),
               foods_.end());
   SpawnSystem::Run(snakes_, foods_, food_count_, width_, height_, rng_, is_playable);
+  end_phase(TickProfile::kSpawn);
 
   const int64_t created_at = 0;
   for (const auto& e : events) {
@@ -244,9 +347,117 @@ void World::Tick() {
     world_chunk_dirty_ = true;
     ++world_version_;
   }
+  end_phase(TickProfile::kEvents);
 
   ++tick_;
   chunk_manager_.Rebuild(snakes_, foods_, obstacles_, tick_);
+  PublishSpatialLocked();
+  end_phase(TickProfile::kChunks);
+
+  prof.tick = tick_;
+  prof.total_ns = t_mark - t_start;
+  prof.snakes = static_cast<int>(snakes_.size());
+  prof.alive_snakes = 0;
+  prof.body_cells = 0;
+  for (const auto& s : snakes_) {
+    if (s.alive) ++prof.alive_snakes;
+    prof.body_cells += static_cast<int64_t>(s.body.size());
+  }
+  prof.foods = static_cast<int>(foods_.size());
+  prof.inputs = static_cast<int>(last_tick_inputs_.size());
+  prof.events = static_cast<int>(events.size());
+}
+
+TickProfile World::LastTickProfile() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return last_tick_profile_;
+}
+
+std::string World::EncodeBinarySnapshot() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::string out;
+  int64_t cells = 0;
+  for (const auto& s : snakes_) cells += static_cast<int64_t>(s.body.size());
+  // The mt19937 text state alone is ~7 KB.
+  out.reserve(8 * 1024 + snakes_.size() * 64 + static_cast<size_t>(cells) * 2 + foods_.size() * 4);
+  BinaryWriter w(out);
+  out.append("SNKW");
+  w.U32(1);
+  w.U64(tick_);
+  w.I64(world_version_);
+  w.I32(width_);
+  w.I32(height_);
+  w.I32(food_count_);
+  w.I32(max_snakes_per_user_);
+  w.I32(next_snake_id_);
+  w.I32(duel_delay_ticks_);
+  w.Str(mask_mode_);
+  w.Str(mask_style_);
+  w.I32(mask_seed_);
+  w.I64(playable_cells_target_);
+  std::ostringstream rng_state;
+  rng_state << rng_;
+  w.Str(rng_state.str());
+
+  w.Varint(snakes_.size());
+  for (const auto& s : snakes_) {
+    w.I32(s.id);
+    w.I32(s.user_id);
+    w.U8(static_cast<uint8_t>(s.dir));
+    w.U8(static_cast<uint8_t>((s.paused ? 1 : 0) | (s.alive ? 2 : 0) | (s.duel_pending ? 4 : 0)));
+    w.ZigZag(s.grow);
+    w.U64(s.last_loss_tick);
+    w.I32(s.duel_with_id);
+    w.U64(s.duel_resolve_tick);
+    w.Str(s.color);
+    w.Str(s.snake_name);
+    w.Varint(s.body.size());
+    Vec2 prev{0, 0};
+    for (const auto& c : s.body) {
+      w.ZigZag(c.x - prev.x);
+      w.ZigZag(c.y - prev.y);
+      prev = c;
+    }
+  }
+
+  w.Varint(foods_.size());
+  Vec2 prev{0, 0};
+  for (const auto& f : foods_) {
+    w.ZigZag(f.x - prev.x);
+    w.ZigZag(f.y - prev.y);
+    prev = Vec2{f.x, f.y};
+  }
+
+  w.Varint(obstacles_.size());
+  for (const auto& o : obstacles_) {
+    w.ZigZag(o.pos.x);
+    w.ZigZag(o.pos.y);
+  }
+
+  // Playable mask as alternating run lengths, starting with a run of 1s.
+  std::vector<uint64_t> runs;
+  uint8_t cur = 1;
+  uint64_t run = 0;
+  for (const uint8_t v : playable_mask_) {
+    const uint8_t b = v ? 1 : 0;
+    if (b != cur) {
+      runs.push_back(run);
+      cur = b;
+      run = 0;
+    }
+    ++run;
+  }
+  runs.push_back(run);
+  w.Varint(runs.size());
+  for (const uint64_t r : runs) w.Varint(r);
+
+  w.Varint(last_tick_inputs_.size());
+  for (const auto& [snake_id, intent] : last_tick_inputs_) {
+    w.I32(snake_id);
+    w.U8(static_cast<uint8_t>((intent.has_desired_dir ? 1 : 0) | (intent.toggle_pause ? 2 : 0)));
+    w.U8(static_cast<uint8_t>(intent.desired_dir));
+  }
+  return out;
 }
 
 uint64_t World::TickId() const {
@@ -329,6 +540,9 @@ void World::ConfigureChunking(int chunk_size, bool single_chunk_mode) {
   chunk_manager_.SetConfig(chunk_size, single_chunk_mode);
   chunk_manager_.SetWorldBounds(width_, height_);
   chunk_manager_.Rebuild(snakes_, foods_, obstacles_, tick_);
+  occupancy_chunk_size_ = single_chunk_mode ? 0 : std::max(8, chunk_size);
+  RebuildOccupancyLocked();
+  PublishSpatialLocked();
 }
 
 void World::SetDuelDelayTicks(int ticks) {
@@ -342,12 +556,16 @@ void World::ConfigureMask(const std::string& mode, int seed, const std::string&
   mask_seed_ = seed;
   mask_style_ = style.empty() ? "jagged" : style;
   RebuildPlayableMaskLocked();
+  occupancy_.RecountPlayable();
+  PublishSpatialLocked();
 }
 
 void World::SetPlayableCellTarget(int64_t playable_cells_target) {
   std::lock_guard<std::mutex> lock(mu_);
   playable_cells_target_ = playable_cells_target;
   RebuildPlayableMaskLocked();
+  occupancy_.RecountPlayable();
+  PublishSpatialLocked();
 }
 
 ChunkId World::CoordToChunk(int x, int y) const {
@@ -431,6 +649,8 @@ std::optional<int> World::CreateSnakeForUser(int user_id,
   s.body = {p};
   snakes_.push_back(s);
   chunk_manager_.Rebuild(snakes_, foods_, obstacles_, tick_);
+  occupancy_.Add(p);
+  PublishSpatialLocked();
 
   const int64_t now = static_cast<int64_t>(tick_);
   snake_created_at_ms_[s.id] = now;
@@ -457,11 +677,13 @@ std::optional<int> World::AttachCellsForUser(int user_id, int snake_id, int amou
   for (int i = 0; i < amount; ++i) {
     // Deterministic extension: append at tail position; movement spreads it naturally.
     s->body.push_back(tail);
+    occupancy_.Add(tail);
   }
   s->grow = 0;
   s->paused = false;
   MarkSnakeDirtyLocked(s->id);
   chunk_manager_.Rebuild(snakes_, foods_, obstacles_, tick_);
+  PublishSpatialLocked();
   return static_cast<int>(s->body.size());
 }
 
@@ -473,9 +695,11 @@ std::optional<int> World::DeleteSnakeForUser(int user_id, int snake_id) {
     const int refunded_cells = static_cast<int>(it->body.size());
     deleted_snake_ids_.insert(snake_id);
     dirty_snake_ids_.erase(snake_id);
+    occupancy_.RemoveBody(it->body);
     snakes_.erase(it);
     snake_created_at_ms_.erase(snake_id);
     chunk_manager_.Rebuild(snakes_, foods_, obstacles_, tick_);
+    PublishSpatialLocked();
     return std::max(0, refunded_cells);
   }
   return std::nullopt;
@@ -532,6 +756,8 @@ void World::ResizeWorld(int new_width, int new_height) {
   world_chunk_dirty_ = true;
   ++world_version_;
   chunk_manager_.Rebuild(snakes_, foods_, obstacles_, tick_);
+  RebuildOccupancyLocked();
+  PublishSpatialLocked();
 }
 
 PersistenceDelta World::DrainPersistenceDelta(int64_t ts_ms) {
@@ -550,20 +776,7 @@ PersistenceDelta World::DrainPersistenceDelta(int64_t ts_ms) {
     const Snake* s = FindSnakeLocked(sid);
     if (!s) continue;
 
-    storage::Snake out;
-    out.snake_id = std::to_string(s->id);
-    out.owner_user_id = std::to_string(s->user_id);
-    out.snake_name = s->snake_name;
-    out.snake_name_normalized = s->snake_name_normalized;
-    out.alive = s->alive;
-    out.is_on_field = s->alive;
-    out.head_x = s->body.empty() ? 0 : s->body[0].x;
-    out.head_y = s->body.empty() ? 0 : s->body[0].y;
-    out.direction = static_cast<int>(s->dir);
-    out.paused = s->paused;
-    out.length_k = static_cast<int>(s->body.size());
-    out.body_compact = EncodeBody(s->body);
-    out.color = s->color;
+    storage::Snake out = ToStorageSnake(*s);
     out.created_at = snake_created_at_ms_.count(sid) ? snake_created_at_ms_[sid] : ts_ms;
     out.updated_at = ts_ms;
 
@@ -633,6 +846,24 @@ std::string World::ColorForUser(int user_id) {
   return palette[static_cast<size_t>(user_id - 1) % palette.size()];
 }
 
+storage::Snake World::ToStorageSnake(const Snake& s) {
+  storage::Snake out;
+  out.snake_id = std::to_string(s.id);
+  out.owner_user_id = std::to_string(s.user_id);
+  out.snake_name = s.snake_name;
+  out.snake_name_normalized = s.snake_name_normalized;
+  out.alive = s.alive;
+  out.is_on_field = s.alive;
+  out.head_x = s.body.empty() ? 0 : s.body[0].x;
+  out.head_y = s.body.empty() ? 0 : s.body[0].y;
+  out.direction = static_cast<int>(s.dir);
+  out.paused = s.paused;
+  out.length_k = static_cast<int>(s.body.size());
+  out.body_compact = EncodeBody(s.body);
+  out.color = s.color;
+  return out;
+}
+
 std::string World::EncodeBody(const std::vector<Vec2>& body) {
   std::ostringstream out;
   out << "[";
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <mutex>
 #include <optional>
@@ -14,6 +16,7 @@
 #include "entities/food.h"
 #include "entities/obstacle.h"
 #include "entities/snake.h"
+#include "occupancy_grid.h"
 #include "systems/collision_system.h"
 #include "systems/movement_system.h"
 
@@ -32,6 +35,38 @@ struct WorldSnapshot {
   int64_t unplayable_cells = 0;
 };
 
+// Wall time spent in each phase of the last Tick(), plus the entity counts it
+// ran against. Filled on every tick; read by metrics and the slow-tick recorder.
+struct TickProfile {
+  enum Phase : int { kPrepare, kMovement, kCollision, kSpawn, kEvents, kChunks, kPhaseCount };
+  static const char* PhaseName(int phase);
+
+  uint64_t tick = 0;  // tick id the profiled step produced
+  std::array<int64_t, kPhaseCount> phase_ns{};
+  int64_t total_ns = 0;
+  int snakes = 0;
+  int alive_snakes = 0;
+  int64_t body_cells = 0;
+  int foods = 0;
+  int inputs = 0;
+  int events = 0;
+};
+
+// Spatial liquidity inputs, kept current by the world as bodies and the mask
+// change. Read without the world lock; fields come from one publish except
+// when a reader races a mutation, in which case they may straddle two.
+struct SpatialMetrics {
+  int64_t occupied_cells = 0;        // distinct in-bounds cells under snake bodies
+  int64_t playable_cells = 0;
+  int64_t free_playable_cells = 0;   // playable and not under a snake
+  uint64_t tick = 0;
+};
+
+struct ChunkOccupancy {
+  ChunkId chunk;
+  int32_t occupied_cells = 0;
+};
+
 struct PersistenceDelta {
   std::vector<storage::Snake> upsert_snakes;
   std::vector<std::string> delete_snake_ids;
@@ -96,6 +131,21 @@ class World {
 
   // Drains only meaningful state mutations (no per-tick movement writes).
   PersistenceDelta DrainPersistenceDelta(int64_t ts_ms);
+  // The persisted row for a snake, minus timestamps and the last event id.
+  static storage::Snake ToStorageSnake(const Snake& s);
+
+  // O(1), lock-free.
+  SpatialMetrics Spatial() const;
+  // Chunks with at least one occupied cell, on the replication chunk grid.
+  std::vector<ChunkOccupancy> OccupiedChunks() const;
+
+  TickProfile LastTickProfile() const;
+  // Compact little-endian dump of the simulation state for offline replay:
+  // "SNKW" u32 version, tick/world version, dimensions, spawn/duel settings,
+  // mask config, RNG state, snakes (bodies as zigzag-varint deltas), foods,
+  // obstacles, the playable mask as run lengths, and finally the input batch
+  // the last Tick() consumed. Taken under the world lock; not for hot paths.
+  std::string EncodeBinarySnapshot() const;
 
  private:
   static int ToInt(const std::string& s);
@@ -113,6 +163,9 @@ class World {
   bool IsPlayableLocked(const Vec2& p) const;
   void RebuildPlayableMaskLocked();
   bool HashJitterLess(int x, int y, uint32_t threshold) const;
+  // Recounts every body into occupancy_ (load, resize, chunk size change).
+  void RebuildOccupancyLocked();
+  void PublishSpatialLocked();
 
   mutable std::mutex mu_;
   int width_;
@@ -135,6 +188,9 @@ class World {
   int64_t playable_cells_count_ = 0;
 
   std::unordered_map<int, InputIntent> input_buffer_;
+  // Input batch consumed by the last Tick(); capacity is reused across ticks.
+  std::vector<std::pair<int, InputIntent>> last_tick_inputs_;
+  TickProfile last_tick_profile_;
   std::unordered_map<int, int64_t> snake_created_at_ms_;
   std::unordered_set<int> dirty_snake_ids_;
   std::unordered_set<int> deleted_snake_ids_;
@@ -150,6 +206,12 @@ class World {
 
   std::mt19937 rng_;
   ChunkManager chunk_manager_;
+  int occupancy_chunk_size_ = 0;  // 0 in single-chunk mode
+  OccupancyGrid occupancy_;
+  std::atomic<int64_t> spatial_occupied_{0};
+  std::atomic<int64_t> spatial_playable_{0};
+  std::atomic<int64_t> spatial_free_playable_{0};
+  std::atomic<uint64_t> spatial_tick_{0};
 };
 
 }  // namespace world
@@ -84,6 +84,21 @@ RuntimeConfig RuntimeConfig::FromEnv() {
   cfg.auth_aoi_radius = clamp_int(getenv_int("AUTH_AOI_RADIUS", cfg.auth_aoi_radius), 0, 16);
   cfg.aoi_pad_chunks = clamp_int(getenv_int("AOI_PAD_CHUNKS", cfg.aoi_pad_chunks), 0, 4);
   cfg.camera_msg_max_hz = clamp_int(getenv_int("CAMERA_MSG_MAX_HZ", cfg.camera_msg_max_hz), 1, 120);
+  cfg.ws_writer_threads = clamp_int(getenv_int("WS_WRITER_THREADS", cfg.ws_writer_threads), 1, 64);
+  cfg.ws_send_threads = clamp_int(getenv_int("WS_SEND_THREADS", cfg.ws_send_threads), 1, 64);
+  cfg.ws_max_pending_events = clamp_int(getenv_int("WS_MAX_PENDING_EVENTS", cfg.ws_max_pending_events), 8, 100000);
+  cfg.ws_slow_consumer_ms = clamp_int(getenv_int("WS_SLOW_CONSUMER_MS", cfg.ws_slow_consumer_ms), 250, 120000);
+  cfg.economy_broadcast_ms = clamp_int(getenv_int("ECONOMY_BROADCAST_MS", cfg.economy_broadcast_ms), 250, 60000);
+  cfg.user_cache_ttl_ms = clamp_int(getenv_int("USER_CACHE_TTL_MS", cfg.user_cache_ttl_ms), 1000, 3600000);
+  cfg.user_cache_max_entries =
+      clamp_int(getenv_int("USER_CACHE_MAX_ENTRIES", cfg.user_cache_max_entries), 100, 10000000);
+  cfg.session_ttl_seconds = clamp_int(getenv_int("SESSION_TTL_SECONDS", cfg.session_ttl_seconds), 30, 86400);
+  cfg.session_shards = clamp_int(getenv_int("SESSION_SHARDS", cfg.session_shards), 1, 256);
+  cfg.static_mmap_threshold_bytes =
+      clamp_int(getenv_int("STATIC_MMAP_THRESHOLD_BYTES", cfg.static_mmap_threshold_bytes), 4096, 1 << 30);
+  cfg.static_cache_max_age_seconds =
+      clamp_int(getenv_int("STATIC_CACHE_MAX_AGE_SECONDS", cfg.static_cache_max_age_seconds), 0, 31536000);
+  cfg.auth_token_ttl_seconds = clamp_int(getenv_int("AUTH_TOKEN_TTL_SECONDS", cfg.auth_token_ttl_seconds), 300, 2592000);
   cfg.max_borrow_per_call = clamp_int(getenv_int("MAX_BORROW_PER_CALL", cfg.max_borrow_per_call), 1, 100000000);
   cfg.food_reward_cells = clamp_int(getenv_int("FOOD_REWARD_CELLS", cfg.food_reward_cells), 1, 1000);
   cfg.resize_threshold = std::max(0.0, std::min(1.0, getenv_double("RESIZE_THRESHOLD", cfg.resize_threshold)));
@@ -139,6 +154,25 @@ RuntimeConfig RuntimeConfig::FromEnv() {
   cfg.persistence_debug_logging = getenv_bool("PERSISTENCE_DEBUG_LOGGING", cfg.persistence_debug_logging);
   cfg.google_auth_enabled = getenv_bool("GOOGLE_AUTH_ENABLED", cfg.google_auth_enabled);
   cfg.google_client_id = getenv_string("GOOGLE_CLIENT_ID", cfg.google_client_id);
+  cfg.google_jwks_url = getenv_string("GOOGLE_JWKS_URL", cfg.google_jwks_url);
+  cfg.google_jwks_file = getenv_string("GOOGLE_JWKS_FILE", cfg.google_jwks_file);
+  cfg.google_jwks_refresh_seconds =
+      clamp_int(getenv_int("GOOGLE_JWKS_REFRESH_SECONDS", cfg.google_jwks_refresh_seconds), 60, 86400);
+  cfg.flight_recorder_dir = getenv_string("FLIGHT_RECORDER_DIR", cfg.flight_recorder_dir);
+  cfg.flight_recorder_slow_tick_ms =
+      clamp_int(getenv_int("FLIGHT_RECORDER_SLOW_TICK_MS", cfg.flight_recorder_slow_tick_ms), 1, 60000);
+  cfg.flight_recorder_max_captures =
+      clamp_int(getenv_int("FLIGHT_RECORDER_MAX_CAPTURES", cfg.flight_recorder_max_captures), 0, 1000);
+  cfg.economy_reconcile_seconds =
+      clamp_int(getenv_int("ECONOMY_RECONCILE_SECONDS", cfg.economy_reconcile_seconds), 30, 86400);
+  cfg.economy_finalize_threads =
+      clamp_int(getenv_int("ECONOMY_FINALIZE_THREADS", cfg.economy_finalize_threads), 1, 64);
+  cfg.economy_user_cache_entries =
+      clamp_int(getenv_int("ECONOMY_USER_CACHE_ENTRIES", cfg.economy_user_cache_entries), 100, 1000000);
+  cfg.economy_history_dir = getenv_string("ECONOMY_HISTORY_DIR", cfg.economy_history_dir);
+  cfg.leaderboard_apply_ms = clamp_int(getenv_int("LEADERBOARD_APPLY_MS", cfg.leaderboard_apply_ms), 20, 10000);
+  cfg.cell_ledger_commit_ms = clamp_int(getenv_int("CELL_LEDGER_COMMIT_MS", cfg.cell_ledger_commit_ms), 0, 1000);
+  cfg.cell_ledger_wait_ms = clamp_int(getenv_int("CELL_LEDGER_WAIT_MS", cfg.cell_ledger_wait_ms), 0, 30000);
   cfg.starter_liquid_assets = static_cast<int64_t>(
       clamp_int(getenv_int("STARTER_LIQUID_ASSETS", static_cast<int>(cfg.starter_liquid_assets)), 1, 1000000));
   cfg.seed_enabled = getenv_bool("SEED_ENABLED", cfg.seed_enabled);
@@ -21,6 +21,18 @@ struct RuntimeConfig {
   int auth_aoi_radius = 2;
   int aoi_pad_chunks = 1;
   int camera_msg_max_hz = 10;
+  int ws_writer_threads = 4;
+  int ws_send_threads = 4;
+  int ws_max_pending_events = 256;
+  int ws_slow_consumer_ms = 5000;
+  int economy_broadcast_ms = 1000;
+  int user_cache_ttl_ms = 60000;
+  int user_cache_max_entries = 100000;
+  int session_ttl_seconds = 900;
+  int session_shards = 16;
+  int static_mmap_threshold_bytes = 262144;
+  int static_cache_max_age_seconds = 300;
+  int auth_token_ttl_seconds = 604800;
   int max_borrow_per_call = 1000000;
   int food_reward_cells = 1;
   double resize_threshold = 0.05;
@@ -51,6 +63,19 @@ struct RuntimeConfig {
   bool persistence_debug_logging = false;
   bool google_auth_enabled = true;
   std::string google_client_id;
+  std::string google_jwks_url = "https://www.googleapis.com/oauth2/v3/certs";
+  std::string google_jwks_file;
+  int google_jwks_refresh_seconds = 3600;
+  std::string flight_recorder_dir = "/var/lib/snake/flight";
+  int flight_recorder_slow_tick_ms = 200;
+  int flight_recorder_max_captures = 20;
+  int economy_reconcile_seconds = 300;
+  int economy_finalize_threads = 4;
+  int economy_user_cache_entries = 10000;
+  std::string economy_history_dir = "/var/lib/snake/economy_history";
+  int leaderboard_apply_ms = 250;
+  int cell_ledger_commit_ms = 10;
+  int cell_ledger_wait_ms = 2000;
   int64_t starter_liquid_assets = 25;
   bool seed_enabled = false;
   std::string seed_config_path;
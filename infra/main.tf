@@ -35,6 +35,25 @@ module "security" {
   tags          = local.tags
 }
 
+# Session token signing key, shared by every instance so tokens survive
+# restarts and verify behind the load balancer. Generated once; rotate by
+# writing a new value to the parameter (this invalidates issued tokens).
+resource "random_password" "auth_token_secret" {
+  length  = 48
+  special = false
+}
+
+resource "aws_ssm_parameter" "auth_token_secret" {
+  name  = "/${var.project}/${var.environment}/auth_token_secret"
+  type  = "SecureString"
+  value = random_password.auth_token_secret.result
+  tags  = local.tags
+
+  lifecycle {
+    ignore_changes = [value]
+  }
+}
+
 module "iam" {
   source = "./modules/iam"
 
@@ -54,6 +73,9 @@ module "iam" {
 
   cloudwatch_log_group_arn = module.observability.log_group_arn
 
+  # Secrets read by user-data and deploys:
+  ssm_parameter_arns = [aws_ssm_parameter.auth_token_secret.arn]
+
   # Needed for EIP attach in user-data:
   allow_eip_association = true
 }
@@ -93,6 +115,8 @@ module "compute" {
   app_git_ref      = var.app_git_ref
   app_build_target = var.app_build_target
   app_listen_port  = var.app_control_port
+
+  auth_token_secret_param = aws_ssm_parameter.auth_token_secret.name
   app_env = merge(var.app_env, {
     AWS_REGION                              = var.aws_region
     DYNAMO_REGION                           = var.aws_region
@@ -12,6 +12,8 @@ data "aws_ami" "al2023_arm" {
   }
 }
 
+data "aws_region" "current" {}
+
 resource "aws_eip" "this" {
   count  = var.allocate_eip ? 1 : 0
   domain = "vpc"
@@ -33,6 +35,8 @@ locals {
     app_build_target   = var.app_build_target
     app_port           = tostring(var.app_listen_port)
     env_lines          = local.env_lines
+    aws_region         = data.aws_region.current.name
+    auth_secret_param  = var.auth_token_secret_param
     eip_allocation_id  = var.allocate_eip ? aws_eip.this[0].allocation_id : ""
     cwagent_config_b64 = base64encode(local.cwagent_config_rendered)
     domain_name        = var.domain_name
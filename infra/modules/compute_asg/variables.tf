@@ -25,6 +25,8 @@ variable "app_git_ref" { type = string }
 variable "app_build_target" { type = string }
 variable "app_listen_port" { type = number }
 variable "app_env" { type = map(string) }
+# SecureString parameter holding AUTH_TOKEN_SECRET; read on the instance.
+variable "auth_token_secret_param" { type = string }
 variable "allow_ssh" { type = bool }
 variable "ssh_key_name" {
   type     = string
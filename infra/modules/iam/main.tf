@@ -55,6 +55,11 @@ resource "aws_iam_role_policy" "inline" {
     Statement = concat(
       jsondecode(data.aws_iam_policy_document.ddb.json).Statement,
       jsondecode(data.aws_iam_policy_document.cwlogs.json).Statement,
+      length(var.ssm_parameter_arns) > 0 ? [{
+        Effect   = "Allow"
+        Action   = ["ssm:GetParameter"]
+        Resource = var.ssm_parameter_arns
+      }] : [],
       var.allow_eip_association ? [{
         Effect = "Allow"
         Action = [
@@ -9,6 +9,11 @@ variable "cloudwatch_log_group_arn" {
   type = string
 }
 
+variable "ssm_parameter_arns" {
+  type    = list(string)
+  default = []
+}
+
 variable "allow_eip_association" {
   type    = bool
   default = true
@@ -66,6 +66,7 @@ SEED_ENABLED="${SEED_ENABLED:-false}"
 SEED_CONFIG_PATH="${SEED_CONFIG_PATH:-}"
 APP_ENV="${APP_ENV:-prod}"
 ADMIN_TOKEN="${ADMIN_TOKEN:-change-me}"
+AUTH_SECRET_PARAM_NAME="${AUTH_SECRET_PARAM_NAME:-/${PROJECT_TAG}/${ENVIRONMENT_TAG}/auth_token_secret}"
 POLL_ATTEMPTS="${POLL_ATTEMPTS:-20}"
 POLL_SLEEP_SECONDS="${POLL_SLEEP_SECONDS:-15}"
 SSM_POLL_ATTEMPTS="${SSM_POLL_ATTEMPTS:-20}"
@@ -182,7 +183,7 @@ COMMAND_ID="$(
     --comment "snake deploy from ${APP_REF}" \
     --parameters "commands=[
 \"set -euo pipefail\",
-\"dnf -y install git clang boost-devel cmake gcc-c++ libcurl-devel openssl-devel zlib-devel sqlite-devel python3 >/dev/null\",
+\"dnf -y install git clang boost-devel cmake gcc-c++ libcurl-devel openssl-devel zlib-devel brotli-devel sqlite-devel python3 >/dev/null\",
 \"if [ ! -f /usr/local/lib64/libaws-cpp-sdk-dynamodb.so ] && [ ! -f /usr/local/lib/libaws-cpp-sdk-dynamodb.so ]; then if [ ! -d /opt/aws-sdk-cpp ]; then git clone --depth 1 --branch 1.11.676 --recurse-submodules https://github.com/aws/aws-sdk-cpp.git /opt/aws-sdk-cpp; else cd /opt/aws-sdk-cpp; git fetch --tags --force; git checkout 1.11.676; git submodule sync --recursive; git submodule update --init --recursive; fi; cmake -S /opt/aws-sdk-cpp -B /opt/aws-sdk-cpp/build -DBUILD_ONLY='dynamodb' -DCMAKE_BUILD_TYPE=Release -DENABLE_TESTING=OFF >/dev/null; cmake --build /opt/aws-sdk-cpp/build -j2 >/dev/null; cmake --install /opt/aws-sdk-cpp/build >/dev/null; echo -e '/usr/local/lib64\\n/usr/local/lib' >/etc/ld.so.conf.d/aws-sdk-cpp.conf; ldconfig || true; fi\",
 \"mkdir -p /opt/snake\",
 \"if [ ! -d /opt/snake/repo/.git ]; then rm -rf /opt/snake/repo; git clone '${APP_GIT_REPO}' /opt/snake/repo; fi\",
@@ -200,7 +201,7 @@ COMMAND_ID="$(
 \"chmod 644 /var/www/snake/index.html || true\",
 \"if [ -d /var/www/snake/src ]; then find /var/www/snake/src -type d -exec chmod 755 {} \\;; find /var/www/snake/src -type f -exec chmod 644 {} \\;; fi\",
 \"if [ -d /var/www/snake/assets ]; then find /var/www/snake/assets -type d -exec chmod 755 {} \\;; find /var/www/snake/assets -type f -exec chmod 644 {} \\;; fi\",
-\"clang++ -std=c++17 -O2 -pthread ${BUILD_TARGET} api/protocol/encode_json.cpp api/storage/dynamo_storage.cpp api/storage/storage_factory.cpp api/economy/economy_v1.cpp api/economy/stabilization_engine.cpp api/economy_engine/compute.cpp api/persistence/profiles/persistence_profiles.cpp api/persistence/layers/runtime/runtime_state_store.cpp api/persistence/layers/sqlite/buffered_sqlite_store.cpp api/persistence/layers/dynamo/permanent_dynamo_store.cpp api/persistence/coordinator/persistence_coordinator.cpp api/persistence/flush/flush_scheduler.cpp config/runtime_config.cpp api/world/world.cpp api/world/chunk_manager.cpp api/world/entities/snake.cpp api/world/entities/food.cpp api/world/systems/movement_system.cpp api/world/systems/collision_system.cpp api/world/systems/spawn_system.cpp api/world/systems/replication_system.cpp -o /opt/snake/snake_server -lboost_system -lsqlite3 -laws-cpp-sdk-dynamodb -laws-cpp-sdk-core -L/usr/local/lib64 -L/usr/local/lib\",
+\"clang++ -std=c++17 -O2 -pthread ${BUILD_TARGET} api/auth/id_token_verifier.cpp api/auth/session_tokens.cpp api/diagnostics/flight_recorder.cpp api/diagnostics/tracer.cpp api/metrics/metrics.cpp api/protocol/encode_json.cpp api/protocol/json_reader.cpp api/protocol/json_writer.cpp api/realtime/broadcast_hub.cpp api/realtime/message_ring.cpp api/realtime/send_queue.cpp api/realtime/session_registry.cpp api/realtime/snapshot_feed.cpp api/storage/dynamo_storage.cpp api/storage/storage_factory.cpp api/storage/user_cache_storage.cpp api/web/static_asset_cache.cpp api/economy/cell_ledger.cpp api/economy/economy_aggregates.cpp api/economy/economy_batch.cpp api/economy/economy_flush_pipeline.cpp api/economy/economy_history.cpp api/economy/economy_snapshot_cache.cpp api/economy/economy_v1.cpp api/economy/period_finalizer.cpp api/economy/stabilization_engine.cpp api/economy_engine/compute.cpp api/leaderboard/leaderboard_service.cpp api/leaderboard/rank_tree.cpp api/persistence/profiles/persistence_profiles.cpp api/persistence/layers/runtime/runtime_state_store.cpp api/persistence/layers/sqlite/buffered_sqlite_store.cpp api/persistence/layers/dynamo/permanent_dynamo_store.cpp api/persistence/coordinator/persistence_coordinator.cpp api/persistence/flush/flush_scheduler.cpp config/runtime_config.cpp api/world/world.cpp api/world/chunk_manager.cpp api/world/occupancy_grid.cpp api/world/entities/snake.cpp api/world/entities/food.cpp api/world/systems/movement_system.cpp api/world/systems/collision_system.cpp api/world/systems/spawn_system.cpp api/world/systems/replication_system.cpp -o /opt/snake/snake_server -lboost_system -lsqlite3 -laws-cpp-sdk-dynamodb -laws-cpp-sdk-core -lz -lbrotlienc -lcrypto -L/usr/local/lib64 -L/usr/local/lib\",
 \"mkdir -p $(dirname ${PERSISTENCE_SQLITE_PATH})\",
 \"cat > /etc/snake.env <<'EOF_ENV'\",
 \"AWS_REGION=${REGION}\",
@@ -278,6 +279,8 @@ COMMAND_ID="$(
 \"APP_ENV=${APP_ENV}\",
 \"ADMIN_TOKEN=${ADMIN_TOKEN}\",
 \"EOF_ENV\",
+\"aws ssm get-parameter --region ${REGION} --name ${AUTH_SECRET_PARAM_NAME} --with-decryption --query Parameter.Value --output text | sed 's/^/AUTH_TOKEN_SECRET=/' >> /etc/snake.env\",
+\"if ! grep -q '^AUTH_TOKEN_SECRET=.' /etc/snake.env; then echo Missing AUTH_TOKEN_SECRET in ${AUTH_SECRET_PARAM_NAME}; exit 1; fi\",
 \"chmod 0644 /etc/snake.env\",
 \"if [ -f /opt/snake/repo/tools/apply_seed_config.py ]; then set -a; . /etc/snake.env; set +a; python3 /opt/snake/repo/tools/apply_seed_config.py; else echo Missing /opt/snake/repo/tools/apply_seed_config.py; exit 1; fi\",
 \"if [ -f /opt/snake/repo/tools/snakecli.py ]; then install -m 0755 /opt/snake/repo/tools/snakecli.py /usr/local/bin/snakecli; else echo Missing /opt/snake/repo/tools/snakecli.py; exit 1; fi\",
@@ -0,0 +1,142 @@
+// Checks economy::ComputeUsersBatch against the scalar economy::ComputeUser
+// field by field, then times both over the same users (single thread).
+// Build/run: make bench-economy-batch [BENCH_ARGS="<users> <iters>"]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../api/economy/economy_batch.h"
+#include "../../api/economy/economy_v1.h"
+
+namespace {
+
+constexpr double kRelTolerance = 1e-12;
+
+struct Population {
+  std::vector<std::string> ids;
+  std::vector<economy::EconomyPeriodRaw> raw;
+  std::vector<std::optional<economy::EconomyUserSnapshot>> prev;
+  std::vector<int64_t> balance;
+  economy::UserColumns columns;
+  int64_t global_y = 0;
+};
+
+// Mix of idle users, bootstrap users (no closing snapshot) and users whose
+// output or capital shrank, so every clamp and select is exercised.
+Population MakePopulation(size_t n, double alpha_default, uint32_t seed) {
+  std::mt19937_64 rng(seed);
+  auto pick = [&](int64_t lo, int64_t hi) { return std::uniform_int_distribution<int64_t>(lo, hi)(rng); };
+  Population p;
+  p.ids.reserve(n);
+  p.raw.resize(n);
+  p.prev.resize(n);
+  p.balance.resize(n);
+  p.columns.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    p.ids.push_back(std::to_string(100000 + i));
+    auto& r = p.raw[i];
+    const bool idle = pick(0, 9) == 0;
+    r.harvested_food = idle ? 0 : pick(0, 5000);
+    r.real_output = pick(0, 3) == 0 ? 0 : r.harvested_food + pick(-50, 500);
+    r.movement_ticks = idle ? 0 : pick(0, 200000);
+    r.deployed_cells = pick(0, 4) == 0 ? 0 : pick(1, 2000);
+    r.alpha_bootstrap_default = alpha_default;
+    if (pick(0, 3) != 0) {
+      economy::EconomyUserSnapshot prev;
+      prev.y_u = pick(0, 6000);
+      prev.k_u = pick(0, 2500);
+      p.prev[i] = prev;
+    }
+    p.balance[i] = pick(0, 1000);
+
+    const int64_t effective_y = r.real_output > 0 ? r.real_output : r.harvested_food;
+    p.columns.y[i] = effective_y;
+    p.columns.k[i] = r.deployed_cells;
+    p.columns.l[i] = r.movement_ticks;
+    p.columns.has_prev[i] = p.prev[i].has_value() ? 1 : 0;
+    p.columns.prev_y[i] = p.prev[i] ? p.prev[i]->y_u : 0;
+    p.columns.prev_k[i] = p.prev[i] ? p.prev[i]->k_u : 0;
+    p.global_y += std::max<int64_t>(0, effective_y);
+  }
+  return p;
+}
+
+bool Close(double a, double b) {
+  if (a == b) return true;
+  return std::fabs(a - b) <= kRelTolerance * std::max(std::fabs(a), std::fabs(b));
+}
+
+double RelError(double a, double b) {
+  const double scale = std::max(std::fabs(a), std::fabs(b));
+  return scale == 0.0 ? 0.0 : std::fabs(a - b) / scale;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t users = argc > 1 ? static_cast<size_t>(std::max(1L, std::atol(argv[1]))) : 1000000;
+  const int iters = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+  const double alpha_default = 0.35;
+  const std::string period_id = "p1";
+  const auto pop = MakePopulation(users, alpha_default, 42);
+
+  std::vector<economy::EconomyUserSnapshot> scalar(users);
+  economy::UserResultColumns batch;
+  batch.resize(users);
+
+  double scalar_ms = 1e300;
+  double batch_ms = 1e300;
+  for (int it = 0; it < iters; ++it) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < users; ++i) {
+      scalar[i] = economy::ComputeUser(pop.raw[i], pop.prev[i] ? &*pop.prev[i] : nullptr, pop.balance[i],
+                                       pop.global_y, period_id, pop.ids[i]);
+    }
+    scalar_ms = std::min(
+        scalar_ms, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    start = std::chrono::steady_clock::now();
+    economy::ComputeUsersBatch(pop.columns, pop.global_y, alpha_default, batch, 0, users);
+    batch_ms = std::min(
+        batch_ms, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  double max_alpha_err = 0.0;
+  double max_a_err = 0.0;
+  double max_share_err = 0.0;
+  for (size_t i = 0; i < users; ++i) {
+    const auto& s = scalar[i];
+    const bool ints_match = s.y_u == batch.y[i] && s.k_u == batch.k[i] && s.l_u == batch.l[i] &&
+                            s.alpha_bootstrap == (batch.alpha_bootstrap[i] != 0);
+    if (!ints_match || !Close(s.alpha_u, batch.alpha[i]) || !Close(s.a_u, batch.a[i]) ||
+        !Close(s.market_share, batch.market_share[i])) {
+      std::fprintf(stderr,
+                   "mismatch user=%s y=%lld/%lld k=%lld/%lld l=%lld/%lld bootstrap=%d/%d alpha=%.17g/%.17g "
+                   "a=%.17g/%.17g share=%.17g/%.17g\n",
+                   pop.ids[i].c_str(), static_cast<long long>(s.y_u), static_cast<long long>(batch.y[i]),
+                   static_cast<long long>(s.k_u), static_cast<long long>(batch.k[i]), static_cast<long long>(s.l_u),
+                   static_cast<long long>(batch.l[i]), s.alpha_bootstrap ? 1 : 0, batch.alpha_bootstrap[i],
+                   s.alpha_u, batch.alpha[i], s.a_u, batch.a[i], s.market_share, batch.market_share[i]);
+      return 1;
+    }
+    max_alpha_err = std::max(max_alpha_err, RelError(s.alpha_u, batch.alpha[i]));
+    max_a_err = std::max(max_a_err, RelError(s.a_u, batch.a[i]));
+    max_share_err = std::max(max_share_err, RelError(s.market_share, batch.market_share[i]));
+  }
+
+  std::printf("users=%zu iters=%d (best of)\n", users, iters);
+  std::printf("%-8s %12s %14s\n", "path", "ms", "users/s");
+  std::printf("%-8s %12.2f %14.0f\n", "scalar", scalar_ms, static_cast<double>(users) / (scalar_ms / 1000.0));
+  std::printf("%-8s %12.2f %14.0f\n", "batch", batch_ms, static_cast<double>(users) / (batch_ms / 1000.0));
+  std::printf("speedup %.2fx\n", scalar_ms / batch_ms);
+  std::printf("parity ok: max rel error alpha=%.3g A=%.3g market_share=%.3g (tolerance %.0e)\n", max_alpha_err,
+              max_a_err, max_share_err, kRelTolerance);
+  return 0;
+}
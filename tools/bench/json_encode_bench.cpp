@@ -0,0 +1,145 @@
+// Compares snapshot JSON encode throughput of the JsonWriter path against the
+// previous ostringstream encoder. Build/run: make bench-json
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../api/protocol/encode_json.h"
+#include "../../api/protocol/json_writer.h"
+
+namespace {
+
+std::string legacy_json_escape(const std::string& in) {
+  std::ostringstream out;
+  for (unsigned char c : in) {
+    switch (c) {
+      case '\"': out << "\\\""; break;
+      case '\\': out << "\\\\"; break;
+      case '\b': out << "\\b"; break;
+      case '\f': out << "\\f"; break;
+      case '\n': out << "\\n"; break;
+      case '\r': out << "\\r"; break;
+      case '\t': out << "\\t"; break;
+      default:
+        if (c < 0x20) {
+          out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        } else {
+          out << static_cast<char>(c);
+        }
+    }
+  }
+  return out.str();
+}
+
+void legacy_vec2_array(std::ostringstream& out, const std::vector<protocol::Vec2>& points) {
+  out << "[";
+  for (size_t i = 0; i < points.size(); ++i) {
+    out << "{\"x\":" << points[i].x << ",\"y\":" << points[i].y << "}";
+    if (i + 1 < points.size()) out << ",";
+  }
+  out << "]";
+}
+
+std::string legacy_encode_snapshot_json(const protocol::Snapshot& s) {
+  std::ostringstream out;
+  out << "{\"tick\":" << s.tick << ",\"w\":" << s.w << ",\"h\":" << s.h << ",\"foods\":";
+  legacy_vec2_array(out, s.foods);
+  out << ",\"snakes\":[";
+  for (size_t i = 0; i < s.snakes.size(); ++i) {
+    const auto& snake = s.snakes[i];
+    out << "{\"id\":" << snake.id << ",\"user_id\":" << snake.user_id << ",\"color\":\""
+        << legacy_json_escape(snake.color) << "\",\"dir\":" << snake.dir
+        << ",\"paused\":" << (snake.paused ? "true" : "false") << ",\"body\":";
+    legacy_vec2_array(out, snake.body);
+    out << "}";
+    if (i + 1 < s.snakes.size()) out << ",";
+  }
+  out << "]}";
+  return out.str();
+}
+
+protocol::Snapshot make_snapshot(int snakes, int body_len, int foods) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> coord(0, 999);
+  protocol::Snapshot s;
+  s.tick = 123456;
+  s.w = 1000;
+  s.h = 1000;
+  for (int i = 0; i < foods; ++i) s.foods.push_back({coord(rng), coord(rng)});
+  for (int i = 0; i < snakes; ++i) {
+    protocol::SnakeState st;
+    st.id = i + 1;
+    st.user_id = (i % 50) + 1;
+    st.color = "#00ffaa";
+    st.dir = 1 + (i % 4);
+    st.paused = (i % 7) == 0;
+    for (int j = 0; j < body_len; ++j) st.body.push_back({coord(rng), coord(rng)});
+    s.snakes.push_back(std::move(st));
+  }
+  return s;
+}
+
+template <typename Fn>
+double run_mb_per_s(Fn&& fn, int iters, size_t& bytes_out) {
+  size_t bytes = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; ++i) bytes += fn();
+  const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  bytes_out = bytes / static_cast<size_t>(iters);
+  return (static_cast<double>(bytes) / (1024.0 * 1024.0)) / sec;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int iters = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+  struct Case {
+    const char* name;
+    int snakes;
+    int body_len;
+    int foods;
+  };
+  const Case cases[] = {{"small", 8, 6, 4}, {"medium", 64, 24, 32}, {"large", 512, 40, 256}};
+
+  std::printf("%-8s %10s %14s %14s %8s\n", "case", "bytes", "legacy MB/s", "writer MB/s", "speedup");
+  for (const auto& c : cases) {
+    const auto snap = make_snapshot(c.snakes, c.body_len, c.foods);
+    if (legacy_encode_snapshot_json(snap) != protocol::encode_snapshot_json(snap)) {
+      std::fprintf(stderr, "output mismatch for case %s\n", c.name);
+      return 1;
+    }
+    const int n = std::max(1, iters / (c.snakes / 8));
+    size_t bytes = 0;
+    const double legacy = run_mb_per_s([&] { return legacy_encode_snapshot_json(snap).size(); }, n, bytes);
+    const double writer = run_mb_per_s(
+        [&] {
+          protocol::JsonWriter w;
+          protocol::encode_snapshot_json(w, snap);
+          return w.size();
+        },
+        n,
+        bytes);
+    std::printf("%-8s %10zu %14.1f %14.1f %7.2fx\n", c.name, bytes, legacy, writer, writer / legacy);
+  }
+
+  const double values[] = {0.0, 1.0, 0.5, -2.25, 1234567.891, 1e-9, 3.14159265358979};
+  for (double v : values) {
+    std::ostringstream ref;
+    ref << std::fixed << std::setprecision(6) << v;
+    std::string r = ref.str();
+    while (!r.empty() && r.back() == '0') r.pop_back();
+    if (!r.empty() && r.back() == '.') r.push_back('0');
+    if (r != protocol::JsonNumber(v)) {
+      std::fprintf(stderr, "number mismatch: %s vs %s\n", r.c_str(), protocol::JsonNumber(v).c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,171 @@
+// Compares WS/REST request parsing throughput of protocol::JsonFields against
+// the previous per-field substring helpers (single thread, so msgs/s per core).
+// Build/run: make bench-json-parse
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../../api/protocol/json_reader.h"
+
+namespace {
+
+std::optional<std::string> legacy_string_field(const std::string& body, const std::string& key) {
+  const std::string pat = "\"" + key + "\"";
+  size_t p = body.find(pat);
+  if (p == std::string::npos) return std::nullopt;
+  p = body.find(':', p);
+  if (p == std::string::npos) return std::nullopt;
+  ++p;
+  while (p < body.size() && isspace(static_cast<unsigned char>(body[p]))) ++p;
+  if (p >= body.size() || body[p] != '"') return std::nullopt;
+  ++p;
+  size_t e = body.find('"', p);
+  if (e == std::string::npos) return std::nullopt;
+  return body.substr(p, e - p);
+}
+
+std::optional<int> legacy_int_field(const std::string& body, const std::string& key) {
+  const std::string pat = "\"" + key + "\"";
+  size_t p = body.find(pat);
+  if (p == std::string::npos) return std::nullopt;
+  p = body.find(':', p);
+  if (p == std::string::npos) return std::nullopt;
+  ++p;
+  while (p < body.size() && isspace(static_cast<unsigned char>(body[p]))) ++p;
+  size_t e = p;
+  while (e < body.size() && (isdigit(static_cast<unsigned char>(body[e])) || body[e] == '-')) ++e;
+  if (e == p) return std::nullopt;
+  return std::stoi(body.substr(p, e - p));
+}
+
+std::optional<double> legacy_double_field(const std::string& body, const std::string& key) {
+  const std::string pat = "\"" + key + "\"";
+  size_t p = body.find(pat);
+  if (p == std::string::npos) return std::nullopt;
+  p = body.find(':', p);
+  if (p == std::string::npos) return std::nullopt;
+  ++p;
+  while (p < body.size() && isspace(static_cast<unsigned char>(body[p]))) ++p;
+  size_t e = p;
+  while (e < body.size() && (isdigit(static_cast<unsigned char>(body[e])) || body[e] == '.' || body[e] == '-' ||
+                             body[e] == 'e' || body[e] == 'E' || body[e] == '+')) {
+    ++e;
+  }
+  if (e == p) return std::nullopt;
+  return std::stod(body.substr(p, e - p));
+}
+
+std::optional<bool> legacy_bool_field(const std::string& body, const std::string& key) {
+  const std::string pat = "\"" + key + "\"";
+  size_t p = body.find(pat);
+  if (p == std::string::npos) return std::nullopt;
+  p = body.find(':', p);
+  if (p == std::string::npos) return std::nullopt;
+  ++p;
+  while (p < body.size() && isspace(static_cast<unsigned char>(body[p]))) ++p;
+  if (body.compare(p, 4, "true") == 0) return true;
+  if (body.compare(p, 5, "false") == 0) return false;
+  return std::nullopt;
+}
+
+// Mirrors the WS reader: type first, then the fields of that message type.
+long legacy_handle(const std::string& msg) {
+  const auto type = legacy_string_field(msg, "type");
+  if (!type) return 0;
+  if (*type == "input") {
+    const auto snake_id = legacy_int_field(msg, "snake_id");
+    const auto dir = legacy_string_field(msg, "dir");
+    const auto pause = legacy_bool_field(msg, "pause_toggle");
+    return snake_id.value_or(0) + (dir ? (*dir)[0] : 0) + (pause.value_or(false) ? 1 : 0);
+  }
+  const auto x = legacy_int_field(msg, "x");
+  const auto y = legacy_int_field(msg, "y");
+  const auto zoom = legacy_double_field(msg, "zoom");
+  const auto follow = legacy_int_field(msg, "follow_snake_id");
+  return x.value_or(0) + y.value_or(0) + static_cast<long>(zoom.value_or(0) * 100) + follow.value_or(0);
+}
+
+long fields_handle(const std::string& msg) {
+  const protocol::JsonFields f(msg);
+  const auto type = f.GetStringView("type");
+  if (!type) return 0;
+  if (*type == "input") {
+    const auto snake_id = f.GetInt("snake_id");
+    const auto dir = f.GetStringView("dir");
+    const auto pause = f.GetBool("pause_toggle");
+    return snake_id.value_or(0) + (dir ? (*dir)[0] : 0) + (pause.value_or(false) ? 1 : 0);
+  }
+  const auto x = f.GetInt("x");
+  const auto y = f.GetInt("y");
+  const auto zoom = f.GetDouble("zoom");
+  const auto follow = f.GetInt("follow_snake_id");
+  return x.value_or(0) + y.value_or(0) + static_cast<long>(zoom.value_or(0) * 100) + follow.value_or(0);
+}
+
+template <typename Fn>
+double run_msgs_per_s(Fn&& fn, const std::vector<std::string>& msgs, int iters, long& checksum) {
+  long sum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; ++i) {
+    for (const auto& m : msgs) sum += fn(m);
+  }
+  const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  checksum = sum;
+  return static_cast<double>(msgs.size()) * static_cast<double>(iters) / sec;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int iters = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200000;
+  struct Case {
+    const char* name;
+    std::vector<std::string> msgs;
+  };
+  const Case cases[] = {
+      {"input", {R"({"type":"input","snake_id":17,"dir":"L"})", R"({"type":"input","snake_id":17,"pause_toggle":true})"}},
+      {"camera",
+       {R"({"type":"camera_set","x":412,"y":233,"zoom":1.25,"follow_snake_id":17})",
+        R"({"type":"camera_set","x":12,"y":980,"zoom":0.5})"}},
+      {"mixed",
+       {R"({"type":"input","snake_id":3,"dir":"U"})", R"({"type":"camera_set","x":40,"y":41,"zoom":2.0})",
+        R"({"type":"input","snake_id":3,"dir":"D"})", R"({"type":"camera_set","x":41,"y":41,"zoom":2.0})"}},
+  };
+
+  std::printf("%-8s %16s %16s %8s\n", "case", "legacy msgs/s", "fields msgs/s", "speedup");
+  for (const auto& c : cases) {
+    for (const auto& m : c.msgs) {
+      if (legacy_handle(m) != fields_handle(m)) {
+        std::fprintf(stderr, "result mismatch for %s\n", m.c_str());
+        return 1;
+      }
+    }
+    long legacy_sum = 0;
+    long fields_sum = 0;
+    const double legacy = run_msgs_per_s(legacy_handle, c.msgs, iters, legacy_sum);
+    const double fields = run_msgs_per_s(fields_handle, c.msgs, iters, fields_sum);
+    if (legacy_sum != fields_sum) {
+      std::fprintf(stderr, "checksum mismatch for case %s\n", c.name);
+      return 1;
+    }
+    std::printf("%-8s %16.0f %16.0f %7.2fx\n", c.name, legacy, fields, fields / legacy);
+  }
+
+  const protocol::JsonFields escaped(R"({"name":"a\"b\\cé😀","n":-3.9e1,"nested":{"k":[1,2,"}"]},"ok":false})");
+  if (!escaped.ok() || escaped.GetString("name") != std::string("a\"b\\c\xc3\xa9\xf0\x9f\x98\x80") ||
+      escaped.GetStringView("name").has_value() || escaped.GetInt("n") != -39 || escaped.GetBool("ok") != false ||
+      !escaped.Find("nested")) {
+    std::fprintf(stderr, "escape/nesting check failed\n");
+    return 1;
+  }
+  if (protocol::JsonFields(R"({"type":"input",)").ok() || protocol::JsonFields("[1,2]").ok()) {
+    std::fprintf(stderr, "malformed input accepted\n");
+    return 1;
+  }
+  return 0;
+}
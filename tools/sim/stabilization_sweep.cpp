@@ -0,0 +1,461 @@
+// Offline what-if runs of the stabilization engine. Replays per-period demand
+// (recorded economy history, a CSV, or a synthetic curve) through the same
+// EvaluateFastSpatialCheck / EvaluatePeriodClose calls the server makes, once
+// per config in a parameter grid, spread over all cores. Prints one summary
+// row per config; --trajectories also writes the per-period series.
+// Build/run: make sim-stabilization SIM_ARGS="--demand logistic --grid target_lcr=1.0,1.2,1.5"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../../api/economy/economy_history.h"
+#include "../../api/economy/economy_v1.h"
+#include "../../api/economy/stabilization_engine.h"
+
+namespace {
+
+struct PeriodInput {
+  int64_t k = 0;  // deployed capital at period close
+  int64_t y = 0;
+  int64_t l = 0;
+};
+
+struct Options {
+  std::string history_dir;
+  std::string csv_path;
+  std::string demand = "logistic";  // linear|exp|logistic|cycle
+  int periods = 288;
+  int period_seconds = 300;
+  int64_t k0 = 1000;
+  int64_t k_max = 20000;
+  double growth = 0.03;
+  int64_t m0 = 0;       // 0: from the input, else k0
+  int64_t field0 = 0;   // 0: k0 * (1 + default target_spatial_ratio)
+  int k_lend = storage::EconomyParams{}.k_land;
+  double aspect_ratio = 16.0 / 9.0;
+  int threads = 0;
+  std::string trajectories_path;
+  std::vector<std::pair<std::string, std::vector<double>>> grid;
+};
+
+struct Step {
+  int period = 0;
+  int64_t k = 0;
+  int64_t field_size = 0;
+  int64_t world_area = 0;
+  int64_t money_supply = 0;
+  double lcr = 0.0;
+  double spatial_ratio = 0.0;
+  double p = 0.0;
+  double pi = 0.0;
+  const char* action = "";
+};
+
+struct Outcome {
+  int64_t expansions = 0;
+  int64_t expanded_cells = 0;
+  int64_t field_size = 0;
+  int64_t world_area = 0;
+  int64_t money_expansions = 0;
+  int64_t money_supply = 0;
+  int64_t constrained_checks = 0;
+  int64_t checks = 0;
+  double min_lcr = 0.0;
+  double final_lcr = 0.0;
+  std::vector<Step> steps;
+};
+
+// Same rounding as the server's world resize.
+std::pair<int64_t, int64_t> DimsFromArea(int64_t area, double aspect_ratio) {
+  const int64_t safe_area = std::max<int64_t>(100, area);
+  const double safe_aspect = aspect_ratio > 0.1 ? aspect_ratio : 16.0 / 9.0;
+  int64_t width = std::max<int64_t>(10, static_cast<int64_t>(std::ceil(std::sqrt(static_cast<double>(safe_area) * safe_aspect))));
+  int64_t height = std::max<int64_t>(10, static_cast<int64_t>(std::ceil(static_cast<double>(safe_area) / static_cast<double>(width))));
+  while (width * height < safe_area) ++height;
+  return {width, height};
+}
+
+bool SetParam(economy::StabilizationConfig& cfg, const std::string& name, double v) {
+  if (name == "auto_expansion_trigger_ratio") {
+    cfg.auto_expansion_trigger_ratio = v;
+  } else if (name == "target_spatial_ratio") {
+    cfg.target_spatial_ratio = v;
+  } else if (name == "auto_expansion_checks_per_period") {
+    cfg.auto_expansion_checks_per_period = std::max(1, static_cast<int>(v));
+  } else if (name == "target_lcr") {
+    cfg.target_lcr = v;
+  } else if (name == "lcr_stress_threshold") {
+    cfg.lcr_stress_threshold = v;
+  } else if (name == "max_auto_money_growth") {
+    cfg.max_auto_money_growth = v;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::vector<economy::StabilizationConfig> ExpandGrid(const Options& opt) {
+  std::vector<economy::StabilizationConfig> out{economy::StabilizationConfig{}};
+  for (const auto& [name, values] : opt.grid) {
+    std::vector<economy::StabilizationConfig> next;
+    next.reserve(out.size() * values.size());
+    for (const auto& base : out) {
+      for (double v : values) {
+        auto cfg = base;
+        SetParam(cfg, name, v);
+        next.push_back(cfg);
+      }
+    }
+    out = std::move(next);
+  }
+  return out;
+}
+
+std::vector<PeriodInput> SyntheticDemand(const Options& opt) {
+  std::vector<PeriodInput> out(static_cast<size_t>(std::max(1, opt.periods)));
+  const double k0 = static_cast<double>(std::max<int64_t>(1, opt.k0));
+  const double k_max = std::max(k0, static_cast<double>(opt.k_max));
+  for (size_t i = 0; i < out.size(); ++i) {
+    const double t = static_cast<double>(i + 1);
+    double k = k0;
+    if (opt.demand == "linear") {
+      k = k0 * (1.0 + opt.growth * t);
+    } else if (opt.demand == "exp") {
+      k = k0 * std::pow(1.0 + opt.growth, t);
+    } else if (opt.demand == "cycle") {
+      // Daily swing of +-50% around k0, assuming 5-minute periods.
+      k = k0 * (1.0 + 0.5 * std::sin(2.0 * M_PI * t / 288.0));
+    } else {
+      k = k_max / (1.0 + (k_max / k0 - 1.0) * std::exp(-opt.growth * t));
+    }
+    out[i].k = static_cast<int64_t>(std::llround(k));
+    out[i].y = out[i].k;
+    out[i].l = out[i].k;
+  }
+  return out;
+}
+
+std::vector<std::string> SplitCsv(const std::string& line) {
+  std::vector<std::string> out;
+  std::stringstream ss(line);
+  std::string cell;
+  while (std::getline(ss, cell, ',')) {
+    cell.erase(0, cell.find_first_not_of(" \t\r"));
+    cell.erase(cell.find_last_not_of(" \t\r") + 1);
+    out.push_back(cell);
+  }
+  return out;
+}
+
+// Header row names the columns: K (required), Y, L, M (first row seeds M0).
+bool LoadCsv(const std::string& path, std::vector<PeriodInput>& out, int64_t* m0) {
+  std::ifstream in(path);
+  std::string line;
+  if (!in || !std::getline(in, line)) return false;
+  const auto header = SplitCsv(line);
+  int col_k = -1, col_y = -1, col_l = -1, col_m = -1;
+  for (size_t i = 0; i < header.size(); ++i) {
+    std::string h = header[i];
+    std::transform(h.begin(), h.end(), h.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    if (h == "K") col_k = static_cast<int>(i);
+    if (h == "Y") col_y = static_cast<int>(i);
+    if (h == "L") col_l = static_cast<int>(i);
+    if (h == "M") col_m = static_cast<int>(i);
+  }
+  if (col_k < 0) return false;
+  const auto at = [](const std::vector<std::string>& row, int col) -> int64_t {
+    if (col < 0 || static_cast<size_t>(col) >= row.size() || row[static_cast<size_t>(col)].empty()) return -1;
+    return std::llround(std::atof(row[static_cast<size_t>(col)].c_str()));
+  };
+  while (std::getline(in, line)) {
+    const auto row = SplitCsv(line);
+    if (row.empty() || at(row, col_k) < 0) continue;
+    PeriodInput p;
+    p.k = at(row, col_k);
+    p.y = std::max<int64_t>(0, at(row, col_y) < 0 ? p.k : at(row, col_y));
+    p.l = std::max<int64_t>(0, at(row, col_l) < 0 ? p.k : at(row, col_l));
+    if (out.empty() && *m0 == 0 && at(row, col_m) > 0) *m0 = at(row, col_m);
+    out.push_back(p);
+  }
+  return !out.empty();
+}
+
+// Finalized periods recorded by the server (ECONOMY_HISTORY_DIR), one bucket
+// per period. Point it at a copy when the server is running.
+bool LoadHistory(const Options& opt, std::vector<PeriodInput>& out, int64_t* m0) {
+  economy::EconomyHistoryStore store({opt.history_dir, 36500});
+  const auto stats = store.stats();
+  if (stats.global_rows == 0) return false;
+  economy::EconomyHistoryStore::Query q;
+  q.series = economy::EconomyHistoryStore::Series::kGlobal;
+  q.step_us = static_cast<int64_t>(std::max(60, opt.period_seconds)) * 1000000;
+  q.to_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count() +
+            q.step_us;
+  q.from_us = std::max(stats.oldest_us, q.to_us - static_cast<int64_t>(economy::EconomyHistoryStore::kMaxBuckets) * q.step_us);
+  const auto res = store.Run(q);
+  const auto column = [&](const char* name) -> const std::vector<economy::EconomyHistoryStore::Bucket>* {
+    for (size_t i = 0; i < res.names.size(); ++i) {
+      if (res.names[i] == name) return &res.buckets[i];
+    }
+    return nullptr;
+  };
+  const auto* k = column("K");
+  const auto* y = column("Y");
+  const auto* l = column("L");
+  const auto* m = column("M");
+  if (!k || k->empty()) return false;
+  // Every column gets a bucket for each row, so bucket i lines up across columns.
+  for (size_t i = 0; i < k->size(); ++i) {
+    PeriodInput p;
+    p.k = std::llround((*k)[i].avg);
+    p.y = y && i < y->size() ? std::llround((*y)[i].avg) : p.k;
+    p.l = l && i < l->size() ? std::llround((*l)[i].avg) : p.k;
+    out.push_back(p);
+  }
+  if (*m0 == 0 && m && !m->empty()) *m0 = std::llround(m->front().avg);
+  return true;
+}
+
+Outcome Simulate(const economy::StabilizationConfig& cfg,
+                 const std::vector<PeriodInput>& periods,
+                 const Options& opt,
+                 bool keep_steps) {
+  economy::StabilizationEngine engine(cfg);
+  Outcome out;
+  out.field_size = opt.field0;
+  const auto dims = DimsFromArea(out.field_size, opt.aspect_ratio);
+  out.world_area = dims.first * dims.second;
+  out.money_supply = opt.m0;
+  out.min_lcr = 1e300;
+  economy::EconomySnapshot prev;
+  const int checks = std::max(1, cfg.auto_expansion_checks_per_period);
+  if (keep_steps) out.steps.reserve(periods.size());
+
+  for (size_t p = 0; p < periods.size(); ++p) {
+    const int64_t k_from = p == 0 ? periods[0].k : periods[p - 1].k;
+    const int64_t k_to = periods[p].k;
+    // Fast checks, with demand moving linearly between period closes.
+    for (int c = 1; c <= checks; ++c) {
+      const int64_t k = k_from + (k_to - k_from) * c / checks;
+      const auto d = engine.Derive(out.money_supply, opt.k_lend, k, out.field_size,
+                                   std::max<int64_t>(0, out.field_size - k));
+      const auto decision = engine.EvaluateFastSpatialCheck(d);
+      ++out.checks;
+      if (decision.should_expand && decision.required_expansion_cells > 0) {
+        const int64_t target = out.field_size + decision.required_expansion_cells;
+        if (target > out.world_area) {
+          const auto grown = DimsFromArea(target, opt.aspect_ratio);
+          out.world_area = grown.first * grown.second;
+        }
+        out.expanded_cells += target - out.field_size;
+        out.field_size = target;
+        ++out.expansions;
+        engine.OnSpatialExpansionApplied();
+      }
+      if (engine.runtime_state().liquidity_constraint_mode_active) ++out.constrained_checks;
+    }
+
+    const std::string period_id = "sim" + std::to_string(p);
+    const auto d = engine.Derive(out.money_supply, opt.k_lend, k_to, out.field_size,
+                                 std::max<int64_t>(0, out.field_size - k_to));
+    const auto close = engine.EvaluatePeriodClose(period_id, d, out.money_supply);
+    if (close.should_expand_money) {
+      out.money_supply += close.actual_money_expansion;
+      ++out.money_expansions;
+    }
+    out.min_lcr = std::min(out.min_lcr, d.lcr);
+    out.final_lcr = d.lcr;
+
+    economy::EconomyPeriodRaw raw;
+    raw.real_output = periods[p].y;
+    raw.movement_ticks = periods[p].l;
+    raw.deployed_cells = k_to;
+    const auto global = economy::ComputeGlobal(raw, p == 0 ? nullptr : &prev, out.money_supply, 0);
+    prev = global;
+    if (keep_steps) {
+      Step s;
+      s.period = static_cast<int>(p);
+      s.k = k_to;
+      s.field_size = out.field_size;
+      s.world_area = out.world_area;
+      s.money_supply = out.money_supply;
+      s.lcr = d.lcr;
+      s.spatial_ratio = d.spatial_ratio_r;
+      s.p = global.p;
+      s.pi = global.pi;
+      s.action = close.should_expand_money ? "monetary_expansion" : "no_adjustment";
+      out.steps.push_back(s);
+    }
+    engine.ResetForNewPeriod();
+  }
+  if (periods.empty()) out.min_lcr = 0.0;
+  return out;
+}
+
+void Usage() {
+  std::cerr
+      << "usage: stabilization_sweep [input] [--grid name=v1,v2,...]... [options]\n"
+         "input (default: synthetic logistic demand):\n"
+         "  --history DIR        finalized periods from an ECONOMY_HISTORY_DIR copy\n"
+         "  --csv FILE           one row per period; header names K (required), Y, L, M\n"
+         "  --demand linear|exp|logistic|cycle  --periods N --k0 N --k-max N --growth R\n"
+         "grid names: auto_expansion_trigger_ratio target_spatial_ratio\n"
+         "  auto_expansion_checks_per_period target_lcr lcr_stress_threshold max_auto_money_growth\n"
+         "options: --period-seconds N --m0 N --field0 N --k-lend N --aspect R --threads N\n"
+         "  --trajectories FILE  per-period CSV for every config\n";
+}
+
+bool ParseArgs(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (i + 1 >= argc) return false;
+    const std::string v = argv[++i];
+    if (a == "--history") {
+      opt.history_dir = v;
+    } else if (a == "--csv") {
+      opt.csv_path = v;
+    } else if (a == "--demand") {
+      opt.demand = v;
+    } else if (a == "--periods") {
+      opt.periods = std::atoi(v.c_str());
+    } else if (a == "--period-seconds") {
+      opt.period_seconds = std::atoi(v.c_str());
+    } else if (a == "--k0") {
+      opt.k0 = std::atoll(v.c_str());
+    } else if (a == "--k-max") {
+      opt.k_max = std::atoll(v.c_str());
+    } else if (a == "--growth") {
+      opt.growth = std::atof(v.c_str());
+    } else if (a == "--m0") {
+      opt.m0 = std::atoll(v.c_str());
+    } else if (a == "--field0") {
+      opt.field0 = std::atoll(v.c_str());
+    } else if (a == "--k-lend") {
+      opt.k_lend = std::max(1, std::atoi(v.c_str()));
+    } else if (a == "--aspect") {
+      opt.aspect_ratio = std::atof(v.c_str());
+    } else if (a == "--threads") {
+      opt.threads = std::atoi(v.c_str());
+    } else if (a == "--trajectories") {
+      opt.trajectories_path = v;
+    } else if (a == "--grid") {
+      const size_t eq = v.find('=');
+      if (eq == std::string::npos) return false;
+      const std::string name = v.substr(0, eq);
+      economy::StabilizationConfig probe;
+      if (!SetParam(probe, name, 0.0)) {
+        std::cerr << "unknown grid parameter: " << name << "\n";
+        return false;
+      }
+      std::vector<double> values;
+      for (const auto& s : SplitCsv(v.substr(eq + 1))) {
+        if (!s.empty()) values.push_back(std::atof(s.c_str()));
+      }
+      if (values.empty()) return false;
+      opt.grid.emplace_back(name, std::move(values));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!ParseArgs(argc, argv, opt)) {
+    Usage();
+    return 2;
+  }
+
+  std::vector<PeriodInput> periods;
+  if (!opt.history_dir.empty()) {
+    if (!LoadHistory(opt, periods, &opt.m0)) {
+      std::cerr << "no finalized periods in " << opt.history_dir << "\n";
+      return 1;
+    }
+  } else if (!opt.csv_path.empty()) {
+    if (!LoadCsv(opt.csv_path, periods, &opt.m0)) {
+      std::cerr << "cannot read periods from " << opt.csv_path << "\n";
+      return 1;
+    }
+  } else {
+    periods = SyntheticDemand(opt);
+  }
+  const int64_t k_first = std::max<int64_t>(1, periods.front().k);
+  if (opt.m0 <= 0) opt.m0 = k_first;
+  if (opt.field0 <= 0) {
+    opt.field0 = static_cast<int64_t>(
+        std::ceil(static_cast<double>(k_first) * (1.0 + economy::StabilizationConfig{}.target_spatial_ratio)));
+  }
+
+  const auto configs = ExpandGrid(opt);
+  const bool keep_steps = !opt.trajectories_path.empty();
+  std::vector<Outcome> outcomes(configs.size());
+  const size_t threads = std::min<size_t>(
+      configs.size(),
+      static_cast<size_t>(opt.threads > 0 ? opt.threads : std::max(1u, std::thread::hardware_concurrency())));
+  const auto started = std::chrono::steady_clock::now();
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < threads; ++t) {
+    pool.emplace_back([&] {
+      for (size_t i = next.fetch_add(1); i < configs.size(); i = next.fetch_add(1)) {
+        outcomes[i] = Simulate(configs[i], periods, opt, keep_steps);
+      }
+    });
+  }
+  for (auto& th : pool) th.join();
+  const double elapsed_ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+  const auto dims0 = DimsFromArea(opt.field0, opt.aspect_ratio);
+  const double area0 = static_cast<double>(dims0.first * dims0.second);
+  std::printf(
+      "config,auto_expansion_trigger_ratio,target_spatial_ratio,auto_expansion_checks_per_period,target_lcr,"
+      "lcr_stress_threshold,max_auto_money_growth,expansions,expanded_cells,field_size,world_area_growth,"
+      "money_expansions,money_supply,money_growth,min_lcr,final_lcr,constrained_check_share\n");
+  for (size_t i = 0; i < configs.size(); ++i) {
+    const auto& c = configs[i];
+    const auto& o = outcomes[i];
+    std::printf("%zu,%g,%g,%d,%g,%g,%g,%lld,%lld,%lld,%.4f,%lld,%lld,%.4f,%.4f,%.4f,%.4f\n", i,
+                c.auto_expansion_trigger_ratio, c.target_spatial_ratio, c.auto_expansion_checks_per_period,
+                c.target_lcr, c.lcr_stress_threshold, c.max_auto_money_growth, static_cast<long long>(o.expansions),
+                static_cast<long long>(o.expanded_cells), static_cast<long long>(o.field_size),
+                static_cast<double>(o.world_area) / area0, static_cast<long long>(o.money_expansions),
+                static_cast<long long>(o.money_supply),
+                static_cast<double>(o.money_supply) / static_cast<double>(opt.m0), o.min_lcr, o.final_lcr,
+                o.checks > 0 ? static_cast<double>(o.constrained_checks) / static_cast<double>(o.checks) : 0.0);
+  }
+
+  if (keep_steps) {
+    std::ofstream traj(opt.trajectories_path);
+    traj << "config,period,K,field_size,world_area,M,lcr,spatial_ratio,P,pi,action\n";
+    for (size_t i = 0; i < outcomes.size(); ++i) {
+      for (const auto& s : outcomes[i].steps) {
+        traj << i << ',' << s.period << ',' << s.k << ',' << s.field_size << ',' << s.world_area << ','
+             << s.money_supply << ',' << s.lcr << ',' << s.spatial_ratio << ',' << s.p << ',' << s.pi << ','
+             << s.action << '\n';
+      }
+    }
+  }
+
+  std::cerr << configs.size() << " configs x " << periods.size() << " periods in " << elapsed_ms << " ms on "
+            << threads << " threads (M0=" << opt.m0 << ", field0=" << opt.field0 << ", k_lend=" << opt.k_lend
+            << ")\n";
+  return 0;
+}